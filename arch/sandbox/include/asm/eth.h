@@ -61,6 +61,83 @@ int sandbox_eth_recv_arp_req(struct udevice *dev);
  */
 int sandbox_eth_recv_ping_req(struct udevice *dev);
 
+/*
+ * sandbox_eth_nd_req_to_reply()
+ *
+ * Check for an IPv6 neighbour solicitation to be sent. If so, inject an
+ * advertisement giving the fake host's MAC address
+ *
+ * @dev: device that received the packet
+ * @packet: pointer to the received pacaket buffer
+ * @len: length of received packet
+ * Return: 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_nd_req_to_reply(struct udevice *dev, void *packet,
+				unsigned int len);
+
+/*
+ * sandbox_eth_ping6_req_to_reply()
+ *
+ * Check for an ICMPv6 echo request to be sent. If so, inject a reply
+ *
+ * @dev: device that received the packet
+ * @packet: pointer to the received pacaket buffer
+ * @len: length of received packet
+ * Return: 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_ping6_req_to_reply(struct udevice *dev, void *packet,
+				   unsigned int len);
+
+/*
+ * sandbox_eth_rs_to_ra()
+ *
+ * Check for an IPv6 router solicitation to be sent. If so, inject an
+ * advertisement of the fake host as the router for the prefix 2001:db8::/64
+ *
+ * @dev: device that received the packet
+ * @packet: pointer to the received pacaket buffer
+ * @len: length of received packet
+ * Return: 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_rs_to_ra(struct udevice *dev, void *packet, unsigned int len);
+
+/*
+ * sandbox_eth_tftp_req_to_reply()
+ *
+ * Act as a TFTP server, over IPv4 or IPv6, for the file set by
+ * sandbox_eth_set_tftp_file(). A read request is answered with an option
+ * acknowledgement for the block size, file size and starting offset, and each
+ * acknowledgement with the next block. Several transfers can run at once, each
+ * answered from its own port. A request for the 'multicast' option joins the
+ * multicast transfer set up in struct sb_tftp_mcast, if there is one.
+ *
+ * @dev: device that received the packet
+ * @packet: pointer to the received pacaket buffer
+ * @len: length of received packet
+ * Return: 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_tftp_req_to_reply(struct udevice *dev, void *packet,
+				  unsigned int len);
+
+/* Address and lease time given by sandbox_eth_dhcp_req_to_reply() */
+#define SB_DHCP_ADDR		"1.1.2.100"
+#define SB_DHCP_LEASE		3600
+
+/*
+ * sandbox_eth_dhcp_req_to_reply()
+ *
+ * Act as a DHCP server, offering the address SB_DHCP_ADDR in answer to a
+ * discover. A request for that address is acknowledged and any other is
+ * refused.
+ *
+ * @dev: device that received the packet
+ * @packet: pointer to the received pacaket buffer
+ * @len: length of received packet
+ * Return: 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_dhcp_req_to_reply(struct udevice *dev, void *packet,
+				  unsigned int len);
+
 /**
  * A packet handler
  *
@@ -71,6 +148,63 @@ int sandbox_eth_recv_ping_req(struct udevice *dev);
 typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
 				   unsigned int len);
 
+/* Number of transfers which the sandbox TFTP server can handle at once */
+#define SB_TFTP_SESSIONS	8
+
+/**
+ * struct sb_tftp_session - a transfer by the sandbox TFTP server
+ *
+ * port - UDP port of the client, 0 if unused
+ * offset - offset in the file of the first block, from the 'offset' option
+ * block_size - block size agreed with the client
+ */
+struct sb_tftp_session {
+	int port;
+	int offset;
+	int block_size;
+};
+
+/* Port to which the sandbox TFTP server sends multicast data */
+#define SB_TFTP_MCAST_PORT	1758
+
+/**
+ * struct sb_tftp_mcast - a multicast transfer by the sandbox TFTP server
+ *
+ * This follows RFC 2090. Simulated clients which joined the group before the
+ * real one receive the file without loss, the first of them acknowledging each
+ * block as master, as the real client's packets are polled for. Once they have
+ * the whole file the real client is made master, so that it can ask for what
+ * it is missing.
+ *
+ * group - group to send the file to, 0 to not offer multicast
+ * others - number of simulated clients
+ * first - first block sent after the real client joins
+ * loss - every loss'th block sent while a simulated client is master does not
+ *	  reach the real client, 0 for none
+ * block_size - block size agreed with the real client
+ * port - UDP port of the real client, 0 if it is not in the group
+ * hwaddr - MAC address of the real client
+ * ip - IP address of the real client
+ * master - true if the real client is master
+ * next - next block for the simulated master to be sent
+ * sent - number of data packets sent to the group
+ * acks - number of acknowledgements from the real client
+ */
+struct sb_tftp_mcast {
+	struct in_addr group;
+	int others;
+	int first;
+	int loss;
+	int block_size;
+	int port;
+	uchar hwaddr[ARP_HLEN];
+	struct in_addr ip;
+	bool master;
+	int next;
+	int sent;
+	int acks;
+};
+
 /**
  * struct eth_sandbox_priv - memory for sandbox mock driver
  *
@@ -82,6 +216,16 @@ typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
  * recv_packets - number of packets returned
  * tx_handler - function to generate responses to sent packets
  * priv - a pointer to some structure a test may want to keep track of
+ * lent_buf - buffer lent for the next received packet, if any
+ * lent_size - size of lent_buf
+ * tftp_data - contents of the file served over TFTP
+ * tftp_size - size of the file served over TFTP
+ * tftp_sessions - TFTP transfers in progress
+ * tftp_mcast - multicast TFTP transfer
+ * mcast_groups - number of multicast groups joined
+ * offload - ETH_OFFLOAD_... flags for the offloads to claim. With
+ *	     ETH_OFFLOAD_RX_CSUM every received packet is reported as having a
+ *	     good checksum, without this being checked
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
@@ -92,6 +236,14 @@ struct eth_sandbox_priv {
 	int recv_packets;
 	sandbox_eth_tx_hand_f *tx_handler;
 	void *priv;
+	uchar *lent_buf;
+	int lent_size;
+	const void *tftp_data;
+	int tftp_size;
+	struct sb_tftp_session tftp_sessions[SB_TFTP_SESSIONS];
+	struct sb_tftp_mcast tftp_mcast;
+	int mcast_groups;
+	int offload;
 };
 
 /*
@@ -108,4 +260,19 @@ void sandbox_eth_set_tx_handler(int index, sandbox_eth_tx_hand_f *handler);
  */
 void sandbox_eth_set_priv(int index, void *priv);
 
+/*
+ * Set the file served over TFTP
+ *
+ * data - contents of the file, NULL to stop serving it
+ * size - size of the file
+ */
+void sandbox_eth_set_tftp_file(int index, const void *data, int size);
+
+/*
+ * Set the offloads which the device claims to do
+ *
+ * offload - ETH_OFFLOAD_... flags
+ */
+void sandbox_eth_set_offload(int index, int offload);
+
 #endif /* __ETH_H */
@@ -379,6 +379,9 @@ static efi_status_t do_bootefi_exec(efi_handle_t handle, void *load_options)
 
 	efi_restore_gd();
 
+	/* U-Boot may write to the disks before the next payload is started */
+	efi_disk_free_caches();
+
 out:
 	free(load_options);
 
@@ -472,6 +475,7 @@ efi_status_t efi_run_image(void *source_buffer, efi_uintn_t source_size)
 	efi_handle_t mem_handle = NULL, handle;
 	struct efi_device_path *file_path = NULL;
 	struct efi_device_path *msg_path;
+	struct efi_handler *handler;
 	efi_status_t ret;
 	u16 *load_options;
 
@@ -511,9 +515,26 @@ efi_status_t efi_run_image(void *source_buffer, efi_uintn_t source_size)
 				      source_size, &handle));
 	if (ret != EFI_SUCCESS) {
 		log_err("Loading image failed\n");
+		/* It may have been partly relocated in place */
+		if (IS_ENABLED(CONFIG_EFI_LOADER_IN_PLACE) &&
+		    source_buffer == image_addr)
+			efi_clear_bootdev();
 		goto out;
 	}
 
+	/*
+	 * An image relocated in place has been modified. Forget it so that it
+	 * is not started again.
+	 */
+	if (source_buffer == image_addr &&
+	    efi_search_protocol(handle, &efi_guid_loaded_image,
+				&handler) == EFI_SUCCESS) {
+		struct efi_loaded_image *info = handler->protocol_interface;
+
+		if (info->image_base == source_buffer)
+			efi_clear_bootdev();
+	}
+
 	/* Transfer environment variable as load options */
 	ret = efi_env_set_load_options(handle, "bootargs", &load_options);
 	if (ret != EFI_SUCCESS)
@@ -6,6 +6,8 @@
 #include <common.h>
 #include <bootstage.h>
 #include <command.h>
+#include <env.h>
+#include <mapmem.h>
 
 static int do_bootstage_report(struct cmd_tbl *cmdtp, int flag, int argc,
 			       char *const argv[])
@@ -59,10 +61,40 @@ static int do_bootstage_stash(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static int do_bootstage_export(struct cmd_tbl *cmdtp, int flag, int argc,
+			       char *const argv[])
+{
+	ulong base, size;
+	char *buf;
+	int ret;
+
+	if (get_base_size(argc, argv, &base, &size))
+		return CMD_RET_USAGE;
+	if (!base || base == -1UL) {
+		printf("No bootstage stash area defined\n");
+		return CMD_RET_FAILURE;
+	}
+
+	buf = map_sysmem(base, size);
+	ret = bootstage_export_json(buf, size);
+	unmap_sysmem(buf);
+	if (ret == -ENOSPC) {
+		printf("Not enough space to export bootstage data\n");
+		return CMD_RET_FAILURE;
+	} else if (ret < 0) {
+		printf("No bootstage data to export\n");
+		return CMD_RET_FAILURE;
+	}
+	env_set_hex("filesize", ret);
+
+	return 0;
+}
+
 static struct cmd_tbl cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+	U_BOOT_CMD_MKENT(export, 4, 0, do_bootstage_export, "", ""),
 };
 
 /*
@@ -92,5 +124,7 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
-	"unstash [<start> [<size>]]  - Unstash data from memory"
+	"unstash [<start> [<size>]]  - Unstash data from memory\n"
+	"export [<start> [<size>]]   - Export data to memory as JSON, setting\n"
+	"                              'filesize'"
 );
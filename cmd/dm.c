@@ -19,7 +19,14 @@
 static int do_dm_dump_all(struct cmd_tbl *cmdtp, int flag, int argc,
 			  char *const argv[])
 {
-	dm_dump_all();
+	bool verbose = false;
+
+	if (argc > 0) {
+		if (strcmp(argv[0], "-v"))
+			return CMD_RET_USAGE;
+		verbose = true;
+	}
+	dm_dump_all(verbose);
 
 	return 0;
 }
@@ -64,13 +71,26 @@ static int do_dm_dump_static_driver_info(struct cmd_tbl *cmdtp, int flag, int ar
 	return 0;
 }
 
+static int do_dm_dump_probe_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+				  char *const argv[])
+{
+	if (!CONFIG_IS_ENABLED(DM_PROBE_STATS)) {
+		printf("Probe statistics are not enabled (CONFIG_DM_PROBE_STATS)\n");
+		return CMD_RET_FAILURE;
+	}
+	dm_dump_probe_stats();
+
+	return 0;
+}
+
 static struct cmd_tbl test_commands[] = {
-	U_BOOT_CMD_MKENT(tree, 0, 1, do_dm_dump_all, "", ""),
+	U_BOOT_CMD_MKENT(tree, 1, 1, do_dm_dump_all, "", ""),
 	U_BOOT_CMD_MKENT(uclass, 1, 1, do_dm_dump_uclass, "", ""),
 	U_BOOT_CMD_MKENT(devres, 1, 1, do_dm_dump_devres, "", ""),
 	U_BOOT_CMD_MKENT(drivers, 1, 1, do_dm_dump_drivers, "", ""),
 	U_BOOT_CMD_MKENT(compat, 1, 1, do_dm_dump_driver_compat, "", ""),
 	U_BOOT_CMD_MKENT(static, 1, 1, do_dm_dump_static_driver_info, "", ""),
+	U_BOOT_CMD_MKENT(stats, 1, 1, do_dm_dump_probe_stats, "", ""),
 };
 
 static __maybe_unused void dm_reloc(void)
@@ -109,10 +129,12 @@ static int do_dm(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 U_BOOT_CMD(
 	dm,	3,	1,	do_dm,
 	"Driver model low level access",
-	"tree          Dump driver model tree ('*' = activated)\n"
+	"tree [-v]     Dump driver model tree ('*' = activated, -v adds heap\n"
+	"                 usage of each probe)\n"
 	"dm uclass        Dump list of instances for each uclass\n"
 	"dm devres        Dump list of device resources for each device\n"
 	"dm drivers       Dump list of drivers with uclass and instances\n"
 	"dm compat        Dump list of drivers with compatibility strings\n"
-	"dm static        Dump list of drivers with static platform data"
+	"dm static        Dump list of drivers with static platform data\n"
+	"dm stats         Dump heap usage of each probed device"
 );
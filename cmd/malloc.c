@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Command-line access to malloc() heap statistics
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <malloc_arena.h>
+#include <malloc_profile.h>
+
+static uint frag_percent(ulong largest, ulong free)
+{
+	return free ? 100 - largest * 100 / free : 0;
+}
+
+static void show_arenas(void)
+{
+#if CONFIG_IS_ENABLED(MALLOC_ARENA)
+	struct malloc_arena *arena;
+	struct malloc_arena_stats *st;
+
+	if (list_empty(malloc_arena_list()))
+		return;
+
+	printf("\n%-12s %8s %10s %10s %10s %10s %6s %5s\n", "Arena", "Allocs",
+	       "In use", "Peak", "Held", "Peak held", "Slabs", "Frag");
+	list_for_each_entry(arena, malloc_arena_list(), sibling) {
+		st = &arena->stats;
+		printf("%-12s %8lu %10lu %10lu %10lu %10lu %6u %4u%%\n",
+		       arena->name, st->allocs, st->in_use, st->peak, st->held,
+		       st->peak_held, st->slabs,
+		       st->held ? (uint)((st->held - st->in_use) * 100 /
+					 st->held) : 0);
+	}
+#endif
+}
+
+static int do_malloc_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	ulong heap = mem_malloc_end - mem_malloc_start;
+	struct mallinfo info = mallinfo();
+	ulong free_bytes, largest;
+
+	/* The space above the break is free and adjoins the top chunk */
+	free_bytes = heap - info.uordblks;
+	largest = max((ulong)malloc_max_free(),
+		      info.keepcost + mem_malloc_end - mem_malloc_brk);
+
+	printf("Heap:    %10lu bytes at %lx\n", heap, mem_malloc_start);
+	printf("In use:  %10lu bytes\n", (ulong)info.uordblks);
+	printf("Peak:    %10lu bytes\n", (ulong)info.usmblks);
+	printf("Free:    %10lu bytes in %lu chunks, largest %lu\n", free_bytes,
+	       (ulong)info.ordblks, largest);
+	printf("Fragmentation: %u%%\n", frag_percent(largest, free_bytes));
+	show_arenas();
+
+	return 0;
+}
+
+#if CONFIG_IS_ENABLED(MALLOC_PROFILE)
+static int do_malloc_dump(struct cmd_tbl *cmdtp, int flag, int argc,
+			  char *const argv[])
+{
+	malloc_profile_dump();
+
+	return 0;
+}
+
+static int do_malloc_top(struct cmd_tbl *cmdtp, int flag, int argc,
+			 char *const argv[])
+{
+	int count = 10;
+
+	if (argc > 1)
+		count = dectoul(argv[1], NULL);
+	malloc_profile_top(count);
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_SYS_LONGHELP
+static char malloc_help_text[] =
+	"stats - show heap usage and fragmentation, and that of each arena"
+#if CONFIG_IS_ENABLED(MALLOC_PROFILE)
+	"\nmalloc dump - list live allocations with their callers\n"
+	"malloc top [<n>] - show the <n> call sites holding the most memory"
+#endif
+	;
+#endif
+
+#if CONFIG_IS_ENABLED(MALLOC_PROFILE)
+U_BOOT_CMD_WITH_SUBCMDS(malloc, "malloc() heap information", malloc_help_text,
+	U_BOOT_SUBCMD_MKENT(dump, 1, 1, do_malloc_dump),
+	U_BOOT_SUBCMD_MKENT(stats, 1, 1, do_malloc_stats),
+	U_BOOT_SUBCMD_MKENT(top, 2, 1, do_malloc_top));
+#else
+U_BOOT_CMD_WITH_SUBCMDS(malloc, "malloc() heap information", malloc_help_text,
+	U_BOOT_SUBCMD_MKENT(stats, 1, 1, do_malloc_stats));
+#endif
@@ -14,11 +14,22 @@
 #include <env.h>
 #include <image.h>
 #include <net.h>
+#include <net6.h>
 #include <net/udp.h>
 #include <net/sntp.h>
 
 static int netboot_common(enum proto_t, struct cmd_tbl *, int, char * const []);
 
+#ifdef CONFIG_IPV6
+#define NETBOOT_MAXARGS		4
+#define NETBOOT_IP6_HELP(cmd) \
+	"\n" cmd " -6 [loadAddress] [[[hostIP6addr]:]bootfilename]\n" \
+	"    - the same, over IPv6"
+#else
+#define NETBOOT_MAXARGS		3
+#define NETBOOT_IP6_HELP(cmd)	""
+#endif
+
 #ifdef CONFIG_CMD_BOOTP
 static int do_bootp(struct cmd_tbl *cmdtp, int flag, int argc,
 		    char *const argv[])
@@ -45,9 +56,10 @@ int do_tftpb(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 }
 
 U_BOOT_CMD(
-	tftpboot,	3,	1,	do_tftpb,
+	tftpboot,	NETBOOT_MAXARGS,	1,	do_tftpb,
 	"boot image via network using TFTP protocol",
 	"[loadAddress] [[hostIPaddr:]bootfilename]"
+	NETBOOT_IP6_HELP("tftpboot")
 );
 #endif
 
@@ -118,9 +130,10 @@ static int do_nfs(struct cmd_tbl *cmdtp, int flag, int argc,
 }
 
 U_BOOT_CMD(
-	nfs,	3,	1,	do_nfs,
+	nfs,	NETBOOT_MAXARGS,	1,	do_nfs,
 	"boot image via network using NFS protocol",
 	"[loadAddress] [[hostIPaddr:]bootfilename]"
+	NETBOOT_IP6_HELP("nfs")
 );
 #endif
 
@@ -189,6 +202,23 @@ static void netboot_update_env(void)
 #endif
 }
 
+#ifdef CONFIG_IPV6
+/* Get a global address from a router, if one is needed to reach the server */
+static int netboot_ip6_setup(void)
+{
+	struct in6_addr server = net_server_ip6;
+	char name[2];
+
+	if (!ip6_is_unspecified_addr(&net_ip6))
+		return 0;
+	net_parse_bootfile6(&server, name, sizeof(name));
+	if (ip6_is_link_local(&server))
+		return 0;
+
+	return net_loop(NDISC) < 0 ? -ENETUNREACH : 0;
+}
+#endif
+
 static int netboot_common(enum proto_t proto, struct cmd_tbl *cmdtp, int argc,
 			  char *const argv[])
 {
@@ -197,9 +227,25 @@ static int netboot_common(enum proto_t proto, struct cmd_tbl *cmdtp, int argc,
 	int   rcode = 0;
 	int   size;
 	ulong addr;
+#ifdef CONFIG_IPV6
+	bool use_ip6 = false;
+#endif
 
 	net_boot_file_name_explicit = false;
 
+#ifdef CONFIG_IPV6
+	if (argc > 1 && !strcmp(argv[1], "-6")) {
+		if (proto != TFTPGET && proto != NFS)
+			return CMD_RET_USAGE;
+		use_ip6 = true;
+		argc--;
+		argv++;
+	}
+	/* The extra argument allowed for '-6' is only used by tftpput */
+	if (proto != TFTPPUT && argc > 3)
+		return CMD_RET_USAGE;
+#endif
+
 	/* pre-set image_load_addr */
 	s = env_get("loadaddr");
 	if (s != NULL)
@@ -257,7 +303,16 @@ static int netboot_common(enum proto_t proto, struct cmd_tbl *cmdtp, int argc,
 	}
 	bootstage_mark(BOOTSTAGE_ID_NET_START);
 
+#ifdef CONFIG_IPV6
+	net_use_ip6 = use_ip6;
+	if (use_ip6 && netboot_ip6_setup())
+		size = -ENETUNREACH;
+	else
+		size = net_loop(proto);
+	net_use_ip6 = false;
+#else
 	size = net_loop(proto);
+#endif
 	if (size < 0) {
 		bootstage_error(BOOTSTAGE_ID_NET_NETLOOP_OK);
 		return CMD_RET_FAILURE;
@@ -312,6 +367,33 @@ U_BOOT_CMD(
 );
 #endif
 
+#if defined(CONFIG_CMD_PING6)
+static int do_ping6(struct cmd_tbl *cmdtp, int flag, int argc,
+		    char *const argv[])
+{
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	if (string_to_ip6(argv[1], strlen(argv[1]), &net_ping_ip6))
+		return CMD_RET_USAGE;
+
+	if (net_loop(PING6) < 0) {
+		printf("ping6 failed; host %s is not alive\n", argv[1]);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("host %s is alive\n", argv[1]);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	ping6,	2,	1,	do_ping6,
+	"send ICMPv6 ECHO_REQUEST to network host",
+	"pingAddress"
+);
+#endif
+
 #if defined(CONFIG_CMD_CDP)
 
 static void cdp_update_env(void)
@@ -496,8 +578,61 @@ static int do_net_list(struct cmd_tbl *cmdtp, int flag, int argc, char *const ar
 	return CMD_RET_SUCCESS;
 }
 
+static int do_net_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	bool reset = argc > 1 && !strcmp(argv[1], "reset");
+	struct eth_stats *st;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	if (argc > 1 && !reset)
+		return CMD_RET_USAGE;
+
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		/* Only probed devices have counters */
+		if (!device_active(dev))
+			continue;
+		st = eth_get_stats(dev);
+		if (reset) {
+			memset(st, '\0', sizeof(*st));
+			continue;
+		}
+		printf("eth%d : %s\n", dev_seq(dev), dev->name);
+		printf("  RX: %lu packets, %lu bytes, %lu errors, %lu dropped, %lu overruns, %lu full batches\n",
+		       st->rx_packets, st->rx_bytes, st->rx_errors,
+		       st->rx_dropped, st->rx_overruns, st->rx_full_batches);
+		printf("      %lu broadcast, %lu multicast, %lu ARP, %lu UDP, %lu ICMP, %lu other\n",
+		       st->rx_broadcast, st->rx_multicast, st->rx_arp,
+		       st->rx_udp, st->rx_icmp, st->rx_other);
+		printf("  TX: %lu packets, %lu bytes, %lu errors\n",
+		       st->tx_packets, st->tx_bytes, st->tx_errors);
+	}
+	return CMD_RET_SUCCESS;
+}
+
+#ifdef CONFIG_NET_ARP_CACHE
+static int do_net_arp(struct cmd_tbl *cmdtp, int flag, int argc,
+		      char *const argv[])
+{
+	if (argc > 1) {
+		if (strcmp(argv[1], "flush"))
+			return CMD_RET_USAGE;
+		arp_cache_flush();
+		return CMD_RET_SUCCESS;
+	}
+	arp_cache_show();
+
+	return CMD_RET_SUCCESS;
+}
+#endif
+
 static struct cmd_tbl cmd_net[] = {
 	U_BOOT_CMD_MKENT(list, 1, 0, do_net_list, "", ""),
+	U_BOOT_CMD_MKENT(stats, 2, 0, do_net_stats, "", ""),
+#ifdef CONFIG_NET_ARP_CACHE
+	U_BOOT_CMD_MKENT(arp, 2, 0, do_net_arp, "", ""),
+#endif
 };
 
 static int do_net(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
@@ -519,8 +654,12 @@ static int do_net(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 }
 
 U_BOOT_CMD(
-	net, 2, 1, do_net,
+	net, 3, 1, do_net,
 	"NET sub-system",
 	"list - list available devices\n"
+	"net stats [reset] - show or clear the packet counters of each device\n"
+#ifdef CONFIG_NET_ARP_CACHE
+	"net arp [flush] - show or forget the MAC addresses found by ARP\n"
+#endif
 );
 #endif // CONFIG_DM_ETH
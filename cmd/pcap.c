@@ -7,6 +7,7 @@
 #include <common.h>
 #include <command.h>
 #include <net.h>
+#include <net6.h>
 #include <net/pcap.h>
 
 static int do_pcap_init(struct cmd_tbl *cmdtp, int flag, int argc,
@@ -48,6 +49,82 @@ static int do_pcap_clear(struct cmd_tbl *cmdtp, int flag, int argc,
 	return pcap_clear() ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
 }
 
+static int do_pcap_ring(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	if (argc != 2)
+		return CMD_RET_USAGE;
+
+	if (!strcmp(argv[1], "on"))
+		pcap_set_ring(true);
+	else if (!strcmp(argv[1], "off"))
+		pcap_set_ring(false);
+	else
+		return CMD_RET_USAGE;
+
+	return CMD_RET_SUCCESS;
+}
+
+static int do_pcap_snaplen(struct cmd_tbl *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	if (argc != 2)
+		return CMD_RET_USAGE;
+
+	if (pcap_set_snaplen(dectoul(argv[1], NULL))) {
+		printf("snaplen must be 1 to %d\n", PCAP_SNAPLEN_MAX);
+		return CMD_RET_FAILURE;
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+static const struct {
+	const char *name;
+	u16 eth_proto;
+	u8 ip_proto;
+} pcap_protos[] = {
+	{ "arp", PROT_ARP, 0 },
+	{ "ip", PROT_IP, 0 },
+	{ "ip6", PROT_IPV6, 0 },
+	{ "icmp", PROT_IP, IPPROTO_ICMP },
+	{ "icmp6", PROT_IPV6, IPPROTO_ICMPV6 },
+	{ "udp", 0, IPPROTO_UDP },
+	{ "tcp", 0, IPPROTO_TCP },
+};
+
+static int do_pcap_filter(struct cmd_tbl *cmdtp, int flag, int argc,
+			  char *const argv[])
+{
+	struct pcap_filter filter;
+	int i, j;
+
+	memset(&filter, '\0', sizeof(filter));
+	if (argc % 2 == 0)
+		return CMD_RET_USAGE;
+
+	for (i = 1; i < argc; i += 2) {
+		if (!strcmp(argv[i], "proto")) {
+			for (j = 0; j < ARRAY_SIZE(pcap_protos); j++) {
+				if (!strcmp(argv[i + 1], pcap_protos[j].name))
+					break;
+			}
+			if (j == ARRAY_SIZE(pcap_protos))
+				return CMD_RET_USAGE;
+			filter.eth_proto = pcap_protos[j].eth_proto;
+			filter.ip_proto = pcap_protos[j].ip_proto;
+		} else if (!strcmp(argv[i], "port")) {
+			filter.port = dectoul(argv[i + 1], NULL);
+		} else if (!strcmp(argv[i], "host")) {
+			filter.host = string_to_ip(argv[i + 1]);
+		} else {
+			return CMD_RET_USAGE;
+		}
+	}
+
+	return pcap_set_filter(&filter) ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+
 static char pcap_help_text[] =
 	"- network packet capture\n\n"
 	"pcap\n"
@@ -56,10 +133,15 @@ static char pcap_help_text[] =
 	"pcap stop\t\t\tstop capture\n"
 	"pcap status\t\t\tprint status\n"
 	"pcap clear\t\t\tclear capture buffer\n"
+	"pcap ring on|off\t\tdrop the oldest packets when full, or stop\n"
+	"pcap snaplen <len>\t\tkeep only the first <len> bytes of packets\n"
+	"pcap filter [proto <proto>] [port <port>] [host <ip>]\n"
+	"\t\t\t\tcapture only matching packets, or all\n"
 	"\n"
 	"With:\n"
 	"\t<addr>: user address to which pcap will be stored (hexedcimal)\n"
 	"\t<max_size>: Maximum size of pcap file (decimal)\n"
+	"\t<proto>: arp, ip, ip6, icmp, icmp6, udp or tcp\n"
 	"\n";
 
 U_BOOT_CMD_WITH_SUBCMDS(pcap, "pcap", pcap_help_text,
@@ -68,4 +150,7 @@ U_BOOT_CMD_WITH_SUBCMDS(pcap, "pcap", pcap_help_text,
 			U_BOOT_SUBCMD_MKENT(stop, 1, 0, do_pcap_stop),
 			U_BOOT_SUBCMD_MKENT(status, 1, 0, do_pcap_status),
 			U_BOOT_SUBCMD_MKENT(clear, 1, 0, do_pcap_clear),
+			U_BOOT_SUBCMD_MKENT(ring, 2, 0, do_pcap_ring),
+			U_BOOT_SUBCMD_MKENT(snaplen, 2, 0, do_pcap_snaplen),
+			U_BOOT_SUBCMD_MKENT(filter, 7, 0, do_pcap_filter),
 );
@@ -46,6 +46,7 @@ enum {
 	BOOTSTAGE_VERSION	= 0,
 	BOOTSTAGE_MAGIC		= 0xb00757a3,
 	BOOTSTAGE_DIGITS	= 9,
+	BOOTSTAGE_JSON_VERSION	= 1,
 };
 
 struct bootstage_hdr {
@@ -224,6 +225,40 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+uint32_t bootstage_accum_name(const char *name, uint32_t start_us)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec, *end;
+	uint32_t duration;
+
+	duration = (uint32_t)timer_get_boot_us() - start_us;
+	if (!data)
+		return duration;
+
+	for (rec = data->record, end = rec + data->rec_count; rec < end;
+	     rec++) {
+		if (rec->id >= BOOTSTAGE_ID_USER && rec->start_us &&
+		    rec->name && !strcmp(rec->name, name))
+			break;
+	}
+	if (rec == end) {
+		/* Drop silently: this is called often and must not spam */
+		if (data->rec_count >= RECORD_COUNT)
+			return duration;
+		rec = &data->record[data->rec_count++];
+		rec->id = data->next_id++;
+		rec->name = name;
+		rec->flags = BOOTSTAGEF_ALLOC;
+		rec->time_us = 0;
+	}
+
+	/* A non-zero start time is what marks this as an accumulator */
+	rec->start_us = start_us ? start_us : 1;
+	rec->time_us += duration;
+
+	return duration;
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -365,6 +400,66 @@ void bootstage_report(void)
 	}
 }
 
+/**
+ * Append a formatted string to a buffer, tracking the length needed
+ *
+ * Like append_data(), the position is advanced even if the buffer is full, so
+ * the caller can tell how much space would have been needed.
+ *
+ * @param ptrp	Pointer to buffer, updated by this function
+ * @param end	Pointer to end of buffer
+ * @param fmt	printf() format string
+ */
+static void append_fmt(char **ptrp, char *end, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(*ptrp, *ptrp < end ? end - *ptrp : 0, fmt, args);
+	va_end(args);
+	*ptrp += len;
+}
+
+int bootstage_export_json(char *buf, int size)
+{
+	struct bootstage_data *data = gd->bootstage;
+	const struct bootstage_record *rec;
+	char *ptr = buf, *end = buf + size;
+	char name[20];
+	bool first = true;
+	const char *p;
+	int i;
+
+	if (!data)
+		return -ENODATA;
+	append_fmt(&ptr, end, "{\"version\":%d,\"records\":[",
+		   BOOTSTAGE_JSON_VERSION);
+	for (rec = data->record, i = 0; i < data->rec_count; i++, rec++) {
+		if (rec->id != BOOTSTAGE_ID_AWAKE && rec->time_us == 0)
+			continue;
+		append_fmt(&ptr, end, "%s\n{\"id\":%d,\"name\":\"",
+			   first ? "" : ",", rec->id);
+		first = false;
+		for (p = get_record_name(name, sizeof(name), rec); *p; p++) {
+			if (*p == '"' || *p == '\\')
+				append_fmt(&ptr, end, "\\%c", *p);
+			else if (*p >= ' ')
+				append_fmt(&ptr, end, "%c", *p);
+		}
+		append_fmt(&ptr, end, "\",\"%s\":%lu}",
+			   rec->start_us ? "accum" : "mark", rec->time_us);
+	}
+	append_fmt(&ptr, end, "\n]}\n");
+
+	if (ptr >= end) {
+		debug("%s: Not enough space for bootstage export\n", __func__);
+		return -ENOSPC;
+	}
+
+	return ptr - buf;
+}
+
 /**
  * Append data to a memory buffer
  *
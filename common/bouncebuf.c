@@ -13,6 +13,50 @@
 #include <bouncebuf.h>
 #include <asm/cache.h>
 
+static struct bounce_buffer_stats bb_stats;
+static void *owned_start;
+static size_t owned_len;
+
+void bounce_buffer_set_owned(void *start, size_t len)
+{
+	owned_start = start;
+	owned_len = start ? len : 0;
+}
+
+void bounce_buffer_get_stats(struct bounce_buffer_stats *stats)
+{
+	*stats = bb_stats;
+}
+
+static ulong cache_start(struct bounce_buffer *state)
+{
+	ulong addr = (ulong)state->bounce_buffer;
+
+	return state->owned ? rounddown(addr, ARCH_DMA_MINALIGN) : addr;
+}
+
+static ulong cache_end(struct bounce_buffer *state)
+{
+	ulong addr = (ulong)state->bounce_buffer;
+
+	if (state->owned)
+		return roundup(addr + state->len, ARCH_DMA_MINALIGN);
+
+	return addr + state->len_aligned;
+}
+
+static bool addr_owned(struct bounce_buffer *state)
+{
+	ulong start = rounddown((ulong)state->user_buffer, ARCH_DMA_MINALIGN);
+	ulong end = roundup((ulong)state->user_buffer + state->len,
+			    ARCH_DMA_MINALIGN);
+
+	return owned_len &&
+	       IS_ALIGNED((ulong)state->user_buffer, BOUNCE_BUFFER_MIN_ALIGN) &&
+	       start >= (ulong)owned_start &&
+	       end <= (ulong)owned_start + owned_len;
+}
+
 static int addr_aligned(struct bounce_buffer *state)
 {
 	const ulong align_mask = ARCH_DMA_MINALIGN - 1;
@@ -38,17 +82,29 @@ int bounce_buffer_start_extalign(struct bounce_buffer *state, void *data,
 				 size_t alignment,
 				 int (*addr_is_aligned)(struct bounce_buffer *state))
 {
+	int aligned;
+
 	state->user_buffer = data;
 	state->bounce_buffer = data;
 	state->len = len;
 	state->len_aligned = roundup(len, alignment);
 	state->flags = flags;
+	state->owned = false;
 
-	if (!addr_is_aligned(state)) {
+	aligned = addr_is_aligned(state);
+	/* The cache lines around a buffer in an owned region may be used */
+	if (!aligned && addr_is_aligned == addr_aligned && addr_owned(state)) {
+		state->owned = true;
+		aligned = 1;
+	}
+
+	if (!aligned) {
 		state->bounce_buffer = memalign(alignment,
 						state->len_aligned);
 		if (!state->bounce_buffer)
 			return -ENOMEM;
+		bb_stats.count++;
+		bb_stats.bytes += state->len;
 
 		if (state->flags & GEN_BB_READ)
 			memcpy(state->bounce_buffer, state->user_buffer,
@@ -59,9 +115,7 @@ int bounce_buffer_start_extalign(struct bounce_buffer *state, void *data,
 	 * Flush data to RAM so DMA reads can pick it up,
 	 * and any CPU writebacks don't race with DMA writes
 	 */
-	flush_dcache_range((unsigned long)state->bounce_buffer,
-				(unsigned long)(state->bounce_buffer) +
-					state->len_aligned);
+	flush_dcache_range(cache_start(state), cache_end(state));
 
 	return 0;
 }
@@ -78,9 +132,7 @@ int bounce_buffer_stop(struct bounce_buffer *state)
 {
 	if (state->flags & GEN_BB_WRITE) {
 		/* Invalidate cache so that CPU can see any newly DMA'd data */
-		invalidate_dcache_range((unsigned long)state->bounce_buffer,
-					(unsigned long)(state->bounce_buffer) +
-						state->len_aligned);
+		invalidate_dcache_range(cache_start(state), cache_end(state));
 	}
 
 	if (state->bounce_buffer == state->user_buffer)
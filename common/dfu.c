@@ -101,6 +101,12 @@ int run_usb_dnl_gadget(int usbctrl_index, char *usb_dnl_gadget)
 		if (dfu_reinit_needed)
 			goto exit;
 
+		ret = dfu_write_poll();
+		if (ret) {
+			pr_err("Deferred DFU write failed!\n");
+			goto exit;
+		}
+
 		WATCHDOG_RESET();
 		usb_gadget_handle_interrupts(usbctrl_index);
 	}
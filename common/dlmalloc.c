@@ -19,7 +19,40 @@
 #include <malloc.h>
 #include <asm/io.h>
 
-#ifdef DEBUG
+#if CONFIG_IS_ENABLED(MALLOC_PROFILE) && !CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
+#include <malloc_profile.h>
+
+/*
+ * The allocator itself gets internal names, so that it does not record the
+ * calls it makes to itself. The public functions at the end of this file
+ * record the allocations made by their callers.
+ */
+#define MALLOC_PROFILE
+#undef mALLOc
+#undef fREe
+#undef rEALLOc
+#undef mEMALIGn
+#undef cALLOc
+#define mALLOc		mprof_malloc
+#define fREe		mprof_free
+#define rEALLOc		mprof_realloc
+#define mEMALIGn	mprof_memalign
+#define cALLOc		mprof_calloc
+
+static Void_t *mALLOc(size_t bytes);
+static void fREe(Void_t *mem);
+static Void_t *rEALLOc(Void_t *oldmem, size_t bytes);
+static Void_t *mEMALIGn(size_t alignment, size_t bytes);
+static Void_t *cALLOc(size_t n, size_t elem_size);
+#endif
+
+/* Heap statistics are needed for unit tests and for reporting heap usage */
+#if defined(DEBUG) || IS_ENABLED(CONFIG_CMD_MALLOC) || \
+	IS_ENABLED(CONFIG_DM_PROBE_STATS)
+#define MALLOC_INFO
+#endif
+
+#ifdef MALLOC_INFO
 #if __STD_C
 static void malloc_update_mallinfo (void);
 void malloc_stats (void);
@@ -27,7 +60,7 @@ void malloc_stats (void);
 static void malloc_update_mallinfo ();
 void malloc_stats();
 #endif
-#endif	/* DEBUG */
+#endif	/* MALLOC_INFO */
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -720,9 +753,9 @@ static struct mallinfo current_mallinfo = {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 
 /* Tracking mmaps */
 
-#ifdef DEBUG
+#ifdef MALLOC_INFO
 static unsigned int n_mmaps = 0;
-#endif	/* DEBUG */
+#endif	/* MALLOC_INFO */
 static unsigned long mmapped_mem = 0;
 #if HAVE_MMAP
 static unsigned int max_n_mmaps = 0;
@@ -754,7 +787,7 @@ static void malloc_init(void)
 	sbrk_base = (char *)(-1);
 	max_sbrked_mem = 0;
 	max_total_mem = 0;
-#ifdef DEBUG
+#ifdef MALLOC_INFO
 	memset((void *)&current_mallinfo, 0, sizeof(struct mallinfo));
 #endif
 }
@@ -2302,7 +2335,7 @@ size_t malloc_usable_size(mem) Void_t* mem;
 
 /* Utility to update current_mallinfo for malloc_stats and mallinfo() */
 
-#ifdef DEBUG
+#ifdef MALLOC_INFO
 static void malloc_update_mallinfo()
 {
   int i;
@@ -2337,10 +2370,37 @@ static void malloc_update_mallinfo()
   current_mallinfo.fordblks = avail;
   current_mallinfo.hblks = n_mmaps;
   current_mallinfo.hblkhd = mmapped_mem;
+  current_mallinfo.usmblks = max_sbrked_mem;
   current_mallinfo.keepcost = chunksize(top);
 
 }
-#endif	/* DEBUG */
+
+/*
+  malloc_max_free:
+
+    Returns the size of the largest free chunk, including the top one.
+    Compared with the total free space, this shows how fragmented the
+    heap is.
+*/
+
+size_t malloc_max_free(void)
+{
+  int i;
+  mbinptr b;
+  mchunkptr p;
+  INTERNAL_SIZE_T max = chunksize(top);
+
+  for (i = 1; i < NAV; ++i)
+  {
+    b = bin_at(i);
+    for (p = last(b); p != b; p = p->bk)
+      if (chunksize(p) > max)
+        max = chunksize(p);
+  }
+
+  return max;
+}
+#endif	/* MALLOC_INFO */
 
 
 
@@ -2359,7 +2419,7 @@ static void malloc_update_mallinfo()
 
 */
 
-#ifdef DEBUG
+#ifdef MALLOC_INFO
 void malloc_stats()
 {
   malloc_update_mallinfo();
@@ -2374,19 +2434,19 @@ void malloc_stats()
 	  (unsigned int)max_n_mmaps);
 #endif
 }
-#endif	/* DEBUG */
+#endif	/* MALLOC_INFO */
 
 /*
   mallinfo returns a copy of updated current mallinfo.
 */
 
-#ifdef DEBUG
+#ifdef MALLOC_INFO
 struct mallinfo mALLINFo()
 {
   malloc_update_mallinfo();
   return current_mallinfo;
 }
-#endif	/* DEBUG */
+#endif	/* MALLOC_INFO */
 
 
 
@@ -2430,6 +2490,53 @@ int mALLOPt(param_number, value) int param_number; int value;
   }
 }
 
+#ifdef MALLOC_PROFILE
+Void_t *malloc(size_t bytes)
+{
+	Void_t *mem = mALLOc(bytes);
+
+	malloc_profile_add(mem, bytes, __builtin_return_address(0));
+
+	return mem;
+}
+
+void free(Void_t *mem)
+{
+	malloc_profile_del(mem);
+	fREe(mem);
+}
+
+Void_t *realloc(Void_t *oldmem, size_t bytes)
+{
+	Void_t *mem = rEALLOc(oldmem, bytes);
+
+	/* On failure the old block remains allocated */
+	if (mem || !bytes)
+		malloc_profile_del(oldmem);
+	malloc_profile_add(mem, bytes, __builtin_return_address(0));
+
+	return mem;
+}
+
+Void_t *memalign(size_t alignment, size_t bytes)
+{
+	Void_t *mem = mEMALIGn(alignment, bytes);
+
+	malloc_profile_add(mem, bytes, __builtin_return_address(0));
+
+	return mem;
+}
+
+Void_t *calloc(size_t n, size_t elem_size)
+{
+	Void_t *mem = cALLOc(n, elem_size);
+
+	malloc_profile_add(mem, n * elem_size, __builtin_return_address(0));
+
+	return mem;
+}
+#endif
+
 int initf_malloc(void)
 {
 #if CONFIG_VAL(SYS_MALLOC_F_LEN)
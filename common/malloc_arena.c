@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Arenas for small allocations
+ *
+ * Each slab is ARENA_SLAB_SIZE bytes, aligned to its size, and starts with a
+ * header followed by objects of a single size class. The slab holding an
+ * object is found by rounding its address down. Allocations too large for a
+ * slab carry their own header and come from malloc(). Rounding down their
+ * address cannot find a live slab, since it would overlap the allocation, so
+ * slab headers are cleared when their slab is freed.
+ */
+
+#define LOG_CATEGORY	LOGC_ALLOC
+
+#include <common.h>
+#include <log.h>
+#include <malloc.h>
+#include <malloc_arena.h>
+#include <linux/kernel.h>
+
+#define ARENA_SLAB_MAGIC	0x736c6162	/* "slab" */
+#define ARENA_LARGE_MAGIC	0x6c617267	/* "larg" */
+
+/**
+ * struct arena_slab - header at the start of each slab
+ *
+ * @magic:	ARENA_SLAB_MAGIC, cleared when the slab is freed
+ * @class:	size class of the objects in this slab
+ * @used:	number of objects in use
+ * @arena:	arena owning this slab
+ * @sibling:	node in the arena's partial or full list
+ * @free:	first free object
+ */
+struct arena_slab {
+	u32 magic;
+	u16 class;
+	u16 used;
+	struct malloc_arena *arena;
+	struct list_head sibling;
+	void *free;
+};
+
+/**
+ * struct arena_large - header before each large allocation
+ *
+ * @magic:	ARENA_LARGE_MAGIC
+ * @size:	size of the allocation, excluding this header
+ * @sibling:	node in the arena's list of large allocations
+ */
+struct arena_large {
+	ulong magic;
+	ulong size;
+	struct list_head sibling;
+};
+
+#define SLAB_HDR_SIZE	ALIGN(sizeof(struct arena_slab), ARENA_MIN_SIZE)
+
+static LIST_HEAD(arena_list);
+
+static uint arena_class(size_t size)
+{
+	uint class = 0;
+
+	while ((ARENA_MIN_SIZE << class) < size)
+		class++;
+
+	return class;
+}
+
+static uint class_size(uint class)
+{
+	return ARENA_MIN_SIZE << class;
+}
+
+static void arena_account(struct malloc_arena *arena, long used, long held)
+{
+	struct malloc_arena_stats *stats = &arena->stats;
+
+	stats->in_use += used;
+	stats->held += held;
+	stats->peak = max(stats->peak, stats->in_use);
+	stats->peak_held = max(stats->peak_held, stats->held);
+}
+
+static struct arena_slab *arena_new_slab(struct malloc_arena *arena,
+					 uint class)
+{
+	uint size = class_size(class);
+	struct arena_slab *slab;
+	void *obj, **link;
+
+	slab = memalign(ARENA_SLAB_SIZE, ARENA_SLAB_SIZE);
+	if (!slab)
+		return NULL;
+	slab->magic = ARENA_SLAB_MAGIC;
+	slab->class = class;
+	slab->used = 0;
+	slab->arena = arena;
+
+	/* Chain all objects into the free list */
+	link = &slab->free;
+	for (obj = (void *)slab + SLAB_HDR_SIZE;
+	     obj + size <= (void *)slab + ARENA_SLAB_SIZE; obj += size) {
+		*link = obj;
+		link = obj;
+	}
+	*link = NULL;
+
+	list_add(&slab->sibling, &arena->partial[class]);
+	arena->stats.slabs++;
+	arena_account(arena, 0, ARENA_SLAB_SIZE);
+
+	return slab;
+}
+
+static void arena_free_slab(struct malloc_arena *arena,
+			    struct arena_slab *slab)
+{
+	list_del(&slab->sibling);
+	slab->magic = 0;
+	arena->stats.slabs--;
+	arena_account(arena, 0, -ARENA_SLAB_SIZE);
+	free(slab);
+}
+
+static void *arena_alloc_large(struct malloc_arena *arena, size_t size)
+{
+	struct arena_large *large;
+
+	large = malloc(sizeof(*large) + size);
+	if (!large)
+		return NULL;
+	large->magic = ARENA_LARGE_MAGIC;
+	large->size = size;
+	list_add(&large->sibling, &arena->large);
+	arena_account(arena, size, sizeof(*large) + size);
+
+	return large + 1;
+}
+
+void *malloc_arena_alloc(struct malloc_arena *arena, size_t size)
+{
+	struct arena_slab *slab;
+	uint class;
+	void *obj;
+
+	if (!arena)
+		return malloc(size);
+	if (size > ARENA_MAX_SIZE)
+		return arena_alloc_large(arena, size);
+
+	class = arena_class(size);
+	if (list_empty(&arena->partial[class])) {
+		slab = arena_new_slab(arena, class);
+		if (!slab)
+			return NULL;
+	} else {
+		slab = list_first_entry(&arena->partial[class],
+					struct arena_slab, sibling);
+	}
+
+	obj = slab->free;
+	slab->free = *(void **)obj;
+	slab->used++;
+	if (!slab->free)
+		list_move(&slab->sibling, &arena->full);
+	arena->stats.allocs++;
+	arena_account(arena, class_size(class), 0);
+
+	return obj;
+}
+
+static struct arena_slab *arena_find_slab(struct malloc_arena *arena,
+					  void *ptr)
+{
+	struct arena_slab *slab;
+
+	slab = (struct arena_slab *)ALIGN_DOWN((ulong)ptr, ARENA_SLAB_SIZE);
+	if ((void *)slab == ptr || slab->magic != ARENA_SLAB_MAGIC ||
+	    slab->arena != arena)
+		return NULL;
+
+	return slab;
+}
+
+void malloc_arena_free(struct malloc_arena *arena, void *ptr)
+{
+	struct arena_large *large;
+	struct arena_slab *slab;
+	uint class;
+
+	if (!arena || !ptr) {
+		free(ptr);
+		return;
+	}
+
+	slab = arena_find_slab(arena, ptr);
+	if (!slab) {
+		large = (struct arena_large *)ptr - 1;
+		if (large->magic != ARENA_LARGE_MAGIC) {
+			log_err("Bad free of %p in arena '%s'\n", ptr,
+				arena->name);
+			return;
+		}
+		large->magic = 0;
+		list_del(&large->sibling);
+		arena->stats.allocs--;
+		arena_account(arena, -(long)large->size,
+			      -(long)(sizeof(*large) + large->size));
+		free(large);
+		return;
+	}
+
+	class = slab->class;
+	if (!slab->free)
+		list_move(&slab->sibling, &arena->partial[class]);
+	*(void **)ptr = slab->free;
+	slab->free = ptr;
+	slab->used--;
+	arena->stats.allocs--;
+	arena_account(arena, -(long)class_size(class), 0);
+
+	/* Keep one slab per class to avoid churning the heap */
+	if (!slab->used && !list_is_singular(&arena->partial[class]))
+		arena_free_slab(arena, slab);
+}
+
+void malloc_arena_reset(struct malloc_arena *arena)
+{
+	struct arena_large *large, *ltmp;
+	struct arena_slab *slab, *tmp;
+	int i;
+
+	for (i = 0; i < ARENA_CLASSES; i++) {
+		list_for_each_entry_safe(slab, tmp, &arena->partial[i], sibling)
+			arena_free_slab(arena, slab);
+	}
+	list_for_each_entry_safe(slab, tmp, &arena->full, sibling)
+		arena_free_slab(arena, slab);
+	list_for_each_entry_safe(large, ltmp, &arena->large, sibling) {
+		large->magic = 0;
+		free(large);
+	}
+	INIT_LIST_HEAD(&arena->large);
+
+	arena->stats.allocs = 0;
+	arena->stats.in_use = 0;
+	arena->stats.held = 0;
+}
+
+struct malloc_arena *malloc_arena_create(const char *name)
+{
+	struct malloc_arena *arena;
+	int i;
+
+	arena = calloc(1, sizeof(*arena));
+	if (!arena)
+		return NULL;
+	arena->name = name;
+	for (i = 0; i < ARENA_CLASSES; i++)
+		INIT_LIST_HEAD(&arena->partial[i]);
+	INIT_LIST_HEAD(&arena->full);
+	INIT_LIST_HEAD(&arena->large);
+	list_add_tail(&arena->sibling, &arena_list);
+
+	return arena;
+}
+
+void malloc_arena_destroy(struct malloc_arena *arena)
+{
+	if (!arena)
+		return;
+
+	malloc_arena_reset(arena);
+	list_del(&arena->sibling);
+	free(arena);
+}
+
+struct list_head *malloc_arena_list(void)
+{
+	return &arena_list;
+}
@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Heap profiling
+ *
+ * Live allocations are kept in an open-addressed hash table indexed by
+ * address. The table is in BSS, so that it does not enlarge the U-Boot image.
+ * BSS is not available before relocation, hence allocations made then are
+ * not recorded. As the table is fixed in size nothing here allocates memory.
+ */
+
+#include <common.h>
+#include <malloc_profile.h>
+#include <asm/global_data.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define MPROF_ENTRIES	CONFIG_MALLOC_PROFILE_ENTRIES
+#define MPROF_MASK	(MPROF_ENTRIES - 1)
+
+/* Number of distinct call sites which 'malloc top' can tell apart */
+#define MPROF_SITES	256
+
+/**
+ * struct mprof_site - heap usage of a call site
+ *
+ * @caller:	address of the call site
+ * @bytes:	bytes held by allocations from this site
+ * @count:	number of allocations from this site
+ */
+struct mprof_site {
+	ulong caller;
+	ulong bytes;
+	uint count;
+};
+
+static struct malloc_profile_rec mprof_table[MPROF_ENTRIES];
+static struct malloc_profile_stats mprof_stats;
+static struct mprof_site mprof_sites[MPROF_SITES];
+
+static uint mprof_hash(ulong ptr)
+{
+	/* Allocations are at least 8-byte aligned */
+	return ((ptr >> 3) * 0x9e3779b1) & MPROF_MASK;
+}
+
+static struct malloc_profile_rec *mprof_find(ulong ptr)
+{
+	uint i, idx = mprof_hash(ptr);
+
+	for (i = 0; i < MPROF_ENTRIES; i++) {
+		struct malloc_profile_rec *rec = &mprof_table[idx];
+
+		if (rec->ptr == ptr || !rec->ptr)
+			return rec;
+		idx = (idx + 1) & MPROF_MASK;
+	}
+
+	return NULL;
+}
+
+void malloc_profile_add(void *ptr, size_t size, void *caller)
+{
+	struct malloc_profile_rec *rec;
+
+	if (!ptr || !(gd->flags & GD_FLG_RELOC))
+		return;
+
+	rec = mprof_find((ulong)ptr);
+	if (!rec || (!rec->ptr && mprof_stats.count == MPROF_MASK)) {
+		/* Keep one free entry so that searches end */
+		mprof_stats.dropped++;
+		return;
+	}
+	if (rec->ptr) {
+		mprof_stats.bytes -= rec->size;
+	} else {
+		rec->ptr = (ulong)ptr;
+		mprof_stats.count++;
+	}
+	rec->caller = (ulong)caller - gd->reloc_off;
+	rec->size = size;
+	rec->seq = ++mprof_stats.seq;
+	mprof_stats.bytes += size;
+	mprof_stats.peak = max(mprof_stats.peak, mprof_stats.bytes);
+}
+
+void malloc_profile_del(void *ptr)
+{
+	struct malloc_profile_rec *rec;
+	uint i, j, home;
+
+	if (!ptr || !(gd->flags & GD_FLG_RELOC))
+		return;
+	rec = mprof_find((ulong)ptr);
+	if (!rec || !rec->ptr)
+		return;
+	mprof_stats.count--;
+	mprof_stats.bytes -= rec->size;
+
+	/*
+	 * Move back any later entry in the same run which may no longer be
+	 * reachable from its home slot, so that no tombstones are needed
+	 */
+	i = rec - mprof_table;
+	for (j = (i + 1) & MPROF_MASK; mprof_table[j].ptr;
+	     j = (j + 1) & MPROF_MASK) {
+		home = mprof_hash(mprof_table[j].ptr);
+		if (((j - home) & MPROF_MASK) >= ((j - i) & MPROF_MASK)) {
+			mprof_table[i] = mprof_table[j];
+			i = j;
+		}
+	}
+	mprof_table[i].ptr = 0;
+}
+
+void malloc_profile_get_stats(struct malloc_profile_stats *stats)
+{
+	*stats = mprof_stats;
+}
+
+static void mprof_show(struct malloc_profile_rec *rec)
+{
+	printf("%10lx %8u %10lx %8u\n", rec->ptr, rec->size, rec->caller,
+	       rec->seq);
+}
+
+static void mprof_show_header(void)
+{
+	printf("%10s %8s %10s %8s\n", "Address", "Size", "Caller", "Seq");
+}
+
+int malloc_profile_leaks(ulong since, bool show)
+{
+	int i, count = 0;
+
+	for (i = 0; i < MPROF_ENTRIES; i++) {
+		struct malloc_profile_rec *rec = &mprof_table[i];
+
+		if (!rec->ptr || rec->seq <= since)
+			continue;
+		if (show) {
+			if (!count)
+				mprof_show_header();
+			mprof_show(rec);
+		}
+		count++;
+	}
+
+	return count;
+}
+
+static void mprof_show_stats(void)
+{
+	printf("Live: %lu allocations, %lu bytes, peak %lu bytes\n",
+	       mprof_stats.count, mprof_stats.bytes, mprof_stats.peak);
+	if (mprof_stats.dropped)
+		printf("Not recorded: %lu allocations\n", mprof_stats.dropped);
+}
+
+void malloc_profile_dump(void)
+{
+	mprof_show_stats();
+	malloc_profile_leaks(0, true);
+}
+
+void malloc_profile_top(int count)
+{
+	struct mprof_site *site;
+	int i, j, used = 0;
+	ulong other = 0;
+
+	for (i = 0; i < MPROF_ENTRIES; i++) {
+		struct malloc_profile_rec *rec = &mprof_table[i];
+
+		if (!rec->ptr)
+			continue;
+		for (j = 0; j < used; j++) {
+			if (mprof_sites[j].caller == rec->caller)
+				break;
+		}
+		if (j == used) {
+			if (used == MPROF_SITES) {
+				other += rec->size;
+				continue;
+			}
+			mprof_sites[used].caller = rec->caller;
+			mprof_sites[used].bytes = 0;
+			mprof_sites[used].count = 0;
+			used++;
+		}
+		mprof_sites[j].bytes += rec->size;
+		mprof_sites[j].count++;
+	}
+
+	/* Move the largest sites to the front */
+	count = min(count, used);
+	for (i = 0; i < count; i++) {
+		struct mprof_site tmp;
+
+		site = &mprof_sites[i];
+		for (j = i + 1; j < used; j++) {
+			if (mprof_sites[j].bytes > site->bytes)
+				site = &mprof_sites[j];
+		}
+		tmp = mprof_sites[i];
+		mprof_sites[i] = *site;
+		*site = tmp;
+	}
+
+	mprof_show_stats();
+	printf("%10s %10s %8s\n", "Caller", "Bytes", "Allocs");
+	for (i = 0; i < count; i++) {
+		site = &mprof_sites[i];
+		printf("%10lx %10lu %8u\n", site->caller, site->bytes,
+		       site->count);
+	}
+	if (other)
+		printf("Other call sites: %lu bytes\n", other);
+}
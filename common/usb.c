@@ -293,6 +293,36 @@ int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 		return -EIO;
 }
 
+/*
+ * submits several Bulk Messages at once, falling back to sending them one
+ * after the other if the controller cannot queue them. Returns 0 if all
+ * messages completed successfully, otherwise a negative value. In that case
+ * dev->status holds the status of the message which failed.
+ */
+int usb_bulk_msgs(struct usb_device *dev, struct usb_bulk_req *reqs,
+		  int count)
+{
+	int ret, i;
+
+#if CONFIG_IS_ENABLED(DM_USB)
+	dev->status = USB_ST_NOT_PROC; /*not yet processed */
+	ret = submit_bulk_msgs(dev, reqs, count);
+	if (ret != -ENOSYS)
+		return ret < 0 ? -EIO : 0;
+#endif
+	for (i = 0; i < count; i++)
+		reqs[i].status = USB_ST_NOT_PROC;
+	for (i = 0; i < count; i++) {
+		ret = usb_bulk_msg(dev, reqs[i].pipe, reqs[i].buffer,
+				   reqs[i].length, &reqs[i].act_len,
+				   USB_CNTL_TIMEOUT * 5);
+		reqs[i].status = dev->status;
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
 
 /*-------------------------------------------------------------------
  * Max Packet stuff
@@ -83,6 +83,7 @@ struct us_data {
 
 	unsigned int	flags;			/* from filter initially */
 #	define USB_READY	(1 << 0)
+#	define USB_NO_QUEUE	(1 << 1)	/* queued reads failed */
 	unsigned char	ifnum;			/* interface number */
 	unsigned char	ep_in;			/* in endpoint */
 	unsigned char	ep_out;			/* out ....... */
@@ -531,6 +532,22 @@ static int usb_stor_CB_reset(struct us_data *us)
  * Set up the command for a BBB device. Note that the actual SCSI
  * command is copied into cbw.CBWCDB.
  */
+/* Fill in a CBW for a command, using the next tag */
+static void usb_stor_BBB_fill_cbw(struct umass_bbb_cbw *cbw,
+				  struct scsi_cmd *srb, int dir_in)
+{
+	cbw->dCBWSignature = cpu_to_le32(CBWSIGNATURE);
+	cbw->dCBWTag = cpu_to_le32(CBWTag++);
+	cbw->dCBWDataTransferLength = cpu_to_le32(srb->datalen);
+	cbw->bCBWFlags = (dir_in ? CBWFLAGS_IN : CBWFLAGS_OUT);
+	cbw->bCBWLUN = srb->lun;
+	cbw->bCDBLength = srb->cmdlen;
+	/* copy the command data into the CBW command data buffer */
+	/* DST SRC LEN!!! */
+
+	memcpy(cbw->CBWCDB, srb->cmd, srb->cmdlen);
+}
+
 static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
 {
 	int result;
@@ -560,16 +577,7 @@ static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
 	/* always OUT to the ep */
 	pipe = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
 
-	cbw->dCBWSignature = cpu_to_le32(CBWSIGNATURE);
-	cbw->dCBWTag = cpu_to_le32(CBWTag++);
-	cbw->dCBWDataTransferLength = cpu_to_le32(srb->datalen);
-	cbw->bCBWFlags = (dir_in ? CBWFLAGS_IN : CBWFLAGS_OUT);
-	cbw->bCBWLUN = srb->lun;
-	cbw->bCDBLength = srb->cmdlen;
-	/* copy the command data into the CBW command data buffer */
-	/* DST SRC LEN!!! */
-
-	memcpy(cbw->CBWCDB, srb->cmd, srb->cmdlen);
+	usb_stor_BBB_fill_cbw(cbw, srb, dir_in);
 	result = usb_bulk_msg(us->pusb_dev, pipe, cbw, UMASS_BBB_CBW_SIZE,
 			      &actlen, USB_CNTL_TIMEOUT * 5);
 	if (result < 0)
@@ -1066,8 +1074,8 @@ static int usb_read_capacity(struct scsi_cmd *srb, struct us_data *ss)
 	return -1;
 }
 
-static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
-		       unsigned long start, unsigned short blocks)
+static void usb_read_10_cmd(struct scsi_cmd *srb, unsigned long start,
+			    unsigned short blocks)
 {
 	memset(&srb->cmd[0], 0, 12);
 	srb->cmd[0] = SCSI_READ10;
@@ -1080,9 +1088,136 @@ static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
 	srb->cmd[8] = (unsigned char) blocks & 0xff;
 	srb->cmdlen = 12;
 	debug("read10: start %lx blocks %x\n", start, blocks);
+}
+
+static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
+		       unsigned long start, unsigned short blocks)
+{
+	usb_read_10_cmd(srb, start, blocks);
 	return ss->transport(srb, ss);
 }
 
+#if CONFIG_USB_STORAGE_QUEUE_DEPTH > 1
+#define USB_STOR_CBW_STRIDE	ROUND(UMASS_BBB_CBW_SIZE, ARCH_DMA_MINALIGN)
+#define USB_STOR_CSW_STRIDE	ROUND(UMASS_BBB_CSW_SIZE, ARCH_DMA_MINALIGN)
+
+/*
+ * Read using several READ(10) commands in flight on a Bulk-Only device
+ *
+ * The CBW, data and CSW of up to CONFIG_USB_STORAGE_QUEUE_DEPTH commands are
+ * all handed to the host controller at once, so the device can start on the
+ * next command as soon as it has sent the status of the previous one,
+ * without waiting for U-Boot to notice. This is only used with controllers
+ * which can queue bulk transfers.
+ *
+ * Bulk-Only Transport does not allow a CBW to be sent before the CSW of the
+ * previous command has been read, so not all devices accept this. Once a
+ * queued read fails on a device, USB_NO_QUEUE is set and it is not tried
+ * again.
+ *
+ * Each command reads at most max_xfer_blk / (2 * QUEUE_DEPTH) blocks. The
+ * controller is sized for one transfer of max_xfer_blk, so the commands in
+ * flight fit in it together with their status stages and any overhead for
+ * unaligned buffers.
+ *
+ * Returns the number of blocks which were read successfully. If the transfer
+ * failed or a status was invalid, the device may have accepted commands whose
+ * status was not read, so a Reset Recovery is done as in
+ * usb_stor_BBB_transport(). The caller reads the rest with usb_read_10(),
+ * which handles sense data and stalls.
+ */
+static lbaint_t usb_stor_BBB_read_queued(struct scsi_cmd *srb,
+					 struct us_data *ss, lbaint_t start,
+					 lbaint_t blks, uintptr_t buf_addr,
+					 ulong blksz)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, cbw_buf, CONFIG_USB_STORAGE_QUEUE_DEPTH *
+				 USB_STOR_CBW_STRIDE);
+	ALLOC_CACHE_ALIGN_BUFFER(u8, csw_buf, CONFIG_USB_STORAGE_QUEUE_DEPTH *
+				 USB_STOR_CSW_STRIDE);
+	struct usb_bulk_req reqs[CONFIG_USB_STORAGE_QUEUE_DEPTH * 3];
+	unsigned short count[CONFIG_USB_STORAGE_QUEUE_DEPTH];
+	struct usb_device *udev = ss->pusb_dev;
+	unsigned int pipein, pipeout;
+	unsigned short per_cmd;
+	bool failed = false, reset = false;
+	lbaint_t done = 0;
+	int num, i, ret;
+
+	per_cmd = max(ss->max_xfer_blk / (2 * CONFIG_USB_STORAGE_QUEUE_DEPTH),
+		      1);
+	pipein = usb_rcvbulkpipe(udev, ss->ep_in);
+	pipeout = usb_sndbulkpipe(udev, ss->ep_out);
+	for (num = 0; num < CONFIG_USB_STORAGE_QUEUE_DEPTH && blks; num++) {
+		struct umass_bbb_cbw *cbw;
+		struct usb_bulk_req *req = &reqs[num * 3];
+
+		count[num] = min_t(lbaint_t, blks, per_cmd);
+		if (count[num] == per_cmd)
+			usb_show_progress();
+		srb->datalen = blksz * count[num];
+		usb_read_10_cmd(srb, start, count[num]);
+		cbw = (void *)(cbw_buf + num * USB_STOR_CBW_STRIDE);
+		usb_stor_BBB_fill_cbw(cbw, srb, US_DIRECTION(srb->cmd[0]));
+
+		req[0].pipe = pipeout;
+		req[0].buffer = cbw;
+		req[0].length = UMASS_BBB_CBW_SIZE;
+		req[1].pipe = pipein;
+		req[1].buffer = (void *)buf_addr;
+		req[1].length = srb->datalen;
+		req[2].pipe = pipein;
+		req[2].buffer = csw_buf + num * USB_STOR_CSW_STRIDE;
+		req[2].length = UMASS_BBB_CSW_SIZE;
+
+		start += count[num];
+		blks -= count[num];
+		buf_addr += srb->datalen;
+	}
+
+	ret = usb_bulk_msgs(udev, reqs, num * 3);
+
+	/*
+	 * Accept commands up to the first one which did not fully succeed,
+	 * but check the status of all of them
+	 */
+	for (i = 0; i < num; i++) {
+		struct umass_bbb_cbw *cbw;
+		struct umass_bbb_csw *csw;
+		struct usb_bulk_req *req = &reqs[i * 3];
+
+		cbw = (void *)(cbw_buf + i * USB_STOR_CBW_STRIDE);
+		csw = (void *)req[2].buffer;
+		/* A transfer error, including a stall, leaves ret set */
+		if (req[0].status || req[1].status || req[2].status)
+			break;
+		if (req[2].act_len != UMASS_BBB_CSW_SIZE ||
+		    le32_to_cpu(csw->dCSWSignature) != CSWSIGNATURE ||
+		    csw->dCSWTag != cbw->dCBWTag ||
+		    csw->bCSWStatus >= CSWSTATUS_PHASE) {
+			debug("%s: invalid CSW for command %d\n", __func__, i);
+			reset = true;
+			break;
+		}
+		if (req[1].act_len != req[1].length ||
+		    csw->bCSWStatus != CSWSTATUS_GOOD ||
+		    csw->dCSWDataResidue)
+			failed = true;
+		if (!failed)
+			done += count[i];
+	}
+
+	if (ret || reset) {
+		debug("%s: queued read failed, status %lx\n", __func__,
+		      udev->status);
+		usb_stor_BBB_reset(ss);
+		ss->flags |= USB_NO_QUEUE;
+	}
+
+	return done;
+}
+#endif
+
 static int usb_write_10(struct scsi_cmd *srb, struct us_data *ss,
 			unsigned long start, unsigned short blocks)
 {
@@ -1171,6 +1306,22 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	      block_dev->devnum, start, blks, buf_addr);
 
 	do {
+#if CONFIG_USB_STORAGE_QUEUE_DEPTH > 1
+		if (ss->protocol == US_PR_BULK && (ss->flags & USB_READY) &&
+		    !(ss->flags & USB_NO_QUEUE) && blks > ss->max_xfer_blk &&
+		    usb_bulk_msgs_queued(udev)) {
+			lbaint_t done;
+
+			done = usb_stor_BBB_read_queued(srb, ss, start, blks,
+							buf_addr,
+							block_dev->blksz);
+			start += done;
+			blks -= done;
+			buf_addr += done * block_dev->blksz;
+			if (!blks)
+				break;
+		}
+#endif
 		/* XXX need some comment here */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -227,6 +227,11 @@ void dev_print (struct blk_desc *dev_desc)
 	} else {
 		puts ("            Capacity: not available\n");
 	}
+#ifdef CONFIG_BOUNCE_BUFFER
+	if (dev_desc->bounce_bytes)
+		printf("            Bounced: %llu bytes\n",
+		       (unsigned long long)dev_desc->bounce_bytes);
+#endif
 }
 #endif
 
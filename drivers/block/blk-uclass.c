@@ -8,13 +8,16 @@
 
 #include <common.h>
 #include <blk.h>
+#include <bouncebuf.h>
 #include <dm.h>
+#include <efi_loader.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
+#include <asm/cache.h>
 #include <linux/err.h>
 
 static const char *if_typename_str[IF_TYPE_COUNT] = {
@@ -436,6 +439,68 @@ int blk_get_device(int if_type, int devnum, struct udevice **devp)
 	return device_probe(*devp);
 }
 
+static ulong blk_xfer(struct blk_desc *block_dev, lbaint_t start,
+		      lbaint_t blkcnt, void *buffer, bool write)
+{
+	struct udevice *dev = block_dev->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+
+	if (write)
+		return ops->write(dev, start, blkcnt, buffer);
+
+	return ops->read(dev, start, blkcnt, buffer);
+}
+
+/*
+ * A buffer which is not aligned to cache lines is bounced by the driver as a
+ * whole. Only the first and last block share cache lines with other data, so
+ * transfer the blocks in between directly and leave just those two to the
+ * bounce buffer. The middle goes first so that invalidating its cache lines
+ * cannot discard data already read into the first or last block.
+ */
+static bool blk_can_split(struct blk_desc *block_dev, lbaint_t blkcnt,
+			  void *buffer)
+{
+	return IS_ENABLED(CONFIG_BLK_SPLIT_UNALIGNED) && blkcnt >= 3 &&
+	       block_dev->blksz >= ARCH_DMA_MINALIGN &&
+	       !IS_ALIGNED((ulong)buffer, ARCH_DMA_MINALIGN) &&
+	       IS_ALIGNED((ulong)buffer, BOUNCE_BUFFER_MIN_ALIGN);
+}
+
+static ulong blk_transfer(struct blk_desc *block_dev, lbaint_t start,
+			  lbaint_t blkcnt, void *buffer, bool write)
+{
+	ulong blksz = block_dev->blksz;
+	lbaint_t last = blkcnt - 1;
+	__maybe_unused struct bounce_buffer_stats before, after;
+	ulong n;
+
+	bounce_buffer_get_stats(&before);
+	if (!blk_can_split(block_dev, blkcnt, buffer)) {
+		n = blk_xfer(block_dev, start, blkcnt, buffer, write);
+		goto out;
+	}
+
+	bounce_buffer_set_owned(buffer, blkcnt * blksz);
+	n = blk_xfer(block_dev, start + 1, blkcnt - 2, buffer + blksz, write);
+	bounce_buffer_set_owned(NULL, 0);
+	/* The blocks done are not contiguous, so report all or nothing */
+	if (n != blkcnt - 2 ||
+	    blk_xfer(block_dev, start, 1, buffer, write) != 1 ||
+	    blk_xfer(block_dev, start + last, 1, buffer + last * blksz,
+		     write) != 1)
+		n = 0;
+	else
+		n = blkcnt;
+out:
+#ifdef CONFIG_BOUNCE_BUFFER
+	bounce_buffer_get_stats(&after);
+	block_dev->bounce_bytes += after.bytes - before.bytes;
+#endif
+
+	return n;
+}
+
 unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			lbaint_t blkcnt, void *buffer)
 {
@@ -449,7 +514,7 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
-	blks_read = ops->read(dev, start, blkcnt, buffer);
+	blks_read = blk_transfer(block_dev, start, blkcnt, buffer, false);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
 			      start, blkcnt, block_dev->blksz, buffer);
@@ -467,7 +532,8 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
-	return ops->write(dev, start, blkcnt, buffer);
+	efi_disk_invalidate_cache(block_dev);
+	return blk_transfer(block_dev, start, blkcnt, (void *)buffer, true);
 }
 
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
@@ -480,9 +546,46 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	efi_disk_invalidate_cache(block_dev);
 	return ops->erase(dev, start, blkcnt);
 }
 
+int blk_drw_multi(struct blk_desc *block_dev, struct blk_req *reqs, int count)
+{
+	struct udevice *dev = block_dev->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+	ulong n;
+	int i;
+
+	if (ops->rw_multi) {
+		for (i = 0; i < count; i++) {
+			if (reqs[i].write) {
+				blkcache_invalidate(block_dev->if_type,
+						    block_dev->devnum);
+				efi_disk_invalidate_cache(block_dev);
+				break;
+			}
+		}
+
+		return ops->rw_multi(dev, reqs, count);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].write)
+			n = blk_dwrite(block_dev, reqs[i].start,
+				       reqs[i].blkcnt, reqs[i].buffer);
+		else
+			n = blk_dread(block_dev, reqs[i].start,
+				      reqs[i].blkcnt, reqs[i].buffer);
+		if (IS_ERR_VALUE(n))
+			return n;
+		if (n != reqs[i].blkcnt)
+			return -EIO;
+	}
+
+	return 0;
+}
+
 int blk_get_from_parent(struct udevice *parent, struct udevice **devp)
 {
 	struct udevice *dev;
@@ -9,6 +9,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <cpu_func.h>
 #include <log.h>
 #include <asm/global_data.h>
@@ -492,7 +493,7 @@ static int device_get_dma_constraints(struct udevice *dev)
 	return 0;
 }
 
-int device_probe(struct udevice *dev)
+static int device_probe_common(struct udevice *dev)
 {
 	const struct driver *drv;
 	int ret;
@@ -601,7 +602,13 @@ int device_probe(struct udevice *dev)
 	}
 
 	if (drv->probe) {
+		uint32_t start_us = 0;
+
+		if (CONFIG_IS_ENABLED(BOOTSTAGE_DM_PROBE))
+			start_us = timer_get_boot_us();
 		ret = drv->probe(dev);
+		if (CONFIG_IS_ENABLED(BOOTSTAGE_DM_PROBE))
+			bootstage_accum_name(drv->name, start_us);
 		if (ret)
 			goto fail;
 	}
@@ -631,6 +638,101 @@ fail:
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+/**
+ * struct probe_frame - A device_probe() call in progress
+ *
+ * @dev: Device being probed
+ * @prev: Enclosing probe, i.e. the one which caused this one, or NULL
+ * @heap: malloc() heap in use when the probe started
+ * @heap_f: Pre-relocation heap in use when the probe started
+ * @nested_heap: Total heap allocated by nested probes
+ * @nested_heap_f: Total pre-relocation heap allocated by nested probes
+ * @done: true if @dev was already probed by a nested call, e.g. by its
+ *	parent, so that this call should not record anything for it
+ */
+struct probe_frame {
+	struct udevice *dev;
+	struct probe_frame *prev;
+	ulong heap;
+	ulong heap_f;
+	long nested_heap;
+	long nested_heap_f;
+	bool done;
+};
+
+static ulong probe_heap_used(void)
+{
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return 0;
+
+	return mallinfo().uordblks;
+}
+
+static ulong probe_heap_f_used(void)
+{
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	return gd->malloc_ptr;
+#else
+	return 0;
+#endif
+}
+
+static void probe_stats_start(struct probe_frame *frame, struct udevice *dev)
+{
+	memset(frame, '\0', sizeof(*frame));
+	frame->dev = dev;
+	frame->prev = gd->dm_probe;
+	frame->heap = probe_heap_used();
+	frame->heap_f = probe_heap_f_used();
+	gd->dm_probe = frame;
+}
+
+static void probe_stats_end(struct probe_frame *frame, int ret)
+{
+	struct dm_probe_stats *stats = &frame->dev->probe_stats;
+	struct probe_frame *prev = frame->prev;
+	long heap = probe_heap_used() - frame->heap;
+	long heap_f = probe_heap_f_used() - frame->heap_f;
+
+	gd->dm_probe = prev;
+	if (prev) {
+		prev->nested_heap += heap;
+		prev->nested_heap_f += heap_f;
+	}
+	if (ret || frame->done)
+		return;
+
+	stats->heap = heap - frame->nested_heap;
+	stats->heap_f = heap_f - frame->nested_heap_f;
+
+	/* Stop any outer call for the same device from overwriting this */
+	for (; prev; prev = prev->prev) {
+		if (prev->dev == frame->dev)
+			prev->done = true;
+	}
+}
+#endif
+
+int device_probe(struct udevice *dev)
+{
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	struct probe_frame frame;
+	int ret;
+
+	if (!dev || dev_get_flags(dev) & DM_FLAG_ACTIVATED)
+		return device_probe_common(dev);
+
+	probe_stats_start(&frame, dev);
+	ret = device_probe_common(dev);
+	probe_stats_end(&frame, ret);
+
+	return ret;
+#else
+	return device_probe_common(dev);
+#endif
+}
+
 void *dev_get_plat(const struct udevice *dev)
 {
 	if (!dev) {
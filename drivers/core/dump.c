@@ -5,12 +5,15 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
 #include <mapmem.h>
+#include <sort.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/uclass-internal.h>
 
-static void show_devices(struct udevice *dev, int depth, int last_flag)
+static void show_devices(struct udevice *dev, int depth, int last_flag,
+			 bool verbose)
 {
 	int i, is_last;
 	struct udevice *child;
@@ -21,6 +24,16 @@ static void show_devices(struct udevice *dev, int depth, int last_flag)
 	       " %-10.10s  %3d  [ %c ]   %-20.20s  ", dev->uclass->uc_drv->name,
 	       dev_get_uclass_index(dev, NULL),
 	       flags & DM_FLAG_ACTIVATED ? '+' : ' ', dev->driver->name);
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	if (verbose) {
+		const struct dm_probe_stats *stats = &dev->probe_stats;
+
+		if (flags & DM_FLAG_ACTIVATED)
+			printf("%8ld %6ld  ", stats->heap, stats->heap_f);
+		else
+			printf("%15s  ", "");
+	}
+#endif
 
 	for (i = depth; i >= 0; i--) {
 		is_last = (last_flag >> i) & 1;
@@ -41,21 +54,89 @@ static void show_devices(struct udevice *dev, int depth, int last_flag)
 
 	list_for_each_entry(child, &dev->child_head, sibling_node) {
 		is_last = list_is_last(&child->sibling_node, &dev->child_head);
-		show_devices(child, depth + 1, (last_flag << 1) | is_last);
+		show_devices(child, depth + 1, (last_flag << 1) | is_last,
+			     verbose);
 	}
 }
 
-void dm_dump_all(void)
+void dm_dump_all(bool verbose)
 {
 	struct udevice *root;
 
+	if (!CONFIG_IS_ENABLED(DM_PROBE_STATS))
+		verbose = false;
 	root = dm_root();
 	if (root) {
-		printf(" Class     Index  Probed  Driver                Name\n");
-		printf("-----------------------------------------------------------\n");
-		show_devices(root, -1, 0);
+		printf(" Class     Index  Probed  Driver                ");
+		if (verbose)
+			printf("%8s %6s  ", "Heap", "Heap_f");
+		printf("Name\n");
+		printf("-----------------------------------------------------------%s\n",
+		       verbose ? "-----------------" : "");
+		show_devices(root, -1, 0, verbose);
+	}
+}
+
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+static int collect_probed(struct udevice *dev, struct udevice **list, int count)
+{
+	struct udevice *child;
+
+	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED) {
+		if (list)
+			list[count] = dev;
+		count++;
+	}
+	list_for_each_entry(child, &dev->child_head, sibling_node)
+		count = collect_probed(child, list, count);
+
+	return count;
+}
+
+static int h_compare_heap(const void *p1, const void *p2)
+{
+	const struct udevice *dev1 = *(struct udevice **)p1;
+	const struct udevice *dev2 = *(struct udevice **)p2;
+
+	if (dev1->probe_stats.heap == dev2->probe_stats.heap)
+		return 0;
+
+	return dev1->probe_stats.heap < dev2->probe_stats.heap ? 1 : -1;
+}
+
+void dm_dump_probe_stats(void)
+{
+	struct udevice *root = dm_root();
+	struct udevice **list;
+	long heap = 0, heap_f = 0;
+	int count, i;
+
+	if (!root)
+		return;
+	count = collect_probed(root, NULL, 0);
+	list = calloc(count, sizeof(*list));
+	if (!list) {
+		printf("Out of memory\n");
+		return;
+	}
+	collect_probed(root, list, 0);
+	qsort(list, count, sizeof(*list), h_compare_heap);
+
+	printf("%8s %6s  %-20s  %s\n", "Heap", "Heap_f", "Driver", "Name");
+	printf("-------------------------------------------------\n");
+	for (i = 0; i < count; i++) {
+		const struct dm_probe_stats *stats = &list[i]->probe_stats;
+
+		printf("%8ld %6ld  %-20.20s  %s\n", stats->heap, stats->heap_f,
+		       list[i]->driver->name, list[i]->name);
+		heap += stats->heap;
+		heap_f += stats->heap_f;
 	}
+	printf("-------------------------------------------------\n");
+	printf("%8ld %6ld  %d devices probed\n", heap, heap_f, count);
+	free(list);
 }
+#endif
 
 /**
  * dm_display_line() - Display information about a single device
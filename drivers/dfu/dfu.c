@@ -17,6 +17,13 @@
 #include <hash.h>
 #include <linux/list.h>
 #include <linux/compiler.h>
+#include <linux/sizes.h>
+
+/*
+ * With CONFIG_DFU_WRITE_ZERO_COPY, chunks at least this large (and a multiple
+ * of it) are written straight from the caller's buffer
+ */
+#define DFU_ZERO_COPY_MIN	SZ_64K
 
 LIST_HEAD(dfu_list);
 static int dfu_alt_num;
@@ -179,13 +186,20 @@ done:
 }
 
 static unsigned char *dfu_buf;
+static unsigned char *dfu_buf_alt;
 static unsigned long dfu_buf_size;
 static enum dfu_device_type dfu_buf_device_type;
 
+/* Entity whose full buffer is being written out by dfu_write_poll() */
+static struct dfu_entity *dfu_pending;
+
 unsigned char *dfu_free_buf(void)
 {
 	free(dfu_buf);
+	free(dfu_buf_alt);
 	dfu_buf = NULL;
+	dfu_buf_alt = NULL;
+	dfu_pending = NULL;
 	return dfu_buf;
 }
 
@@ -241,35 +255,154 @@ static char *dfu_get_hash_algo(void)
 	return NULL;
 }
 
+static int dfu_write_medium_buf(struct dfu_entity *dfu, void *buf, long len)
+{
+	int ret;
+
+	if (dfu_hash_algo)
+		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
+					   buf, len, 0);
+
+	ret = dfu->write_medium(dfu, dfu->offset, buf, &len);
+	if (ret)
+		debug("%s: Write error!\n", __func__);
+
+	/* update offset */
+	dfu->offset += len;
+
+	return ret;
+}
+
+/* Write up to @max bytes of the buffer handed over by dfu_write_queue() */
+static int dfu_write_pending_slice(struct dfu_entity *dfu, long max)
+{
+	long w_size;
+	int ret;
+
+	w_size = min((long)(dfu->p_buf_end - dfu->p_buf), max);
+	ret = dfu_write_medium_buf(dfu, dfu->p_buf, w_size);
+	dfu->p_buf += w_size;
+
+	if (ret || dfu->p_buf == dfu->p_buf_end) {
+		dfu->p_buf = NULL;
+		dfu->p_buf_end = NULL;
+		dfu_pending = NULL;
+		if (!ret)
+			puts("#");
+	}
+
+	return ret;
+}
+
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
 	long w_size;
 	int ret;
 
+	/* the other buffer goes first, if it is still being written */
+	if (dfu->p_buf) {
+		ret = dfu_write_pending_slice(dfu, LONG_MAX);
+		if (ret)
+			return ret;
+	}
+
 	/* flush size? */
 	w_size = dfu->i_buf - dfu->i_buf_start;
 	if (w_size == 0)
 		return 0;
 
-	if (dfu_hash_algo)
-		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
-					   dfu->i_buf_start, w_size, 0);
-
-	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
-	if (ret)
-		debug("%s: Write error!\n", __func__);
+	ret = dfu_write_medium_buf(dfu, dfu->i_buf_start, w_size);
 
 	/* point back */
 	dfu->i_buf = dfu->i_buf_start;
 
-	/* update offset */
-	dfu->offset += w_size;
-
 	puts("#");
 
 	return ret;
 }
 
+/*
+ * Hand the full buffer over to dfu_write_poll() and carry on filling the
+ * other buffer of the pair. Only one buffer can be written out at a time, so
+ * the previous one is finished off first if dfu_write_poll() did not get to
+ * it yet. Without CONFIG_DFU_WRITE_PINGPONG this is dfu_write_buffer_drain().
+ */
+static int dfu_write_buffer_queue(struct dfu_entity *dfu)
+{
+	u8 *next;
+	int ret;
+
+	if (!IS_ENABLED(CONFIG_DFU_WRITE_PINGPONG))
+		return dfu_write_buffer_drain(dfu);
+
+	if (dfu->p_buf) {
+		ret = dfu_write_pending_slice(dfu, LONG_MAX);
+		if (ret)
+			return ret;
+	}
+
+	if (dfu->i_buf_start == dfu_buf) {
+		if (!dfu_buf_alt)
+			dfu_buf_alt = memalign(CONFIG_SYS_CACHELINE_SIZE,
+					       dfu_buf_size);
+		next = dfu_buf_alt;
+	} else if (dfu->i_buf_start == dfu_buf_alt) {
+		next = dfu_buf;
+	} else {
+		next = NULL;
+	}
+	if (!next)
+		return dfu_write_buffer_drain(dfu);
+
+	dfu->p_buf = dfu->i_buf_start;
+	dfu->p_buf_end = dfu->i_buf;
+	dfu_pending = dfu;
+
+	dfu->i_buf_start = next;
+	dfu->i_buf_end = next + dfu_buf_size;
+	dfu->i_buf = next;
+
+	return 0;
+}
+
+#ifdef CONFIG_DFU_WRITE_PINGPONG
+int dfu_write_poll(void)
+{
+	struct dfu_entity *dfu = dfu_pending;
+	int ret;
+
+	if (!dfu)
+		return 0;
+
+	ret = dfu_write_pending_slice(dfu, CONFIG_DFU_WRITE_SLICE_SIZE);
+	if (ret) {
+		dfu_transaction_cleanup(dfu);
+		dfu_error_callback(dfu, "DFU write error");
+	}
+
+	return ret;
+}
+#endif
+
+/*
+ * Check whether @buf can be written to the medium as it is, rather than being
+ * copied into the DFU buffer first. That is always so if it already is the DFU
+ * buffer (thor receives into it); otherwise it must be aligned for DMA and
+ * large enough for skipping the copy to pay off.
+ */
+static bool dfu_write_direct(struct dfu_entity *dfu, void *buf, int size)
+{
+	if (!size || dfu->i_buf != dfu->i_buf_start)
+		return false;
+
+	if (buf == dfu->i_buf_start)
+		return true;
+
+	return IS_ENABLED(CONFIG_DFU_WRITE_ZERO_COPY) &&
+	       IS_ALIGNED((ulong)buf, ARCH_DMA_MINALIGN) &&
+	       size >= DFU_ZERO_COPY_MIN && IS_ALIGNED(size, DFU_ZERO_COPY_MIN);
+}
+
 void dfu_transaction_cleanup(struct dfu_entity *dfu)
 {
 	/* clear everything */
@@ -279,6 +412,10 @@ void dfu_transaction_cleanup(struct dfu_entity *dfu)
 	dfu->i_buf_start = dfu_get_buf(dfu);
 	dfu->i_buf_end = dfu->i_buf_start;
 	dfu->i_buf = dfu->i_buf_start;
+	dfu->p_buf = NULL;
+	dfu->p_buf_end = NULL;
+	if (dfu_pending == dfu)
+		dfu_pending = NULL;
 	dfu->r_left = 0;
 	dfu->b_left = 0;
 	dfu->bad_skip = 0;
@@ -371,9 +508,22 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	/* handle rollover */
 	dfu->i_blk_seq_num = (dfu->i_blk_seq_num + 1) & 0xffff;
 
+	if (dfu_write_direct(dfu, buf, size)) {
+		ret = dfu_write_buffer_drain(dfu);
+		if (!ret)
+			ret = dfu_write_medium_buf(dfu, buf, size);
+		if (ret) {
+			dfu_transaction_cleanup(dfu);
+			dfu_error_callback(dfu, "DFU write error");
+			return ret;
+		}
+		puts("#");
+		return 0;
+	}
+
 	/* flush buffer if overflow */
 	if ((dfu->i_buf + size) > dfu->i_buf_end) {
-		ret = dfu_write_buffer_drain(dfu);
+		ret = dfu_write_buffer_queue(dfu);
 		if (ret) {
 			dfu_transaction_cleanup(dfu);
 			dfu_error_callback(dfu, "DFU write error");
@@ -395,7 +545,10 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 
 	/* if end or if buffer full flush */
 	if (size == 0 || (dfu->i_buf + size) > dfu->i_buf_end) {
-		ret = dfu_write_buffer_drain(dfu);
+		if (size)
+			ret = dfu_write_buffer_queue(dfu);
+		else
+			ret = dfu_write_buffer_drain(dfu);
 		if (ret) {
 			dfu_transaction_cleanup(dfu);
 			dfu_error_callback(dfu, "DFU write error");
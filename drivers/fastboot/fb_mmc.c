@@ -14,18 +14,35 @@
 #include <image-sparse.h>
 #include <image.h>
 #include <log.h>
+#include <malloc.h>
 #include <part.h>
 #include <mmc.h>
 #include <div64.h>
 #include <linux/compat.h>
+#include <linux/sizes.h>
 #include <android_image.h>
+#include <asm/cache.h>
 
 #define FASTBOOT_MAX_BLK_WRITE 16384
 
 #define BOOT_PARTITION_NAME "boot"
 
+#define FASTBOOT_MMC_QUEUE_LEN		32
+#define FASTBOOT_MMC_STAGING_SIZE	SZ_4M
+
 struct fb_mmc_sparse {
 	struct blk_desc	*dev_desc;
+#if CONFIG_IS_ENABLED(MMC_CQE)
+	/* Writes waiting to be submitted to the device as one batch */
+	struct blk_req queue[FASTBOOT_MMC_QUEUE_LEN];
+	int queued;
+	/* Data within the downloaded image is written from where it is */
+	const void *image;
+	size_t image_size;
+	/* Other data, e.g. fill patterns, is copied here */
+	void *staging;
+	size_t staged;
+#endif
 };
 
 static int raw_part_get_info_by_name(struct blk_desc *dev_desc,
@@ -153,13 +170,101 @@ static lbaint_t fb_mmc_blk_write(struct blk_desc *block_dev, lbaint_t start,
 	return blks;
 }
 
+#if CONFIG_IS_ENABLED(MMC_CQE)
+/**
+ * fb_mmc_sparse_flush() - submit the queued writes of a sparse image
+ *
+ * @sparse: Sparse image write state
+ * Return: 0 on success, -ve on error
+ */
+static int fb_mmc_sparse_flush(struct fb_mmc_sparse *sparse)
+{
+	int ret = 0;
+
+	if (sparse->queued) {
+		if (fastboot_progress_callback)
+			fastboot_progress_callback("writing");
+		ret = blk_drw_multi(sparse->dev_desc, sparse->queue,
+				    sparse->queued);
+	}
+	sparse->queued = 0;
+	sparse->staged = 0;
+
+	return ret;
+}
+
+/**
+ * fb_mmc_sparse_queue() - queue a write of a sparse image chunk
+ *
+ * The writes are collected so that a device with command queueing gets
+ * several of them at once. The image-sparse code reuses its buffers for
+ * fill and unaligned chunks, so data from outside the downloaded image is
+ * copied to the staging buffer first. Errors are reported when the queue is
+ * flushed.
+ *
+ * @sparse: Sparse image write state
+ * @blk: First block to write
+ * @blkcnt: Count of blocks
+ * @buffer: Pointer to data buffer
+ * Return: number of blocks written or queued
+ */
+static lbaint_t fb_mmc_sparse_queue(struct fb_mmc_sparse *sparse,
+				    lbaint_t blk, lbaint_t blkcnt,
+				    const void *buffer)
+{
+	ulong blksz = sparse->dev_desc->blksz;
+	bool copy;
+	int i;
+
+	copy = buffer < sparse->image ||
+	       buffer + blkcnt * blksz > sparse->image + sparse->image_size ||
+	       !IS_ALIGNED((ulong)buffer, ARCH_DMA_MINALIGN);
+	if (copy && (!sparse->staging ||
+		     blkcnt * blksz > FASTBOOT_MMC_STAGING_SIZE)) {
+		if (fb_mmc_sparse_flush(sparse))
+			return 0;
+		return fb_mmc_blk_write(sparse->dev_desc, blk, blkcnt, buffer);
+	}
+
+	for (i = 0; i < blkcnt; i += FASTBOOT_MAX_BLK_WRITE) {
+		struct blk_req *req;
+		lbaint_t n = min((int)blkcnt - i, FASTBOOT_MAX_BLK_WRITE);
+		void *data = (void *)buffer + i * blksz;
+
+		if (sparse->queued == FASTBOOT_MMC_QUEUE_LEN ||
+		    (copy && sparse->staged + n * blksz >
+		     FASTBOOT_MMC_STAGING_SIZE)) {
+			if (fb_mmc_sparse_flush(sparse))
+				return i;
+		}
+		if (copy) {
+			memcpy(sparse->staging + sparse->staged, data,
+			       n * blksz);
+			data = sparse->staging + sparse->staged;
+			sparse->staged += ALIGN(n * blksz, ARCH_DMA_MINALIGN);
+		}
+
+		req = &sparse->queue[sparse->queued++];
+		req->start = blk + i;
+		req->blkcnt = n;
+		req->buffer = data;
+		req->write = true;
+	}
+
+	return blkcnt;
+}
+#endif
+
 static lbaint_t fb_mmc_sparse_write(struct sparse_storage *info,
 		lbaint_t blk, lbaint_t blkcnt, const void *buffer)
 {
 	struct fb_mmc_sparse *sparse = info->priv;
-	struct blk_desc *dev_desc = sparse->dev_desc;
 
-	return fb_mmc_blk_write(dev_desc, blk, blkcnt, buffer);
+#if CONFIG_IS_ENABLED(MMC_CQE)
+	return fb_mmc_sparse_queue(sparse, blk, blkcnt, buffer);
+#else
+	return fb_mmc_blk_write(sparse->dev_desc, blk, blkcnt, buffer);
+#endif
 }
 
 static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
@@ -611,6 +716,14 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		int err;
 
 		sparse_priv.dev_desc = dev_desc;
+#if CONFIG_IS_ENABLED(MMC_CQE)
+		sparse_priv.queued = 0;
+		sparse_priv.image = download_buffer;
+		sparse_priv.image_size = download_bytes;
+		sparse_priv.staging = memalign(ARCH_DMA_MINALIGN,
+					       FASTBOOT_MMC_STAGING_SIZE);
+		sparse_priv.staged = 0;
+#endif
 
 		sparse.blksz = info.blksz;
 		sparse.start = info.start;
@@ -625,6 +738,13 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		sparse.priv = &sparse_priv;
 		err = write_sparse_image(&sparse, cmd, download_buffer,
 					 response);
+#if CONFIG_IS_ENABLED(MMC_CQE)
+		if (!err && fb_mmc_sparse_flush(&sparse_priv)) {
+			fastboot_fail("failed writing to device", response);
+			err = -EIO;
+		}
+		free(sparse_priv.staging);
+#endif
 		if (!err)
 			fastboot_okay(NULL, response);
 	} else {
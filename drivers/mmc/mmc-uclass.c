@@ -159,6 +159,23 @@ int mmc_hs400_prepare_ddr(struct mmc *mmc)
 	return dm_mmc_hs400_prepare_ddr(mmc->dev);
 }
 
+#if CONFIG_IS_ENABLED(MMC_CQE)
+static int dm_mmc_cqe_request(struct udevice *dev, struct blk_req *reqs,
+			      int count)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+
+	if (!ops->cqe_request)
+		return -ENOSYS;
+	return ops->cqe_request(dev, reqs, count);
+}
+
+int mmc_cqe_request(struct mmc *mmc, struct blk_req *reqs, int count)
+{
+	return dm_mmc_cqe_request(mmc->dev, reqs, count);
+}
+#endif
+
 static int dm_mmc_host_power_cycle(struct udevice *dev)
 {
 	struct dm_mmc_ops *ops = mmc_get_ops(dev);
@@ -490,6 +507,9 @@ static const struct blk_ops mmc_blk_ops = {
 	.erase	= mmc_berase,
 #endif
 	.select_hwpart	= mmc_select_hwpart,
+#if CONFIG_IS_ENABLED(MMC_CQE)
+	.rw_multi	= mmc_brw_multi,
+#endif
 };
 
 U_BOOT_DRIVER(mmc_blk) = {
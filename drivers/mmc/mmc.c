@@ -2066,6 +2066,8 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 	int err = 0;
 	const struct mode_width_tuning *mwt;
 	const struct ext_csd_bus_width *ecbw;
+	const struct mmc_init_rec *rec = NULL;
+	bool full = card_caps == mmc->card_caps;
 
 #ifdef DEBUG
 	mmc_dump_capabilities("mmc", card_caps);
@@ -2107,10 +2109,19 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 #endif
 		mmc_set_clock(mmc, mmc->legacy_speed, MMC_CLK_ENABLE);
 
+	/* Try what an earlier boot phase selected first */
+	if (full)
+		rec = mmc_fast_init_find(mmc);
+retry:
 	for_each_mmc_mode_by_pref(card_caps, mwt) {
+		if (rec && mwt->mode != rec->mode)
+			continue;
 		for_each_supported_width(card_caps & mwt->widths,
 					 mmc_is_mode_ddr(mwt->mode), ecbw) {
 			enum mmc_voltage old_voltage;
+
+			if (rec && bus_width(ecbw->cap) != rec->bus_width)
+				continue;
 			pr_debug("trying mode %s width %d (at %d MHz)\n",
 				 mmc_mode_name(mwt->mode),
 				 bus_width(ecbw->cap),
@@ -2182,8 +2193,11 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 
 			/* do a transfer to check the configuration */
 			err = mmc_read_and_compare_ext_csd(mmc);
-			if (!err)
+			if (!err) {
+				if (full && !rec)
+					mmc_fast_init_save(mmc);
 				return 0;
+			}
 error:
 			mmc_set_signal_voltage(mmc, old_voltage);
 			/* if an error occurred, revert to a safer bus mode */
@@ -2194,6 +2208,12 @@ error:
 		}
 	}
 
+	if (rec) {
+		pr_debug("recorded bus setup failed, trying all modes\n");
+		rec = NULL;
+		goto retry;
+	}
+
 	pr_err("unable to select a mode : %d\n", err);
 
 	return -ENOTSUPP;
@@ -2399,6 +2419,14 @@ static int mmc_startup_v4(struct mmc *mmc)
 
 	mmc->wr_rel_set = ext_csd[EXT_CSD_WR_REL_SET];
 
+#if CONFIG_IS_ENABLED(MMC_CQE)
+	if (mmc->version >= MMC_VERSION_5_1 &&
+	    (ext_csd[EXT_CSD_CMDQ_SUPPORT] & 0x1))
+		mmc->cmdq_depth = (ext_csd[EXT_CSD_CMDQ_DEPTH] & 0x1f) + 1;
+	else
+		mmc->cmdq_depth = 0;
+#endif
+
 	return 0;
 error:
 	if (mmc->ext_csd) {
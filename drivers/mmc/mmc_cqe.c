@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * eMMC command queueing
+ *
+ * In command queueing mode an eMMC device accepts up to 32 tagged read and
+ * write tasks and works on them in any order, while the host's command queue
+ * engine (CQE) sends them and tracks their completion. Plain read and write
+ * commands are not allowed in this mode, so it is only enabled while a batch
+ * submitted with blk_drw_multi() is being carried out.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <log.h>
+#include <mmc.h>
+#include <asm/cache.h>
+#include "mmc_private.h"
+
+static bool mmc_cqe_usable(struct mmc *mmc, struct blk_desc *block_dev,
+			   struct blk_req *reqs, int count)
+{
+	int i;
+
+	/* Switching the mode costs two commands, not worth it for one */
+	if (count < 2 || !mmc->cmdq_depth || !mmc->high_capacity ||
+	    !(mmc->cfg->host_caps & MMC_CAP_CQE) ||
+	    block_dev->blksz != MMC_MAX_BLOCK_LEN)
+		return false;
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].write && !CONFIG_IS_ENABLED(MMC_WRITE))
+			return false;
+		/* The block count of a task is 16 bits wide */
+		if (!reqs[i].blkcnt || reqs[i].blkcnt > 0xffff ||
+		    reqs[i].blkcnt > mmc->cfg->b_max ||
+		    reqs[i].start + reqs[i].blkcnt > block_dev->lba)
+			return false;
+		if (!IS_ALIGNED((ulong)reqs[i].buffer, ARCH_DMA_MINALIGN))
+			return false;
+	}
+
+	return true;
+}
+
+static int mmc_brw_each(struct udevice *dev, struct blk_req *reqs, int count)
+{
+	ulong n;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].write)
+			n = mmc_bwrite(dev, reqs[i].start, reqs[i].blkcnt,
+				       reqs[i].buffer);
+		else
+			n = mmc_bread(dev, reqs[i].start, reqs[i].blkcnt,
+				      reqs[i].buffer);
+		if (n != reqs[i].blkcnt)
+			return -EIO;
+	}
+
+	return 0;
+}
+
+/* Drop whatever the device still has queued after a failed batch */
+static int mmc_cqe_discard(struct mmc *mmc)
+{
+	struct mmc_cmd cmd;
+
+	cmd.cmdidx = MMC_CMD_CMDQ_TASK_MGMT;
+	cmd.cmdarg = 1;		/* discard the entire queue */
+	cmd.resp_type = MMC_RSP_R1b;
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
+int mmc_brw_multi(struct udevice *dev, struct blk_req *reqs, int count)
+{
+	struct blk_desc *block_dev = dev_get_uclass_plat(dev);
+	struct mmc *mmc;
+	int i, n, ret, err;
+
+	mmc = find_mmc_device(block_dev->devnum);
+	if (!mmc)
+		return -ENODEV;
+
+	if (!mmc_cqe_usable(mmc, block_dev, reqs, count))
+		return mmc_brw_each(dev, reqs, count);
+
+	ret = blk_select_hwpart_devnum(IF_TYPE_MMC, block_dev->devnum,
+				       block_dev->hwpart);
+	if (ret < 0)
+		return ret;
+
+	ret = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN, 1);
+	if (ret) {
+		log_debug("Cannot enable command queueing (err=%d)\n", ret);
+		return mmc_brw_each(dev, reqs, count);
+	}
+
+	for (i = 0; i < count; i += n) {
+		n = min(count - i, (int)mmc->cmdq_depth);
+		ret = mmc_cqe_request(mmc, reqs + i, n);
+		if (ret) {
+			log_debug("Command queue failed (err=%d)\n", ret);
+			mmc_cqe_discard(mmc);
+			break;
+		}
+	}
+
+	err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN, 0);
+
+	return ret ? ret : err;
+}
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Reuse of the eMMC bus setup between boot phases
+ *
+ * Selecting the bus mode walks through the modes supported by the device and
+ * the host, trying each in turn. The result is kept in the bloblist so that a
+ * later phase initialising the same device, e.g. U-Boot proper after SPL,
+ * tries it first and only falls back to the full selection if it does not
+ * work. Tuning is not recorded, so HS200/HS400 are tuned again.
+ */
+
+#define LOG_CATEGORY UCLASS_MMC
+
+#include <common.h>
+#include <bloblist.h>
+#include <log.h>
+#include <mmc.h>
+#include "mmc_private.h"
+
+#define MMC_INIT_RECS	4
+
+/**
+ * struct mmc_init_cache - bloblist record of eMMC bus setups
+ *
+ * @count:	Number of entries used in @rec
+ * @rec:	Bus setup per device
+ */
+struct mmc_init_cache {
+	u32 count;
+	struct mmc_init_rec rec[MMC_INIT_RECS];
+};
+
+static struct mmc_init_rec *mmc_fast_init_lookup(struct mmc_init_cache *cache,
+						 struct mmc *mmc)
+{
+	int i;
+
+	for (i = 0; i < cache->count && i < MMC_INIT_RECS; i++) {
+		if (!memcmp(cache->rec[i].cid, mmc->cid, sizeof(mmc->cid)))
+			return &cache->rec[i];
+	}
+
+	return NULL;
+}
+
+const struct mmc_init_rec *mmc_fast_init_find(struct mmc *mmc)
+{
+	struct mmc_init_cache *cache;
+	struct mmc_init_rec *rec;
+
+	cache = bloblist_find(BLOBLISTT_U_BOOT_MMC_INIT, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	rec = mmc_fast_init_lookup(cache, mmc);
+	if (!rec)
+		return NULL;
+
+	log_debug("%s: trying %s, %d bits\n", mmc->cfg->name,
+		  mmc_mode_name(rec->mode), rec->bus_width);
+
+	return rec;
+}
+
+void mmc_fast_init_save(struct mmc *mmc)
+{
+	struct mmc_init_cache *cache;
+	struct mmc_init_rec *rec;
+
+	cache = bloblist_ensure(BLOBLISTT_U_BOOT_MMC_INIT, sizeof(*cache));
+	if (!cache)
+		return;
+
+	rec = mmc_fast_init_lookup(cache, mmc);
+	if (!rec) {
+		if (cache->count >= MMC_INIT_RECS)
+			return;
+		rec = &cache->rec[cache->count++];
+	}
+
+	memcpy(rec->cid, mmc->cid, sizeof(rec->cid));
+	rec->mode = mmc->selected_mode;
+	rec->bus_width = mmc->bus_width;
+}
@@ -25,6 +25,10 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		void *dst);
 #endif
 
+#if CONFIG_IS_ENABLED(MMC_CQE)
+int mmc_brw_multi(struct udevice *dev, struct blk_req *reqs, int count);
+#endif
+
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 
 #if CONFIG_IS_ENABLED(BLK)
@@ -132,4 +136,44 @@ int mmc_switch_part(struct mmc *mmc, unsigned int part_num);
  */
 int mmc_switch(struct mmc *mmc, u8 set, u8 index, u8 value);
 
+/**
+ * struct mmc_init_rec - bus setup negotiated with an eMMC device
+ *
+ * @cid:	Card identification, to check that the device is the same
+ * @mode:	Selected bus mode (enum bus_mode)
+ * @bus_width:	Bus width in bits
+ */
+struct mmc_init_rec {
+	u32 cid[4];
+	u8 mode;
+	u8 bus_width;
+	u8 reserved[2];
+};
+
+#if CONFIG_IS_ENABLED(MMC_FAST_INIT)
+/**
+ * mmc_fast_init_find() - find the bus setup used by an earlier boot phase
+ *
+ * @mmc:	MMC device, with its CID read
+ * Return: record, or NULL if there is none for this device
+ */
+const struct mmc_init_rec *mmc_fast_init_find(struct mmc *mmc);
+
+/**
+ * mmc_fast_init_save() - record the bus setup selected for a device
+ *
+ * @mmc:	MMC device, with its mode and width selected
+ */
+void mmc_fast_init_save(struct mmc *mmc);
+#else
+static inline const struct mmc_init_rec *mmc_fast_init_find(struct mmc *mmc)
+{
+	return NULL;
+}
+
+static inline void mmc_fast_init_save(struct mmc *mmc)
+{
+}
+#endif
+
 #endif /* _MMC_PRIVATE_H_ */
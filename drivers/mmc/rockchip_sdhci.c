@@ -46,6 +46,7 @@
 
 #define ARASAN_VENDOR_REGISTER		0x78
 #define ARASAN_VENDOR_ENHANCED_STROBE	BIT(0)
+#define ARASAN_CQE_BASE_ADDR		0x200
 
 /* DWC IP vendor area 1 pointer */
 #define DWCMSHC_P_VENDOR_AREA1		0xe8
@@ -149,6 +150,9 @@ struct sdhci_data {
 	 * Return: 0 if successful, -ve on error
 	 */
 	int (*set_enhanced_strobe)(struct sdhci_host *host);
+
+	/* Offset of the CQHCI registers, 0 if there is no command queue engine */
+	u32 cqe_offset;
 };
 
 static int rk3399_emmc_phy_init(struct udevice *dev)
@@ -556,6 +560,10 @@ static int rockchip_sdhci_probe(struct udevice *dev)
 
 	host->ops = &rockchip_sdhci_ops;
 	host->quirks = SDHCI_QUIRK_WAIT_SEND_CMD;
+#if CONFIG_IS_ENABLED(MMC_SDHCI_CQE)
+	if (data->cqe_offset && dev_read_bool(dev, "supports-cqe"))
+		host->cqe_base = host->ioaddr + data->cqe_offset;
+#endif
 
 	host->mmc = &plat->mmc;
 	host->mmc->priv = &prv->host;
@@ -599,6 +607,7 @@ static const struct sdhci_data rk3399_data = {
 	.set_control_reg = rk3399_sdhci_set_control_reg,
 	.set_ios_post = rk3399_sdhci_set_ios_post,
 	.set_enhanced_strobe = rk3399_sdhci_set_enhanced_strobe,
+	.cqe_offset = ARASAN_CQE_BASE_ADDR,
 };
 
 static const struct sdhci_data rk3568_data = {
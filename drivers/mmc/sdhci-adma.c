@@ -9,9 +9,10 @@
 #include <malloc.h>
 #include <asm/cache.h>
 
-static void sdhci_adma_desc(struct sdhci_adma_desc *desc,
+static void sdhci_adma_desc(void *table, uint desc_len,
 			    dma_addr_t addr, u16 len, bool end)
 {
+	struct sdhci_adma_desc *desc = table;
 	u8 attr;
 
 	attr = ADMA_DESC_ATTR_VALID | ADMA_DESC_TRANSFER_DATA;
@@ -25,6 +26,44 @@ static void sdhci_adma_desc(struct sdhci_adma_desc *desc,
 #ifdef CONFIG_DMA_ADDR_T_64BIT
 	desc->addr_hi = upper_32_bits(addr);
 #endif
+	if (desc_len > sizeof(*desc))
+		memset(table + sizeof(*desc), '\0', desc_len - sizeof(*desc));
+}
+
+/**
+ * sdhci_adma_fill() - Describe a buffer in an ADMA table
+ *
+ * @table:	Pointer to the first free descriptor
+ * @desc_len:	Size of one descriptor, at least
+ *		sizeof(struct sdhci_adma_desc). Any padding is zeroed.
+ * @addr:	DMA address of the buffer
+ * @bytes:	Size of the buffer
+ * @end:	true if this is the last buffer of the transfer
+ *
+ * A transfer may be made up of several buffers which are not contiguous in
+ * memory, by filling them in one after the other. The caller must flush the
+ * table from the cache once it is complete.
+ *
+ * Return: number of descriptors written, 0 if @bytes is 0
+ */
+uint sdhci_adma_fill(void *table, uint desc_len, dma_addr_t addr, uint bytes,
+		     bool end)
+{
+	uint desc_count = DIV_ROUND_UP(bytes, ADMA_MAX_LEN);
+	int i = desc_count;
+
+	if (!bytes)
+		return 0;
+	while (--i) {
+		sdhci_adma_desc(table, desc_len, addr, ADMA_MAX_LEN, false);
+		addr += ADMA_MAX_LEN;
+		bytes -= ADMA_MAX_LEN;
+		table += desc_len;
+	}
+
+	sdhci_adma_desc(table, desc_len, addr, bytes, end);
+
+	return desc_count;
 }
 
 /**
@@ -42,25 +81,32 @@ static void sdhci_adma_desc(struct sdhci_adma_desc *desc,
 void sdhci_prepare_adma_table(struct sdhci_adma_desc *table,
 			      struct mmc_data *data, dma_addr_t addr)
 {
-	uint trans_bytes = data->blocksize * data->blocks;
-	uint desc_count = DIV_ROUND_UP(trans_bytes, ADMA_MAX_LEN);
-	struct sdhci_adma_desc *desc = table;
-	int i = desc_count;
-
-	while (--i) {
-		sdhci_adma_desc(desc, addr, ADMA_MAX_LEN, false);
-		addr += ADMA_MAX_LEN;
-		trans_bytes -= ADMA_MAX_LEN;
-		desc++;
-	}
+	uint desc_count;
 
-	sdhci_adma_desc(desc, addr, trans_bytes, true);
+	desc_count = sdhci_adma_fill(table, sizeof(*table), addr,
+				     data->blocksize * data->blocks, true);
 
 	flush_cache((dma_addr_t)table,
 		    ROUND(desc_count * sizeof(struct sdhci_adma_desc),
 			  ARCH_DMA_MINALIGN));
 }
 
+/**
+ * sdhci_adma_alloc() - allocate an ADMA descriptor table
+ *
+ * @max_bytes:	Largest transfer the table must be able to describe
+ * @desc_len:	Size of one descriptor
+ *
+ * Return: pointer to the allocated descriptor table or NULL in case of an
+ * error.
+ */
+void *sdhci_adma_alloc(uint max_bytes, uint desc_len)
+{
+	return memalign(ARCH_DMA_MINALIGN,
+			ROUND(DIV_ROUND_UP(max_bytes, ADMA_MAX_LEN) * desc_len,
+			      ARCH_DMA_MINALIGN));
+}
+
 /**
  * sdhci_adma_init() - initialize the ADMA descriptor table
  *
@@ -110,8 +110,21 @@ static void sdhci_prepare_dma(struct sdhci_host *host, struct mmc_data *data,
 	}
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	else if (host->flags & (USE_ADMA | USE_ADMA64)) {
-		sdhci_prepare_adma_table(host->adma_desc_table, data,
-					 host->start_addr);
+		/* Repeated transfers to the same buffer reuse the table */
+		if (host->start_addr != host->adma_prep_addr ||
+		    trans_bytes != host->adma_prep_bytes) {
+			uint count;
+
+			count = sdhci_adma_fill(host->adma_desc_table,
+						sizeof(struct sdhci_adma_desc),
+						host->start_addr, trans_bytes,
+						true);
+			flush_cache((ulong)host->adma_desc_table,
+				    ROUND(count * sizeof(struct sdhci_adma_desc),
+					  ARCH_DMA_MINALIGN));
+			host->adma_prep_addr = host->start_addr;
+			host->adma_prep_bytes = trans_bytes;
+		}
 
 		sdhci_writel(host, lower_32_bits(host->adma_addr),
 			     SDHCI_ADMA_ADDRESS);
@@ -814,6 +827,236 @@ static int sdhci_set_enhanced_strobe(struct udevice *dev)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(MMC_SDHCI_CQE)
+/*
+ * The command queueing engine takes a list of task descriptors, each followed
+ * by a link to the ADMA2 transfer descriptors for its data. All of them have
+ * the same size as the descriptors of the ADMA path: 128 bits with 64-bit
+ * DMA addresses, else 64 bits. A task moves at most U16_MAX blocks.
+ */
+#define CQHCI_SLOT_LEN		(CQHCI_TASK_DESC_LEN + ADMA_DESC_LEN)
+#define CQHCI_TRAN_TABLE_LEN	ROUND(DIV_ROUND_UP(U16_MAX * MMC_MAX_BLOCK_LEN, \
+						   ADMA_MAX_LEN) * \
+				      ADMA_DESC_LEN, ARCH_DMA_MINALIGN)
+#define CQHCI_TIMEOUT_MS	2000
+
+static inline u32 cqhci_readl(struct sdhci_host *host, int reg)
+{
+	return readl(host->cqe_base + reg);
+}
+
+static inline void cqhci_writel(struct sdhci_host *host, u32 val, int reg)
+{
+	writel(val, host->cqe_base + reg);
+}
+
+static int cqhci_wait(struct sdhci_host *host, int reg, u32 mask, u32 val)
+{
+	ulong start = get_timer(0);
+
+	while ((cqhci_readl(host, reg) & mask) != val) {
+		if (get_timer(start) > 100)
+			return -ETIMEDOUT;
+		udelay(10);
+	}
+
+	return 0;
+}
+
+static void cqhci_set_link(void *slot, dma_addr_t addr)
+{
+	struct sdhci_adma_desc *desc = slot + CQHCI_TASK_DESC_LEN;
+
+	memset(desc, '\0', ADMA_DESC_LEN);
+	desc->attr = ADMA_DESC_ATTR_VALID | ADMA_DESC_LINK_DESC;
+	desc->addr_lo = lower_32_bits(addr);
+#ifdef CONFIG_DMA_ADDR_T_64BIT
+	desc->addr_hi = upper_32_bits(addr);
+#endif
+}
+
+static int sdhci_cqe_alloc(struct sdhci_host *host)
+{
+	if (host->cqe_tdl)
+		return 0;
+
+	host->cqe_tdl = memalign(ARCH_DMA_MINALIGN,
+				 CQHCI_NUM_SLOTS * CQHCI_SLOT_LEN);
+	host->cqe_tran = memalign(ARCH_DMA_MINALIGN,
+				  CQHCI_NUM_SLOTS * CQHCI_TRAN_TABLE_LEN);
+	if (!host->cqe_tdl || !host->cqe_tran) {
+		free(host->cqe_tdl);
+		free(host->cqe_tran);
+		host->cqe_tdl = NULL;
+		host->cqe_tran = NULL;
+		return -ENOMEM;
+	}
+	memset(host->cqe_tdl, '\0', CQHCI_NUM_SLOTS * CQHCI_SLOT_LEN);
+
+	return 0;
+}
+
+static void sdhci_cqe_prep(struct sdhci_host *host, int tag,
+			   struct blk_req *req, dma_addr_t addr)
+{
+	void *slot = host->cqe_tdl + tag * CQHCI_SLOT_LEN;
+	void *tran = host->cqe_tran + tag * CQHCI_TRAN_TABLE_LEN;
+	u32 len = req->blkcnt * MMC_MAX_BLOCK_LEN;
+	u64 task;
+
+	task = CQHCI_TASK_VALID | CQHCI_TASK_END | CQHCI_TASK_INT |
+	       CQHCI_TASK_ACT_TASK | CQHCI_TASK_BLK_COUNT(req->blkcnt) |
+	       CQHCI_TASK_BLK_ADDR(req->start);
+	if (!req->write)
+		task |= CQHCI_TASK_DATA_DIR_READ;
+	memset(slot, '\0', CQHCI_TASK_DESC_LEN);
+	*(__le64 *)slot = cpu_to_le64(task);
+	cqhci_set_link(slot, dev_phys_to_bus(mmc_to_dev(host->mmc),
+					     virt_to_phys(tran)));
+	sdhci_adma_fill(tran, ADMA_DESC_LEN, addr, len, true);
+}
+
+static void sdhci_cqe_enable(struct sdhci_host *host)
+{
+	dma_addr_t tdl = dev_phys_to_bus(mmc_to_dev(host->mmc),
+					 virt_to_phys(host->cqe_tdl));
+	u32 cfg;
+	u8 ctrl;
+
+	/* The engine moves the data with ADMA2, in 512-byte blocks */
+	ctrl = sdhci_readb(host, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	if (host->flags & USE_ADMA64)
+		ctrl |= SDHCI_CTRL_ADMA64;
+	else
+		ctrl |= SDHCI_CTRL_ADMA32;
+	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
+	sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG,
+					    MMC_MAX_BLOCK_LEN),
+		     SDHCI_BLOCK_SIZE);
+	sdhci_writeb(host, 0xe, SDHCI_TIMEOUT_CONTROL);
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+	sdhci_writel(host, SDHCI_INT_CQE | SDHCI_INT_DATA_MASK |
+		     SDHCI_INT_CMD_MASK, SDHCI_INT_ENABLE);
+
+	cfg = cqhci_readl(host, CQHCI_CFG);
+	cfg &= ~(CQHCI_ENABLE | CQHCI_TASK_DESC_SZ | CQHCI_DCMD);
+	if (CQHCI_TASK_DESC_LEN == 16)
+		cfg |= CQHCI_TASK_DESC_SZ;
+	cqhci_writel(host, cfg, CQHCI_CFG);
+	cqhci_writel(host, lower_32_bits(tdl), CQHCI_TDLBA);
+	cqhci_writel(host, upper_32_bits(tdl), CQHCI_TDLBAU);
+	cqhci_writel(host, host->mmc->rca, CQHCI_SSC2);
+	cqhci_writel(host, CQHCI_IS_MASK, CQHCI_IS);
+	cqhci_writel(host, CQHCI_IS_MASK, CQHCI_ISTE);
+	cqhci_writel(host, 0, CQHCI_ISGE);	/* polled, no interrupt */
+	cqhci_writel(host, cfg | CQHCI_ENABLE, CQHCI_CFG);
+
+	if (cqhci_readl(host, CQHCI_CTL) & CQHCI_HALT)
+		cqhci_writel(host, 0, CQHCI_CTL);
+}
+
+static void sdhci_cqe_disable(struct sdhci_host *host, bool recover)
+{
+	cqhci_writel(host, CQHCI_HALT, CQHCI_CTL);
+	if (cqhci_wait(host, CQHCI_CTL, CQHCI_HALT, CQHCI_HALT))
+		log_debug("%s: CQE did not halt\n", host->name);
+	if (recover) {
+		cqhci_writel(host, CQHCI_HALT | CQHCI_CLEAR_ALL_TASKS,
+			     CQHCI_CTL);
+		cqhci_wait(host, CQHCI_TDBR, ~0U, 0);
+	}
+
+	cqhci_writel(host, cqhci_readl(host, CQHCI_CFG) & ~CQHCI_ENABLE,
+		     CQHCI_CFG);
+	cqhci_writel(host, 0, CQHCI_ISTE);
+	cqhci_writel(host, CQHCI_IS_MASK, CQHCI_IS);
+
+	if (recover) {
+		sdhci_reset(host, SDHCI_RESET_CMD);
+		sdhci_reset(host, SDHCI_RESET_DATA);
+	}
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+	sdhci_writel(host, SDHCI_INT_DATA_MASK | SDHCI_INT_CMD_MASK,
+		     SDHCI_INT_ENABLE);
+}
+
+static int sdhci_cqe_wait(struct sdhci_host *host, u32 pending)
+{
+	ulong start = get_timer(0);
+	u32 stat, done;
+
+	while (pending) {
+		stat = cqhci_readl(host, CQHCI_IS);
+		if (stat & (CQHCI_IS_RED | CQHCI_IS_TCL) ||
+		    sdhci_readl(host, SDHCI_INT_STATUS) & SDHCI_INT_ERROR) {
+			log_debug("%s: CQE error, status %x, task %x\n",
+				  host->name, stat,
+				  cqhci_readl(host, CQHCI_TERRI));
+			return -EIO;
+		}
+		if (stat & CQHCI_IS_TCC) {
+			/* Clear the status first so no completion is lost */
+			cqhci_writel(host, CQHCI_IS_TCC, CQHCI_IS);
+			done = cqhci_readl(host, CQHCI_TCN);
+			cqhci_writel(host, done, CQHCI_TCN);
+			pending &= ~done;
+			start = get_timer(0);
+			continue;
+		}
+		if (get_timer(start) > CQHCI_TIMEOUT_MS) {
+			printf("%s: CQE timeout, tasks %x pending\n",
+			       host->name, pending);
+			return -ETIMEDOUT;
+		}
+		udelay(10);
+	}
+
+	return 0;
+}
+
+static int sdhci_cqe_request(struct udevice *dev, struct blk_req *reqs,
+			     int count)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+	dma_addr_t addr[CQHCI_NUM_SLOTS];
+	uint len;
+	int i, ret;
+
+	if (!host->cqe_base)
+		return -ENOSYS;
+	if (count < 1 || count > CQHCI_NUM_SLOTS)
+		return -EINVAL;
+	ret = sdhci_cqe_alloc(host);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < count; i++) {
+		len = reqs[i].blkcnt * MMC_MAX_BLOCK_LEN;
+		addr[i] = dma_map_single(reqs[i].buffer, len,
+					 reqs[i].write ? DMA_TO_DEVICE :
+					 DMA_FROM_DEVICE);
+		sdhci_cqe_prep(host, i, &reqs[i],
+			       dev_phys_to_bus(mmc_to_dev(mmc), addr[i]));
+	}
+	flush_cache((ulong)host->cqe_tdl, CQHCI_NUM_SLOTS * CQHCI_SLOT_LEN);
+	flush_cache((ulong)host->cqe_tran, count * CQHCI_TRAN_TABLE_LEN);
+
+	sdhci_cqe_enable(host);
+	cqhci_writel(host, GENMASK(count - 1, 0), CQHCI_TDBR);
+	ret = sdhci_cqe_wait(host, GENMASK(count - 1, 0));
+	sdhci_cqe_disable(host, ret != 0);
+
+	for (i = 0; i < count; i++)
+		dma_unmap_single(addr[i], reqs[i].blkcnt * MMC_MAX_BLOCK_LEN,
+				 reqs[i].write ? DMA_TO_DEVICE :
+				 DMA_FROM_DEVICE);
+
+	return ret;
+}
+#endif
+
 const struct dm_mmc_ops sdhci_ops = {
 	.send_cmd	= sdhci_send_command,
 	.set_ios	= sdhci_set_ios,
@@ -826,6 +1069,9 @@ const struct dm_mmc_ops sdhci_ops = {
 #if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
 	.set_enhanced_strobe = sdhci_set_enhanced_strobe,
 #endif
+#if CONFIG_IS_ENABLED(MMC_SDHCI_CQE)
+	.cqe_request	= sdhci_cqe_request,
+#endif
 };
 #else
 static const struct mmc_ops sdhci_ops = {
@@ -868,9 +1114,6 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 		       __func__);
 		return -EINVAL;
 	}
-	host->adma_desc_table = sdhci_adma_init();
-	host->adma_addr = (dma_addr_t)host->adma_desc_table;
-
 #ifdef CONFIG_DMA_ADDR_T_64BIT
 	host->flags |= USE_ADMA64;
 #else
@@ -983,8 +1226,26 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 	if (host->host_caps)
 		cfg->host_caps |= host->host_caps;
 
+#if CONFIG_IS_ENABLED(MMC_SDHCI_CQE)
+	if (host->cqe_base)
+		cfg->host_caps |= MMC_CAP_CQE;
+#endif
+
 	cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
 
+#if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
+	/* The table is allocated once, for the largest transfer */
+	if (!host->adma_desc_table) {
+		host->adma_desc_table = sdhci_adma_alloc(cfg->b_max *
+							 MMC_MAX_BLOCK_LEN,
+							 sizeof(struct sdhci_adma_desc));
+		if (!host->adma_desc_table)
+			return -ENOMEM;
+	}
+	host->adma_addr = (dma_addr_t)host->adma_desc_table;
+	host->adma_prep_bytes = 0;
+#endif
+
 	return 0;
 }
 
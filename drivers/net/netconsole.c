@@ -15,6 +15,13 @@
 #define CONFIG_NETCONSOLE_BUFFER_SIZE 512
 #endif
 
+#ifndef CONFIG_NETCONSOLE_FLUSH_MS
+#define CONFIG_NETCONSOLE_FLUSH_MS 0
+#endif
+
+/* Room for a sequence number before the output, as in "[4294967295] " */
+#define NC_SEQ_MAX_LEN	13
+
 static char input_buffer[CONFIG_NETCONSOLE_BUFFER_SIZE];
 static int input_size; /* char count in input buffer */
 static int input_offset; /* offset to valid chars in input buffer */
@@ -27,6 +34,14 @@ static short nc_out_port; /* target output port */
 static short nc_in_port; /* source input port */
 static const char *output_packet; /* used by first send udp */
 static int output_packet_len;
+static char output_buffer[NC_SEQ_MAX_LEN + CONFIG_NETCONSOLE_BUFFER_SIZE];
+static int output_size; /* char count in output buffer */
+static ulong output_start; /* time when the output buffer was started */
+static u32 output_seq; /* sequence number of the next packet */
+static bool nc_seq; /* put sequence numbers in packets */
+static ulong nc_rate; /* most bytes to send per second, or 0 for no limit */
+static u64 nc_credit; /* bytes which may be sent now, times 1000 */
+static ulong nc_credit_time; /* time when nc_credit was last updated */
 /*
  * Start with a default last protocol.
  * We are only interested in NETCONS or not.
@@ -78,6 +93,7 @@ static int refresh_settings_from_env(void)
 	const char *p;
 	static int env_changed_id;
 	int env_id = env_get_id();
+	ulong rate;
 
 	/* update only when the environment has changed */
 	if (env_changed_id != env_id) {
@@ -101,6 +117,15 @@ static int refresh_settings_from_env(void)
 		if (p != NULL)
 			nc_in_port = dectoul(p, NULL);
 
+		nc_seq = env_get_yesno("ncseq") == 1;
+		/* Keep the credit across unrelated changes to the environment */
+		rate = env_get_ulong("ncrate", 10, 0);
+		if (rate != nc_rate) {
+			nc_rate = rate;
+			nc_credit = (u64)nc_rate * 1000;
+			nc_credit_time = get_timer(0);
+		}
+
 		if (is_broadcast(nc_ip))
 			/* broadcast MAC address */
 			memset(nc_ether, 0xff, sizeof(nc_ether));
@@ -225,6 +250,110 @@ static void nc_send_packet(const char *buf, int len)
 	}
 }
 
+/* Check whether @len bytes may be sent now without going over 'ncrate' */
+static bool nc_rate_allow(int len)
+{
+	u64 max = (u64)nc_rate * 1000;
+	ulong now, elapsed;
+
+	if (!nc_rate)
+		return true;
+
+	/* Allow up to a second's worth of output in a burst */
+	now = get_timer(0);
+	elapsed = now - nc_credit_time;
+	if (elapsed >= 1000)
+		nc_credit = max;
+	else
+		nc_credit = min(nc_credit + (u64)nc_rate * elapsed, max);
+	nc_credit_time = now;
+	if (nc_credit < len * 1000ULL)
+		return false;
+	nc_credit -= len * 1000ULL;
+
+	return true;
+}
+
+/* Send what is in the output buffer as one packet */
+static void nc_flush_output(void)
+{
+	char *start = output_buffer + NC_SEQ_MAX_LEN;
+	char seq[NC_SEQ_MAX_LEN + 1];
+	int len = output_size;
+	int seq_len;
+
+	if (!len)
+		return;
+	output_size = 0;
+
+	if (nc_seq) {
+		seq_len = snprintf(seq, sizeof(seq), "[%u] ", output_seq);
+		start -= seq_len;
+		memcpy(start, seq, seq_len);
+		len += seq_len;
+	}
+	/* Dropped packets still use a number, so the loss can be seen */
+	output_seq++;
+
+	if (nc_rate_allow(len))
+		nc_send_packet(start, len);
+}
+
+/* Check whether output has been held for CONFIG_NETCONSOLE_FLUSH_MS */
+static bool nc_output_stale(void)
+{
+	return output_size &&
+	       get_timer(output_start) >= CONFIG_NETCONSOLE_FLUSH_MS;
+}
+
+/*
+ * Add output to the buffer, sending it at the end of each line, when the
+ * buffer is full, or when it has been held for CONFIG_NETCONSOLE_FLUSH_MS
+ */
+static void nc_output(const char *s, int len)
+{
+	char *out = output_buffer + NC_SEQ_MAX_LEN;
+	const char *nl;
+	int chunk;
+
+	if (nc_output_stale())
+		nc_flush_output();
+
+	while (len) {
+		if (!output_size)
+			output_start = get_timer(0);
+		chunk = min(len, CONFIG_NETCONSOLE_BUFFER_SIZE - output_size);
+		nl = memchr(s, '\n', chunk);
+		if (nl)
+			chunk = nl - s + 1;
+		memcpy(out + output_size, s, chunk);
+		output_size += chunk;
+		s += chunk;
+		len -= chunk;
+
+		if (nl || output_size == CONFIG_NETCONSOLE_BUFFER_SIZE)
+			nc_flush_output();
+	}
+
+	if (!IS_ENABLED(CONFIG_NETCONSOLE_BATCH))
+		nc_flush_output();
+}
+
+/*
+ * Send held output, e.g. a prompt, before waiting for input. If @all is
+ * false, only output held for longer than the hold time is sent.
+ */
+static void nc_flush(bool all)
+{
+	if (output_recursion || (!all && !nc_output_stale()))
+		return;
+	output_recursion = 1;
+
+	nc_flush_output();
+
+	output_recursion = 0;
+}
+
 static int nc_stdio_start(struct stdio_dev *dev)
 {
 	int retval;
@@ -251,26 +380,18 @@ static void nc_stdio_putc(struct stdio_dev *dev, char c)
 		return;
 	output_recursion = 1;
 
-	nc_send_packet(&c, 1);
+	nc_output(&c, 1);
 
 	output_recursion = 0;
 }
 
 static void nc_stdio_puts(struct stdio_dev *dev, const char *s)
 {
-	int len;
-
 	if (output_recursion)
 		return;
 	output_recursion = 1;
 
-	len = strlen(s);
-	while (len) {
-		int send_len = min(len, (int)sizeof(input_buffer));
-		nc_send_packet(s, send_len);
-		len -= send_len;
-		s += send_len;
-	}
+	nc_output(s, strlen(s));
 
 	output_recursion = 0;
 }
@@ -279,6 +400,7 @@ static int nc_stdio_getc(struct stdio_dev *dev)
 {
 	uchar c;
 
+	nc_flush(true);
 	input_recursion = 1;
 
 	net_timeout = 0;	/* no timeout */
@@ -310,6 +432,8 @@ static int nc_stdio_tstc(struct stdio_dev *dev)
 	if (input_size)
 		return 1;
 
+	/* This is polled often, so do not send each character on its own */
+	nc_flush(false);
 	eth = eth_get_dev();
 	if (eth_is_active(eth))
 		return 0;	/* inside net loop */
@@ -324,6 +448,13 @@ static int nc_stdio_tstc(struct stdio_dev *dev)
 	return input_size != 0;
 }
 
+static int nc_stdio_stop(struct stdio_dev *dev)
+{
+	nc_flush(true);
+
+	return 0;
+}
+
 int drv_nc_init(void)
 {
 	struct stdio_dev dev;
@@ -334,6 +465,7 @@ int drv_nc_init(void)
 	strcpy(dev.name, "nc");
 	dev.flags = DEV_FLAGS_OUTPUT | DEV_FLAGS_INPUT;
 	dev.start = nc_stdio_start;
+	dev.stop = nc_stdio_stop;
 	dev.putc = nc_stdio_putc;
 	dev.puts = nc_stdio_puts;
 	dev.getc = nc_stdio_getc;
@@ -10,10 +10,13 @@
 #include <dm.h>
 #include <log.h>
 #include <malloc.h>
+#include <ndisc.h>
 #include <net.h>
+#include <net6.h>
 #include <asm/eth.h>
 #include <asm/global_data.h>
 #include <asm/test.h>
+#include <asm/unaligned.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -49,6 +52,23 @@ void sandbox_eth_skip_timeout(void)
 	skip_timeout = true;
 }
 
+/*
+ * sb_eth_rx_full()
+ *
+ * Check whether the receive ring has room for another packet, counting an
+ * overrun if not, as a real controller would when it drops a frame
+ */
+static bool sb_eth_rx_full(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	if (priv->recv_packets < PKTBUFSRX)
+		return false;
+	eth_get_stats(dev)->rx_overruns++;
+
+	return true;
+}
+
 /*
  * sandbox_eth_arp_req_to_reply()
  *
@@ -74,7 +94,7 @@ int sandbox_eth_arp_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (sb_eth_rx_full(dev))
 		return 0;
 
 	/* store this as the assumed IP of the fake host */
@@ -136,7 +156,7 @@ int sandbox_eth_ping_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (sb_eth_rx_full(dev))
 		return 0;
 
 	/* reply to the ping */
@@ -176,7 +196,7 @@ int sandbox_eth_recv_arp_req(struct udevice *dev)
 	struct arp_hdr *arp_recv;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (sb_eth_rx_full(dev))
 		return -EOVERFLOW;
 
 	/* Formulate a fake request */
@@ -218,7 +238,7 @@ int sandbox_eth_recv_ping_req(struct udevice *dev)
 	struct icmp_hdr *icmpr;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (sb_eth_rx_full(dev))
 		return -EOVERFLOW;
 
 	/* Formulate a fake ping */
@@ -254,6 +274,673 @@ int sandbox_eth_recv_ping_req(struct udevice *dev)
 	return 0;
 }
 
+#ifdef CONFIG_IPV6
+/* Prefix which the fake host advertises as a router */
+static const struct in6_addr sb_ip6_prefix = {
+	.s6_addr = { 0x20, 0x01, 0x0d, 0xb8 },
+};
+
+/*
+ * sb_eth_ip6_reply()
+ *
+ * Inject an IPv6 packet, the ICMPv6 or UDP message having already been put in
+ * the next receive buffer. Its checksum is filled in here.
+ *
+ * priv - sandbox driver state
+ * dest_hwaddr - MAC address to send to
+ * src - source address
+ * dest - destination address
+ * nexthdr - IPPROTO_ICMPV6 or IPPROTO_UDP
+ * hop_limit - hop limit
+ * len - length of the message
+ */
+static void sb_eth_ip6_reply(struct eth_sandbox_priv *priv,
+			     const uchar *dest_hwaddr,
+			     const struct in6_addr *src,
+			     const struct in6_addr *dest, int nexthdr,
+			     int hop_limit, int len)
+{
+	struct ethernet_hdr *eth_recv;
+	struct ip6_hdr *ip6r;
+	struct icmp6_hdr *icmpr;
+	struct udp_hdr *udpr;
+	u16 csum;
+
+	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_recv->et_dest, dest_hwaddr, ARP_HLEN);
+	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_recv->et_protlen = htons(PROT_IPV6);
+
+	ip6r = (void *)eth_recv + ETHER_HDR_SIZE;
+	ip6_add_hdr((uchar *)ip6r, src, dest, nexthdr, hop_limit, len);
+	if (nexthdr == IPPROTO_UDP) {
+		udpr = (void *)(ip6r + 1);
+		udpr->udp_xsum = 0;
+		csum = net_ip6_csum(src, dest, len, nexthdr, udpr);
+		udpr->udp_xsum = htons(csum ? csum : 0xffff);
+	} else {
+		icmpr = (void *)(ip6r + 1);
+		icmpr->icmp6_cksum = 0;
+		icmpr->icmp6_cksum = htons(net_ip6_csum(src, dest, len,
+							nexthdr, icmpr));
+	}
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP6_HDR_SIZE + len;
+	++priv->recv_packets;
+}
+
+/*
+ * sb_eth_icmp6()
+ *
+ * Get the ICMPv6 message in a sent packet
+ *
+ * returns the message if there is one of the given type, else NULL
+ */
+static struct icmp6_hdr *sb_eth_icmp6(void *packet, unsigned int len,
+				      int type)
+{
+	struct ethernet_hdr *eth = packet;
+	struct ip6_hdr *ip6 = packet + ETHER_HDR_SIZE;
+	struct icmp6_hdr *icmp = (void *)(ip6 + 1);
+
+	if (ntohs(eth->et_protlen) != PROT_IPV6 ||
+	    len < ETHER_HDR_SIZE + IP6_HDR_SIZE + ICMP6_HDR_SIZE ||
+	    ip6->nexthdr != IPPROTO_ICMPV6 || icmp->icmp6_type != type)
+		return NULL;
+
+	return icmp;
+}
+
+/*
+ * sandbox_eth_nd_req_to_reply()
+ *
+ * Check for a neighbour solicitation to be sent. If so, inject an
+ * advertisement, as the fake host, of whatever address was asked for
+ *
+ * returns 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_nd_req_to_reply(struct udevice *dev, void *packet,
+				unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip6_hdr *ip6 = packet + ETHER_HDR_SIZE;
+	struct nd_msg *ns, *na;
+
+	ns = (struct nd_msg *)sb_eth_icmp6(packet, len, ICMPV6_NEIGHBOUR_SOL);
+	if (!ns)
+		return -EAGAIN;
+
+	/* Don't allow the buffer to overrun */
+	if (sb_eth_rx_full(dev))
+		return 0;
+
+	na = (void *)priv->recv_packet_buffer[priv->recv_packets] +
+		ETHER_HDR_SIZE + IP6_HDR_SIZE;
+	memset(na, '\0', sizeof(*na));
+	na->icmph.icmp6_type = ICMPV6_NEIGHBOUR_ADV;
+	na->icmph.un.na.flags = ND_NA_FLAG_ROUTER | ND_NA_FLAG_SOLICITED |
+				ND_NA_FLAG_OVERRIDE;
+	na->target = ns->target;
+	na->opt[0] = ND_OPT_TARGET_LL_ADDR;
+	na->opt[1] = ND_OPT_LLADDR_SIZE / 8;
+	memcpy(&na->opt[2], priv->fake_host_hwaddr, ARP_HLEN);
+	sb_eth_ip6_reply(priv, eth->et_src, &ns->target, &ip6->saddr,
+			 IPPROTO_ICMPV6, IP6_ND_HOP_LIMIT,
+			 sizeof(*na) + ND_OPT_LLADDR_SIZE);
+
+	return 0;
+}
+
+/*
+ * sandbox_eth_ping6_req_to_reply()
+ *
+ * Check for an ICMPv6 echo request to be sent. If so, inject a reply
+ *
+ * returns 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_ping6_req_to_reply(struct udevice *dev, void *packet,
+				   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip6_hdr *ip6 = packet + ETHER_HDR_SIZE;
+	struct icmp6_hdr *icmp, *icmpr;
+	int msg_len;
+
+	icmp = sb_eth_icmp6(packet, len, ICMPV6_ECHO_REQUEST);
+	if (!icmp)
+		return -EAGAIN;
+
+	/* Don't allow the buffer to overrun */
+	if (sb_eth_rx_full(dev))
+		return 0;
+
+	msg_len = ntohs(ip6->payload_len);
+	icmpr = (void *)priv->recv_packet_buffer[priv->recv_packets] +
+		ETHER_HDR_SIZE + IP6_HDR_SIZE;
+	memcpy(icmpr, icmp, msg_len);
+	icmpr->icmp6_type = ICMPV6_ECHO_REPLY;
+	sb_eth_ip6_reply(priv, eth->et_src, &ip6->daddr, &ip6->saddr,
+			 IPPROTO_ICMPV6, IP6_HOP_LIMIT, msg_len);
+
+	return 0;
+}
+
+/*
+ * sandbox_eth_rs_to_ra()
+ *
+ * Check for a router solicitation to be sent. If so, inject an advertisement
+ * of the fake host as a router, with the prefix 2001:db8::/64
+ *
+ * returns 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_rs_to_ra(struct udevice *dev, void *packet, unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip6_hdr *ip6 = packet + ETHER_HDR_SIZE;
+	struct nd_opt_prefix_info *pi;
+	struct in6_addr router;
+	struct ra_msg *ra;
+	u8 *opt;
+
+	if (!sb_eth_icmp6(packet, len, ICMPV6_ROUTER_SOL))
+		return -EAGAIN;
+
+	/* Don't allow the buffer to overrun */
+	if (sb_eth_rx_full(dev))
+		return 0;
+
+	ra = (void *)priv->recv_packet_buffer[priv->recv_packets] +
+		ETHER_HDR_SIZE + IP6_HDR_SIZE;
+	memset(ra, '\0', sizeof(*ra));
+	ra->icmph.icmp6_type = ICMPV6_ROUTER_ADV;
+	ra->icmph.un.ra.hop_limit = IP6_HOP_LIMIT;
+	ra->icmph.un.ra.lifetime = htons(1800);
+
+	pi = (void *)ra->opt;
+	memset(pi, '\0', sizeof(*pi));
+	pi->type = ND_OPT_PREFIX_INFO;
+	pi->len = sizeof(*pi) / 8;
+	pi->prefix_len = 64;
+	pi->flags = ND_PREFIX_FLAG_ONLINK | ND_PREFIX_FLAG_AUTO;
+	pi->valid_lifetime = htonl(86400);
+	pi->pref_lifetime = htonl(14400);
+	pi->prefix = sb_ip6_prefix;
+
+	opt = ra->opt + sizeof(*pi);
+	opt[0] = ND_OPT_SOURCE_LL_ADDR;
+	opt[1] = ND_OPT_LLADDR_SIZE / 8;
+	memcpy(&opt[2], priv->fake_host_hwaddr, ARP_HLEN);
+
+	ip6_make_lladdr(&router, priv->fake_host_hwaddr);
+	sb_eth_ip6_reply(priv, eth->et_src, &router, &ip6->saddr,
+			 IPPROTO_ICMPV6, IP6_ND_HOP_LIMIT,
+			 sizeof(*ra) + sizeof(*pi) + ND_OPT_LLADDR_SIZE);
+
+	return 0;
+}
+#endif
+
+/* TFTP packets handled by sandbox_eth_tftp_req_to_reply() */
+#define SB_TFTP_PORT		69
+#define SB_TFTP_DATA_PORT	1069
+#define SB_TFTP_RRQ		1
+#define SB_TFTP_DATA		3
+#define SB_TFTP_ACK		4
+#define SB_TFTP_OACK		6
+
+/* Port from which the sandbox TFTP server sends multicast data */
+#define SB_TFTP_MCAST_SRC	(SB_TFTP_DATA_PORT + SB_TFTP_SESSIONS)
+
+/*
+ * sb_eth_udp_send()
+ *
+ * Inject a UDP packet from the fake host over IPv4, the payload having already
+ * been put in the next receive buffer
+ *
+ * priv - sandbox driver state
+ * dest_hwaddr - MAC address to send to
+ * dest_ip - IP address to send to
+ * src_port - UDP port which the packet comes from
+ * dest_port - UDP port to send to
+ * len - length of the payload
+ */
+static void sb_eth_udp_send(struct eth_sandbox_priv *priv,
+			    const uchar *dest_hwaddr, struct in_addr dest_ip,
+			    int src_port, int dest_port, int len)
+{
+	struct ethernet_hdr *eth_recv;
+	struct ip_udp_hdr *ipr;
+
+	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_recv->et_dest, dest_hwaddr, ARP_HLEN);
+	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_recv->et_protlen = htons(PROT_IP);
+
+	ipr = (void *)eth_recv + ETHER_HDR_SIZE;
+	ipr->ip_hl_v = 0x45;
+	ipr->ip_tos = 0;
+	ipr->ip_len = htons(IP_UDP_HDR_SIZE + len);
+	ipr->ip_id = 0;
+	ipr->ip_off = htons(IP_FLAGS_DFRAG);
+	ipr->ip_ttl = 255;
+	ipr->ip_p = IPPROTO_UDP;
+	ipr->ip_sum = 0;
+	net_write_ip(&ipr->ip_src, priv->fake_host_ipaddr);
+	net_write_ip(&ipr->ip_dst, dest_ip);
+	ipr->ip_sum = compute_ip_checksum(ipr, IP_HDR_SIZE);
+	ipr->udp_src = htons(src_port);
+	ipr->udp_dst = htons(dest_port);
+	ipr->udp_len = htons(UDP_HDR_SIZE + len);
+	ipr->udp_xsum = 0;
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len;
+	++priv->recv_packets;
+}
+
+/*
+ * sb_eth_udp_reply()
+ *
+ * Inject a UDP reply to a sent packet, the payload having already been put in
+ * the next receive buffer
+ *
+ * priv - sandbox driver state
+ * packet - sent packet being replied to
+ * src_port - UDP port which the reply comes from
+ * len - length of the payload
+ */
+static void sb_eth_udp_reply(struct eth_sandbox_priv *priv, void *packet,
+			     int src_port, int len)
+{
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+
+#ifdef CONFIG_IPV6
+	if (ntohs(eth->et_protlen) == PROT_IPV6) {
+		struct ip6_hdr *ip6 = packet + ETHER_HDR_SIZE;
+		struct udp_hdr *udp = (void *)(ip6 + 1);
+		struct udp_hdr *udpr;
+
+		udpr = (void *)priv->recv_packet_buffer[priv->recv_packets] +
+			ETHER_HDR_SIZE + IP6_HDR_SIZE;
+		udpr->udp_src = htons(src_port);
+		udpr->udp_dst = udp->udp_src;
+		udpr->udp_len = htons(UDP_HDR_SIZE + len);
+		sb_eth_ip6_reply(priv, eth->et_src, &ip6->daddr, &ip6->saddr,
+				 IPPROTO_UDP, IP6_HOP_LIMIT,
+				 UDP_HDR_SIZE + len);
+		return;
+	}
+#endif
+
+	sb_eth_udp_send(priv, eth->et_src, net_read_ip(&ip->ip_src), src_port,
+			ntohs(ip->udp_src), len);
+}
+
+/*
+ * sb_tftp_mcast_send()
+ *
+ * Send a block of the file to the multicast group
+ *
+ * dev - sandbox device
+ * block - block to send
+ * lost - true if the real client is not to receive it
+ */
+static void sb_tftp_mcast_send(struct udevice *dev, int block, bool lost)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_tftp_mcast *mc = &priv->tftp_mcast;
+	u32 group = ntohl(mc->group.s_addr);
+	uchar hwaddr[ARP_HLEN] = { 0x01, 0x00, 0x5e };
+	uchar *reply;
+	int offset, size;
+
+	mc->sent++;
+	if (lost || sb_eth_rx_full(dev))
+		return;
+
+	offset = (block - 1) * mc->block_size;
+	size = min(priv->tftp_size - offset, mc->block_size);
+	reply = priv->recv_packet_buffer[priv->recv_packets] + ETHER_HDR_SIZE +
+		IP_UDP_HDR_SIZE;
+	put_unaligned_be16(SB_TFTP_DATA, reply);
+	put_unaligned_be16(block, reply + 2);
+	memcpy(reply + 4, priv->tftp_data + offset, size);
+
+	hwaddr[3] = (group >> 16) & 0x7f;
+	hwaddr[4] = (group >> 8) & 0xff;
+	hwaddr[5] = group & 0xff;
+	sb_eth_udp_send(priv, hwaddr, mc->group, SB_TFTP_MCAST_SRC,
+			SB_TFTP_MCAST_PORT, 4 + size);
+}
+
+/* Send an OACK to the real client, saying whether it is master */
+static void sb_tftp_mcast_oack(struct eth_sandbox_priv *priv, bool tsize)
+{
+	struct sb_tftp_mcast *mc = &priv->tftp_mcast;
+	uchar *reply;
+	int size;
+
+	reply = priv->recv_packet_buffer[priv->recv_packets] + ETHER_HDR_SIZE +
+		IP_UDP_HDR_SIZE;
+	put_unaligned_be16(SB_TFTP_OACK, reply);
+	size = 2;
+	size += sprintf((char *)reply + size, "blksize%c%d", 0,
+			mc->block_size) + 1;
+	if (tsize)
+		size += sprintf((char *)reply + size, "tsize%c%d", 0,
+				priv->tftp_size) + 1;
+	size += sprintf((char *)reply + size, "multicast%c%pI4,%d,%d", 0,
+			&mc->group, SB_TFTP_MCAST_PORT, mc->master) + 1;
+	sb_eth_udp_send(priv, mc->hwaddr, mc->ip, SB_TFTP_MCAST_SRC, mc->port,
+			size);
+}
+
+/*
+ * sb_tftp_mcast_stream()
+ *
+ * Have the simulated master acknowledge the last block sent, so that the next
+ * is sent. Once the simulated clients have the whole file, make the real
+ * client master.
+ */
+static void sb_tftp_mcast_stream(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_tftp_mcast *mc = &priv->tftp_mcast;
+
+	if (!priv->tftp_data || !mc->port || mc->master)
+		return;
+
+	if ((mc->next - 1) * mc->block_size > priv->tftp_size) {
+		mc->others = 0;
+		mc->master = true;
+		sb_tftp_mcast_oack(priv, false);
+		return;
+	}
+	sb_tftp_mcast_send(dev, mc->next, mc->loss && !(mc->next % mc->loss));
+	mc->next++;
+}
+
+/*
+ * sandbox_eth_tftp_req_to_reply()
+ *
+ * Check for a TFTP read request or acknowledgement. If so, inject a reply
+ *
+ * returns 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_tftp_req_to_reply(struct udevice *dev, void *packet,
+				  unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	struct sb_tftp_session *sess;
+	struct udp_hdr *udp;
+	uchar *req, *end, *reply;
+	int block, offset, size, i, hdr_size;
+	bool tsize = false, mcast = false;
+
+	if (!priv->tftp_data)
+		return -EAGAIN;
+	if (ntohs(eth->et_protlen) == PROT_IP && ip->ip_p == IPPROTO_UDP) {
+		udp = (struct udp_hdr *)&ip->udp_src;
+		hdr_size = IP_UDP_HDR_SIZE;
+#ifdef CONFIG_IPV6
+	} else if (ntohs(eth->et_protlen) == PROT_IPV6 &&
+		   ((struct ip6_hdr *)ip)->nexthdr == IPPROTO_UDP) {
+		udp = packet + ETHER_HDR_SIZE + IP6_HDR_SIZE;
+		hdr_size = IP6_UDP_HDR_SIZE;
+#endif
+	} else {
+		return -EAGAIN;
+	}
+
+	req = packet + ETHER_HDR_SIZE + hdr_size;
+	end = packet + len;
+
+	/* Don't allow the buffer to overrun */
+	if (sb_eth_rx_full(dev))
+		return 0;
+	reply = priv->recv_packet_buffer[priv->recv_packets] + ETHER_HDR_SIZE +
+		hdr_size;
+
+	if (ntohs(udp->udp_dst) == SB_TFTP_PORT &&
+	    get_unaligned_be16(req) == SB_TFTP_RRQ) {
+		/* Use the client's session if it has one, else a free one */
+		for (i = 0; i < SB_TFTP_SESSIONS - 1; i++) {
+			if (priv->tftp_sessions[i].port == ntohs(udp->udp_src) ||
+			    !priv->tftp_sessions[i].port)
+				break;
+		}
+		sess = &priv->tftp_sessions[i];
+		sess->port = ntohs(udp->udp_src);
+		sess->offset = 0;
+		sess->block_size = 512;
+
+		/* Skip the file name and mode, then look at the options */
+		req += 2;
+		req += strnlen((char *)req, end - req) + 1;
+		req += strnlen((char *)req, end - req) + 1;
+		while (req < end) {
+			char *opt = (char *)req;
+
+			req += strnlen(opt, end - req) + 1;
+			if (req >= end)
+				break;
+			if (!strcmp(opt, "blksize"))
+				sess->block_size = dectoul((char *)req, NULL);
+			else if (!strcmp(opt, "offset"))
+				sess->offset = dectoul((char *)req, NULL);
+			else if (!strcmp(opt, "tsize"))
+				tsize = true;
+			else if (!strcmp(opt, "multicast"))
+				mcast = true;
+			req += strnlen((char *)req, end - req) + 1;
+		}
+
+		if (mcast && priv->tftp_mcast.group.s_addr && hdr_size ==
+		    IP_UDP_HDR_SIZE) {
+			struct sb_tftp_mcast *mc = &priv->tftp_mcast;
+
+			/* A new client starts part-way through the file */
+			if (mc->port != sess->port) {
+				mc->port = sess->port;
+				memcpy(mc->hwaddr, eth->et_src, ARP_HLEN);
+				mc->ip = net_read_ip(&ip->ip_src);
+				mc->block_size = sess->block_size;
+				mc->master = !mc->others;
+				mc->next = max(mc->first, 1);
+			}
+			sess->port = 0;
+			sb_tftp_mcast_oack(priv, tsize);
+
+			return 0;
+		}
+
+		put_unaligned_be16(SB_TFTP_OACK, reply);
+		size = 2;
+		size += sprintf((char *)reply + size, "blksize%c%d", 0,
+				sess->block_size) + 1;
+		if (tsize)
+			size += sprintf((char *)reply + size, "tsize%c%d", 0,
+					priv->tftp_size) + 1;
+		if (sess->offset)
+			size += sprintf((char *)reply + size, "offset%c%d", 0,
+					sess->offset) + 1;
+		sb_eth_udp_reply(priv, packet, SB_TFTP_DATA_PORT + i, size);
+
+		return 0;
+	}
+
+	if (ntohs(udp->udp_dst) == SB_TFTP_MCAST_SRC &&
+	    get_unaligned_be16(req) == SB_TFTP_ACK &&
+	    ntohs(udp->udp_src) == priv->tftp_mcast.port) {
+		struct sb_tftp_mcast *mc = &priv->tftp_mcast;
+
+		/* An acknowledgement of the last block means it is done */
+		mc->acks++;
+		block = get_unaligned_be16(req + 2) + 1;
+		if ((block - 1) * mc->block_size > priv->tftp_size)
+			mc->port = 0;
+		else if (mc->master)
+			sb_tftp_mcast_send(dev, block, false);
+
+		return 0;
+	}
+
+	i = ntohs(udp->udp_dst) - SB_TFTP_DATA_PORT;
+	if (i < 0 || i >= SB_TFTP_SESSIONS ||
+	    get_unaligned_be16(req) != SB_TFTP_ACK)
+		return -EAGAIN;
+	sess = &priv->tftp_sessions[i];
+	if (sess->port != ntohs(udp->udp_src))
+		return -EAGAIN;
+
+	/* Send the block after the one acknowledged, unless all were sent */
+	block = get_unaligned_be16(req + 2) + 1;
+	offset = sess->offset + (block - 1) * sess->block_size;
+	if (offset > priv->tftp_size)
+		return 0;
+	size = min(priv->tftp_size - offset, sess->block_size);
+
+	put_unaligned_be16(SB_TFTP_DATA, reply);
+	put_unaligned_be16(block, reply + 2);
+	memcpy(reply + 4, priv->tftp_data + offset, size);
+	sb_eth_udp_reply(priv, packet, SB_TFTP_DATA_PORT + i, 4 + size);
+
+	return 0;
+}
+
+/* Offsets in a BOOTP message (RFC 951) */
+#define SB_BOOTP_YIADDR		16
+#define SB_BOOTP_SIADDR		20
+#define SB_BOOTP_CHADDR		28
+#define SB_BOOTP_VEND		236
+/* Size of the replies, the smallest a BOOTP message can be */
+#define SB_BOOTP_SIZE		300
+
+#define SB_DHCP_MAGIC		0x63825363
+#define SB_DHCP_PORT		67
+
+/* DHCP options and message types used */
+#define SB_DHCP_OPT_NETMASK	1
+#define SB_DHCP_OPT_REQ_IP	50
+#define SB_DHCP_OPT_LEASE	51
+#define SB_DHCP_OPT_TYPE	53
+#define SB_DHCP_OPT_SERVER	54
+#define SB_DHCP_DISCOVER	1
+#define SB_DHCP_OFFER		2
+#define SB_DHCP_REQUEST		3
+#define SB_DHCP_ACK		5
+#define SB_DHCP_NAK		6
+
+/* Find a DHCP option, returning a pointer to its length */
+static u8 *sb_dhcp_opt(u8 *opt, u8 *end, int code)
+{
+	while (opt + 1 < end && *opt != 255) {
+		if (!*opt) {
+			opt++;
+			continue;
+		}
+		if (*opt == code)
+			return opt + 1;
+		opt += opt[1] + 2;
+	}
+
+	return NULL;
+}
+
+/*
+ * sandbox_eth_dhcp_req_to_reply()
+ *
+ * Check for a DHCP discover or request. If so, inject an offer or an
+ * acknowledgement, from the fake host
+ *
+ * returns 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_dhcp_req_to_reply(struct udevice *dev, void *packet,
+				  unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	struct in_addr addr = string_to_ip(SB_DHCP_ADDR);
+	u8 *req, *end, *reply, *opt;
+	int type;
+
+	req = packet + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+	end = packet + len;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP ||
+	    ntohs(ip->udp_dst) != SB_DHCP_PORT ||
+	    end - req < SB_BOOTP_VEND + 4 ||
+	    get_unaligned_be32(req + SB_BOOTP_VEND) != SB_DHCP_MAGIC)
+		return -EAGAIN;
+
+	opt = sb_dhcp_opt(req + SB_BOOTP_VEND + 4, end, SB_DHCP_OPT_TYPE);
+	if (!opt)
+		return -EAGAIN;
+	switch (opt[1]) {
+	case SB_DHCP_DISCOVER:
+		type = SB_DHCP_OFFER;
+		break;
+	case SB_DHCP_REQUEST:
+		opt = sb_dhcp_opt(req + SB_BOOTP_VEND + 4, end,
+				  SB_DHCP_OPT_REQ_IP);
+		if (opt && opt[0] == 4 &&
+		    net_read_ip(opt + 1).s_addr == addr.s_addr)
+			type = SB_DHCP_ACK;
+		else
+			type = SB_DHCP_NAK;
+		break;
+	default:
+		return -EAGAIN;
+	}
+
+	/* Don't allow the buffer to overrun */
+	if (sb_eth_rx_full(dev))
+		return 0;
+
+	reply = priv->recv_packet_buffer[priv->recv_packets] + ETHER_HDR_SIZE +
+		IP_UDP_HDR_SIZE;
+	memset(reply, '\0', SB_BOOTP_SIZE);
+	/* A reply, with the hardware type and length, and ID, of the request */
+	reply[0] = 2;
+	memcpy(reply + 1, req + 1, 7);
+	memcpy(reply + SB_BOOTP_CHADDR, req + SB_BOOTP_CHADDR, 16);
+	if (type != SB_DHCP_NAK)
+		net_write_ip(reply + SB_BOOTP_YIADDR, addr);
+	net_write_ip(reply + SB_BOOTP_SIADDR, priv->fake_host_ipaddr);
+
+	opt = reply + SB_BOOTP_VEND;
+	put_unaligned_be32(SB_DHCP_MAGIC, opt);
+	opt += 4;
+	*opt++ = SB_DHCP_OPT_TYPE;
+	*opt++ = 1;
+	*opt++ = type;
+	*opt++ = SB_DHCP_OPT_SERVER;
+	*opt++ = 4;
+	net_write_ip(opt, priv->fake_host_ipaddr);
+	opt += 4;
+	if (type != SB_DHCP_NAK) {
+		*opt++ = SB_DHCP_OPT_LEASE;
+		*opt++ = 4;
+		put_unaligned_be32(SB_DHCP_LEASE, opt);
+		opt += 4;
+		*opt++ = SB_DHCP_OPT_NETMASK;
+		*opt++ = 4;
+		put_unaligned_be32(0xffffff00, opt);
+		opt += 4;
+	}
+	*opt = 255;
+	sb_eth_udp_reply(priv, packet, SB_DHCP_PORT, SB_BOOTP_SIZE);
+
+	return 0;
+}
+
 /*
  * sb_default_handler()
  *
@@ -270,6 +957,14 @@ static int sb_default_handler(struct udevice *dev, void *packet,
 		return 0;
 	if (!sandbox_eth_ping_req_to_reply(dev, packet, len))
 		return 0;
+#ifdef CONFIG_IPV6
+	if (!sandbox_eth_nd_req_to_reply(dev, packet, len))
+		return 0;
+	if (!sandbox_eth_ping6_req_to_reply(dev, packet, len))
+		return 0;
+	if (!sandbox_eth_rs_to_ra(dev, packet, len))
+		return 0;
+#endif
 
 	return 0;
 }
@@ -320,6 +1015,54 @@ void sandbox_eth_set_priv(int index, void *priv)
 	dev_priv->priv = priv;
 }
 
+/*
+ * sandbox_eth_set_tftp_file()
+ *
+ * Set the file served by sandbox_eth_tftp_req_to_reply()
+ *
+ * index - interface to serve the file on
+ * data - contents of the file, NULL to stop serving it
+ * size - size of the file
+ */
+void sandbox_eth_set_tftp_file(int index, const void *data, int size)
+{
+	struct udevice *dev;
+	struct eth_sandbox_priv *priv;
+	int ret;
+
+	ret = uclass_get_device(UCLASS_ETH, index, &dev);
+	if (ret)
+		return;
+
+	priv = dev_get_priv(dev);
+	priv->tftp_data = data;
+	priv->tftp_size = size;
+	memset(priv->tftp_sessions, '\0', sizeof(priv->tftp_sessions));
+	memset(&priv->tftp_mcast, '\0', sizeof(priv->tftp_mcast));
+}
+
+/*
+ * sandbox_eth_set_offload()
+ *
+ * Set the offloads which the device claims to do
+ *
+ * index - interface to set
+ * offload - ETH_OFFLOAD_... flags
+ */
+void sandbox_eth_set_offload(int index, int offload)
+{
+	struct udevice *dev;
+	struct eth_sandbox_priv *priv;
+	int ret;
+
+	ret = uclass_get_device(UCLASS_ETH, index, &dev);
+	if (ret)
+		return;
+
+	priv = dev_get_priv(dev);
+	priv->offload = offload;
+}
+
 static int sb_eth_start(struct udevice *dev)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -331,6 +1074,7 @@ static int sb_eth_start(struct udevice *dev)
 		priv->recv_packet_buffer[i] = net_rx_packets[i];
 		priv->recv_packet_length[i] = 0;
 	}
+	priv->lent_buf = NULL;
 
 	return 0;
 }
@@ -347,6 +1091,22 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 	return priv->tx_handler(dev, packet, length);
 }
 
+static int sb_eth_send_info(struct udevice *dev, void *packet, int length,
+			    const struct eth_pkt_info *info)
+{
+	uchar *start = packet + info->csum_start;
+	u16 csum;
+
+	/* Behave like hardware filling in the checksum */
+	if ((info->flags & ETH_PKT_CSUM_PARTIAL) &&
+	    info->csum_start + info->csum_offset + sizeof(csum) <= length) {
+		csum = compute_ip_checksum(start, length - info->csum_start);
+		memcpy(start + info->csum_offset, &csum, sizeof(csum));
+	}
+
+	return sb_eth_send(dev, packet, length);
+}
+
 static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -356,17 +1116,46 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		skip_timeout = false;
 	}
 
+	if (!priv->recv_packets)
+		sb_tftp_mcast_stream(dev);
 	if (priv->recv_packets) {
 		int lcl_recv_packet_length = priv->recv_packet_length[0];
+		uchar *packet = priv->recv_packet_buffer[0];
 
 		debug("eth_sandbox: received packet[%d], %d waiting\n",
 		      lcl_recv_packet_length, priv->recv_packets - 1);
-		*packetp = priv->recv_packet_buffer[0];
+
+		/* Behave like hardware writing to the buffer given to it */
+		if (priv->lent_buf && lcl_recv_packet_length <= priv->lent_size) {
+			memcpy(priv->lent_buf, packet, lcl_recv_packet_length);
+			packet = priv->lent_buf;
+			priv->lent_buf = NULL;
+		}
+		*packetp = packet;
 		return lcl_recv_packet_length;
 	}
 	return 0;
 }
 
+static int sb_eth_recv_batch(struct udevice *dev, int flags, uchar **packetp,
+			     int *lenp, int max)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int count, i;
+
+	lenp[0] = sb_eth_recv(dev, flags, &packetp[0]);
+	if (!lenp[0])
+		return 0;
+
+	count = min(priv->recv_packets, max);
+	for (i = 1; i < count; i++) {
+		packetp[i] = priv->recv_packet_buffer[i];
+		lenp[i] = priv->recv_packet_length[i];
+	}
+
+	return count;
+}
+
 static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -389,7 +1178,21 @@ static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 
 static void sb_eth_stop(struct udevice *dev)
 {
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
 	debug("eth_sandbox: Stop\n");
+	priv->lent_buf = NULL;
+}
+
+static int sb_eth_mcast(struct udevice *dev, const u8 *enetaddr, int join)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	debug("eth_sandbox %s: %s %pM\n", dev->name, join ? "Join" : "Leave",
+	      enetaddr);
+	priv->mcast_groups += join ? 1 : -1;
+
+	return 0;
 }
 
 static int sb_eth_write_hwaddr(struct udevice *dev)
@@ -401,13 +1204,45 @@ static int sb_eth_write_hwaddr(struct udevice *dev)
 	return 0;
 }
 
+static int sb_eth_get_offload(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	return priv->offload;
+}
+
+static void sb_eth_get_rx_info(struct udevice *dev, uchar *packet, int length,
+			       struct eth_pkt_info *info)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	if (priv->offload & ETH_OFFLOAD_RX_CSUM)
+		info->flags |= ETH_PKT_CSUM_VALID;
+}
+
+static int sb_eth_lend_rx_buf(struct udevice *dev, uchar *buf, int size)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	priv->lent_buf = buf;
+	priv->lent_size = size;
+
+	return 0;
+}
+
 static const struct eth_ops sb_eth_ops = {
 	.start			= sb_eth_start,
 	.send			= sb_eth_send,
 	.recv			= sb_eth_recv,
+	.recv_batch		= sb_eth_recv_batch,
 	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
+	.mcast			= sb_eth_mcast,
 	.write_hwaddr		= sb_eth_write_hwaddr,
+	.lend_rx_buf		= sb_eth_lend_rx_buf,
+	.get_offload		= sb_eth_get_offload,
+	.send_info		= sb_eth_send_info,
+	.get_rx_info		= sb_eth_get_rx_info,
 };
 
 static int sb_eth_remove(struct udevice *dev)
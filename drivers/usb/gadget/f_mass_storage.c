@@ -302,6 +302,7 @@ struct fsg_common {
 	struct fsg_buffhd	*next_buffhd_to_fill;
 	struct fsg_buffhd	*next_buffhd_to_drain;
 	struct fsg_buffhd	buffhds[FSG_NUM_BUFFERS];
+	void			*buf;	/* Memory for all of buffhds */
 
 	int			cmnd_size;
 	u8			cmnd[MAX_COMMAND_SIZE];
@@ -826,6 +827,7 @@ static int do_write(struct fsg_common *common)
 	unsigned int		amount;
 	unsigned int		partial_page;
 	ssize_t			nwritten;
+	void			*buf;
 	int			rc;
 
 	if (curlun->ro) {
@@ -934,12 +936,29 @@ static int do_write(struct fsg_common *common)
 			}
 
 			amount = bh->outreq->actual;
+			buf = bh->buf;
+
+			/*
+			 * Take in any following buffers which have arrived
+			 * too, as long as they are next to this one in memory,
+			 * so that they go to the medium in a single write
+			 */
+			while (bh->outreq->length == FSG_BUFLEN &&
+			       bh->outreq->actual == FSG_BUFLEN &&
+			       bh->next->state == BUF_STATE_FULL &&
+			       bh->next->outreq->status == 0 &&
+			       bh->next->buf == bh->buf + FSG_BUFLEN) {
+				bh = bh->next;
+				common->next_buffhd_to_drain = bh->next;
+				bh->state = BUF_STATE_EMPTY;
+				amount += bh->outreq->actual;
+			}
 
 			/* Perform the write */
 			rc = ums[common->lun].write_sector(&ums[common->lun],
 					       file_offset / SECTOR_SIZE,
 					       amount / SECTOR_SIZE,
-					       (char __user *)bh->buf);
+					       (char __user *)buf);
 			if (!rc)
 				return -EIO;
 			nwritten = rc * SECTOR_SIZE;
@@ -2497,7 +2516,17 @@ static struct fsg_common *fsg_common_init(struct fsg_common *common,
 	}
 	common->lun = 0;
 
-	/* Data buffers cyclic list */
+	/*
+	 * Data buffers cyclic list. The buffers are carved out of a single
+	 * allocation, in ring order, so that do_write() can hand several
+	 * consecutive ones to the medium at once.
+	 */
+	common->buf = memalign(CONFIG_SYS_CACHELINE_SIZE,
+			       FSG_NUM_BUFFERS * FSG_BUFLEN);
+	if (unlikely(!common->buf)) {
+		rc = -ENOMEM;
+		goto error_release;
+	}
 	bh = common->buffhds;
 
 	i = FSG_NUM_BUFFERS;
@@ -2508,11 +2537,7 @@ static struct fsg_common *fsg_common_init(struct fsg_common *common,
 buffhds_first_it:
 		bh->inreq_busy = 0;
 		bh->outreq_busy = 0;
-		bh->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, FSG_BUFLEN);
-		if (unlikely(!bh->buf)) {
-			rc = -ENOMEM;
-			goto error_release;
-		}
+		bh->buf = common->buf + (bh - common->buffhds) * FSG_BUFLEN;
 	} while (--i);
 	bh->next = common->buffhds;
 
@@ -2574,13 +2599,7 @@ static void fsg_common_release(struct kref *ref)
 		kfree(common->luns);
 	}
 
-	{
-		struct fsg_buffhd *bh = common->buffhds;
-		unsigned i = FSG_NUM_BUFFERS;
-		do {
-			kfree(bh->buf);
-		} while (++bh, --i);
-	}
+	kfree(common->buf);
 
 	if (common->free_storage_on_release)
 		kfree(common);
@@ -306,11 +306,14 @@ static struct fsg_lun *fsg_lun_from_dev(struct device *dev)
 #define EP0_BUFSIZE	256
 #define DELAYED_STATUS	(EP0_BUFSIZE + 999)	/* An impossibly large value */
 
-/* Number of buffers we will use.  2 is enough for double-buffering */
-#define FSG_NUM_BUFFERS	2
+/*
+ * Number of buffers we will use.  2 is enough for double-buffering, more
+ * lets the host keep streaming while the medium is busy
+ */
+#define FSG_NUM_BUFFERS	CONFIG_USB_GADGET_MASS_STORAGE_NUM_BUFFERS
 
 /* Default size of buffer length. */
-#define FSG_BUFLEN	((u32)131072)
+#define FSG_BUFLEN	((u32)CONFIG_USB_GADGET_MASS_STORAGE_BUFLEN)
 
 /* Maximal number of LUNs supported in mass storage function */
 #define FSG_MAX_LUNS	8
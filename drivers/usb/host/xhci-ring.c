@@ -578,18 +578,58 @@ static void record_transfer_result(struct usb_device *udev,
 
 /**** Bulk and Control transfer methods ****/
 /**
- * Queues up the BULK Request
+ * Works out how many TRBs are needed to transfer a buffer
+ *
+ * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
+ * that the buffer should not span 64KB boundary. if so we send request in
+ * more than 1 TRB by chaining them.
+ *
+ * @param addr		bus address of the buffer
+ * @param length	length of the buffer
+ * Return: number of TRBs needed
+ */
+static int xhci_bulk_num_trbs(u64 addr, int length)
+{
+	int num_trbs = 0;
+	int running_total;
+
+	/* How much data is (potentially) left before the 64KB boundary? */
+	running_total = TRB_MAX_BUFF_SIZE -
+			(lower_32_bits(addr) & (TRB_MAX_BUFF_SIZE - 1));
+	running_total &= TRB_MAX_BUFF_SIZE - 1;
+
+	/*
+	 * If there's some data on this 64KB chunk, or we have to send a
+	 * zero-length transfer, we need at least one TRB
+	 */
+	if (running_total != 0 || length == 0)
+		num_trbs++;
+
+	/* How many more 64KB chunks to transfer, how many more TRBs? */
+	while (running_total < length) {
+		num_trbs++;
+		running_total += TRB_MAX_BUFF_SIZE;
+	}
+
+	return num_trbs;
+}
+
+/**
+ * Queues up one bulk TD and hands it to the hardware, without waiting for it
+ * to complete
  *
  * @param udev		pointer to the USB device structure
  * @param pipe		contains the DIR_IN or OUT , devnum
  * @param length	length of the buffer
  * @param buffer	buffer to be read/written based on the request
- * Return: returns 0 if successful else -1 on failure
+ * @param last_trbp	returns the last TRB of the TD, which is the one that
+ *			generates the completion event
+ * Return: 0 if successful else -ve error code
  */
-int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
-			int length, void *buffer)
+static int xhci_bulk_queue(struct usb_device *udev, unsigned long pipe,
+			   int length, void *buffer, void **last_trbp)
 {
-	int num_trbs = 0;
+	int num_trbs;
 	struct xhci_generic_trb *start_trb;
 	bool first_trb = false;
 	int start_cycle;
@@ -601,7 +641,6 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	struct xhci_virt_device *virt_dev;
 	struct xhci_ep_ctx *ep_ctx;
 	struct xhci_ring *ring;		/* EP transfer ring */
-	union xhci_trb *event;
 
 	int running_total, trb_buff_len;
 	bool more_trbs_coming = true;
@@ -611,12 +650,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	u32 trb_fields[4];
 	u64 val_64 = xhci_virt_to_bus(ctrl, buffer);
 	void *last_transfer_trb_addr;
-	int available_length;
-
-	debug("dev=%p, pipe=%lx, buffer=%p, length=%d\n",
-		udev, pipe, buffer, length);
 
-	available_length = length;
 	ep_index = usb_pipe_ep_index(pipe);
 	virt_dev = ctrl->devs[slot_id];
 
@@ -626,34 +660,13 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
 
 	ring = virt_dev->eps[ep_index].ring;
-	/*
-	 * How much data is (potentially) left before the 64KB boundary?
-	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
-	 * that the buffer should not span 64KB boundary. if so
-	 * we send request in more than 1 TRB by chaining them.
-	 */
-	running_total = TRB_MAX_BUFF_SIZE -
-			(lower_32_bits(val_64) & (TRB_MAX_BUFF_SIZE - 1));
-	trb_buff_len = running_total;
-	running_total &= TRB_MAX_BUFF_SIZE - 1;
-
-	/*
-	 * If there's some data on this 64KB chunk, or we have to send a
-	 * zero-length transfer, we need at least one TRB
-	 */
-	if (running_total != 0 || length == 0)
-		num_trbs++;
-
-	/* How many more 64KB chunks to transfer, how many more TRBs? */
-	while (running_total < length) {
-		num_trbs++;
-		running_total += TRB_MAX_BUFF_SIZE;
-	}
+	num_trbs = xhci_bulk_num_trbs(val_64, length);
 
 	/*
 	 * XXX: Calling routine prepare_ring() called in place of
-	 * prepare_trasfer() as there in 'Linux' since we are not
-	 * maintaining multiple TDs/transfer at the same time.
+	 * prepare_trasfer() as there in 'Linux'. There is no check for room
+	 * on the ring: xhci_bulk_tx_multi() limits the number of TRBs it puts
+	 * in flight so that they always fit.
 	 */
 	ret = prepare_ring(ctrl, ring,
 			   le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK);
@@ -672,14 +685,9 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	maxpacketsize = usb_maxpacket(udev, pipe);
 
 	/* How much data is in the first TRB? */
-	/*
-	 * How much data is (potentially) left before the 64KB boundary?
-	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
-	 * that the buffer should not span 64KB boundary. if so
-	 * we send request in more than 1 TRB by chaining them.
-	 */
 	addr = val_64;
-
+	trb_buff_len = TRB_MAX_BUFF_SIZE -
+		       (lower_32_bits(val_64) & (TRB_MAX_BUFF_SIZE - 1));
 	if (trb_buff_len > length)
 		trb_buff_len = length;
 
@@ -742,6 +750,39 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	} while (running_total < length);
 
 	giveback_first_trb(udev, ep_index, start_cycle, start_trb);
+	*last_trbp = last_transfer_trb_addr;
+
+	return 0;
+}
+
+/**
+ * Queues up the BULK Request
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param length	length of the buffer
+ * @param buffer	buffer to be read/written based on the request
+ * Return: returns 0 if successful else -1 on failure
+ */
+int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
+			int length, void *buffer)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	int slot_id = udev->slot_id;
+	int ep_index = usb_pipe_ep_index(pipe);
+	union xhci_trb *event;
+	void *last_transfer_trb_addr;
+	int available_length = length;
+	u32 field;
+	int ret;
+
+	debug("dev=%p, pipe=%lx, buffer=%p, length=%d\n",
+		udev, pipe, buffer, length);
+
+	ret = xhci_bulk_queue(udev, pipe, length, buffer,
+			      &last_transfer_trb_addr);
+	if (ret)
+		return ret;
 
 again:
 	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
@@ -772,6 +813,214 @@ again:
 	return (udev->status != USB_ST_NOT_PROC) ? 0 : -1;
 }
 
+/**
+ * struct xhci_bulk_td - a bulk TD in flight, queued by xhci_bulk_tx_multi()
+ *
+ * @ep_index:		endpoint index the TD was queued on
+ * @last_trb:		bus address of the last TRB of the TD
+ * @available_length:	length of the TD, less any short packets seen so far
+ * @done:		true once the TD has completed
+ */
+struct xhci_bulk_td {
+	int ep_index;
+	u64 last_trb;
+	int available_length;
+	bool done;
+};
+
+/**
+ * Marks the TDs whose completion is already waiting on the event ring as done
+ *
+ * Their transfer events are consumed here, so that they are not taken for
+ * the result of a later command on the same endpoint.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param td		TDs in flight
+ * @param count		number of TDs in flight
+ */
+static void xhci_bulk_drain(struct usb_device *udev, struct xhci_bulk_td *td,
+			    int count)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+
+	while (event_ready(ctrl)) {
+		union xhci_trb *event = ctrl->event_ring->dequeue;
+		u32 field = le32_to_cpu(event->trans_event.flags);
+		int ep_index, i;
+
+		if (TRB_FIELD_TO_TYPE(field) != TRB_TRANSFER ||
+		    TRB_TO_SLOT_ID(field) != udev->slot_id)
+			break;
+		ep_index = TRB_TO_EP_INDEX(field);
+		for (i = 0; i < count; i++) {
+			if (!td[i].done && td[i].ep_index == ep_index)
+				break;
+		}
+		if (i < count &&
+		    le64_to_cpu(event->trans_event.buffer) == td[i].last_trb)
+			td[i].done = true;
+		xhci_acknowledge_event(ctrl);
+	}
+}
+
+/**
+ * Throws away the TDs still in flight after one of them failed
+ *
+ * Completions already reported are collected first. The endpoint which
+ * reported the error is halted, so it is reset. Any other endpoint which
+ * still has a TD pending is stopped. Either way the xHC's dequeue pointer is
+ * moved to our enqueue pointer, discarding any TDs which have not completed.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param td		TDs in flight
+ * @param count		number of TDs in flight
+ * @param halted_ep	endpoint index which halted, or -1 if none
+ */
+static void xhci_bulk_discard(struct usb_device *udev, struct xhci_bulk_td *td,
+			      int count, int halted_ep)
+{
+	u32 stopped = 0;
+	int i;
+
+	xhci_bulk_drain(udev, td, count);
+	if (halted_ep >= 0) {
+		reset_ep(udev, halted_ep);
+		stopped |= 1 << halted_ep;
+	}
+	for (i = 0; i < count; i++) {
+		if (td[i].done || (stopped & (1 << td[i].ep_index)))
+			continue;
+		abort_td(udev, td[i].ep_index);
+		stopped |= 1 << td[i].ep_index;
+	}
+}
+
+/**
+ * Queues up several BULK requests and waits for them all to complete
+ *
+ * The requests are handed to the hardware together, so several TDs can be in
+ * flight on the same endpoint and the xHC moves from one to the next without
+ * waiting for software. Requests are started in order, which allows a
+ * complete protocol exchange (e.g. a mass-storage command, its data and its
+ * status) to be queued at once. As many requests as fit in the endpoint rings
+ * are queued at a time.
+ *
+ * If a request fails, the requests after it are not completed and have their
+ * status set to USB_ST_NOT_PROC.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param reqs		requests to transfer
+ * @param count		number of requests
+ * Return: 0 if all requests completed successfully, else -ve error code
+ */
+int xhci_bulk_tx_multi(struct usb_device *udev, struct usb_bulk_req *reqs,
+		       int count)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_bulk_td td[XHCI_MAX_BULK_TDS];
+	int trbs_used[MAX_EP_CTX_NUM];
+	int first, num, i, ret;
+
+	for (i = 0; i < count; i++)
+		reqs[i].status = USB_ST_NOT_PROC;
+
+	for (first = 0; first < count; first += num) {
+		memset(trbs_used, '\0', sizeof(trbs_used));
+
+		/* Queue as many TDs as the rings can hold */
+		for (num = 0; num < XHCI_MAX_BULK_TDS && first + num < count;
+		     num++) {
+			struct usb_bulk_req *req = &reqs[first + num];
+			int ep_index = usb_pipe_ep_index(req->pipe);
+			void *last_trb;
+			int num_trbs;
+
+			num_trbs = xhci_bulk_num_trbs(xhci_virt_to_bus(ctrl,
+							req->buffer),
+						      req->length);
+			if (num && trbs_used[ep_index] + num_trbs >
+			    TRBS_PER_SEGMENT - 2)
+				break;
+			trbs_used[ep_index] += num_trbs;
+
+			ret = xhci_bulk_queue(udev, req->pipe, req->length,
+					      req->buffer, &last_trb);
+			if (ret) {
+				xhci_bulk_discard(udev, td, num, -1);
+				return ret;
+			}
+			td[num].ep_index = ep_index;
+			td[num].last_trb = xhci_virt_to_bus(ctrl, last_trb);
+			td[num].available_length = req->length;
+			td[num].done = false;
+		}
+
+		/* Collect the completions, which arrive in order per endpoint */
+		for (i = 0; i < num; i++) {
+			while (!td[i].done) {
+				struct usb_bulk_req *req;
+				union xhci_trb *event;
+				u32 field, len;
+				int ep_index, j;
+
+				event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
+				if (!event) {
+					debug("XHCI bulk transfer timed out, aborting...\n");
+					xhci_bulk_discard(udev, td, num, -1);
+					udev->status = USB_ST_NAK_REC;
+					udev->act_len = 0;
+					reqs[first + i].status = udev->status;
+					return -ETIMEDOUT;
+				}
+				field = le32_to_cpu(event->trans_event.flags);
+				len = le32_to_cpu(event->trans_event.transfer_len);
+				BUG_ON(TRB_TO_SLOT_ID(field) != udev->slot_id);
+				ep_index = TRB_TO_EP_INDEX(field);
+
+				/* Find the oldest TD in flight on this endpoint */
+				for (j = i; j < num; j++) {
+					if (!td[j].done &&
+					    td[j].ep_index == ep_index)
+						break;
+				}
+				if (j == num) {
+					printf("Unexpected XHCI transfer event on EP %d, skipping...\n",
+					       ep_index);
+					xhci_acknowledge_event(ctrl);
+					continue;
+				}
+
+				if (le64_to_cpu(event->trans_event.buffer) !=
+				    td[j].last_trb &&
+				    GET_COMP_CODE(len) == COMP_SHORT_TX) {
+					td[j].available_length -=
+						(int)EVENT_TRB_LEN(len);
+					xhci_acknowledge_event(ctrl);
+					continue;
+				}
+
+				req = &reqs[first + j];
+				record_transfer_result(udev, event,
+						       td[j].available_length);
+				xhci_acknowledge_event(ctrl);
+				if (req->length)
+					xhci_inval_cache((uintptr_t)req->buffer,
+							 req->length);
+				td[j].done = true;
+				req->act_len = udev->act_len;
+				req->status = udev->status;
+				if (udev->status) {
+					xhci_bulk_discard(udev, td, num,
+							  ep_index);
+					return -EIO;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
 /**
  * Queues up the Control Transfer Request
  *
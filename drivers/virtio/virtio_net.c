@@ -36,15 +36,19 @@ struct virtio_net_priv {
 };
 
 /*
- * For simplicity, the driver only negotiates the VIRTIO_NET_F_MAC feature.
- * For the VIRTIO_NET_F_STATUS feature, we don't negotiate it, hence per spec
- * we should assume the link is always active.
+ * For simplicity, the driver only negotiates the VIRTIO_NET_F_MAC feature and
+ * the checksum offloads. For the VIRTIO_NET_F_STATUS feature, we don't
+ * negotiate it, hence per spec we should assume the link is always active.
  */
 static const u32 feature[] = {
+	VIRTIO_NET_F_CSUM,
+	VIRTIO_NET_F_GUEST_CSUM,
 	VIRTIO_NET_F_MAC
 };
 
 static const u32 feature_legacy[] = {
+	VIRTIO_NET_F_CSUM,
+	VIRTIO_NET_F_GUEST_CSUM,
 	VIRTIO_NET_F_MAC
 };
 
@@ -74,7 +78,8 @@ static int virtio_net_start(struct udevice *dev)
 	return 0;
 }
 
-static int virtio_net_send(struct udevice *dev, void *packet, int length)
+static int virtio_net_send_info(struct udevice *dev, void *packet, int length,
+				const struct eth_pkt_info *info)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
 	struct virtio_net_hdr hdr;
@@ -92,6 +97,15 @@ static int virtio_net_send(struct udevice *dev, void *packet, int length)
 
 	memset(hdr_sg.addr, 0, priv->net_hdr_len);
 
+	/* Both headers start with the same fields */
+	if (info && (info->flags & ETH_PKT_CSUM_PARTIAL)) {
+		struct virtio_net_hdr *h = hdr_sg.addr;
+
+		h->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+		h->csum_start = cpu_to_virtio16(dev, info->csum_start);
+		h->csum_offset = cpu_to_virtio16(dev, info->csum_offset);
+	}
+
 	ret = virtqueue_add(priv->tx_vq, sgs, 2, 0);
 	if (ret)
 		return ret;
@@ -106,9 +120,35 @@ static int virtio_net_send(struct udevice *dev, void *packet, int length)
 	return 0;
 }
 
+static int virtio_net_send(struct udevice *dev, void *packet, int length)
+{
+	return virtio_net_send_info(dev, packet, length, NULL);
+}
+
+/*
+ * Fill in the checksum of a packet which only has the pseudo-header checksum,
+ * as sent by another guest on the same host, so that it is correct wherever
+ * the packet ends up
+ */
+static void virtio_net_fill_csum(struct udevice *dev,
+				 struct virtio_net_hdr *hdr, uchar *packet,
+				 unsigned int len)
+{
+	unsigned int start = virtio16_to_cpu(dev, hdr->csum_start);
+	unsigned int offset = virtio16_to_cpu(dev, hdr->csum_offset);
+	u16 csum;
+
+	if (start + offset + sizeof(csum) > len)
+		return;
+	csum = compute_ip_checksum(packet + start, len - start);
+	memcpy(packet + start + offset, &csum, sizeof(csum));
+	hdr->flags = VIRTIO_NET_HDR_F_DATA_VALID;
+}
+
 static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
+	struct virtio_net_hdr *hdr;
 	unsigned int len;
 	void *buf;
 
@@ -116,10 +156,37 @@ static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 	if (!buf)
 		return -EAGAIN;
 
+	hdr = buf;
+	if (hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM)
+		virtio_net_fill_csum(dev, hdr, buf + priv->net_hdr_len,
+				     len - priv->net_hdr_len);
+
 	*packetp = buf + priv->net_hdr_len;
 	return len - priv->net_hdr_len;
 }
 
+static void virtio_net_get_rx_info(struct udevice *dev, uchar *packet,
+				   int length, struct eth_pkt_info *info)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	struct virtio_net_hdr *hdr = (void *)(packet - priv->net_hdr_len);
+
+	if (hdr->flags & VIRTIO_NET_HDR_F_DATA_VALID)
+		info->flags |= ETH_PKT_CSUM_VALID;
+}
+
+static int virtio_net_get_offload(struct udevice *dev)
+{
+	int offload = 0;
+
+	if (virtio_has_feature(dev, VIRTIO_NET_F_CSUM))
+		offload |= ETH_OFFLOAD_TX_CSUM;
+	if (virtio_has_feature(dev, VIRTIO_NET_F_GUEST_CSUM))
+		offload |= ETH_OFFLOAD_RX_CSUM;
+
+	return offload;
+}
+
 static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
@@ -224,6 +291,9 @@ static const struct eth_ops virtio_net_ops = {
 	.stop = virtio_net_stop,
 	.write_hwaddr = virtio_net_write_hwaddr,
 	.read_rom_hwaddr = virtio_net_read_rom_hwaddr,
+	.get_offload = virtio_net_get_offload,
+	.send_info = virtio_net_send_info,
+	.get_rx_info = virtio_net_get_rx_info,
 };
 
 U_BOOT_DRIVER(virtio_net) = {
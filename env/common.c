@@ -35,6 +35,43 @@ struct hsearch_data env_htab = {
 	.change_ok = env_flags_validate,
 };
 
+#if CONFIG_IS_ENABLED(ENV_SAVE_ONLY_CHANGED)
+/*
+ * What is in storage: the change count of env_htab and the CRC of the
+ * exported environment when it was last loaded or saved
+ */
+static bool env_stored;
+static unsigned int env_stored_changes;
+static u32 env_stored_crc;
+
+/* The same for the latest export, which becomes stored once it is saved */
+static unsigned int env_export_changes;
+static u32 env_export_crc;
+
+static void env_set_stored(u32 crc)
+{
+	env_stored = true;
+	env_stored_changes = env_htab.changes;
+	env_stored_crc = crc;
+}
+
+void env_clear_stored(void)
+{
+	env_stored = false;
+}
+
+void env_mark_saved(void)
+{
+	env_stored = true;
+	env_stored_changes = env_export_changes;
+	env_stored_crc = env_export_crc;
+}
+#else
+static inline void env_set_stored(u32 crc)
+{
+}
+#endif
+
 /*
  * This env_set() function is defined in cmd/nvedit.c, since it calls
  * _do_env_set(), whis is a static function in that file.
@@ -300,12 +337,11 @@ int env_set_default_vars(int nvars, char * const vars[], int flags)
 int env_import(const char *buf, int check, int flags)
 {
 	env_t *ep = (env_t *)buf;
+	uint32_t crc;
 
-	if (check) {
-		uint32_t crc;
-
-		memcpy(&crc, &ep->crc, sizeof(crc));
+	memcpy(&crc, &ep->crc, sizeof(crc));
 
+	if (check) {
 		if (crc32(0, ep->data, ENV_SIZE) != crc) {
 			env_set_default("bad CRC", 0);
 			return -ENOMSG; /* needed for env_load() */
@@ -315,6 +351,7 @@ int env_import(const char *buf, int check, int flags)
 	if (himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', flags, 0,
 			0, NULL)) {
 		gd->flags |= GD_FLG_ENV_READY;
+		env_set_stored(crc);
 		return 0;
 	}
 
@@ -379,7 +416,7 @@ int env_import_redund(const char *buf1, int buf1_read_fail,
 		      const char *buf2, int buf2_read_fail,
 		      int flags)
 {
-	env_t *ep;
+	env_t *ep, *other;
 	int ret;
 
 	ret = env_check_redund(buf1, buf1_read_fail, buf2, buf2_read_fail);
@@ -392,19 +429,29 @@ int env_import_redund(const char *buf1, int buf1_read_fail,
 		return -ENOMSG;
 	}
 
-	if (gd->env_valid == ENV_VALID)
+	if (gd->env_valid == ENV_VALID) {
 		ep = (env_t *)buf1;
-	else
+		other = (env_t *)buf2;
+	} else {
 		ep = (env_t *)buf2;
+		other = (env_t *)buf1;
+	}
 
 	env_flags = ep->flags;
 
-	return env_import((char *)ep, 0, flags);
+	ret = env_import((char *)ep, 0, flags);
+
+	/* Let the next save repair a bad copy, even if nothing changes */
+	if (CONFIG_IS_ENABLED(ENV_SAVE_ONLY_CHANGED) && !ret &&
+	    (buf1_read_fail || buf2_read_fail ||
+	     crc32(0, other->data, ENV_SIZE) != other->crc))
+		env_clear_stored();
+
+	return ret;
 }
 #endif /* CONFIG_SYS_REDUNDAND_ENVIRONMENT */
 
-/* Export the environment and generate CRC for it. */
-int env_export(env_t *env_out)
+static int env_export_data(env_t *env_out)
 {
 	char *res;
 	ssize_t	len;
@@ -418,6 +465,44 @@ int env_export(env_t *env_out)
 
 	env_out->crc = crc32(0, env_out->data, ENV_SIZE);
 
+	return 0;
+}
+
+#if CONFIG_IS_ENABLED(ENV_SAVE_ONLY_CHANGED)
+bool env_needs_save(void)
+{
+	env_t *env;
+	bool changed;
+
+	if (!env_stored)
+		return true;
+	if (env_htab.changes == env_stored_changes)
+		return false;
+
+	/* Variables were set, but perhaps back to their stored values */
+	env = malloc(sizeof(*env));
+	if (!env)
+		return true;
+	changed = env_export_data(env) || env->crc != env_stored_crc;
+	free(env);
+	if (!changed)
+		env_stored_changes = env_htab.changes;
+
+	return changed;
+}
+#endif
+
+/* Export the environment and generate CRC for it. */
+int env_export(env_t *env_out)
+{
+	if (env_export_data(env_out))
+		return 1;
+
+#if CONFIG_IS_ENABLED(ENV_SAVE_ONLY_CHANGED)
+	env_export_changes = env_htab.changes;
+	env_export_crc = env_out->crc;
+#endif
+
 #ifdef CONFIG_SYS_REDUNDAND_ENVIRONMENT
 	env_out->flags = ++env_flags; /* increase the serial */
 #endif
@@ -267,11 +267,18 @@ int env_save(void)
 			return -ENODEV;
 		}
 
+		if (!env_needs_save()) {
+			printf("unchanged\n");
+			return 0;
+		}
+
 		ret = drv->save();
-		if (ret)
+		if (ret) {
 			printf("Failed (%d)\n", ret);
-		else
+		} else {
 			printf("OK\n");
+			env_mark_saved();
+		}
 
 		if (!ret)
 			return 0;
@@ -295,6 +302,7 @@ int env_erase(void)
 			return -ENODEV;
 
 		printf("Erasing Environment on %s... ", drv->name);
+		env_clear_stored();
 		ret = drv->erase();
 		if (ret)
 			printf("Failed (%d)\n", ret);
@@ -372,6 +380,7 @@ int env_select(const char *name)
 				gd->env_load_prio = prio;
 				gd->env_valid = ENV_INVALID;
 				gd->flags &= ~GD_FLG_ENV_DEFAULT;
+				env_clear_stored();
 			}
 			printf("OK\n");
 			return 0;
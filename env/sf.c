@@ -72,6 +72,43 @@ static int setup_flash_device(struct spi_flash **env_flash)
 }
 
 #if defined(CONFIG_ENV_OFFSET_REDUND)
+/*
+ * Update the copy of the environment at @offset, which spans several sectors.
+ * The copy being replaced is that of the previous save, so usually only some
+ * sectors differ and the others need not be erased and written again.
+ */
+static int env_sf_write_changed(struct spi_flash *flash, u32 offset,
+				const env_t *env, u32 sect_size)
+{
+	const char *src = (const char *)env;
+	u32 pos, len;
+	char *buf;
+	int ret = 0;
+
+	buf = memalign(ARCH_DMA_MINALIGN, sect_size);
+	if (!buf)
+		return -ENOMEM;
+
+	for (pos = 0; pos < CONFIG_ENV_SIZE; pos += sect_size) {
+		len = min_t(u32, sect_size, CONFIG_ENV_SIZE - pos);
+		ret = spi_flash_read(flash, offset + pos, len, buf);
+		if (ret)
+			break;
+		if (!memcmp(buf, src + pos, len))
+			continue;
+
+		ret = spi_flash_erase(flash, offset + pos, sect_size);
+		if (ret)
+			break;
+		ret = spi_flash_write(flash, offset + pos, len, src + pos);
+		if (ret)
+			break;
+	}
+	free(buf);
+
+	return ret;
+}
+
 static int env_sf_save(void)
 {
 	env_t	env_new;
@@ -118,24 +155,31 @@ static int env_sf_save(void)
 
 	sector = DIV_ROUND_UP(CONFIG_ENV_SIZE, sect_size);
 
-	puts("Erasing SPI flash...");
-	ret = spi_flash_erase(env_flash, env_new_offset,
-				sector * sect_size);
-	if (ret)
-		goto done;
+	if (sector > 1) {
+		puts("Updating SPI flash...");
+		ret = env_sf_write_changed(env_flash, env_new_offset, &env_new,
+					   sect_size);
+		if (ret)
+			goto done;
+	} else {
+		puts("Erasing SPI flash...");
+		ret = spi_flash_erase(env_flash, env_new_offset, sect_size);
+		if (ret)
+			goto done;
 
-	puts("Writing to SPI flash...");
+		puts("Writing to SPI flash...");
 
-	ret = spi_flash_write(env_flash, env_new_offset,
-		CONFIG_ENV_SIZE, &env_new);
-	if (ret)
-		goto done;
-
-	if (sect_size > CONFIG_ENV_SIZE) {
-		ret = spi_flash_write(env_flash, saved_offset,
-					saved_size, saved_buffer);
+		ret = spi_flash_write(env_flash, env_new_offset,
+				      CONFIG_ENV_SIZE, &env_new);
 		if (ret)
 			goto done;
+
+		if (sect_size > CONFIG_ENV_SIZE) {
+			ret = spi_flash_write(env_flash, saved_offset,
+					      saved_size, saved_buffer);
+			if (ret)
+				goto done;
+		}
 	}
 
 	ret = spi_flash_write(env_flash, env_offset + offsetof(env_t, flags),
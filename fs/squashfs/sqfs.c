@@ -10,6 +10,7 @@
 #include <asm/unaligned.h>
 #include <errno.h>
 #include <fs.h>
+#include <malloc_arena.h>
 #include <linux/types.h>
 #include <linux/byteorder/little_endian.h>
 #include <linux/byteorder/generic.h>
@@ -293,7 +294,7 @@ static int sqfs_tokenize(char **tokens, int count, const char *str)
 		return -ENOMEM;
 
 	if (!strcmp(strc, "/")) {
-		tokens[0] = strdup(strc);
+		tokens[0] = malloc_arena_strdup(ctxt.arena, strc);
 		if (!tokens[0]) {
 			ret = -ENOMEM;
 			goto free_strc;
@@ -301,10 +302,10 @@ static int sqfs_tokenize(char **tokens, int count, const char *str)
 	} else {
 		for (j = 0; j < count; j++) {
 			aux = strtok(!j ? strc : NULL, "/");
-			tokens[j] = strdup(aux);
+			tokens[j] = malloc_arena_strdup(ctxt.arena, aux);
 			if (!tokens[j]) {
 				for (i = 0; i < j; i++)
-					free(tokens[i]);
+					malloc_arena_free(ctxt.arena, tokens[i]);
 				ret = -ENOMEM;
 				goto free_strc;
 			}
@@ -327,7 +328,7 @@ static int sqfs_clean_base_path(char **base, int count, int updir)
 	int i;
 
 	for (i = count - updir - 1; i < count; i++)
-		free(base[i]);
+		malloc_arena_free(ctxt.arena, base[i]);
 
 	return count - updir - 1;
 }
@@ -398,10 +399,10 @@ static char *sqfs_get_abs_path(const char *base, const char *rel)
 out:
 	if (rel_tokens)
 		for (i = 0; i < rc; i++)
-			free(rel_tokens[i]);
+			malloc_arena_free(ctxt.arena, rel_tokens[i]);
 	if (base_tokens)
 		for (i = 0; i < bc; i++)
-			free(base_tokens[i]);
+			malloc_arena_free(ctxt.arena, base_tokens[i]);
 
 	free(rel_tokens);
 	free(base_tokens);
@@ -953,7 +954,7 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 
 out:
 	for (j = 0; j < token_count; j++)
-		free(token_list[j]);
+		malloc_arena_free(ctxt.arena, token_list[j]);
 	free(token_list);
 	free(pos_list);
 	free(path);
@@ -1103,6 +1104,7 @@ int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition
 	if (ret) {
 		goto error;
 	}
+	ctxt.arena = malloc_arena_create("squashfs");
 
 	return 0;
 error:
@@ -1705,6 +1707,8 @@ free_strings:
 void sqfs_close(void)
 {
 	sqfs_decompressor_cleanup(&ctxt);
+	malloc_arena_destroy(ctxt.arena);
+	ctxt.arena = NULL;
 	free(ctxt.sblk);
 	ctxt.sblk = NULL;
 	ctxt.cur_dev = NULL;
@@ -77,6 +77,8 @@ struct squashfs_ctxt {
 	struct disk_partition cur_part_info;
 	struct blk_desc *cur_dev;
 	struct squashfs_super_block *sblk;
+	/* Path tokens, freed at once when the filesystem is closed */
+	struct malloc_arena *arena;
 #if IS_ENABLED(CONFIG_ZSTD)
 	void *zstd_workspace;
 #endif
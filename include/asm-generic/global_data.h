@@ -211,6 +211,13 @@ struct global_data {
 	 * @uclass_root_s.
 	 */
 	struct list_head *uclass_root;
+# if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	/**
+	 * @dm_probe: innermost device_probe() in progress, used to attribute
+	 * memory to nested probes
+	 */
+	void *dm_probe;
+# endif
 # if CONFIG_IS_ENABLED(OF_PLATDATA_DRIVER_RT)
 	/** @dm_driver_rt: Dynamic info about the driver */
 	struct driver_rt *dm_driver_rt;
@@ -92,6 +92,9 @@ struct blk_desc {
 		uint32_t mbr_sig;	/* MBR integer signature */
 		efi_guid_t guid_sig;	/* GPT GUID Signature */
 	};
+#ifdef CONFIG_BOUNCE_BUFFER
+	u64		bounce_bytes;	/* bytes bounced by the driver */
+#endif
 #if CONFIG_IS_ENABLED(BLK)
 	/*
 	 * For now we have a few functions which take struct blk_desc as a
@@ -210,6 +213,21 @@ static inline void blkcache_invalidate(int iftype, int dev) {}
 
 #endif
 
+/**
+ * struct blk_req - one transfer of a batch passed to blk_drw_multi()
+ *
+ * @start:	Start block number (0=first)
+ * @blkcnt:	Number of blocks
+ * @buffer:	Data to write, or destination for data read
+ * @write:	true to write to the device, false to read from it
+ */
+struct blk_req {
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	bool write;
+};
+
 #if CONFIG_IS_ENABLED(BLK)
 struct udevice;
 
@@ -271,6 +289,21 @@ struct blk_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
+
+	/**
+	 * rw_multi() - carry out a batch of reads and writes
+	 *
+	 * This allows devices which can queue several commands, like eMMC
+	 * with command queueing, to keep the medium busy. The transfers may
+	 * be carried out in any order and at the same time, so the caller
+	 * must not pass overlapping writes, or reads overlapping writes.
+	 *
+	 * @dev:	Device to transfer to or from
+	 * @reqs:	Transfers to carry out
+	 * @count:	Number of transfers in @reqs
+	 * @return 0 if all transfers completed, -ve on error
+	 */
+	int (*rw_multi)(struct udevice *dev, struct blk_req *reqs, int count);
 };
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
@@ -288,6 +321,20 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+/**
+ * blk_drw_multi() - carry out a batch of reads and writes
+ *
+ * The device may carry out the transfers in any order and at the same time,
+ * so @reqs must not contain overlapping writes, or reads overlapping writes.
+ * Devices without support for this get the transfers one at a time.
+ *
+ * @block_dev:	Block device descriptor
+ * @reqs:	Transfers to carry out
+ * @count:	Number of transfers in @reqs
+ * Return: 0 if all transfers completed, -ve on error
+ */
+int blk_drw_multi(struct blk_desc *block_dev, struct blk_req *reqs, int count);
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -485,6 +532,26 @@ static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
+static inline int blk_drw_multi(struct blk_desc *block_dev,
+				struct blk_req *reqs, int count)
+{
+	ulong n;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].write)
+			n = blk_dwrite(block_dev, reqs[i].start,
+				       reqs[i].blkcnt, reqs[i].buffer);
+		else
+			n = blk_dread(block_dev, reqs[i].start,
+				      reqs[i].blkcnt, reqs[i].buffer);
+		if (n != reqs[i].blkcnt)
+			return -EIO;
+	}
+
+	return 0;
+}
+
 /**
  * struct blk_driver - Driver for block interface types
  *
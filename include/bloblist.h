@@ -54,6 +54,7 @@ enum bloblist_tag_t {
 	 */
 	BLOBLISTT_PROJECT_AREA = 0x8000,
 	BLOBLISTT_U_BOOT_SPL_HANDOFF = 0x8000, /* Hand-off info from SPL */
+	BLOBLISTT_U_BOOT_MMC_INIT = 0x8001, /* eMMC bus mode and width */
 
 	/*
 	 * Vendor-specific tags are permitted here. Projects can be open source
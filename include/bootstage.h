@@ -207,6 +207,7 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ACCUM_FSP_M,
 	BOOTSTAGE_ID_ACCUM_FSP_S,
 	BOOTSTAGE_ID_ACCUM_MMAP_SPI,
+	BOOTSTAGE_ID_ACCUM_EFI_LOAD_PE,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -312,6 +313,21 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name);
  */
 uint32_t bootstage_accum(enum bootstage_id id);
 
+/**
+ * bootstage_accum_name() - Accumulate time against a named activity
+ *
+ * This is similar to bootstage_accum() but looks up the accumulator by name
+ * rather than by id, allocating a new user id the first time a name is seen.
+ * It is intended for activities which have no fixed id, such as the probe
+ * time of each driver. If the record table is full the time is dropped.
+ *
+ * @name:	Name of the activity. This must remain valid for the lifetime of
+ *		bootstage (e.g. a driver name), since it is not copied
+ * @start_us:	Start time of this iteration, from timer_get_boot_us()
+ * Return: time spent in this iteration of the activity
+ */
+uint32_t bootstage_accum_name(const char *name, uint32_t start_us);
+
 /* Print a report about boot time */
 void bootstage_report(void);
 
@@ -331,6 +347,25 @@ int bootstage_fdt_add_report(void);
  */
 int bootstage_stash(void *base, int size);
 
+/**
+ * bootstage_export_json() - Export bootstage data as JSON
+ *
+ * This writes all records to a buffer in a form which is easy to process
+ * automatically, e.g. to track boot-time regressions in CI. The output looks
+ * like this, with one record per line:
+ *
+ *	{"version":1,"records":[
+ *	{"id":0,"name":"reset","mark":0},
+ *	{"id":213,"name":"sdhci-cdns","accum":3476}
+ *	]}
+ *
+ * @buf:	Buffer to write to
+ * @size:	Size of buffer in bytes
+ * Return: number of bytes written (excluding the nul terminator), -ENOSPC
+ *	if the buffer is too small, or -ENODATA if bootstage is not set up
+ */
+int bootstage_export_json(char *buf, int size);
+
 /**
  * Read bootstage data from memory
  *
@@ -411,6 +446,17 @@ static inline uint32_t bootstage_accum(enum bootstage_id id)
 	return 0;
 }
 
+static inline uint32_t bootstage_accum_name(const char *name,
+					    uint32_t start_us)
+{
+	return 0;
+}
+
+static inline int bootstage_export_json(char *buf, int size)
+{
+	return 0;	/* Nothing to export */
+}
+
 static inline int bootstage_stash(void *base, int size)
 {
 	return 0;	/* Pretend to succeed */
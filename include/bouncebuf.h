@@ -51,6 +51,22 @@ struct bounce_buffer {
 	size_t len_aligned;
 	/* Copy of flags parameter passed to start() */
 	unsigned int flags;
+	/* User buffer used directly within an owned region */
+	bool owned;
+};
+
+/* Alignment a DMA engine needs for a buffer in an owned region */
+#define BOUNCE_BUFFER_MIN_ALIGN	8
+
+/**
+ * struct bounce_buffer_stats - bounce buffer statistics
+ *
+ * @count:	number of buffers bounced
+ * @bytes:	number of bytes in the bounced buffers
+ */
+struct bounce_buffer_stats {
+	ulong count;
+	u64 bytes;
 };
 
 /**
@@ -83,4 +99,36 @@ int bounce_buffer_start_extalign(struct bounce_buffer *state, void *data,
  */
 int bounce_buffer_stop(struct bounce_buffer *state);
 
+#ifdef CONFIG_BOUNCE_BUFFER
+/**
+ * bounce_buffer_set_owned() -- Allow DMA to buffers within a region
+ *
+ * A buffer which is not aligned to cache lines is normally bounced, as the
+ * cache lines it shares with other data must not be invalidated. Within the
+ * owned region, a buffer aligned to BOUNCE_BUFFER_MIN_ALIGN is used directly
+ * if the cache lines around it are inside the region, too. The caller is
+ * responsible for not touching the rest of the region during the transfer.
+ *
+ * start:	start of the region, NULL to end it
+ * len:		length of the region
+ */
+void bounce_buffer_set_owned(void *start, size_t len);
+
+/**
+ * bounce_buffer_get_stats() -- Get the bounce buffer statistics
+ * stats:	returns the statistics since boot
+ */
+void bounce_buffer_get_stats(struct bounce_buffer_stats *stats);
+#else
+static inline void bounce_buffer_set_owned(void *start, size_t len)
+{
+}
+
+static inline void bounce_buffer_get_stats(struct bounce_buffer_stats *stats)
+{
+	stats->count = 0;
+	stats->bytes = 0;
+}
+#endif
+
 #endif
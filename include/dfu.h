@@ -146,6 +146,8 @@ struct dfu_entity {
 	u8 *i_buf;
 	u8 *i_buf_start;
 	u8 *i_buf_end;
+	u8 *p_buf;	/* full buffer being written out by dfu_write_poll() */
+	u8 *p_buf_end;
 	u64 r_left;
 	long b_left;
 
@@ -356,6 +358,29 @@ int dfu_write(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
  */
 int dfu_flush(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 
+#ifdef CONFIG_DFU_WRITE_PINGPONG
+/**
+ * dfu_write_poll() - write out part of a full DFU buffer
+ *
+ * With CONFIG_DFU_WRITE_PINGPONG, dfu_write() hands a full buffer over and
+ * carries on receiving into a second one. This writes the next
+ * CONFIG_DFU_WRITE_SLICE_SIZE bytes of the handed over buffer to the medium,
+ * so that it should be called whenever the caller would otherwise be idle,
+ * e.g. between polls of the USB controller. Whatever is left is written by the
+ * next dfu_write() which needs the buffer, or by dfu_flush().
+ *
+ * On error the transaction is aborted.
+ *
+ * Return:	0 for success, a negative error code otherwise
+ */
+int dfu_write_poll(void);
+#else
+static inline int dfu_write_poll(void)
+{
+	return 0;
+}
+#endif
+
 /**
  * dfu_initiated_callback() - weak callback called on DFU transaction start
  *
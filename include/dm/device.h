@@ -114,6 +114,22 @@ enum {
 	DM_REMOVE_NO_PD		= 1 << 1,
 };
 
+/**
+ * struct dm_probe_stats - Statistics about probing a device
+ *
+ * This is only used with CONFIG_DM_PROBE_STATS. Memory used by nested probes,
+ * e.g. of a clock needed by the device, is attributed to the nested device and
+ * is not included in @heap or @heap_f.
+ *
+ * @heap: Bytes of malloc() heap allocated by the probe (may be negative if
+ *	the probe freed more than it allocated)
+ * @heap_f: Bytes of pre-relocation malloc() heap allocated by the probe
+ */
+struct dm_probe_stats {
+	long heap;
+	long heap_f;
+};
+
 /**
  * struct udevice - An instance of a driver
  *
@@ -167,6 +183,8 @@ enum {
  *		automatically when the device is removed / unbound
  * @dma_offset: Offset between the physical address space (CPU's) and the
  *		device's bus address space
+ * @probe_stats: Statistics about the last probe of this device, see
+ *		struct dm_probe_stats
  */
 struct udevice {
 	const struct driver *driver;
@@ -196,6 +214,9 @@ struct udevice {
 #if CONFIG_IS_ENABLED(DM_DMA)
 	ulong dma_offset;
 #endif
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+	struct dm_probe_stats probe_stats;
+#endif
 };
 
 /**
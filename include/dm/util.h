@@ -24,8 +24,22 @@ struct list_head;
  */
 int list_count_items(struct list_head *head);
 
-/* Dump out a tree of all devices */
-void dm_dump_all(void);
+/**
+ * dm_dump_all() - Dump out a tree of all devices
+ *
+ * @verbose: true to also show probe time and heap usage of each device (only
+ *	available with CONFIG_DM_PROBE_STATS)
+ */
+void dm_dump_all(bool verbose);
+
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+/* Dump out probed devices with their heap usage, largest first */
+void dm_dump_probe_stats(void);
+#else
+static inline void dm_dump_probe_stats(void)
+{
+}
+#endif
 
 /* Dump out a list of uclasses and their devices */
 void dm_dump_uclass(void);
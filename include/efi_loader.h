@@ -97,6 +97,10 @@ void efi_set_bootdev(const char *dev, const char *devnr, const char *path,
 void efi_net_set_dhcp_ack(void *pkt, int len);
 /* Print information about all loaded images */
 void efi_print_image_infos(void *pc);
+/* Called by the block layer to discard blocks read ahead after a write */
+void efi_disk_invalidate_cache(struct blk_desc *desc);
+/* Free all read-ahead buffers when the EFI payload is done with the disks */
+void efi_disk_free_caches(void);
 
 /* Hook at initialization */
 efi_status_t efi_launch_capsules(void);
@@ -119,6 +123,8 @@ static inline void efi_set_bootdev(const char *dev, const char *devnr,
 				   size_t buffer_size) { }
 static inline void efi_net_set_dhcp_ack(void *pkt, int len) { }
 static inline void efi_print_image_infos(void *pc) { }
+static inline void efi_disk_invalidate_cache(struct blk_desc *desc) { }
+static inline void efi_disk_free_caches(void) { }
 static inline efi_status_t efi_launch_capsules(void)
 {
 	return EFI_SUCCESS;
@@ -257,6 +263,8 @@ extern const efi_guid_t efi_guid_host_dev;
 #endif
 /* GUID of the EFI_BLOCK_IO_PROTOCOL */
 extern const efi_guid_t efi_block_io_guid;
+/* GUID of the EFI_BLOCK_IO2_PROTOCOL */
+extern const efi_guid_t efi_block_io2_guid;
 extern const efi_guid_t efi_global_variable_guid;
 extern const efi_guid_t efi_guid_console_control;
 extern const efi_guid_t efi_guid_device_path;
@@ -537,6 +545,8 @@ efi_status_t efi_tcg2_do_initial_measurement(void);
 efi_status_t tcg2_measure_pe_image(void *efi, u64 efi_size,
 				   struct efi_loaded_image_obj *handle,
 				   struct efi_loaded_image *loaded_image_info);
+/* Execute pending EFI_BLOCK_IO2_PROTOCOL requests */
+void efi_disk_process_requests(void);
 /* Create handles and protocols for the partitions of a block device */
 int efi_disk_create_partitions(efi_handle_t parent, struct blk_desc *desc,
 			       const char *if_typename, int diskid,
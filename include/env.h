@@ -345,6 +345,43 @@ int env_import_redund(const char *buf1, int buf1_read_fail,
 		      const char *buf2, int buf2_read_fail,
 		      int flags);
 
+#if CONFIG_IS_ENABLED(ENV_SAVE_ONLY_CHANGED)
+/**
+ * env_needs_save() - Check whether the environment differs from storage
+ *
+ * This is quick if no variable was set or deleted since the environment was
+ * loaded or saved. Otherwise the environment is exported and its CRC is
+ * compared with that of the stored one.
+ *
+ * Return: true if the environment must be saved, false if storage already
+ *	holds it
+ */
+bool env_needs_save(void);
+
+/**
+ * env_mark_saved() - Record that the last env_export() has been saved
+ */
+void env_mark_saved(void);
+
+/**
+ * env_clear_stored() - Forget what is in storage, so that it is saved again
+ */
+void env_clear_stored(void);
+#else
+static inline bool env_needs_save(void)
+{
+	return true;
+}
+
+static inline void env_mark_saved(void)
+{
+}
+
+static inline void env_clear_stored(void)
+{
+}
+#endif
+
 /**
  * env_get_default() - Look up a variable from the default environment
  *
@@ -983,6 +983,9 @@ extern ulong mem_malloc_brk;
 
 void mem_malloc_init(ulong start, ulong size);
 
+/* Size of the largest free chunk in the heap */
+size_t malloc_max_free(void);
+
 #ifdef __cplusplus
 };  /* end of extern "C" */
 #endif
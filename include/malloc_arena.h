@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Arenas for small allocations
+ *
+ * An arena serves small allocations from slabs of equally sized objects, one
+ * set of slabs per size class, which are taken from the malloc() heap. This
+ * keeps many short-lived allocations of a subsystem from fragmenting the
+ * heap. Everything allocated from an arena can be freed at once, e.g. when a
+ * filesystem is unmounted.
+ */
+
+#ifndef __MALLOC_ARENA_H
+#define __MALLOC_ARENA_H
+
+#include <malloc.h>
+#include <linux/list.h>
+#include <linux/string.h>
+#include <linux/types.h>
+
+/* Size of each slab */
+#define ARENA_SLAB_SIZE		4096
+
+/* Size classes are powers of two from ARENA_MIN_SIZE to ARENA_MAX_SIZE */
+#define ARENA_MIN_SHIFT		4
+#define ARENA_CLASSES		6
+#define ARENA_MIN_SIZE		(1 << ARENA_MIN_SHIFT)
+#define ARENA_MAX_SIZE		(1 << (ARENA_MIN_SHIFT + ARENA_CLASSES - 1))
+
+/**
+ * struct malloc_arena_stats - statistics for an arena
+ *
+ * @allocs:	number of live allocations
+ * @in_use:	bytes in live allocations, counting whole slab objects
+ * @peak:	highest value of @in_use
+ * @held:	bytes taken from the heap for slabs and large allocations
+ * @peak_held:	highest value of @held
+ * @slabs:	number of slabs
+ */
+struct malloc_arena_stats {
+	ulong allocs;
+	ulong in_use;
+	ulong peak;
+	ulong held;
+	ulong peak_held;
+	uint slabs;
+};
+
+/**
+ * struct malloc_arena - an arena for small allocations
+ *
+ * @name:	name of the arena, shown by 'malloc stats'
+ * @sibling:	node in the list of all arenas
+ * @partial:	slabs with free objects, for each size class
+ * @full:	slabs without free objects
+ * @large:	allocations above ARENA_MAX_SIZE, taken from the heap directly
+ * @stats:	statistics for this arena
+ */
+struct malloc_arena {
+	const char *name;
+	struct list_head sibling;
+	struct list_head partial[ARENA_CLASSES];
+	struct list_head full;
+	struct list_head large;
+	struct malloc_arena_stats stats;
+};
+
+#if CONFIG_IS_ENABLED(MALLOC_ARENA)
+/**
+ * malloc_arena_create() - create a new arena
+ *
+ * @name:	name of the arena, which must remain valid while it exists
+ * Return: new arena, or NULL if out of memory
+ */
+struct malloc_arena *malloc_arena_create(const char *name);
+
+/**
+ * malloc_arena_destroy() - free an arena and everything allocated from it
+ *
+ * @arena:	arena to destroy, may be NULL
+ */
+void malloc_arena_destroy(struct malloc_arena *arena);
+
+/**
+ * malloc_arena_reset() - free everything allocated from an arena
+ *
+ * The arena remains usable afterwards.
+ *
+ * @arena:	arena to reset
+ */
+void malloc_arena_reset(struct malloc_arena *arena);
+
+/**
+ * malloc_arena_alloc() - allocate memory from an arena
+ *
+ * The memory is aligned to ARENA_MIN_SIZE bytes, or to what malloc() provides
+ * for allocations above ARENA_MAX_SIZE.
+ *
+ * @arena:	arena to allocate from, NULL to use malloc()
+ * @size:	number of bytes to allocate
+ * Return: allocated memory, or NULL if out of memory
+ */
+void *malloc_arena_alloc(struct malloc_arena *arena, size_t size);
+
+/**
+ * malloc_arena_free() - free memory allocated from an arena
+ *
+ * @arena:	arena the memory was allocated from, NULL if it came from
+ *		malloc()
+ * @ptr:	memory to free, may be NULL
+ */
+void malloc_arena_free(struct malloc_arena *arena, void *ptr);
+
+/**
+ * malloc_arena_list() - get the list of all arenas
+ *
+ * Return: list of all arenas, to be walked with list_for_each_entry()
+ */
+struct list_head *malloc_arena_list(void);
+#else
+static inline struct malloc_arena *malloc_arena_create(const char *name)
+{
+	return NULL;
+}
+
+static inline void malloc_arena_destroy(struct malloc_arena *arena)
+{
+}
+
+static inline void malloc_arena_reset(struct malloc_arena *arena)
+{
+}
+
+static inline void *malloc_arena_alloc(struct malloc_arena *arena, size_t size)
+{
+	return malloc(size);
+}
+
+static inline void malloc_arena_free(struct malloc_arena *arena, void *ptr)
+{
+	free(ptr);
+}
+#endif
+
+/**
+ * malloc_arena_strdup() - duplicate a string into an arena
+ *
+ * @arena:	arena to allocate from, NULL to use malloc()
+ * @str:	string to duplicate
+ * Return: copy of the string, or NULL if out of memory
+ */
+static inline char *malloc_arena_strdup(struct malloc_arena *arena,
+					const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *copy;
+
+	copy = malloc_arena_alloc(arena, len);
+	if (copy)
+		memcpy(copy, str, len);
+
+	return copy;
+}
+
+#endif
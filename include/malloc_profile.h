@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Heap profiling
+ *
+ * With CONFIG_MALLOC_PROFILE, each live heap allocation is recorded with its
+ * size, the address of the code which made it and a sequence number. This
+ * shows which call sites own heap memory and finds allocations which are
+ * never freed.
+ */
+
+#ifndef __MALLOC_PROFILE_H
+#define __MALLOC_PROFILE_H
+
+#include <linux/string.h>
+#include <linux/types.h>
+
+/**
+ * struct malloc_profile_rec - record of a live allocation
+ *
+ * @ptr:	address of the allocation, 0 if this record is unused
+ * @caller:	address of the caller, as in the U-Boot symbol map
+ * @size:	size requested by the caller
+ * @seq:	sequence number of the allocation, counting from 1
+ */
+struct malloc_profile_rec {
+	ulong ptr;
+	ulong caller;
+	u32 size;
+	u32 seq;
+};
+
+/**
+ * struct malloc_profile_stats - overall heap profile
+ *
+ * @count:	number of live allocations recorded
+ * @bytes:	total size of the live allocations recorded
+ * @peak:	highest value of @bytes
+ * @dropped:	number of allocations not recorded as the table was full
+ * @seq:	sequence number of the latest allocation
+ */
+struct malloc_profile_stats {
+	ulong count;
+	ulong bytes;
+	ulong peak;
+	ulong dropped;
+	ulong seq;
+};
+
+#if CONFIG_IS_ENABLED(MALLOC_PROFILE)
+/**
+ * malloc_profile_add() - record an allocation
+ *
+ * If @ptr is already recorded, its record is replaced. This happens when one
+ * allocator calls another, the outermost one knowing the real caller.
+ *
+ * @ptr:	address of the allocation, NULL to do nothing
+ * @size:	size requested
+ * @caller:	return address of the allocation function
+ */
+void malloc_profile_add(void *ptr, size_t size, void *caller);
+
+/**
+ * malloc_profile_del() - remove the record of an allocation being freed
+ *
+ * @ptr:	address of the allocation; unknown addresses are ignored
+ */
+void malloc_profile_del(void *ptr);
+
+/**
+ * malloc_profile_get_stats() - get the overall heap profile
+ *
+ * @stats:	returns the statistics
+ */
+void malloc_profile_get_stats(struct malloc_profile_stats *stats);
+
+/**
+ * malloc_profile_leaks() - count allocations made since a point in time
+ *
+ * This counts the live allocations with a sequence number above @since,
+ * i.e. those made after malloc_profile_get_stats() returned @since as the
+ * sequence number, and not freed since.
+ *
+ * @since:	sequence number to check from
+ * @show:	true to print each allocation found
+ * Return: number of allocations found
+ */
+int malloc_profile_leaks(ulong since, bool show);
+
+/**
+ * malloc_profile_dump() - print all live allocations
+ */
+void malloc_profile_dump(void);
+
+/**
+ * malloc_profile_top() - print the call sites holding the most memory
+ *
+ * @count:	number of call sites to show
+ */
+void malloc_profile_top(int count);
+#else
+static inline void malloc_profile_add(void *ptr, size_t size, void *caller)
+{
+}
+
+static inline void malloc_profile_del(void *ptr)
+{
+}
+
+static inline void malloc_profile_get_stats(struct malloc_profile_stats *stats)
+{
+	memset(stats, '\0', sizeof(*stats));
+}
+
+static inline int malloc_profile_leaks(ulong since, bool show)
+{
+	return 0;
+}
+#endif
+
+#endif
@@ -74,6 +74,7 @@ struct bd_info;
 #define MMC_CAP_NONREMOVABLE	BIT(14)
 #define MMC_CAP_NEEDS_POLL	BIT(15)
 #define MMC_CAP_CD_ACTIVE_HIGH  BIT(16)
+#define MMC_CAP_CQE		BIT(17)	/* host has a command queue engine */
 
 #define MMC_MODE_8BIT		BIT(30)
 #define MMC_MODE_4BIT		BIT(29)
@@ -112,6 +113,7 @@ struct bd_info;
 #define MMC_CMD_ERASE_GROUP_START	35
 #define MMC_CMD_ERASE_GROUP_END		36
 #define MMC_CMD_ERASE			38
+#define MMC_CMD_CMDQ_TASK_MGMT		48
 #define MMC_CMD_APP_CMD			55
 #define MMC_CMD_SPI_READ_OCR		58
 #define MMC_CMD_SPI_CRC_ON_OFF		59
@@ -213,6 +215,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 /*
  * EXT_CSD fields
  */
+#define EXT_CSD_CMDQ_MODE_EN		15	/* R/W */
 #define EXT_CSD_ENH_START_ADDR		136	/* R/W */
 #define EXT_CSD_ENH_SIZE_MULT		140	/* R/W */
 #define EXT_CSD_GP_SIZE_MULT		143	/* R/W */
@@ -242,6 +245,8 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_HC_ERASE_GRP_SIZE	224	/* RO */
 #define EXT_CSD_BOOT_MULT		226	/* RO */
 #define EXT_CSD_GENERIC_CMD6_TIME       248     /* RO */
+#define EXT_CSD_CMDQ_DEPTH		307	/* RO */
+#define EXT_CSD_CMDQ_SUPPORT		308	/* RO */
 #define EXT_CSD_BKOPS_SUPPORT		502	/* RO */
 
 /*
@@ -535,6 +540,24 @@ struct dm_mmc_ops {
 	 * @return 0 if success, -ve on error
 	 */
 	int (*hs400_prepare_ddr)(struct udevice *dev);
+
+#if CONFIG_IS_ENABLED(MMC_CQE)
+	/**
+	 * cqe_request() - carry out a batch of transfers with the CQE
+	 *
+	 * Enable the command queue engine, queue one task per transfer, wait
+	 * for all of them to complete and disable the engine again. The card
+	 * is in command queueing mode while this is called. Only hosts which
+	 * set MMC_CAP_CQE need to implement this.
+	 *
+	 * @dev:	Device to use
+	 * @reqs:	Transfers to carry out, in 512-byte blocks
+	 * @count:	Number of transfers, at most the card's queue depth
+	 * @return 0 if all transfers completed, -ve on error
+	 */
+	int (*cqe_request)(struct udevice *dev, struct blk_req *reqs,
+			   int count);
+#endif
 };
 
 #define mmc_get_ops(dev)        ((struct dm_mmc_ops *)(dev)->driver->ops)
@@ -551,6 +574,7 @@ int mmc_deferred_probe(struct mmc *mmc);
 int mmc_reinit(struct mmc *mmc);
 int mmc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt);
 int mmc_hs400_prepare_ddr(struct mmc *mmc);
+int mmc_cqe_request(struct mmc *mmc, struct blk_req *reqs, int count);
 #else
 struct mmc_ops {
 	int (*send_cmd)(struct mmc *mmc,
@@ -679,6 +703,9 @@ struct mmc {
 	u8 part_config;
 	u8 gen_cmd6_time;	/* units: 10 ms */
 	u8 part_switch_time;	/* units: 10 ms */
+#if CONFIG_IS_ENABLED(MMC_CQE)
+	u8 cmdq_depth;		/* 0 if the card has no command queue */
+#endif
 	uint tran_speed;
 	uint legacy_speed; /* speed for the legacy mode provided by the card */
 	uint read_bl_len;
@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Neighbour discovery for IPv6 (RFC 4861)
+ *
+ * This does for IPv6 what ARP does for IPv4, and also takes our global
+ * address and default router from router advertisements (RFC 4862).
+ */
+
+#ifndef __NDISC_H__
+#define __NDISC_H__
+
+#include <net6.h>
+
+/* Option types */
+#define ND_OPT_SOURCE_LL_ADDR	1
+#define ND_OPT_TARGET_LL_ADDR	2
+#define ND_OPT_PREFIX_INFO	3
+#define ND_OPT_MTU		5
+
+/* Neighbour advertisement flags */
+#define ND_NA_FLAG_ROUTER	0x80
+#define ND_NA_FLAG_SOLICITED	0x40
+#define ND_NA_FLAG_OVERRIDE	0x20
+
+/* Prefix information flags */
+#define ND_PREFIX_FLAG_ONLINK	0x80
+#define ND_PREFIX_FLAG_AUTO	0x40
+
+/* Size of a link-layer address option for Ethernet, in bytes */
+#define ND_OPT_LLADDR_SIZE	8
+
+/*
+ *	Prefix information option
+ */
+struct nd_opt_prefix_info {
+	u8		type;
+	u8		len;		/* in units of 8 bytes		*/
+	u8		prefix_len;	/* in bits			*/
+	u8		flags;		/* ND_PREFIX_FLAG_...		*/
+	u32		valid_lifetime;	/* in seconds			*/
+	u32		pref_lifetime;	/* in seconds			*/
+	u32		reserved;
+	struct in6_addr	prefix;
+} __attribute__((packed));
+
+/*
+ *	Neighbour solicitation or advertisement
+ */
+struct nd_msg {
+	struct icmp6_hdr icmph;
+	struct in6_addr	target;
+	u8		opt[0];
+} __attribute__((packed));
+
+/*
+ *	Router solicitation
+ */
+struct rs_msg {
+	struct icmp6_hdr icmph;
+	u8		opt[0];
+} __attribute__((packed));
+
+/*
+ *	Router advertisement
+ */
+struct ra_msg {
+	struct icmp6_hdr icmph;
+	u32		reachable_time;
+	u32		retrans_timer;
+	u8		opt[0];
+} __attribute__((packed));
+
+/* The neighbour discovery transmit packet */
+extern uchar *ndisc_tx_packet;
+
+#ifdef CONFIG_IPV6
+/**
+ * ndisc_init() - Set up neighbour discovery, once
+ */
+void ndisc_init(void);
+
+/**
+ * ndisc_wait() - Find the MAC address for the packet in net_tx_packet
+ *
+ * This sends a neighbour solicitation for the next hop to @dest, which is
+ * the router if @dest is not on our link. Once the answer comes the packet
+ * is sent.
+ *
+ * @ether:	Returns the MAC address of the next hop
+ * @dest:	Destination of the packet
+ * @len:	Length of the packet, including the Ethernet header
+ */
+void ndisc_wait(uchar *ether, const struct in6_addr *dest, int len);
+
+/**
+ * ndisc_is_waiting() - Check whether a packet is waiting for an address
+ *
+ * Return: true if a packet is held in net_tx_packet
+ */
+bool ndisc_is_waiting(void);
+
+/**
+ * ndisc_cancel() - Give up on any neighbour or router discovery
+ */
+void ndisc_cancel(void);
+
+/**
+ * ndisc_timeout_check() - Send solicitations again if there is no answer
+ *
+ * Return: 1 if waiting for a neighbour advertisement, else 0
+ */
+int ndisc_timeout_check(void);
+
+/**
+ * ndisc_receive() - Process a received neighbour discovery message
+ *
+ * @et:		Ethernet header of the packet
+ * @ip6:	IPv6 header of the packet
+ * @len:	Length of the ICMPv6 message
+ * Return: 0 if OK, -EINVAL if the message is malformed
+ */
+int ndisc_receive(struct ethernet_hdr *et, struct ip6_hdr *ip6, int len);
+
+/**
+ * ndisc_start() - Solicit a router advertisement, to set up our address
+ *
+ * This is the start function for NDISC. The loop succeeds once we have a
+ * global address.
+ */
+void ndisc_start(void);
+#else
+static inline void ndisc_init(void)
+{
+}
+
+static inline bool ndisc_is_waiting(void)
+{
+	return false;
+}
+
+static inline void ndisc_cancel(void)
+{
+}
+
+static inline int ndisc_timeout_check(void)
+{
+	return 0;
+}
+#endif
+
+#endif /* __NDISC_H__ */
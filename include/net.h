@@ -107,6 +107,36 @@ enum eth_state_t {
 	ETH_STATE_ACTIVE
 };
 
+/* Offloads which an Ethernet device can do, see eth_get_offload() */
+#define ETH_OFFLOAD_TX_CSUM	(1 << 0)	/* Fill in UDP/TCP checksums */
+#define ETH_OFFLOAD_RX_CSUM	(1 << 1)	/* Check UDP/TCP checksums */
+#define ETH_OFFLOAD_TSO		(1 << 2)	/* Split large TCP segments */
+#define ETH_OFFLOAD_LRO		(1 << 3)	/* Merge received TCP data */
+
+/* Flags for struct eth_pkt_info */
+#define ETH_PKT_CSUM_PARTIAL	(1 << 0)	/* Send: fill in checksum */
+#define ETH_PKT_CSUM_VALID	(1 << 1)	/* Receive: checksum good */
+#define ETH_PKT_GSO		(1 << 2)	/* Segmented by @gso_size */
+
+/**
+ * struct eth_pkt_info - offload metadata of a packet
+ *
+ * @flags:	ETH_PKT_... flags
+ * @csum_start:	with ETH_PKT_CSUM_PARTIAL, offset from the start of the frame
+ *		of the data to checksum, which runs to the end of the frame
+ * @csum_offset: with ETH_PKT_CSUM_PARTIAL, offset from @csum_start at which
+ *		to store the checksum. It holds the pseudo-header checksum,
+ *		which is included in the sum
+ * @gso_size:	with ETH_PKT_GSO, payload size of each segment, which the
+ *		device splits a packet into (TSO) or merged it from (LRO)
+ */
+struct eth_pkt_info {
+	u32 flags;
+	u16 csum_start;
+	u16 csum_offset;
+	u16 gso_size;
+};
+
 #ifdef CONFIG_DM_ETH
 /**
  * struct eth_pdata - Platform data for Ethernet MAC controllers
@@ -159,6 +189,22 @@ enum eth_recv_flags {
  *		    to the network stack. This function should fill in the
  *		    eth_pdata::enetaddr field - optional
  * set_promisc: Enable or Disable promiscuous mode
+ * lend_rx_buf: Receive the next packet into the given buffer instead of one
+ *		of the driver's own, if it fits. recv() then returns a pointer
+ *		to this buffer. A NULL buffer, a call to stop() or the packet
+ *		being received gives the buffer back to the caller - optional
+ * recv_batch: Like recv() but return up to @max packets at once, setting
+ *	       their buffers in @packetp and their lengths in @lenp. Returns
+ *	       the number of packets, or an error. All are processed before
+ *	       free_pkt() is called for each, in the same order. If provided,
+ *	       this is used instead of recv() - optional
+ * get_offload: Return the ETH_OFFLOAD_... flags for what the device can do.
+ *		These may depend on what was negotiated with it - optional
+ * send_info: Like send() but with metadata in @info asking for offloads. It is
+ *	      only used for offloads reported by get_offload() - optional
+ * get_rx_info: Fill in the metadata for a packet returned by recv() or
+ *		recv_batch(), e.g. to say that its checksum was checked. It is
+ *		called before the packet is processed - optional
  */
 struct eth_ops {
 	int (*start)(struct udevice *dev);
@@ -170,6 +216,53 @@ struct eth_ops {
 	int (*write_hwaddr)(struct udevice *dev);
 	int (*read_rom_hwaddr)(struct udevice *dev);
 	int (*set_promisc)(struct udevice *dev, bool enable);
+	int (*lend_rx_buf)(struct udevice *dev, uchar *buf, int size);
+	int (*recv_batch)(struct udevice *dev, int flags, uchar **packetp,
+			  int *lenp, int max);
+	int (*get_offload)(struct udevice *dev);
+	int (*send_info)(struct udevice *dev, void *packet, int length,
+			 const struct eth_pkt_info *info);
+	void (*get_rx_info)(struct udevice *dev, uchar *packet, int length,
+			    struct eth_pkt_info *info);
+};
+
+/**
+ * struct eth_stats - packet counters of an Ethernet device
+ *
+ * @rx_packets:		packets received
+ * @rx_bytes:		bytes received
+ * @rx_errors:		errors returned by the driver when receiving
+ * @rx_dropped:		packets dropped by the network stack as malformed
+ * @rx_overruns:	packets lost as the driver's receive ring was full, if
+ *			the driver can tell
+ * @rx_full_batches:	polls which found a full batch of packets waiting, a
+ *			sign that the receive ring may be overflowing
+ * @rx_broadcast:	broadcast packets received
+ * @rx_multicast:	multicast packets received
+ * @rx_arp:		ARP packets received
+ * @rx_udp:		IPv4 UDP packets received
+ * @rx_icmp:		IPv4 ICMP packets received
+ * @rx_other:		other packets received
+ * @tx_packets:		packets sent
+ * @tx_bytes:		bytes sent
+ * @tx_errors:		errors returned by the driver when sending
+ */
+struct eth_stats {
+	ulong rx_packets;
+	ulong rx_bytes;
+	ulong rx_errors;
+	ulong rx_dropped;
+	ulong rx_overruns;
+	ulong rx_full_batches;
+	ulong rx_broadcast;
+	ulong rx_multicast;
+	ulong rx_arp;
+	ulong rx_udp;
+	ulong rx_icmp;
+	ulong rx_other;
+	ulong tx_packets;
+	ulong tx_bytes;
+	ulong tx_errors;
 };
 
 #define eth_get_ops(dev) ((struct eth_ops *)(dev)->driver->ops)
@@ -186,6 +279,20 @@ unsigned char *eth_get_ethaddr(void); /* get the current device MAC */
 int eth_is_active(struct udevice *dev); /* Test device for active state */
 int eth_init_state_only(void); /* Set active state */
 void eth_halt_state_only(void); /* Set passive state */
+
+/**
+ * eth_get_stats() - Get the packet counters of an Ethernet device
+ *
+ * Drivers which can detect that their receive ring overflowed add the number
+ * of packets lost to the rx_overruns counter.
+ *
+ * @dev:	Device to check, which must be probed
+ * Return: counters, which may be cleared by the caller
+ */
+struct eth_stats *eth_get_stats(struct udevice *dev);
+
+/* Count a packet dropped by the network stack on the current device */
+void eth_count_rx_dropped(void);
 #endif
 
 #ifndef CONFIG_DM_ETH
@@ -255,6 +362,10 @@ int eth_write_hwaddr(struct eth_device *dev, const char *base_name,
 		     int eth_number);
 
 int usb_eth_initialize(struct bd_info *bi);
+
+static inline void eth_count_rx_dropped(void)
+{
+}
 #endif
 
 int eth_initialize(void);		/* Initialize network subsystem */
@@ -302,13 +413,59 @@ int eth_env_get_enetaddr_by_index(const char *base_name, int index,
 int eth_init(void);			/* Initialize the device */
 int eth_send(void *packet, int length);	   /* Send a packet */
 
+/**
+ * eth_send_info() - Send a packet with offload metadata
+ *
+ * This is like eth_send() but lets the device fill in checksums, etc. as
+ * described by @info. Only offloads reported by eth_get_offload() may be used.
+ *
+ * @packet:	Packet to send
+ * @length:	Length of the packet
+ * @info:	Offload metadata, or NULL for none
+ * Return: 0 if OK, -ve on error
+ */
+int eth_send_info(void *packet, int length, const struct eth_pkt_info *info);
+
+/**
+ * eth_get_offload() - Get the offloads which the current device can do
+ *
+ * Return: ETH_OFFLOAD_... flags, 0 if none or if there is no device
+ */
+int eth_get_offload(void);
+
 #if defined(CONFIG_API) || defined(CONFIG_EFI_LOADER)
 int eth_receive(void *packet, int length); /* Receive a packet*/
 extern void (*push_packet)(void *packet, int length);
 #endif
 int eth_rx(void);			/* Check for received packets */
+
+/**
+ * eth_lend_rx_buf() - Lend a buffer for the next received packet
+ *
+ * The current device receives the next packet into @buf, if it fits, so that
+ * the data lands where the protocol wants it without being copied. The
+ * buffer belongs to the device until the packet arrives, the device is
+ * stopped or this is called again with a NULL @buf.
+ *
+ * @buf:	Buffer to receive into, NULL to take back a lent buffer
+ * @size:	Size of the buffer
+ * Return: 0 if OK, -ENOSYS if the device cannot do this, other -ve on error
+ */
+int eth_lend_rx_buf(uchar *buf, int size);
+
 void eth_halt(void);			/* stop SCC */
 const char *eth_get_name(void);		/* get name of current device */
+
+/**
+ * eth_mcast_join() - Join or leave a multicast group
+ *
+ * This has the current device receive, or stop receiving, the packets sent
+ * to the MAC address for an IPv4 multicast group (RFC 1112).
+ *
+ * @mcast_addr:	Multicast group
+ * @join:	1 to join, 0 to leave
+ * Return: 0 if OK, -ve on error, e.g. if the device cannot do this
+ */
 int eth_mcast_join(struct in_addr mcast_addr, int join);
 
 /**********************************************************************/
@@ -371,6 +528,7 @@ struct vlan_ethernet_hdr {
 #define PROT_NCSI	0x88f8		/* NC-SI control packets        */
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -564,7 +722,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, UDP
+	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, UDP, PING6, NDISC
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
@@ -600,6 +758,11 @@ static inline int is_cdp_packet(const uchar *ethaddr)
 }
 #endif
 
+#ifdef CONFIG_MCAST_TFTP
+/* Multicast group whose packets are received, 0 if none */
+extern struct in_addr net_mcast_addr;
+#endif
+
 #if defined(CONFIG_CMD_SNTP)
 extern struct in_addr	net_ntp_server;		/* the ip address to NTP */
 extern int net_ntp_time_offset;			/* offset time from UTC */
@@ -664,6 +827,56 @@ bool arp_is_waiting(void);		/* Waiting for ARP reply? */
 void net_set_icmp_handler(rxhand_icmp_f *f); /* Set ICMP RX handler */
 void net_set_timeout_handler(ulong, thand_f *);/* Set timeout handler */
 
+/* Received payload bytes which protocols had to copy into place */
+extern ulong net_rx_copied;
+
+/**
+ * net_store_payload() - Put received data in its destination
+ *
+ * This copies the data unless it was received in place, in a buffer lent
+ * with net_rx_lend(). The areas may overlap.
+ *
+ * @dest:	Destination of the data
+ * @src:	Data in the received packet
+ * @len:	Number of bytes
+ */
+void net_store_payload(void *dest, const void *src, int len);
+
+#ifdef CONFIG_NET_RX_LEND
+/**
+ * net_rx_lend() - Receive the next packet so that its payload is in place
+ *
+ * This lends the Ethernet device a buffer starting @hdr_len bytes before
+ * @dest, so that the payload of a packet with that many bytes of headers
+ * lands at @dest. The bytes covered by the headers are saved and put back by
+ * net_rx_reclaim(), which this calls first for any earlier buffer.
+ *
+ * @dest:	Where the payload of the next packet should go
+ * @hdr_len:	Number of bytes in front of the payload, from the Ethernet
+ *		header onwards
+ * @len:	Largest payload expected
+ * Return: 0 if OK, -ve if nothing was lent
+ */
+int net_rx_lend(uchar *dest, int hdr_len, int len);
+
+/**
+ * net_rx_reclaim() - Take back a lent buffer and restore what it covered
+ *
+ * This must not be called while the packet received into the buffer is
+ * still being processed.
+ */
+void net_rx_reclaim(void);
+#else
+static inline int net_rx_lend(uchar *dest, int hdr_len, int len)
+{
+	return -ENOSYS;
+}
+
+static inline void net_rx_reclaim(void)
+{
+}
+#endif
+
 /* Network loop state */
 enum net_loop_state {
 	NETLOOP_CONTINUE,
@@ -713,6 +926,19 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport,
 /* Processes a received packet */
 void net_process_received_packet(uchar *in_packet, int len);
 
+/**
+ * net_process_received_packet_info() - Process a packet with offload metadata
+ *
+ * This is like net_process_received_packet() but skips checks which the
+ * device has already done, as described by @info
+ *
+ * @in_packet:	Received packet
+ * @len:	Length of the packet
+ * @info:	Offload metadata, or NULL for none
+ */
+void net_process_received_packet_info(uchar *in_packet, int len,
+				      const struct eth_pkt_info *info);
+
 #if defined(CONFIG_NETCONSOLE) && !defined(CONFIG_SPL_BUILD)
 void nc_start(void);
 int nc_input_packet(uchar *pkt, struct in_addr src_ip, unsigned dest_port,
@@ -745,6 +971,22 @@ static inline void eth_set_last_protocol(int protocol)
  */
 void net_auto_load(void);
 
+#ifdef CONFIG_NET_ARP_CACHE
+/**
+ * arp_cache_flush() - Forget all MAC addresses found by ARP
+ */
+void arp_cache_flush(void);
+
+/**
+ * arp_cache_show() - Print the MAC addresses found by ARP, with their ages
+ */
+void arp_cache_show(void);
+#else
+static inline void arp_cache_flush(void)
+{
+}
+#endif
+
 /*
  * The following functions are a bit ugly, but necessary to deal with
  * alignment restrictions on ARM.
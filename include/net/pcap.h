@@ -4,6 +4,31 @@
  * Ramon Fried <rfried.dev@gmail.com>
  */
 
+#ifndef __NET_PCAP_H__
+#define __NET_PCAP_H__
+
+#include <net.h>
+
+/* Most bytes which can be kept of each packet */
+#define PCAP_SNAPLEN_MAX	65535
+
+/**
+ * struct pcap_filter - Which packets to capture
+ *
+ * A packet is captured if it matches every field which is set.
+ *
+ * @eth_proto:	Ethernet protocol (PROT_...), 0 for any
+ * @ip_proto:	IP protocol (IPPROTO_...), over IPv4 or IPv6, 0 for any
+ * @port:	UDP or TCP port, source or destination, 0 for any
+ * @host:	IPv4 address, source or destination, 0 for any
+ */
+struct pcap_filter {
+	u16 eth_proto;
+	u8 ip_proto;
+	u16 port;
+	struct in_addr host;
+};
+
 /**
  * pcap_init() - Initialize PCAP memory buffer
  *
@@ -17,12 +42,46 @@ int pcap_init(phys_addr_t paddr, unsigned long size);
 /**
  * pcap_start_stop() - start / stop pcap capture
  *
+ * Stopping sets the 'pcapsize' environment variable to the size of the file.
+ *
  * @start	if true, start capture if false stop capture
  *
  * Return:	0 on success, -ERROR on error
  */
 int pcap_start_stop(bool start);
 
+/**
+ * pcap_set_ring() - choose what happens when the buffer is full
+ *
+ * Stopping a capture in ring mode puts the packets back in order, so that
+ * the buffer holds a pcap file.
+ *
+ * @enable:	if true, the oldest packets make way for new ones, if false
+ *		capture stops
+ * Return:	0 on success, -ERROR on error
+ */
+int pcap_set_ring(bool enable);
+
+/**
+ * pcap_set_snaplen() - set how much of each packet is kept
+ *
+ * Keeping only the headers makes capture cheaper and the buffer go further.
+ *
+ * @len:	most bytes to keep, up to PCAP_SNAPLEN_MAX
+ * Return:	0 on success, -EINVAL if @len is not valid
+ */
+int pcap_set_snaplen(unsigned int len);
+
+/**
+ * pcap_set_filter() - set which packets are captured
+ *
+ * Packets are checked before anything is copied.
+ *
+ * @filter:	filter to use, NULL to capture all packets
+ * Return:	0 on success, -ERROR on error
+ */
+int pcap_set_filter(const struct pcap_filter *filter);
+
 /**
  * pcap_clear() - clear pcap capture buffer and statistics
  *
@@ -53,3 +112,5 @@ bool pcap_active(void);
  * Return:	0 on success, -ERROR on error
  */
 int pcap_post(const void *packet, size_t len, bool outgoing);
+
+#endif /* __NET_PCAP_H__ */
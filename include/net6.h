@@ -0,0 +1,338 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * IPv6 support
+ *
+ * IPv6 runs alongside IPv4 in net_loop(). Protocols which can use it, i.e.
+ * TFTP and NFS, do so when net_use_ip6 is set, talking to net_server_ip6.
+ * Our link-local address is made from the MAC address, and a global address
+ * comes from the 'ip6addr' environment variable or from router advertisements.
+ */
+
+#ifndef __NET6_H__
+#define __NET6_H__
+
+#include <net.h>
+#include <linux/string.h>
+
+/**
+ * struct in6_addr - IPv6 address, in network byte order
+ */
+struct in6_addr {
+	union {
+		u8	u6_addr8[16];
+		u16	u6_addr16[8];
+		u32	u6_addr32[4];
+	} in6_u;
+#define s6_addr		in6_u.u6_addr8
+#define s6_addr16	in6_u.u6_addr16
+#define s6_addr32	in6_u.u6_addr32
+} __attribute__((packed));
+
+#define IN6ADDRSZ	sizeof(struct in6_addr)
+
+/* Longest string form of an IPv6 address, with its terminator */
+#define IP6_STR_LEN	40
+
+/*
+ *	IPv6 header
+ */
+struct ip6_hdr {
+	u32		ip6_flow;	/* version, class and flow label */
+	u16		payload_len;	/* length after this header	*/
+	u8		nexthdr;	/* next header type		*/
+	u8		hop_limit;	/* hop limit			*/
+	struct in6_addr	saddr;		/* source address		*/
+	struct in6_addr	daddr;		/* destination address		*/
+} __attribute__((packed));
+
+#define IP6_HDR_SIZE		(sizeof(struct ip6_hdr))
+#define IP6_UDP_HDR_SIZE	(IP6_HDR_SIZE + UDP_HDR_SIZE)
+
+/* Version 6, no traffic class or flow label */
+#define IP6_FLOW		0x60000000
+
+#define IPPROTO_ICMPV6		58	/* ICMP for IPv6		*/
+
+#define IP6_HOP_LIMIT		64	/* hop limit for our packets	*/
+#define IP6_ND_HOP_LIMIT	255	/* hop limit for neighbour discovery */
+
+/*
+ *	UDP header
+ */
+struct udp_hdr {
+	u16		udp_src;	/* UDP source port		*/
+	u16		udp_dst;	/* UDP destination port		*/
+	u16		udp_len;	/* Length of UDP packet		*/
+	u16		udp_xsum;	/* Checksum			*/
+} __attribute__((packed));
+
+/*
+ *	ICMPv6 header
+ */
+struct icmp6_hdr {
+	u8		icmp6_type;
+	u8		icmp6_code;
+	u16		icmp6_cksum;
+	union {
+		u32	data32;
+		struct {
+			u16	id;
+			u16	sequence;
+		} echo;
+		struct {
+			u8	flags;		/* ND_NA_... flags	*/
+			u8	reserved[3];
+		} na;
+		struct {
+			u8	hop_limit;	/* current hop limit	*/
+			u8	flags;		/* managed/other config	*/
+			u16	lifetime;	/* router lifetime in s	*/
+		} ra;
+	} un;
+} __attribute__((packed));
+
+#define ICMP6_HDR_SIZE		(sizeof(struct icmp6_hdr))
+
+#define ICMPV6_ECHO_REQUEST	128
+#define ICMPV6_ECHO_REPLY	129
+#define ICMPV6_ROUTER_SOL	133
+#define ICMPV6_ROUTER_ADV	134
+#define ICMPV6_NEIGHBOUR_SOL	135
+#define ICMPV6_NEIGHBOUR_ADV	136
+
+/* Unspecified address (::) */
+extern const struct in6_addr net_null_addr_ip6;
+
+#ifdef CONFIG_IPV6
+/* Our global address, from 'ip6addr' or a router advertisement */
+extern struct in6_addr net_ip6;
+/* Length of the prefix of our global address */
+extern u32 net_prefix_length;
+/* Our link-local address, made from our MAC address */
+extern struct in6_addr net_link_local_ip6;
+/* Router for addresses off our link, from 'gatewayip6' or an advertisement */
+extern struct in6_addr net_gateway6;
+/* Server address, from 'serverip6' */
+extern struct in6_addr net_server_ip6;
+/* The address to ping */
+extern struct in6_addr net_ping_ip6;
+/* Use IPv6 rather than IPv4 for TFTP and NFS */
+extern bool net_use_ip6;
+
+/**
+ * string_to_ip6() - Convert a string to an IPv6 address
+ *
+ * This accepts the usual forms, with '::' standing for a run of zero groups.
+ *
+ * @str:	String to convert
+ * @len:	Length of the string, which need not be terminated
+ * @addr:	Returns the address
+ * Return: 0 if OK, -EINVAL if the string is not a valid address
+ */
+int string_to_ip6(const char *str, size_t len, struct in6_addr *addr);
+
+/**
+ * ip6_is_our_addr() - Check whether an address is one of ours
+ *
+ * @addr:	Address to check
+ * Return: true if it is our global or link-local address
+ */
+bool ip6_is_our_addr(const struct in6_addr *addr);
+
+/**
+ * ip6_make_eui64_addr() - Make an address from a /64 prefix and a MAC address
+ *
+ * @addr:	Returns the address
+ * @prefix:	Prefix, of which the first 64 bits are used
+ * @enetaddr:	MAC address from which the interface identifier is made
+ */
+void ip6_make_eui64_addr(struct in6_addr *addr, const struct in6_addr *prefix,
+			 const u8 enetaddr[ARP_HLEN]);
+
+/**
+ * ip6_make_lladdr() - Make the link-local address for a MAC address
+ *
+ * @lladdr:	Returns the address
+ * @enetaddr:	MAC address
+ */
+void ip6_make_lladdr(struct in6_addr *lladdr, const u8 enetaddr[ARP_HLEN]);
+
+/**
+ * ip6_make_snma() - Make the solicited-node multicast address of an address
+ *
+ * @mcast:	Returns the multicast address
+ * @ip6:	Address to be solicited
+ */
+void ip6_make_snma(struct in6_addr *mcast, const struct in6_addr *ip6);
+
+/**
+ * ip6_make_mult_ethdstaddr() - Make the MAC address for a multicast address
+ *
+ * @enetaddr:	Returns the MAC address
+ * @mcast:	IPv6 multicast address
+ */
+void ip6_make_mult_ethdstaddr(u8 enetaddr[ARP_HLEN],
+			      const struct in6_addr *mcast);
+
+/**
+ * ip6_addr_in_subnet() - Check whether two addresses share a prefix
+ *
+ * @our_addr:	First address
+ * @neigh_addr:	Second address
+ * @prefix_length: Number of leading bits to compare
+ * Return: true if the first @prefix_length bits are the same
+ */
+bool ip6_addr_in_subnet(const struct in6_addr *our_addr,
+			const struct in6_addr *neigh_addr, u32 prefix_length);
+
+/**
+ * net_ip6_csum() - Work out the checksum of an ICMPv6 or UDP message
+ *
+ * This covers the pseudo-header as well as the message. A message with a
+ * correct checksum in place gives 0.
+ *
+ * @saddr:	Source address
+ * @daddr:	Destination address
+ * @len:	Length of the message
+ * @proto:	IPPROTO_... number of the message
+ * @data:	The message
+ * Return: checksum, in host byte order
+ */
+u16 net_ip6_csum(const struct in6_addr *saddr, const struct in6_addr *daddr,
+		 u16 len, u8 proto, const void *data);
+
+/**
+ * ip6_add_hdr() - Fill in an IPv6 header
+ *
+ * @xip:	Where to put the header
+ * @src:	Source address
+ * @dest:	Destination address
+ * @nextheader:	IPPROTO_... number of what follows
+ * @hop_limit:	Hop limit
+ * @payload_len: Length of what follows
+ * Return: size of the header
+ */
+int ip6_add_hdr(uchar *xip, const struct in6_addr *src,
+		const struct in6_addr *dest, int nextheader, int hop_limit,
+		int payload_len);
+
+/**
+ * net_ip6_src() - Get the source address to use for a destination
+ *
+ * @dest:	Destination address
+ * Return: our link-local address for link-local and multicast destinations,
+ *	or if we have no global address, else our global address
+ */
+const struct in6_addr *net_ip6_src(const struct in6_addr *dest);
+
+/**
+ * net_send_ip6_packet() - Send a packet in net_tx_packet over IPv6
+ *
+ * The ICMPv6 or UDP message must already be in place after the Ethernet and
+ * IPv6 headers. Its checksum is filled in here. If the MAC address of the
+ * next hop is not known, it is found by neighbour discovery first.
+ *
+ * @ether:	MAC address of the next hop, all zeroes if not known, in
+ *		which case it is filled in once found
+ * @dest:	Destination address
+ * @nextheader:	IPPROTO_ICMPV6 or IPPROTO_UDP
+ * @payload_len: Length of the message
+ * Return: 0 if sent, 1 if waiting for neighbour discovery
+ */
+int net_send_ip6_packet(uchar *ether, const struct in6_addr *dest,
+			int nextheader, int payload_len);
+
+/**
+ * net_send_udp_packet6() - Send a UDP packet in net_tx_packet over IPv6
+ *
+ * The payload must already be at net_ip_udp_hdr_size() bytes after the
+ * Ethernet header.
+ *
+ * @ether:	As for net_send_ip6_packet()
+ * @dest:	Destination address
+ * @dport:	Destination port
+ * @sport:	Source port
+ * @len:	Length of the payload
+ * Return: 0 if sent, 1 if waiting for neighbour discovery
+ */
+int net_send_udp_packet6(uchar *ether, const struct in6_addr *dest, int dport,
+			 int sport, int len);
+
+/**
+ * net_ip6_handler() - Process a received IPv6 packet
+ *
+ * @et:		Ethernet header of the packet
+ * @ip6:	IPv6 header of the packet
+ * @len:	Length of the packet from the IPv6 header on
+ * Return: 0 if OK (including packets which are not for us), -EINVAL if the
+ *	packet is malformed or its checksum is wrong
+ */
+int net_ip6_handler(struct ethernet_hdr *et, struct ip6_hdr *ip6, int len);
+
+/**
+ * net_ip6_init() - Set up IPv6 for a run of the network loop
+ *
+ * This makes our link-local address from our MAC address.
+ */
+void net_ip6_init(void);
+
+/**
+ * is_serverip6_in_cmd() - Check whether the boot file name has a server
+ *
+ * Return: true if it starts with an address in brackets, as in
+ *	"[2001:db8::1]:file"
+ */
+bool is_serverip6_in_cmd(void);
+
+/**
+ * net_parse_bootfile6() - Parse the boot file name for use over IPv6
+ *
+ * @ipaddr:	Returns the server address, if the name has one
+ * @filename:	Returns the file name
+ * @max_len:	Size of @filename
+ * Return: 1 if parsed, 0 if there is no boot file name, -EINVAL if the
+ *	server address is not valid
+ */
+int net_parse_bootfile6(struct in6_addr *ipaddr, char *filename, int max_len);
+#else
+#define net_use_ip6	false
+
+static inline void net_ip6_init(void)
+{
+}
+
+static inline int net_send_udp_packet6(uchar *ether,
+				       const struct in6_addr *dest, int dport,
+				       int sport, int len)
+{
+	return -ENOSYS;
+}
+#endif
+
+static inline bool ip6_is_unspecified_addr(const struct in6_addr *addr)
+{
+	return !memcmp(addr, &net_null_addr_ip6, IN6ADDRSZ);
+}
+
+static inline bool ip6_is_multicast(const struct in6_addr *addr)
+{
+	return addr->s6_addr[0] == 0xff;
+}
+
+/* Check for a link-local unicast address, in fe80::/10 */
+static inline bool ip6_is_link_local(const struct in6_addr *addr)
+{
+	return addr->s6_addr[0] == 0xfe && (addr->s6_addr[1] & 0xc0) == 0x80;
+}
+
+/**
+ * net_ip_udp_hdr_size() - Get the size of the IP and UDP headers we send
+ *
+ * Return: size for IPv6 if net_use_ip6 is set, else for IPv4
+ */
+static inline int net_ip_udp_hdr_size(void)
+{
+	return net_use_ip6 ? IP6_UDP_HDR_SIZE : IP_UDP_HDR_SIZE;
+}
+
+#endif /* __NET6_H__ */
@@ -123,6 +123,7 @@
 #define  SDHCI_INT_CARD_INSERT	BIT(6)
 #define  SDHCI_INT_CARD_REMOVE	BIT(7)
 #define  SDHCI_INT_CARD_INT	BIT(8)
+#define  SDHCI_INT_CQE		BIT(14)
 #define  SDHCI_INT_ERROR	BIT(15)
 #define  SDHCI_INT_TIMEOUT	BIT(16)
 #define  SDHCI_INT_CRC		BIT(17)
@@ -292,8 +293,8 @@ struct sdhci_ops {
 #else
 #define ADMA_DESC_LEN	8
 #endif
-#define ADMA_TABLE_NO_ENTRIES (CONFIG_SYS_MMC_MAX_BLK_COUNT * \
-			       MMC_MAX_BLOCK_LEN) / ADMA_MAX_LEN
+#define ADMA_TABLE_NO_ENTRIES DIV_ROUND_UP(CONFIG_SYS_MMC_MAX_BLK_COUNT * \
+					   MMC_MAX_BLOCK_LEN, ADMA_MAX_LEN)
 
 #define ADMA_TABLE_SZ (ADMA_TABLE_NO_ENTRIES * ADMA_DESC_LEN)
 
@@ -307,6 +308,63 @@ struct sdhci_ops {
 #define ADMA_DESC_TRANSFER_DATA		ADMA_DESC_ATTR_ACT2
 #define ADMA_DESC_LINK_DESC	(ADMA_DESC_ATTR_ACT1 | ADMA_DESC_ATTR_ACT2)
 
+/*
+ * Command Queueing Host Controller Interface (CQHCI) registers, relative to
+ * sdhci_host->cqe_base
+ */
+#define CQHCI_VER		0x00
+#define CQHCI_CAP		0x04
+#define CQHCI_CFG		0x08
+#define  CQHCI_ENABLE		BIT(0)
+#define  CQHCI_TASK_DESC_SZ	BIT(8)
+#define  CQHCI_DCMD		BIT(12)
+#define CQHCI_CTL		0x0C
+#define  CQHCI_HALT		BIT(0)
+#define  CQHCI_CLEAR_ALL_TASKS	BIT(8)
+#define CQHCI_IS		0x10
+#define CQHCI_ISTE		0x14
+#define CQHCI_ISGE		0x18
+#define CQHCI_IC		0x1C
+#define  CQHCI_IS_HAC		BIT(0)
+#define  CQHCI_IS_TCC		BIT(1)
+#define  CQHCI_IS_RED		BIT(2)
+#define  CQHCI_IS_TCL		BIT(3)
+#define  CQHCI_IS_MASK		(CQHCI_IS_HAC | CQHCI_IS_TCC | \
+				 CQHCI_IS_RED | CQHCI_IS_TCL)
+#define CQHCI_TDLBA		0x20
+#define CQHCI_TDLBAU		0x24
+#define CQHCI_TDBR		0x28
+#define CQHCI_TCN		0x2C
+#define CQHCI_DQS		0x30
+#define CQHCI_DPT		0x34
+#define CQHCI_TCLR		0x38
+#define CQHCI_SSC1		0x40
+#define CQHCI_SSC2		0x44
+#define CQHCI_CRDCT		0x48
+#define CQHCI_RMEM		0x50
+#define CQHCI_TERRI		0x54
+#define CQHCI_CRI		0x58
+#define CQHCI_CRA		0x5C
+
+#define CQHCI_NUM_SLOTS		32
+
+/*
+ * CQHCI task descriptor. It takes 128 bits, the upper half unused, when the
+ * transfer descriptors use 64-bit addresses.
+ */
+#define CQHCI_TASK_VALID		BIT_ULL(0)
+#define CQHCI_TASK_END			BIT_ULL(1)
+#define CQHCI_TASK_INT			BIT_ULL(2)
+#define CQHCI_TASK_ACT_TASK		(0x5ULL << 3)
+#define CQHCI_TASK_DATA_DIR_READ	BIT_ULL(12)
+#define CQHCI_TASK_BLK_COUNT(x)		((u64)((x) & 0xffff) << 16)
+#define CQHCI_TASK_BLK_ADDR(x)		((u64)((x) & 0xffffffff) << 32)
+#ifdef CONFIG_DMA_ADDR_T_64BIT
+#define CQHCI_TASK_DESC_LEN		16
+#else
+#define CQHCI_TASK_DESC_LEN		8
+#endif
+
 struct sdhci_adma_desc {
 	u8 attr;
 	u8 reserved;
@@ -348,6 +406,13 @@ struct sdhci_host {
 	dma_addr_t adma_addr;
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	struct sdhci_adma_desc *adma_desc_table;
+	dma_addr_t adma_prep_addr;	/* transfer described by the table */
+	uint adma_prep_bytes;
+#endif
+#if CONFIG_IS_ENABLED(MMC_SDHCI_CQE)
+	void *cqe_base;		/* CQHCI registers, set by the driver */
+	void *cqe_tdl;		/* task descriptor list */
+	void *cqe_tran;		/* transfer descriptors, one table per slot */
 #endif
 };
 
@@ -520,6 +585,9 @@ extern const struct dm_mmc_ops sdhci_ops;
 #endif
 
 struct sdhci_adma_desc *sdhci_adma_init(void);
+void *sdhci_adma_alloc(uint max_bytes, uint desc_len);
+uint sdhci_adma_fill(void *table, uint desc_len, dma_addr_t addr, uint bytes,
+		     bool end);
 void sdhci_prepare_adma_table(struct sdhci_adma_desc *table,
 			      struct mmc_data *data, dma_addr_t addr);
 
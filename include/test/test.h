@@ -13,6 +13,8 @@
  * struct unit_test_state - Entire state of test system
  *
  * @fail_count: Number of tests that failed
+ * @leak_count: Number of allocations left behind by tests (MALLOC_PROFILE)
+ * @malloc_seq: Allocation sequence number when the current test started
  * @start: Store the starting mallinfo when doing leak test
  * @of_live: true to use livetree if available, false to use flattree
  * @of_root: Record of the livetree root node (used for setting up tests)
@@ -25,6 +27,8 @@
  */
 struct unit_test_state {
 	int fail_count;
+	int leak_count;
+	ulong malloc_seq;
 	struct mallinfo start;
 	struct device_node *of_root;
 	bool of_live;
@@ -180,8 +180,37 @@ int usb_reset_root_port(struct usb_device *dev);
 #define usb_reset_root_port(dev)
 #endif
 
+/**
+ * struct usb_bulk_req - one transfer in a group submitted with usb_bulk_msgs()
+ *
+ * @pipe: Bulk pipe to use
+ * @buffer: Data buffer
+ * @length: Number of bytes to transfer
+ * @act_len: Returns the number of bytes actually transferred
+ * @status: Returns the status of the transfer (USB_ST_...), or
+ *	USB_ST_NOT_PROC if it was not completed
+ */
+struct usb_bulk_req {
+	unsigned long pipe;
+	void *buffer;
+	int length;
+	int act_len;
+	unsigned long status;
+};
+
 int submit_bulk_msg(struct usb_device *dev, unsigned long pipe,
 			void *buffer, int transfer_len);
+#if CONFIG_IS_ENABLED(DM_USB)
+int submit_bulk_msgs(struct usb_device *dev, struct usb_bulk_req *reqs,
+		     int count);
+/* Check if the controller keeps several bulk messages in flight at once */
+bool usb_bulk_msgs_queued(struct usb_device *dev);
+#else
+static inline bool usb_bulk_msgs_queued(struct usb_device *dev)
+{
+	return false;
+}
+#endif
 int submit_control_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 			int transfer_len, struct devrequest *setup);
 int submit_int_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
@@ -268,6 +297,8 @@ int usb_control_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, unsigned short size, int timeout);
 int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, int len, int *actual_length, int timeout);
+int usb_bulk_msgs(struct usb_device *dev, struct usb_bulk_req *reqs,
+		  int count);
 int usb_int_msg(struct usb_device *dev, unsigned long pipe,
 		void *buffer, int transfer_len, int interval, bool nonblock);
 int usb_lock_async(struct usb_device *dev, int lock);
@@ -707,6 +738,20 @@ struct dm_usb_ops {
 	 */
 	int (*bulk)(struct udevice *bus, struct usb_device *udev,
 		    unsigned long pipe, void *buffer, int length);
+	/**
+	 * bulk_multi() - Send several bulk messages at once (optional)
+	 *
+	 * The transfers are started in order but may be in flight at the
+	 * same time, so the controller can move from one to the next without
+	 * waiting for software. If a transfer fails, the following ones are
+	 * not completed.
+	 *
+	 * @reqs: Transfers to perform, updated with the result of each
+	 * @count: Number of transfers
+	 * @return 0 if all transfers completed successfully, -ve on error
+	 */
+	int (*bulk_multi)(struct udevice *bus, struct usb_device *udev,
+			  struct usb_bulk_req *reqs, int count);
 	/**
 	 * interrupt() - Send an interrupt message
 	 *
@@ -984,6 +984,8 @@ typedef enum {
 #define TRBS_PER_SEGMENT	64
 /* Allow two commands + a link TRB, along with any reserved command TRBs */
 #define MAX_RSVD_CMD_TRBS	(TRBS_PER_SEGMENT - 3)
+/* Maximum number of bulk TDs which xhci_bulk_tx_multi() keeps in flight */
+#define XHCI_MAX_BULK_TDS	16
 #define SEGMENT_SIZE		(TRBS_PER_SEGMENT*16)
 /* SEGMENT_SHIFT should be log2(SEGMENT_SIZE).
  * Change this if you change TRBS_PER_SEGMENT!
@@ -1249,6 +1251,8 @@ void xhci_acknowledge_event(struct xhci_ctrl *ctrl);
 union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected);
 int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		 int length, void *buffer);
+int xhci_bulk_tx_multi(struct usb_device *udev, struct usb_bulk_req *reqs,
+		       int count);
 int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
 		 struct devrequest *req, int length, void *buffer);
 int xhci_check_maxpacket(struct usb_device *udev);
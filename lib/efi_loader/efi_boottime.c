@@ -803,6 +803,7 @@ static efi_status_t EFIAPI efi_create_event_ext(
  *
  * Our timers have to work without interrupts, so we check whenever keyboard
  * input or disk accesses happen if enough time elapsed for them to fire.
+ * Queued asynchronous block I/O requests are executed here, too.
  */
 void efi_timer_check(void)
 {
@@ -827,6 +828,8 @@ void efi_timer_check(void)
 		evt->is_signaled = false;
 		efi_signal_event(evt);
 	}
+	if (IS_ENABLED(CONFIG_PARTITIONS))
+		efi_disk_process_requests();
 	efi_process_event_queue();
 	WATCHDOG_RESET();
 }
@@ -2166,6 +2169,9 @@ static efi_status_t EFIAPI efi_exit_boot_services(efi_handle_t image_handle,
 			list_del(&evt->link);
 	}
 
+	/* The payload takes over the block devices */
+	efi_disk_free_caches();
+
 	if (!efi_st_keep_devices) {
 		bootm_disable_interrupts();
 		if (IS_ENABLED(CONFIG_USB_DEVICE))
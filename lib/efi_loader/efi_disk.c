@@ -15,10 +15,12 @@
 #include <log.h>
 #include <part.h>
 #include <malloc.h>
+#include <asm/cache.h>
 
 struct efi_system_partition efi_system_partition;
 
 const efi_guid_t efi_block_io_guid = EFI_BLOCK_IO_PROTOCOL_GUID;
+const efi_guid_t efi_block_io2_guid = EFI_BLOCK_IO2_PROTOCOL_GUID;
 const efi_guid_t efi_system_partition_guid = PARTITION_SYSTEM_GUID;
 
 /**
@@ -26,6 +28,7 @@ const efi_guid_t efi_system_partition_guid = PARTITION_SYSTEM_GUID;
  *
  * @header:	EFI object header
  * @ops:	EFI disk I/O protocol interface
+ * @ops2:	EFI disk I/O 2 protocol interface
  * @ifname:	interface name for block device
  * @dev_index:	device index of block device
  * @media:	block I/O media information
@@ -38,6 +41,7 @@ const efi_guid_t efi_system_partition_guid = PARTITION_SYSTEM_GUID;
 struct efi_disk_obj {
 	struct efi_object header;
 	struct efi_block_io ops;
+	struct efi_block_io2 ops2;
 	const char *ifname;
 	int dev_index;
 	struct efi_block_io_media media;
@@ -48,6 +52,61 @@ struct efi_disk_obj {
 	struct blk_desc *desc;
 };
 
+enum efi_disk_direction {
+	EFI_DISK_READ,
+	EFI_DISK_WRITE,
+	EFI_DISK_FLUSH,
+};
+
+/**
+ * struct efi_disk_cache - read-ahead buffer of a block device
+ *
+ * The buffer is shared by the disk and its partitions as they use the same
+ * block device descriptor.
+ *
+ * @link:	link in the list of read-ahead buffers
+ * @desc:	block device descriptor
+ * @buf:	buffer holding the blocks read ahead
+ * @start:	first block held in the buffer
+ * @count:	number of valid blocks in the buffer, 0 if empty
+ * @next:	block following the last read, used to detect sequential reads
+ */
+struct efi_disk_cache {
+	struct list_head link;
+	struct blk_desc *desc;
+	void *buf;
+	lbaint_t start;
+	lbaint_t count;
+	lbaint_t next;
+};
+
+/* List of the read-ahead buffers of all block devices */
+static LIST_HEAD(efi_disk_caches);
+
+/**
+ * struct efi_disk_request - pending asynchronous block I/O 2 request
+ *
+ * @link:		link in the list of pending requests
+ * @diskobj:		disk object
+ * @token:		token to signal on completion
+ * @direction:		read, write, or flush
+ * @lba:		starting logical block
+ * @buffer_size:	size of the buffer in bytes
+ * @buffer:		data buffer
+ */
+struct efi_disk_request {
+	struct list_head link;
+	struct efi_disk_obj *diskobj;
+	struct efi_block_io2_token *token;
+	enum efi_disk_direction direction;
+	u64 lba;
+	efi_uintn_t buffer_size;
+	void *buffer;
+};
+
+/* List of pending asynchronous requests in submission order */
+static LIST_HEAD(efi_disk_requests);
+
 /**
  * efi_disk_reset() - reset block device
  *
@@ -70,22 +129,141 @@ static efi_status_t EFIAPI efi_disk_reset(struct efi_block_io *this,
 	return EFI_EXIT(EFI_SUCCESS);
 }
 
-enum efi_disk_direction {
-	EFI_DISK_READ,
-	EFI_DISK_WRITE,
-};
+/**
+ * efi_disk_get_cache() - get the read-ahead buffer of a block device
+ *
+ * The buffer is allocated on first use.
+ *
+ * @desc:	block device descriptor
+ * Return:	read-ahead buffer or NULL if read-ahead is not available
+ */
+static struct efi_disk_cache *efi_disk_get_cache(struct blk_desc *desc)
+{
+	struct efi_disk_cache *cache;
+
+	if (!CONFIG_EFI_DISK_READ_AHEAD_SIZE ||
+	    desc->blksz > CONFIG_EFI_DISK_READ_AHEAD_SIZE / 2)
+		return NULL;
+
+	list_for_each_entry(cache, &efi_disk_caches, link) {
+		if (cache->desc == desc)
+			return cache;
+	}
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->buf = memalign(ARCH_DMA_MINALIGN,
+			      CONFIG_EFI_DISK_READ_AHEAD_SIZE);
+	if (!cache->buf) {
+		free(cache);
+		return NULL;
+	}
+	cache->desc = desc;
+	list_add(&cache->link, &efi_disk_caches);
+
+	return cache;
+}
+
+/**
+ * efi_disk_invalidate_cache() - discard blocks read ahead
+ *
+ * The block layer calls this function whenever a block device is written to
+ * or erased, whether through the EFI_BLOCK_IO_PROTOCOL or not.
+ *
+ * @desc:	block device descriptor
+ */
+void efi_disk_invalidate_cache(struct blk_desc *desc)
+{
+	struct efi_disk_cache *cache;
+
+	list_for_each_entry(cache, &efi_disk_caches, link) {
+		if (cache->desc == desc) {
+			cache->count = 0;
+			cache->next = 0;
+		}
+	}
+}
+
+/**
+ * efi_disk_free_caches() - free all read-ahead buffers
+ *
+ * This function is called when ExitBootServices() is invoked and when the
+ * EFI payload returns. The block devices may be removed or written by other
+ * means afterwards.
+ */
+void efi_disk_free_caches(void)
+{
+	struct efi_disk_cache *cache, *next;
+
+	list_for_each_entry_safe(cache, next, &efi_disk_caches, link) {
+		list_del(&cache->link);
+		free(cache->buf);
+		free(cache);
+	}
+}
+
+/**
+ * efi_disk_read_ahead() - read blocks using the read-ahead buffer
+ *
+ * Small reads continuing where the previous read ended are served from the
+ * read-ahead buffer which is refilled with CONFIG_EFI_DISK_READ_AHEAD_SIZE
+ * bytes on a miss. All other reads go directly to the block device.
+ *
+ * @desc:	block device descriptor
+ * @lba:	starting block
+ * @blocks:	number of blocks to read
+ * @buffer:	destination buffer
+ * Return:	number of blocks read
+ */
+static ulong efi_disk_read_ahead(struct blk_desc *desc, lbaint_t lba,
+				 lbaint_t blocks, void *buffer)
+{
+	struct efi_disk_cache *cache = efi_disk_get_cache(desc);
+	lbaint_t ra_blocks = CONFIG_EFI_DISK_READ_AHEAD_SIZE / desc->blksz;
+	bool sequential;
+	ulong n;
+
+	if (!cache || blocks > ra_blocks / 2)
+		goto direct;
+
+	sequential = lba == cache->next;
+	cache->next = lba + blocks;
+
+	if (lba < cache->start ||
+	    lba + blocks > cache->start + cache->count) {
+		if (!sequential)
+			goto direct;
+
+		cache->count = 0;
+		n = min(ra_blocks, desc->lba - lba);
+		if (n < blocks || blk_dread(desc, lba, n, cache->buf) != n)
+			goto direct;
+		cache->start = lba;
+		cache->count = n;
+	}
+
+	memcpy(buffer, cache->buf + (lba - cache->start) * desc->blksz,
+	       blocks * desc->blksz);
 
-static efi_status_t efi_disk_rw_blocks(struct efi_block_io *this,
-			u32 media_id, u64 lba, unsigned long buffer_size,
+	return blocks;
+direct:
+	n = blk_dread(desc, lba, blocks, buffer);
+	if (cache)
+		cache->next = lba + n;
+
+	return n;
+}
+
+static efi_status_t efi_disk_rw_blocks(struct efi_disk_obj *diskobj,
+			u64 lba, unsigned long buffer_size,
 			void *buffer, enum efi_disk_direction direction)
 {
-	struct efi_disk_obj *diskobj;
 	struct blk_desc *desc;
 	int blksz;
 	int blocks;
 	unsigned long n;
 
-	diskobj = container_of(this, struct efi_disk_obj, ops);
 	desc = (struct blk_desc *) diskobj->desc;
 	blksz = desc->blksz;
 	blocks = buffer_size / blksz;
@@ -99,7 +277,7 @@ static efi_status_t efi_disk_rw_blocks(struct efi_block_io *this,
 		return EFI_BAD_BUFFER_SIZE;
 
 	if (direction == EFI_DISK_READ)
-		n = blk_dread(desc, lba, blocks, buffer);
+		n = efi_disk_read_ahead(desc, lba, blocks, buffer);
 	else
 		n = blk_dwrite(desc, lba, blocks, buffer);
 
@@ -114,6 +292,89 @@ static efi_status_t efi_disk_rw_blocks(struct efi_block_io *this,
 	return EFI_SUCCESS;
 }
 
+/**
+ * efi_disk_check_io() - check the parameters of a block I/O request
+ *
+ * @media:		media information
+ * @media_id:		id of the medium
+ * @lba:		starting logical block
+ * @buffer_size:	size of the buffer
+ * @buffer:		data buffer
+ * @direction:		read or write
+ * Return:		status code
+ */
+static efi_status_t efi_disk_check_io(struct efi_block_io_media *media,
+				      u32 media_id, u64 lba,
+				      efi_uintn_t buffer_size, void *buffer,
+				      enum efi_disk_direction direction)
+{
+	if (direction == EFI_DISK_WRITE && media->read_only)
+		return EFI_WRITE_PROTECTED;
+	/* TODO: check for media changes */
+	if (media_id != media->media_id)
+		return EFI_MEDIA_CHANGED;
+	if (!media->media_present)
+		return EFI_NO_MEDIA;
+	/* media->io_align is a power of 2 or 0 */
+	if (media->io_align &&
+	    (uintptr_t)buffer & (media->io_align - 1))
+		return EFI_INVALID_PARAMETER;
+	if (lba * media->block_size + buffer_size >
+	    (media->last_block + 1) * media->block_size)
+		return EFI_INVALID_PARAMETER;
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_disk_transfer() - read or write blocks
+ *
+ * The parameters must have been checked with efi_disk_check_io(). If
+ * CONFIG_EFI_LOADER_BOUNCE_BUFFER is enabled, data is transferred through the
+ * bounce buffer.
+ *
+ * @diskobj:		disk object
+ * @lba:		starting logical block
+ * @buffer_size:	size of the buffer
+ * @buffer:		data buffer
+ * @direction:		read or write
+ * Return:		status code
+ */
+static efi_status_t efi_disk_transfer(struct efi_disk_obj *diskobj, u64 lba,
+				      efi_uintn_t buffer_size, void *buffer,
+				      enum efi_disk_direction direction)
+{
+#ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
+	while (buffer_size) {
+		efi_uintn_t size = min_t(efi_uintn_t, buffer_size,
+					 EFI_LOADER_BOUNCE_BUFFER_SIZE);
+		efi_status_t r;
+
+		/* Populate bounce buffer if necessary */
+		if (direction == EFI_DISK_WRITE)
+			memcpy(efi_bounce_buffer, buffer, size);
+
+		r = efi_disk_rw_blocks(diskobj, lba, size, efi_bounce_buffer,
+				       direction);
+		if (r != EFI_SUCCESS)
+			return r;
+
+		/* Copy from bounce buffer to real buffer if necessary */
+		if (direction == EFI_DISK_READ)
+			memcpy(buffer, efi_bounce_buffer, size);
+
+		lba += size / diskobj->media.block_size;
+		buffer += size;
+		buffer_size -= size;
+	}
+
+	return EFI_SUCCESS;
+#else
+	return efi_disk_rw_blocks(diskobj, lba, buffer_size, buffer,
+				  direction);
+#endif
+}
+
 /**
  * efi_disk_read_blocks() - reads blocks from device
  *
@@ -133,48 +394,20 @@ static efi_status_t EFIAPI efi_disk_read_blocks(struct efi_block_io *this,
 			u32 media_id, u64 lba, efi_uintn_t buffer_size,
 			void *buffer)
 {
-	void *real_buffer = buffer;
 	efi_status_t r;
 
 	if (!this)
 		return EFI_INVALID_PARAMETER;
-	/* TODO: check for media changes */
-	if (media_id != this->media->media_id)
-		return EFI_MEDIA_CHANGED;
-	if (!this->media->media_present)
-		return EFI_NO_MEDIA;
-	/* media->io_align is a power of 2 or 0 */
-	if (this->media->io_align &&
-	    (uintptr_t)buffer & (this->media->io_align - 1))
-		return EFI_INVALID_PARAMETER;
-	if (lba * this->media->block_size + buffer_size >
-	    (this->media->last_block + 1) * this->media->block_size)
-		return EFI_INVALID_PARAMETER;
-
-#ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
-	if (buffer_size > EFI_LOADER_BOUNCE_BUFFER_SIZE) {
-		r = efi_disk_read_blocks(this, media_id, lba,
-			EFI_LOADER_BOUNCE_BUFFER_SIZE, buffer);
-		if (r != EFI_SUCCESS)
-			return r;
-		return efi_disk_read_blocks(this, media_id, lba +
-			EFI_LOADER_BOUNCE_BUFFER_SIZE / this->media->block_size,
-			buffer_size - EFI_LOADER_BOUNCE_BUFFER_SIZE,
-			buffer + EFI_LOADER_BOUNCE_BUFFER_SIZE);
-	}
-
-	real_buffer = efi_bounce_buffer;
-#endif
+	r = efi_disk_check_io(this->media, media_id, lba, buffer_size, buffer,
+			      EFI_DISK_READ);
+	if (r != EFI_SUCCESS)
+		return r;
 
 	EFI_ENTRY("%p, %x, %llx, %zx, %p", this, media_id, lba,
 		  buffer_size, buffer);
 
-	r = efi_disk_rw_blocks(this, media_id, lba, buffer_size, real_buffer,
-			       EFI_DISK_READ);
-
-	/* Copy from bounce buffer to real buffer if necessary */
-	if ((r == EFI_SUCCESS) && (real_buffer != buffer))
-		memcpy(buffer, real_buffer, buffer_size);
+	r = efi_disk_transfer(container_of(this, struct efi_disk_obj, ops),
+			      lba, buffer_size, buffer, EFI_DISK_READ);
 
 	return EFI_EXIT(r);
 }
@@ -199,50 +432,20 @@ static efi_status_t EFIAPI efi_disk_write_blocks(struct efi_block_io *this,
 			u32 media_id, u64 lba, efi_uintn_t buffer_size,
 			void *buffer)
 {
-	void *real_buffer = buffer;
 	efi_status_t r;
 
 	if (!this)
 		return EFI_INVALID_PARAMETER;
-	if (this->media->read_only)
-		return EFI_WRITE_PROTECTED;
-	/* TODO: check for media changes */
-	if (media_id != this->media->media_id)
-		return EFI_MEDIA_CHANGED;
-	if (!this->media->media_present)
-		return EFI_NO_MEDIA;
-	/* media->io_align is a power of 2 or 0 */
-	if (this->media->io_align &&
-	    (uintptr_t)buffer & (this->media->io_align - 1))
-		return EFI_INVALID_PARAMETER;
-	if (lba * this->media->block_size + buffer_size >
-	    (this->media->last_block + 1) * this->media->block_size)
-		return EFI_INVALID_PARAMETER;
-
-#ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
-	if (buffer_size > EFI_LOADER_BOUNCE_BUFFER_SIZE) {
-		r = efi_disk_write_blocks(this, media_id, lba,
-			EFI_LOADER_BOUNCE_BUFFER_SIZE, buffer);
-		if (r != EFI_SUCCESS)
-			return r;
-		return efi_disk_write_blocks(this, media_id, lba +
-			EFI_LOADER_BOUNCE_BUFFER_SIZE / this->media->block_size,
-			buffer_size - EFI_LOADER_BOUNCE_BUFFER_SIZE,
-			buffer + EFI_LOADER_BOUNCE_BUFFER_SIZE);
-	}
-
-	real_buffer = efi_bounce_buffer;
-#endif
+	r = efi_disk_check_io(this->media, media_id, lba, buffer_size, buffer,
+			      EFI_DISK_WRITE);
+	if (r != EFI_SUCCESS)
+		return r;
 
 	EFI_ENTRY("%p, %x, %llx, %zx, %p", this, media_id, lba,
 		  buffer_size, buffer);
 
-	/* Populate bounce buffer if necessary */
-	if (real_buffer != buffer)
-		memcpy(real_buffer, buffer, buffer_size);
-
-	r = efi_disk_rw_blocks(this, media_id, lba, buffer_size, real_buffer,
-			       EFI_DISK_WRITE);
+	r = efi_disk_transfer(container_of(this, struct efi_disk_obj, ops),
+			      lba, buffer_size, buffer, EFI_DISK_WRITE);
 
 	return EFI_EXIT(r);
 }
@@ -274,6 +477,412 @@ static const struct efi_block_io block_io_disk_template = {
 	.flush_blocks = &efi_disk_flush_blocks,
 };
 
+/**
+ * efi_disk_complete() - complete an asynchronous request
+ *
+ * @req:	request
+ * @status:	transaction status
+ */
+static void efi_disk_complete(struct efi_disk_request *req,
+			      efi_status_t status)
+{
+	list_del(&req->link);
+	req->token->transaction_status = status;
+	efi_signal_event(req->token->event);
+	free(req);
+}
+
+#ifndef CONFIG_EFI_LOADER_BOUNCE_BUFFER
+/* Maximum number of requests handed to the block device at once */
+#define EFI_DISK_BATCH_MAX	32
+
+/**
+ * efi_disk_batch_overlaps() - check if a transfer conflicts with a batch
+ *
+ * The transfers of a batch may be carried out in any order, so a transfer
+ * touching the same blocks or memory as an earlier one has to wait.
+ *
+ * @reqs:	batch
+ * @count:	number of entries in @reqs
+ * @new:	candidate transfer
+ * @blksz:	block size
+ * Return:	true if @new overlaps an entry of @reqs
+ */
+static bool efi_disk_batch_overlaps(struct blk_req *reqs, int count,
+				    struct blk_req *new, ulong blksz)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (new->start < reqs[i].start + reqs[i].blkcnt &&
+		    reqs[i].start < new->start + new->blkcnt)
+			return true;
+		if (new->buffer < reqs[i].buffer + reqs[i].blkcnt * blksz &&
+		    reqs[i].buffer < new->buffer + new->blkcnt * blksz)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * efi_disk_batch() - execute several pending requests together
+ *
+ * Directly following requests for the same disk and direction are passed to
+ * blk_drw_multi() as one batch which a device supporting command queueing
+ * carries out with several transfers in flight. Other devices are left to
+ * efi_disk_transfer() and its read-ahead.
+ *
+ * @first:	first pending request
+ * @status:	on return, status of the batch
+ * Return:	last request served, NULL if nothing was batched
+ */
+static struct efi_disk_request *efi_disk_batch(struct efi_disk_request *first,
+					       efi_status_t *status)
+{
+	struct efi_disk_obj *diskobj = first->diskobj;
+	struct blk_desc *desc = diskobj->desc;
+	struct blk_req reqs[EFI_DISK_BATCH_MAX];
+	struct efi_disk_request *req = first, *last = NULL;
+	int count = 0;
+
+	if (first->direction == EFI_DISK_FLUSH ||
+	    !blk_get_ops(desc->bdev)->rw_multi)
+		return NULL;
+
+	list_for_each_entry_from(req, &efi_disk_requests, link) {
+		struct blk_req *new = &reqs[count];
+
+		if (count == EFI_DISK_BATCH_MAX || req->diskobj != diskobj ||
+		    req->direction != first->direction ||
+		    !req->buffer_size || req->buffer_size % desc->blksz)
+			break;
+		new->start = req->lba + diskobj->offset;
+		new->blkcnt = req->buffer_size / desc->blksz;
+		new->buffer = req->buffer;
+		new->write = req->direction == EFI_DISK_WRITE;
+		if (efi_disk_batch_overlaps(reqs, count, new, desc->blksz))
+			break;
+		count++;
+		last = req;
+	}
+	if (count < 2)
+		return NULL;
+
+	if (blk_drw_multi(desc, reqs, count))
+		*status = EFI_DEVICE_ERROR;
+	else
+		*status = EFI_SUCCESS;
+
+	return last;
+}
+#else
+static struct efi_disk_request *efi_disk_batch(struct efi_disk_request *first,
+					       efi_status_t *status)
+{
+	return NULL;
+}
+#endif
+
+/**
+ * efi_disk_process_requests() - execute pending asynchronous requests
+ *
+ * U-Boot's block devices are synchronous. Requests submitted via the
+ * EFI_BLOCK_IO2_PROTOCOL are queued and executed here, in submission order,
+ * when the event loop runs. Reads of consecutive blocks into a contiguous
+ * buffer are combined into a single block device transfer. Devices that can
+ * queue several transfers get the pending requests in batches.
+ *
+ * This function is called by efi_timer_check().
+ */
+void efi_disk_process_requests(void)
+{
+	static bool busy;
+
+	/* efi_disk_rw_blocks() calls efi_timer_check() */
+	if (busy)
+		return;
+	busy = true;
+
+	while (!list_empty(&efi_disk_requests)) {
+		struct efi_disk_request *req, *last, *next;
+		LIST_HEAD(done);
+		efi_uintn_t size;
+		efi_status_t r = EFI_SUCCESS;
+
+		req = list_first_entry(&efi_disk_requests,
+				       struct efi_disk_request, link);
+		size = req->buffer_size;
+		last = req;
+
+		next = efi_disk_batch(req, &r);
+		if (next) {
+			last = next;
+			goto complete;
+		}
+
+		if (req->direction == EFI_DISK_READ) {
+			/* Combine with directly following reads */
+			while (!list_is_last(&last->link, &efi_disk_requests)) {
+				next = list_entry(last->link.next,
+						  struct efi_disk_request, link);
+				if (next->diskobj != req->diskobj ||
+				    next->direction != EFI_DISK_READ ||
+				    next->lba != req->lba + size /
+				    req->diskobj->media.block_size ||
+				    next->buffer != req->buffer + size)
+					break;
+				size += next->buffer_size;
+				last = next;
+			}
+		}
+
+		if (req->direction != EFI_DISK_FLUSH)
+			r = efi_disk_transfer(req->diskobj, req->lba, size,
+					      req->buffer, req->direction);
+complete:
+		/*
+		 * Complete all requests served by the transfer. They are moved
+		 * to a local list first as notification functions may queue
+		 * or abort requests.
+		 */
+		list_cut_position(&done, &efi_disk_requests, &last->link);
+		list_for_each_entry_safe(req, next, &done, link)
+			efi_disk_complete(req, r);
+	}
+
+	busy = false;
+}
+
+/**
+ * efi_disk_queue() - queue an asynchronous request
+ *
+ * @diskobj:		disk object
+ * @token:		token to signal on completion
+ * @direction:		read, write, or flush
+ * @lba:		starting logical block
+ * @buffer_size:	size of the buffer
+ * @buffer:		data buffer
+ * Return:		status code
+ */
+static efi_status_t efi_disk_queue(struct efi_disk_obj *diskobj,
+				   struct efi_block_io2_token *token,
+				   enum efi_disk_direction direction, u64 lba,
+				   efi_uintn_t buffer_size, void *buffer)
+{
+	struct efi_disk_request *req;
+
+	req = calloc(1, sizeof(*req));
+	if (!req)
+		return EFI_OUT_OF_RESOURCES;
+	req->diskobj = diskobj;
+	req->token = token;
+	req->direction = direction;
+	req->lba = lba;
+	req->buffer_size = buffer_size;
+	req->buffer = buffer;
+	list_add_tail(&req->link, &efi_disk_requests);
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_disk_reset_ex() - reset block device
+ *
+ * This function implements the ResetEx service of the
+ * EFI_BLOCK_IO2_PROTOCOL. Pending requests of the device are aborted.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:			pointer to the BLOCK_IO2_PROTOCOL
+ * @extended_verification:	extended verification
+ * Return:			status code
+ */
+static efi_status_t EFIAPI efi_disk_reset_ex(struct efi_block_io2 *this,
+					     bool extended_verification)
+{
+	struct efi_disk_obj *diskobj;
+	struct efi_disk_request *req, *tmp;
+
+	EFI_ENTRY("%p, %x", this, extended_verification);
+
+	if (!this)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
+
+	diskobj = container_of(this, struct efi_disk_obj, ops2);
+	list_for_each_entry_safe(req, tmp, &efi_disk_requests, link) {
+		if (req->diskobj == diskobj)
+			efi_disk_complete(req, EFI_ABORTED);
+	}
+
+	return EFI_EXIT(EFI_SUCCESS);
+}
+
+/**
+ * efi_disk_rw_blocks_ex() - read or write blocks, possibly asynchronously
+ *
+ * If the token or its event is NULL the transfer is executed immediately.
+ * Otherwise it is queued and the token's event is signaled on completion.
+ *
+ * @this:		pointer to the BLOCK_IO2_PROTOCOL
+ * @media_id:		id of the medium
+ * @lba:		starting logical block
+ * @token:		token to signal on completion
+ * @buffer_size:	size of the buffer
+ * @buffer:		data buffer
+ * @direction:		read or write
+ * Return:		status code
+ */
+static efi_status_t efi_disk_rw_blocks_ex(struct efi_block_io2 *this,
+					  u32 media_id, u64 lba,
+					  struct efi_block_io2_token *token,
+					  efi_uintn_t buffer_size,
+					  void *buffer,
+					  enum efi_disk_direction direction)
+{
+	struct efi_disk_obj *diskobj;
+	efi_status_t r;
+
+	if (!this || !buffer)
+		return EFI_INVALID_PARAMETER;
+	r = efi_disk_check_io(this->media, media_id, lba, buffer_size, buffer,
+			      direction);
+	if (r != EFI_SUCCESS)
+		return r;
+	if (buffer_size & (this->media->block_size - 1))
+		return EFI_BAD_BUFFER_SIZE;
+
+	diskobj = container_of(this, struct efi_disk_obj, ops2);
+	if (!token || !token->event)
+		return efi_disk_transfer(diskobj, lba, buffer_size, buffer,
+					 direction);
+
+	token->transaction_status = EFI_NOT_READY;
+	if (!buffer_size) {
+		token->transaction_status = EFI_SUCCESS;
+		efi_signal_event(token->event);
+		return EFI_SUCCESS;
+	}
+
+	return efi_disk_queue(diskobj, token, direction, lba, buffer_size,
+			      buffer);
+}
+
+/**
+ * efi_disk_read_blocks_ex() - read blocks from device
+ *
+ * This function implements the ReadBlocksEx service of the
+ * EFI_BLOCK_IO2_PROTOCOL.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:		pointer to the BLOCK_IO2_PROTOCOL
+ * @media_id:		id of the medium to be read from
+ * @lba:		starting logical block for reading
+ * @token:		token to signal on completion
+ * @buffer_size:	size of the read buffer
+ * @buffer:		pointer to the destination buffer
+ * Return:		status code
+ */
+static efi_status_t EFIAPI
+efi_disk_read_blocks_ex(struct efi_block_io2 *this, u32 media_id, u64 lba,
+			struct efi_block_io2_token *token,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	EFI_ENTRY("%p, %x, %llx, %p, %zx, %p", this, media_id, lba, token,
+		  buffer_size, buffer);
+
+	return EFI_EXIT(efi_disk_rw_blocks_ex(this, media_id, lba, token,
+					      buffer_size, buffer,
+					      EFI_DISK_READ));
+}
+
+/**
+ * efi_disk_write_blocks_ex() - write blocks to device
+ *
+ * This function implements the WriteBlocksEx service of the
+ * EFI_BLOCK_IO2_PROTOCOL.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:		pointer to the BLOCK_IO2_PROTOCOL
+ * @media_id:		id of the medium to be written to
+ * @lba:		starting logical block for writing
+ * @token:		token to signal on completion
+ * @buffer_size:	size of the write buffer
+ * @buffer:		pointer to the source buffer
+ * Return:		status code
+ */
+static efi_status_t EFIAPI
+efi_disk_write_blocks_ex(struct efi_block_io2 *this, u32 media_id, u64 lba,
+			 struct efi_block_io2_token *token,
+			 efi_uintn_t buffer_size, void *buffer)
+{
+	EFI_ENTRY("%p, %x, %llx, %p, %zx, %p", this, media_id, lba, token,
+		  buffer_size, buffer);
+
+	return EFI_EXIT(efi_disk_rw_blocks_ex(this, media_id, lba, token,
+					      buffer_size, buffer,
+					      EFI_DISK_WRITE));
+}
+
+/**
+ * efi_disk_flush_blocks_ex() - flush modified data to the device
+ *
+ * This function implements the FlushBlocksEx service of the
+ * EFI_BLOCK_IO2_PROTOCOL. The flush completes after all previously queued
+ * requests.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:	pointer to the BLOCK_IO2_PROTOCOL
+ * @token:	token to signal on completion
+ * Return:	status code
+ */
+static efi_status_t EFIAPI
+efi_disk_flush_blocks_ex(struct efi_block_io2 *this,
+			 struct efi_block_io2_token *token)
+{
+	efi_status_t ret = EFI_SUCCESS;
+
+	EFI_ENTRY("%p, %p", this, token);
+
+	if (!this) {
+		ret = EFI_INVALID_PARAMETER;
+		goto out;
+	}
+	if (this->media->read_only) {
+		ret = EFI_WRITE_PROTECTED;
+		goto out;
+	}
+	if (!this->media->media_present) {
+		ret = EFI_NO_MEDIA;
+		goto out;
+	}
+
+	if (!token || !token->event) {
+		efi_disk_process_requests();
+		goto out;
+	}
+
+	token->transaction_status = EFI_NOT_READY;
+	ret = efi_disk_queue(container_of(this, struct efi_disk_obj, ops2),
+			     token, EFI_DISK_FLUSH, 0, 0, NULL);
+out:
+	return EFI_EXIT(ret);
+}
+
+static const struct efi_block_io2 block_io2_disk_template = {
+	.reset_ex = &efi_disk_reset_ex,
+	.read_blocks_ex = &efi_disk_read_blocks_ex,
+	.write_blocks_ex = &efi_disk_write_blocks_ex,
+	.flush_blocks_ex = &efi_disk_flush_blocks_ex,
+};
+
 /**
  * efi_fs_from_path() - retrieve simple file system protocol
  *
@@ -422,6 +1031,7 @@ static efi_status_t efi_disk_add_dev(
 	ret = EFI_CALL(efi_install_multiple_protocol_interfaces(
 			&handle, &efi_guid_device_path, diskobj->dp,
 			&efi_block_io_guid, &diskobj->ops,
+			&efi_block_io2_guid, &diskobj->ops2,
 			guid, NULL, NULL));
 	if (ret != EFI_SUCCESS)
 		goto error;
@@ -441,6 +1051,7 @@ static efi_status_t efi_disk_add_dev(
 			return ret;
 	}
 	diskobj->ops = block_io_disk_template;
+	diskobj->ops2 = block_io2_disk_template;
 	diskobj->ifname = if_typename;
 	diskobj->dev_index = dev_index;
 	diskobj->desc = desc;
@@ -458,6 +1069,7 @@ static efi_status_t efi_disk_add_dev(
 	if (part)
 		diskobj->media.logical_partition = 1;
 	diskobj->ops.media = &diskobj->media;
+	diskobj->ops2.media = &diskobj->media;
 	if (disk)
 		*disk = diskobj;
 
@@ -10,6 +10,7 @@
 #define LOG_CATEGORY LOGC_EFI
 
 #include <common.h>
+#include <bootstage.h>
 #include <cpu_func.h>
 #include <efi_loader.h>
 #include <log.h>
@@ -765,11 +766,95 @@ static u32 section_size(IMAGE_SECTION_HEADER *sec)
 		return sec->SizeOfRawData;
 }
 
+/**
+ * efi_pe_can_load_in_place() - check if an image can be relocated in place
+ *
+ * An image can be relocated where it resides if its file layout matches its
+ * memory layout, i.e. every section is stored at its virtual address, the
+ * buffer is suitably aligned, and the memory for the complete image is free.
+ * This is typically the case for EFI stub kernels loaded with the 'load'
+ * command. On success the memory is reserved for the image.
+ *
+ * @efi:		pointer to the EFI binary
+ * @efi_size:		size of @efi binary
+ * @sections:		section headers
+ * @num_sections:	number of sections
+ * @virt_size:		size of the image in memory
+ * @alignment:		section alignment
+ * @memory_type:	memory type for the image
+ * Return:		true if the image can be relocated in place
+ */
+static bool efi_pe_can_load_in_place(void *efi, size_t efi_size,
+				     IMAGE_SECTION_HEADER *sections,
+				     int num_sections, unsigned long virt_size,
+				     u32 alignment, int memory_type)
+{
+	u64 addr = (uintptr_t)efi;
+	u32 end = 0;
+	int i;
+
+	if (!IS_ENABLED(CONFIG_EFI_LOADER_IN_PLACE))
+		return false;
+
+	alignment = max_t(u32, alignment, EFI_PAGE_SIZE);
+	if (addr % alignment)
+		return false;
+
+	for (i = 0; i < num_sections; i++) {
+		IMAGE_SECTION_HEADER *sec = &sections[i];
+
+		if (sec->SizeOfRawData &&
+		    (sec->PointerToRawData != sec->VirtualAddress ||
+		     sec->PointerToRawData + sec->SizeOfRawData > efi_size))
+			return false;
+		/* Sections must be ordered and must not overlap */
+		if (sec->VirtualAddress < end)
+			return false;
+		end = sec->VirtualAddress + section_size(sec);
+	}
+
+	return efi_allocate_pages(EFI_ALLOCATE_ADDRESS, memory_type,
+				  efi_size_in_pages(virt_size),
+				  &addr) == EFI_SUCCESS;
+}
+
+/**
+ * efi_pe_get_destination() - get memory for the relocated image
+ *
+ * @efi:		pointer to the EFI binary
+ * @efi_size:		size of @efi binary
+ * @sections:		section headers
+ * @num_sections:	number of sections
+ * @virt_size:		size of the image in memory
+ * @alignment:		section alignment
+ * @memory_type:	memory type for the image
+ * @in_place:		on return true if the image is relocated in place
+ * Return:		memory for the image or NULL
+ */
+static void *efi_pe_get_destination(void *efi, size_t efi_size,
+				    IMAGE_SECTION_HEADER *sections,
+				    int num_sections, unsigned long virt_size,
+				    u32 alignment, int memory_type,
+				    bool *in_place)
+{
+	*in_place = efi_pe_can_load_in_place(efi, efi_size, sections,
+					     num_sections, virt_size,
+					     alignment, memory_type);
+	if (*in_place) {
+		log_debug("Relocating image in place at %p\n", efi);
+		return efi;
+	}
+
+	return efi_alloc_aligned_pages(virt_size, memory_type, alignment);
+}
+
 /**
  * efi_load_pe() - relocate EFI binary
  *
  * This function loads all sections from a PE binary into a newly reserved
- * piece of memory. On success the entry point is returned as handle->entry.
+ * piece of memory. If the memory layout of the binary allows, the binary is
+ * relocated where it resides instead. On success the entry point is returned
+ * as handle->entry.
  *
  * @handle:		loaded image handle
  * @efi:		pointer to the EFI binary
@@ -793,6 +878,7 @@ efi_status_t efi_load_pe(struct efi_loaded_image_obj *handle,
 	uint64_t image_base;
 	unsigned long virt_size = 0;
 	int supported = 0;
+	bool in_place;
 	efi_status_t ret;
 
 	ret = efi_check_pe(efi, efi_size, (void **)&nt);
@@ -823,6 +909,8 @@ efi_status_t efi_load_pe(struct efi_loaded_image_obj *handle,
 		return EFI_LOAD_ERROR;
 	}
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_EFI_LOAD_PE, "efi_load_pe");
+
 	/* Authenticate an image */
 	if (efi_image_authenticate(efi, efi_size)) {
 		handle->auth_status = EFI_IMAGE_AUTH_PASSED;
@@ -846,9 +934,11 @@ efi_status_t efi_load_pe(struct efi_loaded_image_obj *handle,
 		image_base = opt->ImageBase;
 		efi_set_code_and_data_type(loaded_image_info, opt->Subsystem);
 		handle->image_type = opt->Subsystem;
-		efi_reloc = efi_alloc_aligned_pages(virt_size,
-						    loaded_image_info->image_code_type,
-						    opt->SectionAlignment);
+		efi_reloc = efi_pe_get_destination(efi, efi_size, sections,
+						   num_sections, virt_size,
+						   opt->SectionAlignment,
+						   loaded_image_info->image_code_type,
+						   &in_place);
 		if (!efi_reloc) {
 			log_err("Out of memory\n");
 			ret = EFI_OUT_OF_RESOURCES;
@@ -862,9 +952,11 @@ efi_status_t efi_load_pe(struct efi_loaded_image_obj *handle,
 		image_base = opt->ImageBase;
 		efi_set_code_and_data_type(loaded_image_info, opt->Subsystem);
 		handle->image_type = opt->Subsystem;
-		efi_reloc = efi_alloc_aligned_pages(virt_size,
-						    loaded_image_info->image_code_type,
-						    opt->SectionAlignment);
+		efi_reloc = efi_pe_get_destination(efi, efi_size, sections,
+						   num_sections, virt_size,
+						   opt->SectionAlignment,
+						   loaded_image_info->image_code_type,
+						   &in_place);
 		if (!efi_reloc) {
 			log_err("Out of memory\n");
 			ret = EFI_OUT_OF_RESOURCES;
@@ -894,31 +986,47 @@ efi_status_t efi_load_pe(struct efi_loaded_image_obj *handle,
 
 #endif
 
-	/* Copy PE headers */
-	memcpy(efi_reloc, efi,
-	       sizeof(*dos)
-		 + sizeof(*nt)
-		 + nt->FileHeader.SizeOfOptionalHeader
-		 + num_sections * sizeof(IMAGE_SECTION_HEADER));
-
-	/* Load sections into RAM */
-	for (i = num_sections - 1; i >= 0; i--) {
-		IMAGE_SECTION_HEADER *sec = &sections[i];
-		u32 copy_size = section_size(sec);
+	if (in_place) {
+		/* Zero the uninitialized part of the sections */
+		for (i = num_sections - 1; i >= 0; i--) {
+			IMAGE_SECTION_HEADER *sec = &sections[i];
 
-		if (copy_size > sec->SizeOfRawData) {
-			copy_size = sec->SizeOfRawData;
-			memset(efi_reloc + sec->VirtualAddress, 0,
-			       sec->Misc.VirtualSize);
+			if (sec->Misc.VirtualSize > sec->SizeOfRawData)
+				memset(efi_reloc + sec->VirtualAddress +
+				       sec->SizeOfRawData, 0,
+				       sec->Misc.VirtualSize -
+				       sec->SizeOfRawData);
+		}
+	} else {
+		/* Copy PE headers */
+		memcpy(efi_reloc, efi,
+		       sizeof(*dos)
+			 + sizeof(*nt)
+			 + nt->FileHeader.SizeOfOptionalHeader
+			 + num_sections * sizeof(IMAGE_SECTION_HEADER));
+
+		/* Load sections into RAM */
+		for (i = num_sections - 1; i >= 0; i--) {
+			IMAGE_SECTION_HEADER *sec = &sections[i];
+			u32 copy_size = section_size(sec);
+
+			if (copy_size > sec->SizeOfRawData) {
+				copy_size = sec->SizeOfRawData;
+				memset(efi_reloc + sec->VirtualAddress, 0,
+				       sec->Misc.VirtualSize);
+			}
+			memcpy(efi_reloc + sec->VirtualAddress,
+			       efi + sec->PointerToRawData,
+			       copy_size);
 		}
-		memcpy(efi_reloc + sec->VirtualAddress,
-		       efi + sec->PointerToRawData,
-		       copy_size);
 	}
 
 	/* Run through relocations */
 	if (efi_loader_relocate(rel, rel_size, efi_reloc,
 				(unsigned long)image_base) != EFI_SUCCESS) {
+		if (in_place)
+			log_err("Image at %p partly relocated, load it again\n",
+				efi_reloc);
 		efi_free_pages((uintptr_t) efi_reloc,
 			       (virt_size + EFI_PAGE_MASK) >> EFI_PAGE_SHIFT);
 		ret = EFI_LOAD_ERROR;
@@ -935,10 +1043,12 @@ efi_status_t efi_load_pe(struct efi_loaded_image_obj *handle,
 	loaded_image_info->image_size = virt_size;
 
 	if (handle->auth_status == EFI_IMAGE_AUTH_PASSED)
-		return EFI_SUCCESS;
+		ret = EFI_SUCCESS;
 	else
-		return EFI_SECURITY_VIOLATION;
+		ret = EFI_SECURITY_VIOLATION;
 
 err:
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_EFI_LOAD_PE);
+
 	return ret;
 }
@@ -13,7 +13,8 @@
 #include <watchdog.h>
 #include <asm/cache.h>
 #include <asm/global_data.h>
-#include <linux/list_sort.h>
+#include <linux/bitops.h>
+#include <linux/rbtree_augmented.h>
 #include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -23,17 +24,29 @@ DECLARE_GLOBAL_DATA_PTR;
 
 efi_uintn_t efi_memory_map_key;
 
+/**
+ * struct efi_mem_list - memory map entry
+ *
+ * @node:		node in the tree of memory map entries
+ * @max_free_pages:	largest number of EFI_CONVENTIONAL_MEMORY pages in a
+ *			single entry of the subtree rooted at this node
+ * @desc:		memory descriptor
+ *
+ * The memory map entries never overlap. They are kept in a red-black tree
+ * sorted by physical start address. Each node is augmented with the size of
+ * the largest free region in its subtree so that a free region of a given
+ * size can be found without walking the whole map.
+ */
 struct efi_mem_list {
-	struct list_head link;
+	struct rb_node node;
+	u64 max_free_pages;
 	struct efi_mem_desc desc;
 };
 
-#define EFI_CARVE_NO_OVERLAP		-1
-#define EFI_CARVE_LOOP_AGAIN		-2
-#define EFI_CARVE_OVERLAPS_NONRAM	-3
-
-/* This list contains all memory map items */
-LIST_HEAD(efi_mem);
+/* This tree contains all memory map items */
+static struct rb_root efi_mem = RB_ROOT;
+/* Number of entries in the memory map */
+static efi_uintn_t efi_mem_entries;
 
 #ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
 void *efi_bounce_buffer;
@@ -46,9 +59,9 @@ void *efi_bounce_buffer;
  * @checksum:	checksum
  * @data:	allocated pool memory
  *
- * U-Boot services each UEFI AllocatePool() request as a separate
- * (multiple) page allocation. We have to track the number of pages
- * to be able to free the correct amount later.
+ * U-Boot services each UEFI AllocatePool() request exceeding the largest
+ * pool size class as a separate (multiple) page allocation. We have to track
+ * the number of pages to be able to free the correct amount later.
  *
  * The checksum calculated in function checksum() is used in FreePool() to avoid
  * freeing memory not allocated by AllocatePool() and duplicate freeing.
@@ -62,172 +75,271 @@ struct efi_pool_allocation {
 	char data[] __aligned(ARCH_DMA_MINALIGN);
 };
 
+/* Smallest pool size class */
+#define EFI_POOL_MIN_SHIFT	6
+/* Number of pool size classes, 64 to 1024 bytes */
+#define EFI_POOL_CLASSES	5
+
+/**
+ * struct efi_pool_page - page split into pool slots of a single size class
+ *
+ * @num_pages:	always 0, distinguishes the page from struct
+ *		efi_pool_allocation
+ * @checksum:	checksum
+ * @link:	link in the list of pages with free slots
+ * @used:	bitmap of allocated slots
+ * @slot_size:	size of each slot in bytes
+ * @num_slots:	number of slots in the page
+ * @type:	memory type of the page
+ * @class:	size class of the page
+ * @data:	slots
+ *
+ * Small AllocatePool() requests are served from pages holding slots of a
+ * fixed size. Pages are kept per memory type so that GetMemoryMap() still
+ * reports each allocation with the type it was requested with. A page is
+ * returned to the memory map when its last slot is freed.
+ */
+struct efi_pool_page {
+	u64 num_pages;
+	u64 checksum;
+	struct list_head link;
+	u64 used;
+	u32 slot_size;
+	u16 num_slots;
+	u8 type;
+	u8 class;
+	char data[] __aligned(ARCH_DMA_MINALIGN);
+};
+
+/* Pages with free slots per memory type and size class */
+static struct list_head efi_pool_pages[EFI_MAX_MEMORY_TYPE][EFI_POOL_CLASSES];
+
 /**
  * checksum() - calculate checksum for memory allocated from pool
  *
- * @alloc:	allocation header
+ * @addr:	address of the allocation header
+ * @num_pages:	number of pages in the allocation
  * Return:	checksum, always non-zero
  */
-static u64 checksum(struct efi_pool_allocation *alloc)
+static u64 checksum(uintptr_t addr, u64 num_pages)
 {
-	u64 addr = (uintptr_t)alloc;
-	u64 ret = (addr >> 32) ^ (addr << 32) ^ alloc->num_pages ^
+	u64 ret = ((u64)addr >> 32) ^ ((u64)addr << 32) ^ num_pages ^
 		  EFI_ALLOC_POOL_MAGIC;
 	if (!ret)
 		++ret;
 	return ret;
 }
 
-/*
- * Sorts the memory list from highest address to lowest address
- *
- * When allocating memory we should always start from the highest
- * address chunk, so sort the memory list such that the first list
- * iterator gets the highest address and goes lower from there.
- */
-static int efi_mem_cmp(void *priv, struct list_head *a, struct list_head *b)
-{
-	struct efi_mem_list *mema = list_entry(a, struct efi_mem_list, link);
-	struct efi_mem_list *memb = list_entry(b, struct efi_mem_list, link);
-
-	if (mema->desc.physical_start == memb->desc.physical_start)
-		return 0;
-	else if (mema->desc.physical_start < memb->desc.physical_start)
-		return 1;
-	else
-		return -1;
-}
-
 static uint64_t desc_get_end(struct efi_mem_desc *desc)
 {
 	return desc->physical_start + (desc->num_pages << EFI_PAGE_SHIFT);
 }
 
-static void efi_mem_sort(void)
+static u64 efi_mem_compute_max(struct efi_mem_list *mem)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *prevmem = NULL;
-	bool merge_again = true;
+	u64 max = 0;
+	struct efi_mem_list *child;
+
+	if (mem->desc.type == EFI_CONVENTIONAL_MEMORY)
+		max = mem->desc.num_pages;
+	if (mem->node.rb_left) {
+		child = rb_entry(mem->node.rb_left, struct efi_mem_list, node);
+		max = max(max, child->max_free_pages);
+	}
+	if (mem->node.rb_right) {
+		child = rb_entry(mem->node.rb_right, struct efi_mem_list, node);
+		max = max(max, child->max_free_pages);
+	}
 
-	list_sort(NULL, &efi_mem, efi_mem_cmp);
+	return max;
+}
 
-	/* Now merge entries that can be merged */
-	while (merge_again) {
-		merge_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			struct efi_mem_desc *prev = &prevmem->desc;
-			struct efi_mem_desc *cur;
-			uint64_t pages;
+RB_DECLARE_CALLBACKS(static, efi_mem_augment, struct efi_mem_list, node,
+		     u64, max_free_pages, efi_mem_compute_max)
 
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			if (!prevmem) {
-				prevmem = lmem;
-				continue;
-			}
+static struct efi_mem_list *efi_mem_next(struct efi_mem_list *mem)
+{
+	return rb_entry_safe(rb_next(&mem->node), struct efi_mem_list, node);
+}
 
-			cur = &lmem->desc;
+static struct efi_mem_list *efi_mem_prev(struct efi_mem_list *mem)
+{
+	return rb_entry_safe(rb_prev(&mem->node), struct efi_mem_list, node);
+}
 
-			if ((desc_get_end(cur) == prev->physical_start) &&
-			    (prev->type == cur->type) &&
-			    (prev->attribute == cur->attribute)) {
-				/* There is an existing map before, reuse it */
-				pages = cur->num_pages;
-				prev->num_pages += pages;
-				prev->physical_start -= pages << EFI_PAGE_SHIFT;
-				prev->virtual_start -= pages << EFI_PAGE_SHIFT;
-				list_del(&lmem->link);
-				free(lmem);
+/**
+ * efi_mem_lookup() - find the first memory map entry ending above an address
+ *
+ * @addr:	address
+ * Return:	entry containing @addr, else the entry with the lowest start
+ *		address above @addr, NULL if there is none
+ */
+static struct efi_mem_list *efi_mem_lookup(u64 addr)
+{
+	struct rb_node *rb = efi_mem.rb_node;
+	struct efi_mem_list *ret = NULL;
+
+	while (rb) {
+		struct efi_mem_list *mem;
+
+		mem = rb_entry(rb, struct efi_mem_list, node);
+		if (addr < mem->desc.physical_start) {
+			ret = mem;
+			rb = rb->rb_left;
+		} else if (addr >= desc_get_end(&mem->desc)) {
+			rb = rb->rb_right;
+		} else {
+			return mem;
+		}
+	}
 
-				merge_again = true;
-				break;
-			}
+	return ret;
+}
 
-			prevmem = lmem;
-		}
+/**
+ * efi_mem_insert() - insert an entry into the memory map tree
+ *
+ * The entry must not overlap any entry already in the tree.
+ *
+ * @new:	entry to insert
+ */
+static void efi_mem_insert(struct efi_mem_list *new)
+{
+	struct rb_node **link = &efi_mem.rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*link) {
+		struct efi_mem_list *mem;
+
+		parent = *link;
+		mem = rb_entry(parent, struct efi_mem_list, node);
+		if (new->desc.physical_start < mem->desc.physical_start)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
 	}
+
+	new->max_free_pages = new->desc.type == EFI_CONVENTIONAL_MEMORY ?
+			      new->desc.num_pages : 0;
+	rb_link_node(&new->node, parent, link);
+	efi_mem_augment_propagate(parent, NULL);
+	rb_insert_augmented(&new->node, &efi_mem, &efi_mem_augment);
+	++efi_mem_entries;
 }
 
-/** efi_mem_carve_out - unmap memory region
+/**
+ * efi_mem_remove() - remove an entry from the memory map tree and free it
  *
- * @map:		memory map
- * @carve_desc:		memory region to unmap
- * @overlap_only_ram:	the carved out region may only overlap RAM
- * Return Value:	the number of overlapping pages which have been
- *			removed from the map,
- *			EFI_CARVE_NO_OVERLAP, if the regions don't overlap,
- *			EFI_CARVE_OVERLAPS_NONRAM, if the carve and map overlap,
- *			and the map contains anything but free ram
- *			(only when overlap_only_ram is true),
- *			EFI_CARVE_LOOP_AGAIN, if the mapping list should be
- *			traversed again, as it has been altered.
+ * @mem:	entry to remove
+ */
+static void efi_mem_remove(struct efi_mem_list *mem)
+{
+	rb_erase_augmented(&mem->node, &efi_mem, &efi_mem_augment);
+	--efi_mem_entries;
+	free(mem);
+}
+
+/**
+ * efi_mem_resize() - change the range covered by a memory map entry
  *
- * Unmaps all memory occupied by the carve_desc region from the list entry
- * pointed to by map.
+ * The new range must not overlap any other entry so that the tree order is
+ * preserved.
  *
- * In case of EFI_CARVE_OVERLAPS_NONRAM it is the callers responsibility
- * to re-add the already carved out pages to the mapping.
+ * @mem:	entry to change
+ * @start:	new start address
+ * @end:	new end address
  */
-static s64 efi_mem_carve_out(struct efi_mem_list *map,
-			     struct efi_mem_desc *carve_desc,
-			     bool overlap_only_ram)
-{
-	struct efi_mem_list *newmap;
-	struct efi_mem_desc *map_desc = &map->desc;
-	uint64_t map_start = map_desc->physical_start;
-	uint64_t map_end = map_start + (map_desc->num_pages << EFI_PAGE_SHIFT);
-	uint64_t carve_start = carve_desc->physical_start;
-	uint64_t carve_end = carve_start +
-			     (carve_desc->num_pages << EFI_PAGE_SHIFT);
-
-	/* check whether we're overlapping */
-	if ((carve_end <= map_start) || (carve_start >= map_end))
-		return EFI_CARVE_NO_OVERLAP;
-
-	/* We're overlapping with non-RAM, warn the caller if desired */
-	if (overlap_only_ram && (map_desc->type != EFI_CONVENTIONAL_MEMORY))
-		return EFI_CARVE_OVERLAPS_NONRAM;
-
-	/* Sanitize carve_start and carve_end to lie within our bounds */
-	carve_start = max(carve_start, map_start);
-	carve_end = min(carve_end, map_end);
-
-	/* Carving at the beginning of our map? Just move it! */
-	if (carve_start == map_start) {
-		if (map_end == carve_end) {
-			/* Full overlap, just remove map */
-			list_del(&map->link);
-			free(map);
-		} else {
-			map->desc.physical_start = carve_end;
-			map->desc.virtual_start = carve_end;
-			map->desc.num_pages = (map_end - carve_end)
-					      >> EFI_PAGE_SHIFT;
-		}
+static void efi_mem_resize(struct efi_mem_list *mem, u64 start, u64 end)
+{
+	mem->desc.physical_start = start;
+	mem->desc.virtual_start = start;
+	mem->desc.num_pages = (end - start) >> EFI_PAGE_SHIFT;
+	efi_mem_augment_propagate(&mem->node, NULL);
+}
 
-		return (carve_end - carve_start) >> EFI_PAGE_SHIFT;
-	}
+/**
+ * efi_mem_can_merge() - check if two adjacent entries can be merged
+ *
+ * @low:	entry at the lower address
+ * @high:	entry at the higher address
+ * Return:	true if @high directly follows @low with the same attributes
+ */
+static bool efi_mem_can_merge(struct efi_mem_list *low,
+			      struct efi_mem_list *high)
+{
+	return low && high &&
+	       desc_get_end(&low->desc) == high->desc.physical_start &&
+	       low->desc.type == high->desc.type &&
+	       low->desc.attribute == high->desc.attribute;
+}
 
-	/*
-	 * Overlapping maps, just split the list map at carve_start,
-	 * it will get moved or removed in the next iteration.
-	 *
-	 * [ map_desc |__carve_start__| newmap ]
-	 */
+/**
+ * efi_mem_check_ram() - check that a region is fully covered by free RAM
+ *
+ * @start:	start address of the region
+ * @end:	end address of the region
+ * Return:	true if every page of the region is EFI_CONVENTIONAL_MEMORY
+ */
+static bool efi_mem_check_ram(u64 start, u64 end)
+{
+	struct efi_mem_list *mem = efi_mem_lookup(start);
+	u64 addr = start;
+
+	for (; mem && addr < end; mem = efi_mem_next(mem)) {
+		if (mem->desc.physical_start > addr ||
+		    mem->desc.type != EFI_CONVENTIONAL_MEMORY)
+			return false;
+		addr = desc_get_end(&mem->desc);
+	}
 
-	/* Create a new map from [ carve_start ... map_end ] */
-	newmap = calloc(1, sizeof(*newmap));
-	newmap->desc = map->desc;
-	newmap->desc.physical_start = carve_start;
-	newmap->desc.virtual_start = carve_start;
-	newmap->desc.num_pages = (map_end - carve_start) >> EFI_PAGE_SHIFT;
-	/* Insert before current entry (descending address order) */
-	list_add_tail(&newmap->link, &map->link);
+	return addr >= end;
+}
 
-	/* Shrink the map to [ map_start ... carve_start ] */
-	map_desc->num_pages = (carve_start - map_start) >> EFI_PAGE_SHIFT;
+/**
+ * efi_mem_carve_out() - unmap a memory region
+ *
+ * Removes the range [start, end) from all entries of the memory map. Entries
+ * extending across the start and the end of the region are split.
+ *
+ * @start:	start address of the region
+ * @end:	end address of the region
+ * Return:	status code
+ */
+static efi_status_t efi_mem_carve_out(u64 start, u64 end)
+{
+	struct efi_mem_list *mem = efi_mem_lookup(start);
+
+	while (mem && mem->desc.physical_start < end) {
+		struct efi_mem_list *next = efi_mem_next(mem);
+		u64 map_start = mem->desc.physical_start;
+		u64 map_end = desc_get_end(&mem->desc);
+
+		if (map_start < start && map_end > end) {
+			struct efi_mem_list *newmap;
+
+			/*
+			 * Split the map around the carved out region
+			 *
+			 * [ mem |__carve__| newmap ]
+			 */
+			newmap = calloc(1, sizeof(*newmap));
+			if (!newmap)
+				return EFI_OUT_OF_RESOURCES;
+			newmap->desc = mem->desc;
+			efi_mem_resize(mem, map_start, start);
+			efi_mem_resize(newmap, end, map_end);
+			efi_mem_insert(newmap);
+		} else if (map_start < start) {
+			efi_mem_resize(mem, map_start, start);
+		} else if (map_end > end) {
+			efi_mem_resize(mem, end, map_end);
+		} else {
+			efi_mem_remove(mem);
+		}
+		mem = next;
+	}
 
-	return EFI_CARVE_LOOP_AGAIN;
+	return EFI_SUCCESS;
 }
 
 /**
@@ -243,11 +355,10 @@ static efi_status_t efi_add_memory_map_pg(u64 start, u64 pages,
 					  int memory_type,
 					  bool overlap_only_ram)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *newlist;
-	bool carve_again;
-	uint64_t carved_pages = 0;
+	struct efi_mem_list *newlist, *neighbour;
 	struct efi_event *evt;
+	efi_status_t ret;
+	u64 end;
 
 	EFI_PRINT("%s: 0x%llx 0x%llx %d %s\n", __func__,
 		  start, pages, memory_type, overlap_only_ram ? "yes" : "no");
@@ -258,8 +369,18 @@ static efi_status_t efi_add_memory_map_pg(u64 start, u64 pages,
 	if (!pages)
 		return EFI_SUCCESS;
 
-	++efi_memory_map_key;
+	end = start + (pages << EFI_PAGE_SHIFT);
+
+	/*
+	 * The payload wanted to have RAM overlaps only. Check this before
+	 * touching the map so that it stays intact on error.
+	 */
+	if (overlap_only_ram && !efi_mem_check_ram(start, end))
+		return EFI_NO_MAPPING;
+
 	newlist = calloc(1, sizeof(*newlist));
+	if (!newlist)
+		return EFI_OUT_OF_RESOURCES;
 	newlist->desc.type = memory_type;
 	newlist->desc.physical_start = start;
 	newlist->desc.virtual_start = start;
@@ -278,60 +399,29 @@ static efi_status_t efi_add_memory_map_pg(u64 start, u64 pages,
 		break;
 	}
 
-	/* Add our new map */
-	do {
-		carve_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			s64 r;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			r = efi_mem_carve_out(lmem, &newlist->desc,
-					      overlap_only_ram);
-			switch (r) {
-			case EFI_CARVE_OVERLAPS_NONRAM:
-				/*
-				 * The user requested to only have RAM overlaps,
-				 * but we hit a non-RAM region. Error out.
-				 */
-				return EFI_NO_MAPPING;
-			case EFI_CARVE_NO_OVERLAP:
-				/* Just ignore this list entry */
-				break;
-			case EFI_CARVE_LOOP_AGAIN:
-				/*
-				 * We split an entry, but need to loop through
-				 * the list again to actually carve it.
-				 */
-				carve_again = true;
-				break;
-			default:
-				/* We carved a number of pages */
-				carved_pages += r;
-				carve_again = true;
-				break;
-			}
-
-			if (carve_again) {
-				/* The list changed, we need to start over */
-				break;
-			}
-		}
-	} while (carve_again);
-
-	if (overlap_only_ram && (carved_pages != pages)) {
-		/*
-		 * The payload wanted to have RAM overlaps, but we overlapped
-		 * with an unallocated region. Error out.
-		 */
-		return EFI_NO_MAPPING;
+	++efi_memory_map_key;
+	ret = efi_mem_carve_out(start, end);
+	if (ret != EFI_SUCCESS) {
+		free(newlist);
+		return ret;
 	}
 
 	/* Add our new map */
-        list_add_tail(&newlist->link, &efi_mem);
-
-	/* And make sure memory is listed in descending order */
-	efi_mem_sort();
+	efi_mem_insert(newlist);
+
+	/* Merge with adjacent entries of the same kind */
+	neighbour = efi_mem_prev(newlist);
+	if (efi_mem_can_merge(neighbour, newlist)) {
+		start = neighbour->desc.physical_start;
+		efi_mem_remove(neighbour);
+		efi_mem_resize(newlist, start, end);
+	}
+	neighbour = efi_mem_next(newlist);
+	if (efi_mem_can_merge(newlist, neighbour)) {
+		end = desc_get_end(&neighbour->desc);
+		efi_mem_remove(neighbour);
+		efi_mem_resize(newlist, newlist->desc.physical_start, end);
+	}
 
 	/* Notify that the memory map was changed */
 	list_for_each_entry(evt, &efi_events, link) {
@@ -385,64 +475,74 @@ efi_status_t efi_add_memory_map(u64 start, u64 size, int memory_type)
  */
 static efi_status_t efi_check_allocated(u64 addr, bool must_be_allocated)
 {
-	struct efi_mem_list *item;
+	struct efi_mem_list *item = efi_mem_lookup(addr);
+
+	if (!item || addr < item->desc.physical_start)
+		return EFI_NOT_FOUND;
+
+	if (must_be_allocated ^ (item->desc.type == EFI_CONVENTIONAL_MEMORY))
+		return EFI_SUCCESS;
+	else
+		return EFI_NOT_FOUND;
+}
+
+/**
+ * efi_find_free_memory_node() - find free memory in a subtree
+ *
+ * The highest suitable address is returned. Subtrees without a large enough
+ * free region are skipped.
+ *
+ * @rb:		root of the subtree
+ * @len:	number of bytes needed
+ * @max_addr:	page aligned address the allocation may not exceed
+ * Return:	start address of the free memory, 0 if not found
+ */
+static u64 efi_find_free_memory_node(struct rb_node *rb, u64 len,
+				     u64 max_addr)
+{
+	struct efi_mem_list *mem;
+	struct efi_mem_desc *desc;
+	u64 ret;
+
+	if (!rb)
+		return 0;
+
+	mem = rb_entry(rb, struct efi_mem_list, node);
+	if ((mem->max_free_pages << EFI_PAGE_SHIFT) < len)
+		return 0;
 
-	list_for_each_entry(item, &efi_mem, link) {
-		u64 start = item->desc.physical_start;
-		u64 end = start + (item->desc.num_pages << EFI_PAGE_SHIFT);
+	desc = &mem->desc;
+	if (desc->physical_start < max_addr) {
+		/* Higher addresses first */
+		ret = efi_find_free_memory_node(rb->rb_right, len, max_addr);
+		if (ret)
+			return ret;
 
-		if (addr >= start && addr < end) {
-			if (must_be_allocated ^
-			    (item->desc.type == EFI_CONVENTIONAL_MEMORY))
-				return EFI_SUCCESS;
-			else
-				return EFI_NOT_FOUND;
+		/* We only take memory from free RAM */
+		if (desc->type == EFI_CONVENTIONAL_MEMORY) {
+			u64 curmax = min(max_addr, desc_get_end(desc));
+
+			/* Return the highest address within bounds */
+			if (curmax - desc->physical_start >= len)
+				return curmax - len;
 		}
 	}
 
-	return EFI_NOT_FOUND;
+	return efi_find_free_memory_node(rb->rb_left, len, max_addr);
 }
 
 static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
 {
-	struct list_head *lhandle;
-
 	/*
 	 * Prealign input max address, so we simplify our matching
 	 * logic below and can just reuse it as return pointer.
 	 */
 	max_addr &= ~EFI_PAGE_MASK;
 
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem = list_entry(lhandle,
-			struct efi_mem_list, link);
-		struct efi_mem_desc *desc = &lmem->desc;
-		uint64_t desc_len = desc->num_pages << EFI_PAGE_SHIFT;
-		uint64_t desc_end = desc->physical_start + desc_len;
-		uint64_t curmax = min(max_addr, desc_end);
-		uint64_t ret = curmax - len;
-
-		/* We only take memory from free RAM */
-		if (desc->type != EFI_CONVENTIONAL_MEMORY)
-			continue;
-
-		/* Out of bounds for max_addr */
-		if ((ret + len) > max_addr)
-			continue;
-
-		/* Out of bounds for upper map limit */
-		if ((ret + len) > desc_end)
-			continue;
-
-		/* Out of bounds for lower map limit */
-		if (ret < desc->physical_start)
-			continue;
-
-		/* Return the highest address in this map within bounds */
-		return ret;
-	}
+	if (!len)
+		return 0;
 
-	return 0;
+	return efi_find_free_memory_node(efi_mem.rb_node, len, max_addr);
 }
 
 /*
@@ -601,9 +701,135 @@ void *efi_alloc_aligned_pages(u64 len, int memory_type, size_t align)
 	return (void *)(uintptr_t)aligned_mem;
 }
 
+/**
+ * efi_pool_class() - get the pool size class for an allocation
+ *
+ * @size:	number of bytes to be allocated
+ * Return:	size class, -1 if the allocation needs whole pages
+ */
+static int efi_pool_class(efi_uintn_t size)
+{
+	int class;
+
+	for (class = 0; class < EFI_POOL_CLASSES; ++class) {
+		if (size <= (1UL << (EFI_POOL_MIN_SHIFT + class)))
+			return class;
+	}
+
+	return -1;
+}
+
+/**
+ * efi_pool_page_list() - get the list of pages with free slots
+ *
+ * @type:	memory type
+ * @class:	size class
+ * Return:	list head
+ */
+static struct list_head *efi_pool_page_list(int type, int class)
+{
+	struct list_head *head = &efi_pool_pages[type][class];
+
+	if (!head->next)
+		INIT_LIST_HEAD(head);
+
+	return head;
+}
+
+/**
+ * efi_pool_alloc_slot() - allocate pool memory from a size class page
+ *
+ * @pool_type:	type of the pool from which memory is to be allocated
+ * @class:	size class
+ * @buffer:	allocated memory
+ * Return:	status code
+ */
+static efi_status_t efi_pool_alloc_slot(enum efi_memory_type pool_type,
+					int class, void **buffer)
+{
+	struct list_head *head = efi_pool_page_list(pool_type, class);
+	struct efi_pool_page *page;
+	unsigned int slot;
+
+	if (list_empty(head)) {
+		efi_status_t r;
+		u64 addr;
+
+		r = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type, 1,
+				       &addr);
+		if (r != EFI_SUCCESS)
+			return r;
+
+		page = (struct efi_pool_page *)(uintptr_t)addr;
+		page->num_pages = 0;
+		page->checksum = checksum(addr, 0);
+		page->used = 0;
+		page->slot_size = max_t(u32, 1U << (EFI_POOL_MIN_SHIFT + class),
+					ARCH_DMA_MINALIGN);
+		page->num_slots = (EFI_PAGE_SIZE -
+				   offsetof(struct efi_pool_page, data)) /
+				  page->slot_size;
+		page->num_slots = min_t(u16, page->num_slots, 64);
+		page->type = pool_type;
+		page->class = class;
+		list_add(&page->link, head);
+	}
+
+	page = list_first_entry(head, struct efi_pool_page, link);
+	slot = __ffs64(~page->used);
+	page->used |= 1ULL << slot;
+	if (page->used == GENMASK_ULL(page->num_slots - 1, 0))
+		list_del(&page->link);
+
+	*buffer = page->data + slot * page->slot_size;
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_pool_free_slot() - free pool memory allocated from a size class page
+ *
+ * @page:	page containing the allocation
+ * @buffer:	start of memory to be freed
+ * Return:	status code
+ */
+static efi_status_t efi_pool_free_slot(struct efi_pool_page *page,
+				       void *buffer)
+{
+	uintptr_t offset = (uintptr_t)buffer - (uintptr_t)page->data;
+	unsigned int slot = offset / page->slot_size;
+	bool full = page->used == GENMASK_ULL(page->num_slots - 1, 0);
+
+	if ((uintptr_t)buffer < (uintptr_t)page->data ||
+	    offset % page->slot_size || slot >= page->num_slots ||
+	    !(page->used & (1ULL << slot))) {
+		printf("%s: illegal free 0x%p\n", __func__, buffer);
+		return EFI_INVALID_PARAMETER;
+	}
+
+	page->used &= ~(1ULL << slot);
+	if (page->used) {
+		if (full)
+			list_add(&page->link,
+				 efi_pool_page_list(page->type, page->class));
+		return EFI_SUCCESS;
+	}
+
+	/* Last slot freed, return the page to the memory map */
+	if (!full)
+		list_del(&page->link);
+	page->checksum = 0;
+
+	return efi_free_pages((uintptr_t)page, 1);
+}
+
 /**
  * efi_allocate_pool - allocate memory from pool
  *
+ * Allocations up to the largest pool size class share pages with other
+ * allocations of the same memory type and size class. Larger allocations are
+ * served as separate page allocations.
+ *
  * @pool_type:	type of the pool from which memory is to be allocated
  * @size:	number of bytes to be allocated
  * @buffer:	allocated memory
@@ -616,6 +842,7 @@ efi_status_t efi_allocate_pool(enum efi_memory_type pool_type, efi_uintn_t size,
 	struct efi_pool_allocation *alloc;
 	u64 num_pages = efi_size_in_pages(size +
 					  sizeof(struct efi_pool_allocation));
+	int class;
 
 	if (!buffer)
 		return EFI_INVALID_PARAMETER;
@@ -625,12 +852,17 @@ efi_status_t efi_allocate_pool(enum efi_memory_type pool_type, efi_uintn_t size,
 		return EFI_SUCCESS;
 	}
 
+	class = efi_pool_class(size);
+	if (class >= 0 && pool_type < EFI_MAX_MEMORY_TYPE &&
+	    pool_type != EFI_CONVENTIONAL_MEMORY)
+		return efi_pool_alloc_slot(pool_type, class, buffer);
+
 	r = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type, num_pages,
 			       &addr);
 	if (r == EFI_SUCCESS) {
 		alloc = (struct efi_pool_allocation *)(uintptr_t)addr;
 		alloc->num_pages = num_pages;
-		alloc->checksum = checksum(alloc);
+		alloc->checksum = checksum(addr, num_pages);
 		*buffer = alloc->data;
 	}
 
@@ -647,6 +879,7 @@ efi_status_t efi_free_pool(void *buffer)
 {
 	efi_status_t ret;
 	struct efi_pool_allocation *alloc;
+	uintptr_t page = (uintptr_t)buffer & ~EFI_PAGE_MASK;
 
 	if (!buffer)
 		return EFI_INVALID_PARAMETER;
@@ -655,11 +888,17 @@ efi_status_t efi_free_pool(void *buffer)
 	if (ret != EFI_SUCCESS)
 		return ret;
 
+	/* Allocations from a size class page are preceded by a page header */
+	alloc = (struct efi_pool_allocation *)page;
+	if (!alloc->num_pages && alloc->checksum == checksum(page, 0))
+		return efi_pool_free_slot((struct efi_pool_page *)page,
+					  buffer);
+
 	alloc = container_of(buffer, struct efi_pool_allocation, data);
 
 	/* Check that this memory was allocated by efi_allocate_pool() */
 	if (((uintptr_t)alloc & EFI_PAGE_MASK) ||
-	    alloc->checksum != checksum(alloc)) {
+	    alloc->checksum != checksum((uintptr_t)alloc, alloc->num_pages)) {
 		printf("%s: illegal free 0x%p\n", __func__, buffer);
 		return EFI_INVALID_PARAMETER;
 	}
@@ -689,8 +928,7 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 				uint32_t *descriptor_version)
 {
 	efi_uintn_t map_size = 0;
-	int map_entries = 0;
-	struct list_head *lhandle;
+	struct rb_node *rb;
 	efi_uintn_t provided_map_size;
 
 	if (!memory_map_size)
@@ -698,10 +936,7 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 
 	provided_map_size = *memory_map_size;
 
-	list_for_each(lhandle, &efi_mem)
-		map_entries++;
-
-	map_size = map_entries * sizeof(struct efi_mem_desc);
+	map_size = efi_mem_entries * sizeof(struct efi_mem_desc);
 
 	*memory_map_size = map_size;
 
@@ -717,15 +952,13 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 	if (!memory_map)
 		return EFI_INVALID_PARAMETER;
 
-	/* Copy list into array */
-	/* Return the list in ascending order */
-	memory_map = &memory_map[map_entries - 1];
-	list_for_each(lhandle, &efi_mem) {
+	/* Copy tree into array in ascending order */
+	for (rb = rb_first(&efi_mem); rb; rb = rb_next(rb)) {
 		struct efi_mem_list *lmem;
 
-		lmem = list_entry(lhandle, struct efi_mem_list, link);
+		lmem = rb_entry(rb, struct efi_mem_list, node);
 		*memory_map = lmem->desc;
-		memory_map--;
+		memory_map++;
 	}
 
 	if (map_key)
@@ -11,6 +11,8 @@
  * ConnectController is used to setup partitions and to install the simple
  * file protocol.
  * A known file is read from the file system and verified.
+ * Blocks are read asynchronously via the block IO 2 protocol and compared to
+ * a synchronous read.
  */
 
 #include <efi_selftest.h>
@@ -26,6 +28,7 @@
 static struct efi_boot_services *boottime;
 
 static const efi_guid_t block_io_protocol_guid = EFI_BLOCK_IO_PROTOCOL_GUID;
+static const efi_guid_t block_io2_protocol_guid = EFI_BLOCK_IO2_PROTOCOL_GUID;
 static const efi_guid_t guid_device_path = EFI_DEVICE_PATH_PROTOCOL_GUID;
 static const efi_guid_t guid_simple_file_system_protocol =
 					EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID;
@@ -289,6 +292,81 @@ static efi_uintn_t dp_size(struct efi_device_path *dp)
 	return (char *)pos - (char *)dp;
 }
 
+/**
+ * check_block_io2() - check asynchronous reads via the block IO 2 protocol
+ *
+ * Two adjacent blocks are read with separate tokens and compared to the
+ * result of a synchronous read via the block IO protocol.
+ *
+ * @handle:	handle of the partition
+ * @block_io:	block IO protocol of the partition
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int check_block_io2(efi_handle_t handle, struct efi_block_io *block_io)
+{
+	struct efi_block_io2 *block_io2;
+	struct efi_block_io2_token tokens[2];
+	u8 expected[2 << LB_BLOCK_SIZE] __aligned(ARCH_DMA_MINALIGN);
+	u8 data[2 << LB_BLOCK_SIZE] __aligned(ARCH_DMA_MINALIGN);
+	efi_uintn_t index;
+	efi_status_t ret;
+	int i;
+
+	ret = boottime->open_protocol(handle, &block_io2_protocol_guid,
+				      (void **)&block_io2, NULL, NULL,
+				      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to open block IO 2 protocol\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = block_io->read_blocks(block_io, block_io->media->media_id, 0,
+				    sizeof(expected), expected);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("ReadBlocks failed\n");
+		return EFI_ST_FAILURE;
+	}
+
+	boottime->set_mem(data, sizeof(data), 0);
+	for (i = 0; i < 2; ++i) {
+		ret = boottime->create_event(0, TPL_CALLBACK, NULL, NULL,
+					     &tokens[i].event);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("Failed to create event\n");
+			return EFI_ST_FAILURE;
+		}
+		ret = block_io2->read_blocks_ex(block_io2,
+						block_io2->media->media_id, i,
+						&tokens[i], 1 << LB_BLOCK_SIZE,
+						data + (i << LB_BLOCK_SIZE));
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("ReadBlocksEx failed\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	for (i = 0; i < 2; ++i) {
+		ret = boottime->wait_for_event(1, &tokens[i].event, &index);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("Failed to wait for event\n");
+			return EFI_ST_FAILURE;
+		}
+		if (tokens[i].transaction_status != EFI_SUCCESS) {
+			efi_st_error("Asynchronous read failed\n");
+			return EFI_ST_FAILURE;
+		}
+		ret = boottime->close_event(tokens[i].event);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("Failed to close event\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	if (memcmp(data, expected, sizeof(data))) {
+		efi_st_error("Asynchronous read returned wrong data\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
 /*
  * Execute unit test.
  *
@@ -372,6 +450,9 @@ static int execute(void)
 			     part1_size - 1);
 		return EFI_ST_FAILURE;
 	}
+	if (check_block_io2(handle_partition, block_io_protocol) !=
+	    EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
 	/* Open the simple file system protocol */
 	ret = boottime->open_protocol(handle_partition,
 				      &guid_simple_file_system_protocol,
@@ -5,7 +5,7 @@
  * Copyright (c) 2018 Heinrich Schuchardt <xypron.glpk@gmx.de>
  *
  * This unit test checks the following boottime services:
- * AllocatePages, FreePages, GetMemoryMap
+ * AllocatePages, FreePages, AllocatePool, FreePool, GetMemoryMap
  *
  * The memory type used for the device tree is checked.
  */
@@ -13,6 +13,8 @@
 #include <efi_selftest.h>
 
 #define EFI_ST_NUM_PAGES 8
+#define EFI_ST_NUM_POOLS 4
+#define EFI_ST_POOL_SIZE 24
 
 static const efi_guid_t fdt_guid = EFI_FDT_GUID;
 static struct efi_boot_services *boottime;
@@ -102,12 +104,14 @@ static int execute(void)
 {
 	u64 p1;
 	u64 p2;
+	u8 *pools[EFI_ST_NUM_POOLS];
 	efi_uintn_t map_size = 0;
 	efi_uintn_t map_key;
 	efi_uintn_t desc_size;
 	u32 desc_version;
 	struct efi_mem_desc *memory_map;
 	efi_status_t ret;
+	unsigned int i;
 
 	/* Allocate two page ranges with different memory type */
 	ret = boottime->allocate_pages(EFI_ALLOCATE_ANY_PAGES,
@@ -125,6 +129,29 @@ static int execute(void)
 		return EFI_ST_FAILURE;
 	}
 
+	/* Allocate small pools which may share pages */
+	for (i = 0; i < EFI_ST_NUM_POOLS; ++i) {
+		ret = boottime->allocate_pool(EFI_RUNTIME_SERVICES_DATA,
+					      EFI_ST_POOL_SIZE,
+					      (void **)&pools[i]);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("AllocatePool did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+		if ((uintptr_t)pools[i] & 7) {
+			efi_st_error("Pool memory is not 8 byte aligned\n");
+			return EFI_ST_FAILURE;
+		}
+		memset(pools[i], i, EFI_ST_POOL_SIZE);
+	}
+	for (i = 0; i < EFI_ST_NUM_POOLS; ++i) {
+		if (pools[i][0] != i ||
+		    pools[i][EFI_ST_POOL_SIZE - 1] != i) {
+			efi_st_error("Pool allocations overlap\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+
 	/* Load memory map */
 	ret = boottime->get_memory_map(&map_size, NULL, &map_key, &desc_size,
 				       &desc_version);
@@ -155,6 +182,13 @@ static int execute(void)
 	if (find_in_memory_map(map_size, memory_map, desc_size, p2,
 			       EFI_RUNTIME_SERVICES_DATA) != EFI_ST_SUCCESS)
 		return EFI_ST_FAILURE;
+	for (i = 0; i < EFI_ST_NUM_POOLS; ++i) {
+		if (find_in_memory_map(map_size, memory_map, desc_size,
+				       (uintptr_t)pools[i],
+				       EFI_RUNTIME_SERVICES_DATA) !=
+		    EFI_ST_SUCCESS)
+			return EFI_ST_FAILURE;
+	}
 
 	/* Free memory */
 	ret = boottime->free_pages(p1, EFI_ST_NUM_PAGES);
@@ -167,6 +201,13 @@ static int execute(void)
 		efi_st_error("FreePages did not return EFI_SUCCESS\n");
 		return EFI_ST_FAILURE;
 	}
+	for (i = 0; i < EFI_ST_NUM_POOLS; ++i) {
+		ret = boottime->free_pool(pools[i]);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("FreePool did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+	}
 	ret = boottime->free_pool(memory_map);
 	if (ret != EFI_SUCCESS) {
 		efi_st_error("FreePool did not return EFI_SUCCESS\n");
@@ -168,6 +168,7 @@ void hdestroy_r(struct hsearch_data *htab)
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
+	htab->changes++;
 }
 
 /*
@@ -274,6 +275,7 @@ static inline int _compare_and_overwrite_entry(struct env_entry item,
 
 			free(htab->table[idx].entry.data);
 			htab->table[idx].entry.data = strdup(item.data);
+			htab->changes++;
 			if (!htab->table[idx].entry.data) {
 				__set_errno(ENOMEM);
 				*retval = NULL;
@@ -398,6 +400,7 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		}
 
 		++htab->filled;
+		htab->changes++;
 
 		/* This is a new entry, so look up a possible callback */
 		env_callback_init(&htab->table[idx].entry);
@@ -458,6 +461,7 @@ static void _hdelete(const char *key, struct hsearch_data *htab,
 	htab->table[idx].used = USED_DELETED;
 
 	--htab->filled;
+	htab->changes++;
 }
 
 int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
@@ -31,6 +31,25 @@
 # define ARP_TIMEOUT_COUNT	CONFIG_NET_RETRY_COUNT
 #endif
 
+#ifdef CONFIG_NET_ARP_CACHE
+/**
+ * struct arp_cache_entry - MAC address found by ARP, for reuse
+ *
+ * @ip:		IP address which was asked for, zero if the entry is free
+ * @ethaddr:	MAC address in the reply
+ * @time:	get_timer() value when the reply came
+ */
+struct arp_cache_entry {
+	struct in_addr ip;
+	uchar ethaddr[ARP_HLEN];
+	ulong time;
+};
+
+static struct arp_cache_entry arp_cache[CONFIG_NET_ARP_CACHE_SIZE];
+/* Our MAC address when the cache was filled */
+static uchar arp_cache_our_ethaddr[ARP_HLEN];
+#endif
+
 struct in_addr net_arp_wait_packet_ip;
 static struct in_addr net_arp_wait_reply_ip;
 /* MAC address of waiting packet's destination */
@@ -82,23 +101,114 @@ void arp_raw_request(struct in_addr source_ip, const uchar *target_ethaddr,
 	net_send_packet(arp_tx_packet, eth_hdr_size + ARP_HDR_SIZE);
 }
 
+/* Get the address to ask for to reach @ip, the gateway if it is off our net */
+static struct in_addr arp_next_hop(struct in_addr ip)
+{
+	if ((ip.s_addr & net_netmask.s_addr) !=
+	    (net_ip.s_addr & net_netmask.s_addr) && net_gateway.s_addr)
+		return net_gateway;
+
+	return ip;
+}
+
 void arp_request(void)
 {
 	if ((net_arp_wait_packet_ip.s_addr & net_netmask.s_addr) !=
-	    (net_ip.s_addr & net_netmask.s_addr)) {
-		if (net_gateway.s_addr == 0) {
-			puts("## Warning: gatewayip needed but not set\n");
-			net_arp_wait_reply_ip = net_arp_wait_packet_ip;
-		} else {
-			net_arp_wait_reply_ip = net_gateway;
+	    (net_ip.s_addr & net_netmask.s_addr) && net_gateway.s_addr == 0)
+		puts("## Warning: gatewayip needed but not set\n");
+	net_arp_wait_reply_ip = arp_next_hop(net_arp_wait_packet_ip);
+
+	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
+}
+
+#ifdef CONFIG_NET_ARP_CACHE
+static bool arp_cache_expired(struct arp_cache_entry *entry)
+{
+	return get_timer(entry->time) >= CONFIG_NET_ARP_CACHE_TTL * 1000UL;
+}
+
+static struct arp_cache_entry *arp_cache_find(struct in_addr ip)
+{
+	int i;
+
+	/* Entries are only good for the interface which asked */
+	if (memcmp(arp_cache_our_ethaddr, net_ethaddr, ARP_HLEN)) {
+		arp_cache_flush();
+		memcpy(arp_cache_our_ethaddr, net_ethaddr, ARP_HLEN);
+		return NULL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(arp_cache); i++) {
+		if (arp_cache[i].ip.s_addr == ip.s_addr)
+			return &arp_cache[i];
+	}
+
+	return NULL;
+}
+
+bool arp_cache_lookup(struct in_addr ip, uchar *ethaddr)
+{
+	struct arp_cache_entry *entry;
+
+	entry = arp_cache_find(arp_next_hop(ip));
+	if (!entry)
+		return false;
+	if (arp_cache_expired(entry)) {
+		entry->ip.s_addr = 0;
+		return false;
+	}
+	debug_cond(DEBUG_DEV_PKT, "ARP cache: %pI4 is %pM\n", &entry->ip,
+		   entry->ethaddr);
+	memcpy(ethaddr, entry->ethaddr, ARP_HLEN);
+
+	return true;
+}
+
+void arp_cache_add(struct in_addr ip, const uchar *ethaddr)
+{
+	struct arp_cache_entry *entry;
+	int i;
+
+	if (!ip.s_addr)
+		return;
+
+	entry = arp_cache_find(ip);
+	if (!entry) {
+		/* Use a free entry if there is one, else the oldest */
+		entry = &arp_cache[0];
+		for (i = 1; i < ARRAY_SIZE(arp_cache) && entry->ip.s_addr;
+		     i++) {
+			if (!arp_cache[i].ip.s_addr ||
+			    get_timer(arp_cache[i].time) >
+			    get_timer(entry->time))
+				entry = &arp_cache[i];
 		}
-	} else {
-		net_arp_wait_reply_ip = net_arp_wait_packet_ip;
 	}
+	entry->ip = ip;
+	memcpy(entry->ethaddr, ethaddr, ARP_HLEN);
+	entry->time = get_timer(0);
+}
 
-	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
+void arp_cache_flush(void)
+{
+	memset(arp_cache, '\0', sizeof(arp_cache));
 }
 
+void arp_cache_show(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(arp_cache); i++) {
+		if (!arp_cache[i].ip.s_addr || arp_cache_expired(&arp_cache[i]))
+			continue;
+		printf("%-15pI4 %pM %lus\n", &arp_cache[i].ip,
+		       arp_cache[i].ethaddr,
+		       CONFIG_NET_ARP_CACHE_TTL -
+		       get_timer(arp_cache[i].time) / 1000);
+	}
+}
+#endif
+
 int arp_timeout_check(void)
 {
 	ulong t;
@@ -168,6 +278,8 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 		debug_cond(DEBUG_DEV_PKT, "Got ARP REQUEST, return our IP\n");
 		eth_hdr_size = net_update_ether(et, et->et_src, PROT_ARP);
 		arp->ar_op = htons(ARPOP_REPLY);
+		/* The sender is likely to be one we talk to next */
+		arp_cache_add(net_read_ip(&arp->ar_spa), &arp->ar_sha);
 		memcpy(&arp->ar_tha, &arp->ar_sha, ARP_HLEN);
 		net_copy_ip(&arp->ar_tpa, &arp->ar_spa);
 		memcpy(&arp->ar_sha, net_ethaddr, ARP_HLEN);
@@ -215,6 +327,7 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 			if (arp_wait_packet_ethaddr != NULL)
 				memcpy(arp_wait_packet_ethaddr,
 				       &arp->ar_sha, ARP_HLEN);
+			arp_cache_add(reply_ip_addr, &arp->ar_sha);
 
 			net_get_arp_handler()((uchar *)arp, 0, reply_ip_addr,
 					      0, len);
@@ -29,4 +29,35 @@ void arp_raw_request(struct in_addr source_ip, const uchar *targetEther,
 int arp_timeout_check(void);
 void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len);
 
+#ifdef CONFIG_NET_ARP_CACHE
+/**
+ * arp_cache_lookup() - Look for a MAC address found by an earlier ARP
+ *
+ * @ip:		Address to send to, which is looked up as the gateway if it
+ *		is not on our network
+ * @ethaddr:	Returns the MAC address, if found
+ * Return: true if found, false if ARP is needed
+ */
+bool arp_cache_lookup(struct in_addr ip, uchar *ethaddr);
+
+/**
+ * arp_cache_add() - Remember the MAC address for an IP address
+ *
+ * Once the cache is full, the oldest entry makes way.
+ *
+ * @ip:		IP address
+ * @ethaddr:	Its MAC address
+ */
+void arp_cache_add(struct in_addr ip, const uchar *ethaddr);
+#else
+static inline bool arp_cache_lookup(struct in_addr ip, uchar *ethaddr)
+{
+	return false;
+}
+
+static inline void arp_cache_add(struct in_addr ip, const uchar *ethaddr)
+{
+}
+#endif
+
 #endif /* __ARP_H__ */
@@ -78,6 +78,24 @@ static u8 dhcp_option_overload;
 static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			unsigned src, unsigned len);
 
+#ifdef CONFIG_DHCP_LEASE_REUSE
+/* Requests for the address of our lease before starting again */
+#define DHCP_REBOOT_COUNT	3
+/* Milliseconds to wait for an answer to each */
+#define DHCP_REBOOT_TIMEOUT	1000UL
+
+/* The acknowledgement which gave us our lease */
+static uchar dhcp_lease_ack[PKTSIZE];
+/* Its length, 0 if we have no lease */
+static unsigned int dhcp_lease_len;
+/* MAC address which sent it */
+static uchar dhcp_lease_ethaddr[ARP_HLEN];
+/* get_timer() value when it came */
+static ulong dhcp_lease_start;
+/* Lease time in seconds */
+static u32 dhcp_lease_secs;
+#endif
+
 /* For Debug */
 #if 0
 static char *dhcpmsg2str(int type)
@@ -720,6 +738,26 @@ void bootp_reset(void)
 	bootp_timeout = 250;
 }
 
+/* Make a new ID for a request, in network byte order, and expect it back */
+static u32 bootp_new_id(void)
+{
+	u32 id;
+
+	/*
+	 *	Bootp ID is the lower 4 bytes of our ethernet address
+	 *	plus the current time in ms.
+	 */
+	id = ((u32)net_ethaddr[2] << 24)
+		| ((u32)net_ethaddr[3] << 16)
+		| ((u32)net_ethaddr[4] << 8)
+		| (u32)net_ethaddr[5];
+	id += get_timer(0);
+	id = htonl(id);
+	bootp_add_id(id);
+
+	return id;
+}
+
 void bootp_request(void)
 {
 	uchar *pkt, *iphdr;
@@ -804,17 +842,7 @@ void bootp_request(void)
 	extlen = bootp_extended((u8 *)bp->bp_vend);
 #endif
 
-	/*
-	 *	Bootp ID is the lower 4 bytes of our ethernet address
-	 *	plus the current time in ms.
-	 */
-	bootp_id = ((u32)net_ethaddr[2] << 24)
-		| ((u32)net_ethaddr[3] << 16)
-		| ((u32)net_ethaddr[4] << 8)
-		| (u32)net_ethaddr[5];
-	bootp_id += get_timer(0);
-	bootp_id = htonl(bootp_id);
-	bootp_add_id(bootp_id);
+	bootp_id = bootp_new_id();
 	net_copy_u32(&bp->bp_id, &bootp_id);
 
 	/*
@@ -979,13 +1007,13 @@ static int dhcp_message_type(unsigned char *popt)
 	return -1;
 }
 
-static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
+static void dhcp_send_request_packet(u32 id, struct in_addr server_ip,
+				     struct in_addr requested_ip)
 {
 	uchar *pkt, *iphdr;
 	struct bootp_hdr *bp;
 	int pktlen, iplen, extlen;
 	int eth_hdr_size;
-	struct in_addr offered_ip;
 	struct in_addr zero_ip;
 	struct in_addr bcast_ip;
 
@@ -1018,20 +1046,11 @@ static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
 	memcpy(bp->bp_chaddr, net_ethaddr, 6);
 	copy_filename(bp->bp_file, net_boot_file_name, sizeof(bp->bp_file));
 
-	/*
-	 * ID is the id of the OFFER packet
-	 */
+	net_copy_u32(&bp->bp_id, &id);
 
-	net_copy_u32(&bp->bp_id, &bp_offer->bp_id);
-
-	/*
-	 * Copy options from OFFER packet if present
-	 */
-
-	/* Copy offered IP into the parameters request list */
-	net_copy_ip(&offered_ip, &bp_offer->bp_yiaddr);
+	/* Put the requested IP into the parameters request list */
 	extlen = dhcp_extended((u8 *)bp->bp_vend, DHCP_REQUEST,
-		dhcp_server_ip, offered_ip);
+		server_ip, requested_ip);
 
 	iplen = BOOTP_HDR_SIZE - OPT_FIELD_SIZE + extlen;
 	pktlen = eth_hdr_size + IP_UDP_HDR_SIZE + iplen;
@@ -1045,6 +1064,24 @@ static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
 	net_send_packet(net_tx_packet, pktlen);
 }
 
+#ifdef CONFIG_DHCP_LEASE_REUSE
+/* Keep the acknowledgement of our lease, to use the lease again */
+static void dhcp_lease_save(struct bootp_hdr *bp, unsigned int len)
+{
+	if (!dhcp_leasetime)
+		return;
+
+	/* The end options after it stop parsing going past the copy */
+	memset(dhcp_lease_ack, 0xff, sizeof(dhcp_lease_ack));
+	dhcp_lease_len = min_t(unsigned int, len, sizeof(dhcp_lease_ack));
+	memcpy(dhcp_lease_ack, bp, dhcp_lease_len);
+	memcpy(dhcp_lease_ethaddr,
+	       ((struct ethernet_hdr *)net_rx_packet)->et_src, ARP_HLEN);
+	dhcp_lease_start = get_timer(0);
+	dhcp_lease_secs = ntohl(dhcp_leasetime);
+}
+#endif
+
 /*
  *	Handle DHCP received packets.
  */
@@ -1052,6 +1089,7 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 unsigned src, unsigned len)
 {
 	struct bootp_hdr *bp = (struct bootp_hdr *)pkt;
+	struct in_addr offered_ip;
 
 	debug("DHCPHandler: got packet: (src=%d, dst=%d, len=%d) state: %d\n",
 	      src, dest, len, dhcp_state);
@@ -1063,6 +1101,17 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	debug("DHCPHandler: got DHCP packet: (src=%d, dst=%d, len=%d) state: "
 	      "%d\n", src, dest, len, dhcp_state);
 
+#ifdef CONFIG_DHCP_LEASE_REUSE
+	if (dhcp_state == REBOOTING &&
+	    dhcp_message_type((u8 *)bp->bp_vend) == DHCP_NAK) {
+		puts("DHCP server refused our lease; starting again\n");
+		dhcp_lease_len = 0;
+		bootp_try = 0;
+		bootp_request();
+		return;
+	}
+#endif
+
 	if (net_read_ip(&bp->bp_yiaddr).s_addr == 0) {
 #if defined(CONFIG_SERVERIP_FROM_PROXYDHCP)
 		store_bootp_params(bp);
@@ -1097,7 +1146,10 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			dhcp_state = REQUESTING;
 
 			net_set_timeout_handler(5000, bootp_timeout_handler);
-			dhcp_send_request_packet(bp);
+			/* The request has the ID of the offer */
+			net_copy_ip(&offered_ip, &bp->bp_yiaddr);
+			dhcp_send_request_packet(net_read_u32(&bp->bp_id),
+						 dhcp_server_ip, offered_ip);
 #ifdef CONFIG_SYS_BOOTFILE_PREFIX
 		}
 #endif	/* CONFIG_SYS_BOOTFILE_PREFIX */
@@ -1105,12 +1157,20 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		return;
 		break;
 	case REQUESTING:
-		debug("DHCP State: REQUESTING\n");
+	case REBOOTING:
+		debug("DHCP State: %s\n",
+		      dhcp_state == REBOOTING ? "REBOOTING" : "REQUESTING");
 
 		if (dhcp_message_type((u8 *)bp->bp_vend) == DHCP_ACK) {
 			dhcp_packet_process_options(bp);
+			/* Without an offer, the EFI loader gets the ACK */
+			if (dhcp_state == REBOOTING)
+				efi_net_set_dhcp_ack(pkt, len);
 			/* Store net params from reply */
 			store_net_params(bp);
+#ifdef CONFIG_DHCP_LEASE_REUSE
+			dhcp_lease_save(bp, len);
+#endif
 			dhcp_state = BOUND;
 			printf("DHCP client bound to address %pI4 (%lu ms)\n",
 			       &net_ip, get_timer(bootp_start));
@@ -1131,8 +1191,77 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	}
 }
 
+#ifdef CONFIG_DHCP_LEASE_REUSE
+static void dhcp_reboot_request(void);
+
+static void dhcp_reboot_timeout_handler(void)
+{
+	if (bootp_try >= DHCP_REBOOT_COUNT) {
+		puts("\nNo answer for our lease; starting again\n");
+		dhcp_lease_len = 0;
+		bootp_try = 0;
+		bootp_request();
+		return;
+	}
+	dhcp_reboot_request();
+}
+
+/*
+ * Ask for the address of our lease again, without discovery. This is the
+ * INIT-REBOOT state of RFC 2131.
+ */
+static void dhcp_reboot_request(void)
+{
+	struct bootp_hdr *bp = (struct bootp_hdr *)dhcp_lease_ack;
+	struct in_addr lease_ip, zero_ip;
+
+	net_copy_ip(&lease_ip, &bp->bp_yiaddr);
+	zero_ip.s_addr = 0;
+	printf("DHCP request for %pI4 %d\n", &lease_ip, ++bootp_try);
+
+	dhcp_state = REBOOTING;
+	net_set_udp_handler(dhcp_handler);
+	net_set_timeout_handler(DHCP_REBOOT_TIMEOUT,
+				dhcp_reboot_timeout_handler);
+	dhcp_send_request_packet(bootp_new_id(), zero_ip, lease_ip);
+}
+
+/* Take our settings from the acknowledgement of our lease again */
+static void dhcp_lease_reuse(void)
+{
+	struct bootp_hdr *bp = (struct bootp_hdr *)dhcp_lease_ack;
+
+	dhcp_packet_process_options(bp);
+	efi_net_set_dhcp_ack(dhcp_lease_ack, dhcp_lease_len);
+	store_net_params(bp);
+	memcpy(net_server_ethaddr, dhcp_lease_ethaddr, ARP_HLEN);
+	dhcp_state = BOUND;
+	printf("DHCP client reusing lease for %pI4 (%lu s left)\n", &net_ip,
+	       dhcp_lease_secs - get_timer(dhcp_lease_start) / 1000);
+	bootstage_mark_name(BOOTSTAGE_ID_BOOTP_STOP, "bootp_stop");
+
+	net_auto_load();
+}
+#endif
+
 void dhcp_request(void)
 {
+#ifdef CONFIG_DHCP_LEASE_REUSE
+	struct bootp_hdr *bp = (struct bootp_hdr *)dhcp_lease_ack;
+
+	/* A lease is only ours on the interface which asked for it */
+	if (dhcp_lease_len && !memcmp(bp->bp_chaddr, net_ethaddr, HWL_ETHER)) {
+		bootstage_mark_name(BOOTSTAGE_ID_BOOTP_START, "bootp_start");
+		/* Until the renewal time (T1) the lease is used as it is */
+		if (dhcp_lease_secs == 0xffffffff ||
+		    get_timer(dhcp_lease_start) / 1000 < dhcp_lease_secs / 2)
+			dhcp_lease_reuse();
+		else
+			dhcp_reboot_request();
+		return;
+	}
+#endif
+	dhcp_leasetime = 0;
 	bootp_request();
 }
 #endif	/* CONFIG_CMD_DHCP */
@@ -26,10 +26,12 @@ DECLARE_GLOBAL_DATA_PTR;
  * struct eth_device_priv - private structure for each Ethernet device
  *
  * @state: The state of the Ethernet MAC driver (defined by enum eth_state_t)
+ * @stats: Packet counters
  */
 struct eth_device_priv {
 	enum eth_state_t state;
 	bool running;
+	struct eth_stats stats;
 };
 
 /**
@@ -354,9 +356,63 @@ int eth_is_active(struct udevice *dev)
 	return priv->state == ETH_STATE_ACTIVE;
 }
 
-int eth_send(void *packet, int length)
+struct eth_stats *eth_get_stats(struct udevice *dev)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	return &priv->stats;
+}
+
+void eth_count_rx_dropped(void)
+{
+	struct udevice *current = eth_get_dev();
+
+	if (current)
+		eth_get_stats(current)->rx_dropped++;
+}
+
+/* Count a received packet by its destination and protocol */
+static void eth_count_rx(struct eth_stats *stats, uchar *packet, int len)
+{
+	struct ethernet_hdr *et = (struct ethernet_hdr *)packet;
+	struct ip_udp_hdr *ip = (struct ip_udp_hdr *)(packet + ETHER_HDR_SIZE);
+
+	stats->rx_packets++;
+	stats->rx_bytes += len;
+	if (len < ETHER_HDR_SIZE) {
+		stats->rx_other++;
+		return;
+	}
+	if (is_broadcast_ethaddr(et->et_dest))
+		stats->rx_broadcast++;
+	else if (is_multicast_ethaddr(et->et_dest))
+		stats->rx_multicast++;
+
+	switch (ntohs(et->et_protlen)) {
+	case PROT_ARP:
+		stats->rx_arp++;
+		break;
+	case PROT_IP:
+		if (len >= ETHER_HDR_SIZE + IP_HDR_SIZE &&
+		    ip->ip_p == IPPROTO_UDP)
+			stats->rx_udp++;
+		else if (len >= ETHER_HDR_SIZE + IP_HDR_SIZE &&
+			 ip->ip_p == IPPROTO_ICMP)
+			stats->rx_icmp++;
+		else
+			stats->rx_other++;
+		break;
+	default:
+		stats->rx_other++;
+		break;
+	}
+}
+
+int eth_send_info(void *packet, int length, const struct eth_pkt_info *info)
 {
 	struct udevice *current;
+	struct eth_stats *stats;
+	struct eth_ops *ops;
 	int ret;
 
 	current = eth_get_dev();
@@ -366,10 +422,19 @@ int eth_send(void *packet, int length)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
-	ret = eth_get_ops(current)->send(current, packet, length);
+	stats = eth_get_stats(current);
+	ops = eth_get_ops(current);
+	if (info && ops->send_info)
+		ret = ops->send_info(current, packet, length, info);
+	else
+		ret = ops->send(current, packet, length);
 	if (ret < 0) {
+		stats->tx_errors++;
 		/* We cannot completely return the error at present */
 		debug("%s: send() returned error %d\n", __func__, ret);
+	} else {
+		stats->tx_packets++;
+		stats->tx_bytes += length;
 	}
 #if defined(CONFIG_CMD_PCAP)
 	if (ret >= 0)
@@ -378,9 +443,105 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+int eth_send(void *packet, int length)
+{
+	return eth_send_info(packet, length, NULL);
+}
+
+int eth_get_offload(void)
+{
+	struct udevice *current;
+
+	current = eth_get_dev();
+	if (!current || !eth_get_ops(current)->get_offload)
+		return 0;
+
+	return eth_get_ops(current)->get_offload(current);
+}
+
+int eth_mcast_join(struct in_addr mcast_ip, int join)
+{
+	struct udevice *current;
+	u8 mcast_mac[ARP_HLEN];
+	u32 group = ntohl(mcast_ip.s_addr);
+
+	current = eth_get_dev();
+	if (!current)
+		return -ENODEV;
+	if (!eth_get_ops(current)->mcast)
+		return -ENOSYS;
+
+	/* The low 23 bits of the group go in 01:00:5e:00:00:00 */
+	mcast_mac[0] = 0x01;
+	mcast_mac[1] = 0x00;
+	mcast_mac[2] = 0x5e;
+	mcast_mac[3] = (group >> 16) & 0x7f;
+	mcast_mac[4] = (group >> 8) & 0xff;
+	mcast_mac[5] = group & 0xff;
+
+	return eth_get_ops(current)->mcast(current, mcast_mac, join);
+}
+
+int eth_lend_rx_buf(uchar *buf, int size)
+{
+	struct udevice *current;
+
+	current = eth_get_dev();
+	if (!current)
+		return -ENODEV;
+
+	if (!eth_is_active(current))
+		return -EINVAL;
+
+	if (!eth_get_ops(current)->lend_rx_buf)
+		return -ENOSYS;
+
+	return eth_get_ops(current)->lend_rx_buf(current, buf, size);
+}
+
+/* Count and process a received packet, along with its offload metadata */
+static void eth_rx_packet(struct udevice *current, struct eth_stats *stats,
+			  uchar *packet, int len)
+{
+	struct eth_ops *ops = eth_get_ops(current);
+	struct eth_pkt_info info = {};
+
+	eth_count_rx(stats, packet, len);
+	if (ops->get_rx_info)
+		ops->get_rx_info(current, packet, len, &info);
+	net_process_received_packet_info(packet, len, &info);
+}
+
+/* Receive and process a batch of packets with the recv_batch() operation */
+static int eth_rx_batch(struct udevice *current, struct eth_stats *stats)
+{
+	struct eth_ops *ops = eth_get_ops(current);
+	uchar *packets[ETH_PACKETS_BATCH_RECV];
+	int lens[ETH_PACKETS_BATCH_RECV];
+	int count, i;
+
+	count = ops->recv_batch(current, ETH_RECV_CHECK_DEVICE, packets, lens,
+				ETH_PACKETS_BATCH_RECV);
+	if (count <= 0)
+		return count;
+	if (count == ETH_PACKETS_BATCH_RECV)
+		stats->rx_full_batches++;
+
+	for (i = 0; i < count; i++) {
+		eth_rx_packet(current, stats, packets[i], lens[i]);
+	}
+	if (ops->free_pkt) {
+		for (i = 0; i < count; i++)
+			ops->free_pkt(current, packets[i], lens[i]);
+	}
+
+	return count;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
+	struct eth_stats *stats;
 	uchar *packet;
 	int flags;
 	int ret;
@@ -393,21 +554,31 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
-	/* Process up to 32 packets at one time */
-	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
-		ret = eth_get_ops(current)->recv(current, flags, &packet);
-		flags = 0;
-		if (ret > 0)
-			net_process_received_packet(packet, ret);
-		if (ret >= 0 && eth_get_ops(current)->free_pkt)
-			eth_get_ops(current)->free_pkt(current, packet, ret);
-		if (ret <= 0)
-			break;
+	stats = eth_get_stats(current);
+	if (eth_get_ops(current)->recv_batch) {
+		ret = eth_rx_batch(current, stats);
+	} else {
+		/* Process up to 32 packets at one time */
+		flags = ETH_RECV_CHECK_DEVICE;
+		for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
+			ret = eth_get_ops(current)->recv(current, flags,
+							 &packet);
+			flags = 0;
+			if (ret > 0)
+				eth_rx_packet(current, stats, packet, ret);
+			if (ret >= 0 && eth_get_ops(current)->free_pkt)
+				eth_get_ops(current)->free_pkt(current, packet,
+							       ret);
+			if (ret <= 0)
+				break;
+		}
+		if (i == ETH_PACKETS_BATCH_RECV)
+			stats->rx_full_batches++;
 	}
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
+		stats->rx_errors++;
 		/* We cannot completely return the error at present */
 		debug("%s: recv() returned error %d\n", __func__, ret);
 	}
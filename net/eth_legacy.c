@@ -373,6 +373,17 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+int eth_send_info(void *packet, int length, const struct eth_pkt_info *info)
+{
+	/* Legacy drivers have no offloads, so there is nothing to ask for */
+	return eth_send(packet, length);
+}
+
+int eth_get_offload(void)
+{
+	return 0;
+}
+
 int eth_rx(void)
 {
 	if (!eth_current)
@@ -381,6 +392,11 @@ int eth_rx(void)
 	return eth_current->recv(eth_current);
 }
 
+int eth_lend_rx_buf(uchar *buf, int size)
+{
+	return -ENOSYS;
+}
+
 #ifdef CONFIG_API
 static void eth_save_packet(void *packet, int length)
 {
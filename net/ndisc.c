@@ -0,0 +1,370 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Neighbour discovery for IPv6 (RFC 4861) and stateless address
+ * autoconfiguration (RFC 4862)
+ *
+ * Like ARP, only the address of one next hop is looked for at a time, for
+ * the packet waiting in net_tx_packet, and nothing is cached.
+ */
+
+#include <common.h>
+#include <env.h>
+#include <log.h>
+#include <net.h>
+#include <net6.h>
+#include <ndisc.h>
+
+/* Milliseconds before soliciting again, RETRANS_TIMER in RFC 4861 */
+#define ND_TIMEOUT		1000UL
+/* Number of solicitations before giving up, MAX_MULTICAST_SOLICIT */
+#define ND_TIMEOUT_COUNT	3
+
+/*
+ * Milliseconds between router solicitations. This is shorter than the
+ * RTR_SOLICITATION_INTERVAL of RFC 4861, so as not to hold up booting.
+ */
+#define ND_RS_TIMEOUT		1000UL
+/* Number of router solicitations, MAX_RTR_SOLICITATIONS */
+#define ND_RS_COUNT		3
+
+/* Length of the prefix from which we make an address, in bits */
+#define ND_SLAAC_PREFIX_LEN	64
+
+static const struct in6_addr all_routers_ip6 = {
+	.s6_addr = { 0xff, 0x02, [15] = 0x02 },
+};
+
+/* Next hop whose MAC address is wanted, 0 if none */
+static struct in6_addr ndisc_wait_reply_ip;
+/* MAC address of waiting packet's destination */
+static uchar *ndisc_wait_packet_ethaddr;
+static int ndisc_wait_tx_packet_size;
+static ulong ndisc_wait_timer_start;
+static int ndisc_wait_try;
+/* Number of router solicitations sent, 0 if not soliciting */
+static int ndisc_rs_try;
+uchar *ndisc_tx_packet;
+static uchar ndisc_tx_packet_buf[PKTSIZE_ALIGN + PKTALIGN];
+
+void ndisc_init(void)
+{
+	ndisc_wait_packet_ethaddr = NULL;
+	ndisc_wait_reply_ip = net_null_addr_ip6;
+	ndisc_wait_tx_packet_size = 0;
+	ndisc_rs_try = 0;
+	ndisc_tx_packet = &ndisc_tx_packet_buf[0] + (PKTALIGN - 1);
+	ndisc_tx_packet -= (ulong)ndisc_tx_packet % PKTALIGN;
+}
+
+/* Get where the ICMPv6 message goes in a packet we send */
+static void *ndisc_msg(uchar *pkt)
+{
+	return pkt + net_eth_hdr_size() + IP6_HDR_SIZE;
+}
+
+static int ndisc_add_lladdr_opt(u8 *opt, int type)
+{
+	opt[0] = type;
+	opt[1] = ND_OPT_LLADDR_SIZE / 8;
+	memcpy(&opt[2], net_ethaddr, ARP_HLEN);
+
+	return ND_OPT_LLADDR_SIZE;
+}
+
+/* Find the next option of a type, from @opt on, NULL if there is none */
+static u8 *ndisc_find_opt(u8 *opt, u8 *end, int type)
+{
+	int len;
+
+	while (end - opt >= 2) {
+		len = opt[1] * 8;
+		if (!len || len > end - opt)
+			return NULL;
+		if (opt[0] == type)
+			return opt;
+		opt += len;
+	}
+
+	return NULL;
+}
+
+/* Add the headers to the ICMPv6 message in @pkt and send it */
+static void ndisc_send(uchar *pkt, const struct in6_addr *src,
+		       const struct in6_addr *dest, const uchar *ether,
+		       int len)
+{
+	struct icmp6_hdr *icmp = ndisc_msg(pkt);
+	int eth_hdr_size;
+
+	eth_hdr_size = net_set_ether(pkt, ether, PROT_IPV6);
+	ip6_add_hdr(pkt + eth_hdr_size, src, dest, IPPROTO_ICMPV6,
+		    IP6_ND_HOP_LIMIT, len);
+	icmp->icmp6_cksum = 0;
+	icmp->icmp6_cksum = htons(net_ip6_csum(src, dest, len, IPPROTO_ICMPV6,
+					       icmp));
+
+	net_send_packet(pkt, eth_hdr_size + IP6_HDR_SIZE + len);
+}
+
+static void ndisc_request(void)
+{
+	struct nd_msg *ns = ndisc_msg(ndisc_tx_packet);
+	struct in6_addr snma;
+	uchar ether[ARP_HLEN];
+	int len;
+
+	debug_cond(DEBUG_DEV_PKT, "NS for %pI6c %d\n", &ndisc_wait_reply_ip,
+		   ndisc_wait_try);
+
+	memset(&ns->icmph, '\0', ICMP6_HDR_SIZE);
+	ns->icmph.icmp6_type = ICMPV6_NEIGHBOUR_SOL;
+	ns->target = ndisc_wait_reply_ip;
+	len = sizeof(*ns) + ndisc_add_lladdr_opt(ns->opt,
+						 ND_OPT_SOURCE_LL_ADDR);
+
+	ip6_make_snma(&snma, &ndisc_wait_reply_ip);
+	ip6_make_mult_ethdstaddr(ether, &snma);
+	ndisc_send(ndisc_tx_packet, net_ip6_src(&ndisc_wait_reply_ip), &snma,
+		   ether, len);
+}
+
+void ndisc_wait(uchar *ether, const struct in6_addr *dest, int len)
+{
+	bool on_link;
+
+	on_link = ip6_is_link_local(dest) ||
+		(!ip6_is_unspecified_addr(&net_ip6) &&
+		 ip6_addr_in_subnet(&net_ip6, dest, net_prefix_length));
+	if (on_link) {
+		ndisc_wait_reply_ip = *dest;
+	} else if (ip6_is_unspecified_addr(&net_gateway6)) {
+		puts("## Warning: gatewayip6 needed but not set\n");
+		ndisc_wait_reply_ip = *dest;
+	} else {
+		ndisc_wait_reply_ip = net_gateway6;
+	}
+
+	ndisc_wait_packet_ethaddr = ether;
+	ndisc_wait_tx_packet_size = len;
+	ndisc_wait_try = 1;
+	ndisc_wait_timer_start = get_timer(0);
+	ndisc_request();
+}
+
+bool ndisc_is_waiting(void)
+{
+	return !!ndisc_wait_tx_packet_size;
+}
+
+void ndisc_cancel(void)
+{
+	ndisc_wait_tx_packet_size = 0;
+	ndisc_wait_packet_ethaddr = NULL;
+	ndisc_rs_try = 0;
+}
+
+int ndisc_timeout_check(void)
+{
+	ulong t;
+
+	if (!ndisc_is_waiting())
+		return 0;
+
+	t = get_timer(0);
+	if (t - ndisc_wait_timer_start > ND_TIMEOUT) {
+		ndisc_wait_try++;
+
+		if (ndisc_wait_try > ND_TIMEOUT_COUNT) {
+			puts("\nNeighbour discovery retry count exceeded; starting again\n");
+			ndisc_cancel();
+			net_set_state(NETLOOP_FAIL);
+		} else {
+			ndisc_wait_timer_start = t;
+			ndisc_request();
+		}
+	}
+
+	return 1;
+}
+
+/* Answer a solicitation for one of our addresses */
+static int ndisc_receive_ns(struct ethernet_hdr *et, struct ip6_hdr *ip6,
+			    int len)
+{
+	struct nd_msg *ns = (struct nd_msg *)(ip6 + 1);
+	struct nd_msg *na;
+	uchar *tx_packet;
+
+	if (len < sizeof(*ns))
+		return -EINVAL;
+	/* Duplicate address detection by another host is not answered */
+	if (!ip6_is_our_addr(&ns->target) ||
+	    ip6_is_unspecified_addr(&ip6->saddr))
+		return 0;
+
+	debug_cond(DEBUG_DEV_PKT, "Got NS for %pI6c, return our MAC\n",
+		   &ns->target);
+
+	tx_packet = net_get_async_tx_pkt_buf();
+	na = ndisc_msg(tx_packet);
+	memset(&na->icmph, '\0', ICMP6_HDR_SIZE);
+	na->icmph.icmp6_type = ICMPV6_NEIGHBOUR_ADV;
+	na->icmph.un.na.flags = ND_NA_FLAG_SOLICITED | ND_NA_FLAG_OVERRIDE;
+	na->target = ns->target;
+	len = sizeof(*na) + ndisc_add_lladdr_opt(na->opt,
+						 ND_OPT_TARGET_LL_ADDR);
+	ndisc_send(tx_packet, &ns->target, &ip6->saddr, et->et_src, len);
+
+	return 0;
+}
+
+/* Send the waiting packet if this is the advertisement we want */
+static int ndisc_receive_na(struct ethernet_hdr *et, struct ip6_hdr *ip6,
+			    int len)
+{
+	struct nd_msg *na = (struct nd_msg *)(ip6 + 1);
+	u8 *opt, *ethaddr = et->et_src;
+
+	if (len < sizeof(*na))
+		return -EINVAL;
+	if (!ndisc_is_waiting() ||
+	    memcmp(&na->target, &ndisc_wait_reply_ip, IN6ADDRSZ))
+		return 0;
+
+	opt = ndisc_find_opt(na->opt, (u8 *)na + len, ND_OPT_TARGET_LL_ADDR);
+	if (opt)
+		ethaddr = &opt[2];
+	debug_cond(DEBUG_DEV_PKT, "Got NA, set eth addr (%pM)\n", ethaddr);
+
+	/* save address for later use */
+	if (ndisc_wait_packet_ethaddr)
+		memcpy(ndisc_wait_packet_ethaddr, ethaddr, ARP_HLEN);
+
+	/* set the mac address in the waiting packet's header and transmit it */
+	memcpy(((struct ethernet_hdr *)net_tx_packet)->et_dest, ethaddr,
+	       ARP_HLEN);
+	net_send_packet(net_tx_packet, ndisc_wait_tx_packet_size);
+
+	/* no neighbour solicitation pending now */
+	ndisc_wait_tx_packet_size = 0;
+	ndisc_wait_packet_ethaddr = NULL;
+
+	return 0;
+}
+
+/* Take our address from an autonomous /64 prefix, if we have none yet */
+static void ndisc_slaac(struct nd_opt_prefix_info *pi)
+{
+	char buf[IP6_STR_LEN + 4];
+
+	if (!(pi->flags & ND_PREFIX_FLAG_AUTO) || !pi->valid_lifetime ||
+	    pi->prefix_len != ND_SLAAC_PREFIX_LEN ||
+	    !ip6_is_unspecified_addr(&net_ip6))
+		return;
+
+	ip6_make_eui64_addr(&net_ip6, &pi->prefix, net_ethaddr);
+	net_prefix_length = ND_SLAAC_PREFIX_LEN;
+	sprintf(buf, "%pI6c/%d", &net_ip6, net_prefix_length);
+	env_set("ip6addr", buf);
+	printf("IPv6 address: %s\n", buf);
+}
+
+/* Take our router, and perhaps our address, from an advertisement */
+static int ndisc_receive_ra(struct ethernet_hdr *et, struct ip6_hdr *ip6,
+			    int len)
+{
+	struct ra_msg *ra = (struct ra_msg *)(ip6 + 1);
+	u8 *opt, *end = (u8 *)ra + len;
+	char buf[IP6_STR_LEN];
+
+	if (len < sizeof(*ra))
+		return -EINVAL;
+	/* Routers advertise from their link-local address */
+	if (!ip6_is_link_local(&ip6->saddr))
+		return -EINVAL;
+
+	debug_cond(DEBUG_DEV_PKT, "Got RA from %pI6c\n", &ip6->saddr);
+
+	if (ra->icmph.un.ra.lifetime && ip6_is_unspecified_addr(&net_gateway6)) {
+		net_gateway6 = ip6->saddr;
+		sprintf(buf, "%pI6c", &net_gateway6);
+		env_set("gatewayip6", buf);
+	}
+
+	for (opt = ndisc_find_opt(ra->opt, end, ND_OPT_PREFIX_INFO); opt;
+	     opt = ndisc_find_opt(opt + opt[1] * 8, end, ND_OPT_PREFIX_INFO)) {
+		if (opt[1] * 8 < sizeof(struct nd_opt_prefix_info))
+			return -EINVAL;
+		ndisc_slaac((struct nd_opt_prefix_info *)opt);
+	}
+
+	if (ndisc_rs_try && !ip6_is_unspecified_addr(&net_ip6)) {
+		ndisc_rs_try = 0;
+		net_set_state(NETLOOP_SUCCESS);
+	}
+
+	return 0;
+}
+
+int ndisc_receive(struct ethernet_hdr *et, struct ip6_hdr *ip6, int len)
+{
+	struct icmp6_hdr *icmp = (struct icmp6_hdr *)(ip6 + 1);
+
+	/* Only accept messages which cannot have passed through a router */
+	if (ip6->hop_limit != IP6_ND_HOP_LIMIT || icmp->icmp6_code)
+		return -EINVAL;
+
+	switch (icmp->icmp6_type) {
+	case ICMPV6_NEIGHBOUR_SOL:
+		return ndisc_receive_ns(et, ip6, len);
+	case ICMPV6_NEIGHBOUR_ADV:
+		return ndisc_receive_na(et, ip6, len);
+	case ICMPV6_ROUTER_ADV:
+		return ndisc_receive_ra(et, ip6, len);
+	default:
+		return 0;
+	}
+}
+
+static void ndisc_send_rs(void)
+{
+	struct rs_msg *rs = ndisc_msg(ndisc_tx_packet);
+	uchar ether[ARP_HLEN];
+	int len;
+
+	debug_cond(DEBUG_DEV_PKT, "RS %d\n", ndisc_rs_try);
+
+	memset(&rs->icmph, '\0', ICMP6_HDR_SIZE);
+	rs->icmph.icmp6_type = ICMPV6_ROUTER_SOL;
+	len = sizeof(*rs) + ndisc_add_lladdr_opt(rs->opt,
+						 ND_OPT_SOURCE_LL_ADDR);
+
+	ip6_make_mult_ethdstaddr(ether, &all_routers_ip6);
+	ndisc_send(ndisc_tx_packet, &net_link_local_ip6, &all_routers_ip6,
+		   ether, len);
+}
+
+static void ndisc_rs_timeout_handler(void)
+{
+	if (!ndisc_rs_try)
+		return;
+
+	if (ndisc_rs_try >= ND_RS_COUNT) {
+		ndisc_rs_try = 0;
+		puts("\nNo router advertisement received\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	ndisc_rs_try++;
+	ndisc_send_rs();
+	net_set_timeout_handler(ND_RS_TIMEOUT, ndisc_rs_timeout_handler);
+}
+
+void ndisc_start(void)
+{
+	printf("Using %s device\n", eth_get_name());
+	ndisc_rs_try = 1;
+	ndisc_send_rs();
+	net_set_timeout_handler(ND_RS_TIMEOUT, ndisc_rs_timeout_handler);
+}
@@ -90,7 +90,9 @@
 #include <errno.h>
 #include <image.h>
 #include <log.h>
+#include <ndisc.h>
 #include <net.h>
+#include <net6.h>
 #include <net/fastboot.h>
 #include <net/tftp.h>
 #if defined(CONFIG_CMD_PCAP)
@@ -112,6 +114,7 @@
 #include "link_local.h"
 #include "nfs.h"
 #include "ping.h"
+#include "ping6.h"
 #include "rarp.h"
 #if defined(CONFIG_CMD_WOL)
 #include "wol.h"
@@ -140,6 +143,10 @@ u8 net_server_ethaddr[6];
 struct in_addr	net_ip;
 /* Server IP addr (0 = unknown) */
 struct in_addr	net_server_ip;
+#ifdef CONFIG_MCAST_TFTP
+/* Multicast group joined (0 = none) */
+struct in_addr net_mcast_addr;
+#endif
 /* Current receive packet */
 uchar *net_rx_packet;
 /* Current rx packet length */
@@ -175,6 +182,8 @@ bool net_boot_file_name_explicit;
 u32 net_boot_file_size;
 /* Boot file size in blocks as reported by the DHCP server */
 u32 net_boot_file_expected_size_in_blocks;
+/* Received payload bytes which protocols had to copy into place */
+ulong net_rx_copied;
 
 static uchar net_pkt_buf[(PKTBUFSRX+1) * PKTSIZE_ALIGN + PKTALIGN];
 /* Receive packets */
@@ -340,15 +349,17 @@ void net_auto_load(void)
 
 static int net_init_loop(void)
 {
-	if (eth_get_dev())
+	if (eth_get_dev()) {
 		memcpy(net_ethaddr, eth_get_ethaddr(), 6);
-	else
+		net_ip6_init();
+	} else {
 		/*
 		 * Not ideal, but there's no way to get the actual error, and I
 		 * don't feel like fixing all the users of eth_get_dev to deal
 		 * with errors.
 		 */
 		return -ENONET;
+	}
 
 	return 0;
 }
@@ -362,9 +373,63 @@ static void net_clear_handlers(void)
 
 static void net_cleanup_loop(void)
 {
+	net_rx_reclaim();
 	net_clear_handlers();
+#ifdef CONFIG_MCAST_TFTP
+	/* Do not stay in a group joined by an aborted download */
+	if (net_mcast_addr.s_addr)
+		eth_mcast_join(net_mcast_addr, 0);
+	net_mcast_addr.s_addr = 0;
+#endif
+}
+
+void net_store_payload(void *dest, const void *src, int len)
+{
+	if (dest == src)
+		return;
+	memmove(dest, src, len);
+	net_rx_copied += len;
+}
+
+#ifdef CONFIG_NET_RX_LEND
+/* Most bytes of headers in front of the payload in a lent buffer */
+#define NET_LEND_HDR_MAX	128
+
+/* The buffer lent to the Ethernet device and the bytes it covers */
+static uchar *net_lent_buf;
+static int net_lent_hdr_len;
+static uchar net_lent_save[NET_LEND_HDR_MAX];
+
+void net_rx_reclaim(void)
+{
+	if (!net_lent_buf)
+		return;
+
+	eth_lend_rx_buf(NULL, 0);
+	memcpy(net_lent_buf, net_lent_save, net_lent_hdr_len);
+	net_lent_buf = NULL;
 }
 
+int net_rx_lend(uchar *dest, int hdr_len, int len)
+{
+	uchar *buf = dest - hdr_len;
+	int ret;
+
+	net_rx_reclaim();
+	if (hdr_len > NET_LEND_HDR_MAX)
+		return -E2BIG;
+
+	memcpy(net_lent_save, buf, hdr_len);
+	ret = eth_lend_rx_buf(buf, hdr_len + len);
+	if (ret)
+		return ret;
+	net_lent_buf = buf;
+	net_lent_hdr_len = hdr_len;
+
+	return 0;
+}
+#endif
+
 int net_init(void)
 {
 	static int first_call = 1;
@@ -382,6 +447,7 @@ int net_init(void)
 				(i + 1) * PKTSIZE_ALIGN;
 		}
 		arp_init();
+		ndisc_init();
 		net_clear_handlers();
 
 		/* Only need to setup buffer pointers once. */
@@ -427,6 +493,7 @@ restart:
 #ifdef CONFIG_USB_KEYBOARD
 	net_busy_flag = 0;
 #endif
+	net_rx_reclaim();
 	net_set_state(NETLOOP_CONTINUE);
 
 	/*
@@ -497,6 +564,16 @@ restart:
 			ping_start();
 			break;
 #endif
+#if defined(CONFIG_CMD_PING6)
+		case PING6:
+			ping6_start();
+			break;
+#endif
+#if defined(CONFIG_IPV6)
+		case NDISC:
+			ndisc_start();
+			break;
+#endif
 #if defined(CONFIG_CMD_NFS) && !defined(CONFIG_SPL_BUILD)
 		case NFS:
 			nfs_start();
@@ -562,6 +639,8 @@ restart:
 		WATCHDOG_RESET();
 		if (arp_timeout_check() > 0)
 			time_start = get_timer(0);
+		if (ndisc_timeout_check() > 0)
+			time_start = get_timer(0);
 
 		/*
 		 *	Check the ethernet for a new packet.  The ethernet
@@ -577,6 +656,7 @@ restart:
 		if (ctrlc()) {
 			/* cancel any ARP that may not have completed */
 			net_arp_wait_packet_ip.s_addr = 0;
+			ndisc_cancel();
 
 			net_cleanup_loop();
 			eth_halt();
@@ -652,6 +732,8 @@ restart:
 			net_cleanup_loop();
 			/* Invalidate the last protocol */
 			eth_set_last_protocol(BOOTP);
+			/* An address we kept may be why it failed */
+			arp_cache_flush();
 			debug_cond(DEBUG_INT_STATE, "--- net_loop Fail!\n");
 			ret = -ENONET;
 			goto done;
@@ -805,6 +887,8 @@ uchar *net_get_async_tx_pkt_buf(void)
 {
 	if (arp_is_waiting())
 		return arp_tx_packet; /* If we are waiting, we already sent */
+	else if (ndisc_is_waiting())
+		return ndisc_tx_packet;
 	else
 		return net_tx_packet;
 }
@@ -816,6 +900,33 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 				  IPPROTO_UDP, 0, 0, 0);
 }
 
+/*
+ * Send a UDP packet, letting the device fill in the checksum. This is not
+ * done for a packet held back waiting for ARP, as the device may change.
+ */
+static void net_send_udp_csum_offload(uchar *pkt, int eth_hdr_size, int len)
+{
+	struct ip_udp_hdr *ip = (struct ip_udp_hdr *)(pkt + eth_hdr_size);
+	struct eth_pkt_info info = {
+		.flags		= ETH_PKT_CSUM_PARTIAL,
+		.csum_start	= eth_hdr_size + IP_HDR_SIZE,
+		.csum_offset	= offsetof(struct ip_udp_hdr, udp_xsum) -
+				  IP_HDR_SIZE,
+	};
+	u32 src = ntohl(net_read_ip(&ip->ip_src).s_addr);
+	u32 dst = ntohl(net_read_ip(&ip->ip_dst).s_addr);
+	u32 sum;
+
+	/* The device adds the pseudo-header checksum to that of the data */
+	sum = IPPROTO_UDP + ntohs(ip->udp_len);
+	sum += (src >> 16) + (src & 0xffff) + (dst >> 16) + (dst & 0xffff);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	ip->udp_xsum = htons(sum);
+
+	eth_send_info(pkt, len, &info);
+}
+
 int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 		       int payload_len, int proto, u8 action, u32 tcp_seq_num,
 		       u32 tcp_ack_num)
@@ -837,6 +948,10 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 	if (dest.s_addr == 0xFFFFFFFF)
 		ether = (uchar *)net_bcast_ethaddr;
 
+	/* the MAC address may be known from an earlier command */
+	if (!memcmp(ether, net_null_ethaddr, 6))
+		arp_cache_lookup(dest, ether);
+
 	pkt = (uchar *)net_tx_packet;
 
 	eth_hdr_size = net_set_ether(pkt, ether, PROT_IP);
@@ -870,7 +985,13 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 	} else {
 		debug_cond(DEBUG_DEV_PKT, "sending UDP to %pI4/%pM\n",
 			   &dest, ether);
-		net_send_packet(net_tx_packet, pkt_hdr_size + payload_len);
+		if (proto == IPPROTO_UDP &&
+		    (eth_get_offload() & ETH_OFFLOAD_TX_CSUM))
+			net_send_udp_csum_offload(pkt, eth_hdr_size,
+						  pkt_hdr_size + payload_len);
+		else
+			net_send_packet(net_tx_packet,
+					pkt_hdr_size + payload_len);
 		return 0;	/* transmitted */
 	}
 }
@@ -1074,12 +1195,14 @@ static void receive_icmp(struct ip_udp_hdr *ip, int len,
 	}
 }
 
-void net_process_received_packet(uchar *in_packet, int len)
+void net_process_received_packet_info(uchar *in_packet, int len,
+				      const struct eth_pkt_info *info)
 {
 	struct ethernet_hdr *et;
 	struct ip_udp_hdr *ip;
 	struct in_addr dst_ip;
 	struct in_addr src_ip;
+	bool csum_valid;
 	int eth_proto;
 #if defined(CONFIG_CMD_CDP)
 	int iscdp;
@@ -1097,7 +1220,7 @@ void net_process_received_packet(uchar *in_packet, int len)
 
 	/* too small packet? */
 	if (len < ETHER_HDR_SIZE)
-		return;
+		goto drop;
 
 #if defined(CONFIG_API) || defined(CONFIG_EFI_LOADER)
 	if (push_packet) {
@@ -1143,7 +1266,7 @@ void net_process_received_packet(uchar *in_packet, int len)
 
 		/* too small packet? */
 		if (len < VLAN_ETHER_HDR_SIZE)
-			return;
+			goto drop;
 
 		/* if no VLAN active */
 		if ((ntohs(net_our_vlan) & VLAN_IDMASK) == VLAN_NONE
@@ -1194,12 +1317,12 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if (len < IP_UDP_HDR_SIZE) {
 			debug("len bad %d < %lu\n", len,
 			      (ulong)IP_UDP_HDR_SIZE);
-			return;
+			goto drop;
 		}
 		/* Check the packet length */
 		if (len < ntohs(ip->ip_len)) {
 			debug("len bad %d < %d\n", len, ntohs(ip->ip_len));
-			return;
+			goto drop;
 		}
 		len = ntohs(ip->ip_len);
 		debug_cond(DEBUG_NET_PKT, "len=%d, v=%02x\n",
@@ -1207,23 +1330,29 @@ void net_process_received_packet(uchar *in_packet, int len)
 
 		/* Can't deal with anything except IPv4 */
 		if ((ip->ip_hl_v & 0xf0) != 0x40)
-			return;
+			goto drop;
 		/* Can't deal with IP options (headers != 20 bytes) */
 		if ((ip->ip_hl_v & 0x0f) > 0x05)
-			return;
+			goto drop;
 		/* Check the Checksum of the header */
 		if (!ip_checksum_ok((uchar *)ip, IP_HDR_SIZE)) {
 			debug("checksum bad\n");
-			return;
+			goto drop;
 		}
 		/* If it is not for us, ignore it */
 		dst_ip = net_read_ip(&ip->ip_dst);
 		if (net_ip.s_addr && dst_ip.s_addr != net_ip.s_addr &&
 		    dst_ip.s_addr != 0xFFFFFFFF) {
+#ifdef CONFIG_MCAST_TFTP
+			if (net_mcast_addr.s_addr != dst_ip.s_addr)
+#endif
 				return;
 		}
 		/* Read source IP address for later use */
 		src_ip = net_read_ip(&ip->ip_src);
+		/* Devices only check the checksum of unfragmented packets */
+		csum_valid = info && (info->flags & ETH_PKT_CSUM_VALID) &&
+			     !(ip->ip_off & htons(IP_OFFS | IP_FLAGS_MFRAG));
 		/*
 		 * The function returns the unchanged packet if it's not
 		 * a fragment, and either the complete packet or NULL if
@@ -1261,13 +1390,14 @@ void net_process_received_packet(uchar *in_packet, int len)
 		}
 
 		if (ntohs(ip->udp_len) < UDP_HDR_SIZE || ntohs(ip->udp_len) > ntohs(ip->ip_len))
-			return;
+			goto drop;
 
 		debug_cond(DEBUG_DEV_PKT,
 			   "received UDP (to=%pI4, from=%pI4, len=%d)\n",
 			   &dst_ip, &src_ip, len);
 
-		if (IS_ENABLED(CONFIG_UDP_CHECKSUM) && ip->udp_xsum != 0) {
+		if (IS_ENABLED(CONFIG_UDP_CHECKSUM) && ip->udp_xsum != 0 &&
+		    !csum_valid) {
 			ulong   xsum;
 			u8 *sumptr;
 			ushort  sumlen;
@@ -1297,7 +1427,7 @@ void net_process_received_packet(uchar *in_packet, int len)
 			if ((xsum != 0x00000000) && (xsum != 0x0000ffff)) {
 				printf(" UDP wrong checksum %08lx %08x\n",
 				       xsum, ntohs(ip->udp_xsum));
-				return;
+				goto drop;
 			}
 		}
 
@@ -1317,12 +1447,27 @@ void net_process_received_packet(uchar *in_packet, int len)
 				      ntohs(ip->udp_src),
 				      ntohs(ip->udp_len) - UDP_HDR_SIZE);
 		break;
+#ifdef CONFIG_IPV6
+	case PROT_IPV6:
+		if (net_ip6_handler(et, (struct ip6_hdr *)ip, len))
+			goto drop;
+		break;
+#endif
 #ifdef CONFIG_CMD_WOL
 	case PROT_WOL:
 		wol_receive(ip, len);
 		break;
 #endif
 	}
+	return;
+
+drop:
+	eth_count_rx_dropped();
+}
+
+void net_process_received_packet(uchar *in_packet, int len)
+{
+	net_process_received_packet_info(in_packet, len, NULL);
 }
 
 /**********************************************************************/
@@ -1339,6 +1484,14 @@ static int net_check_prereq(enum proto_t protocol)
 		}
 		goto common;
 #endif
+#if defined(CONFIG_CMD_PING6)
+	case PING6:
+		if (ip6_is_unspecified_addr(&net_ping_ip6)) {
+			puts("*** ERROR: ping address not given\n");
+			return 1;
+		}
+		goto ethaddr;
+#endif
 #if defined(CONFIG_CMD_DNS)
 	case DNS:
 		if (net_dns_server.s_addr == 0) {
@@ -1360,6 +1513,16 @@ static int net_check_prereq(enum proto_t protocol)
 		/* Fall through */
 	case TFTPGET:
 	case TFTPPUT:
+#if defined(CONFIG_IPV6)
+		if (net_use_ip6) {
+			if (ip6_is_unspecified_addr(&net_server_ip6) &&
+			    !is_serverip6_in_cmd()) {
+				puts("*** ERROR: `serverip6' not set\n");
+				return 1;
+			}
+			goto ethaddr;
+		}
+#endif
 		if (net_server_ip.s_addr == 0 && !is_serverip_in_cmd()) {
 			puts("*** ERROR: `serverip' not set\n");
 			return 1;
@@ -1386,6 +1549,10 @@ common:
 	case CDP:
 	case DHCP:
 	case LINKLOCAL:
+#if defined(CONFIG_IPV6)
+	case NDISC:
+ethaddr:
+#endif
 		if (memcmp(net_ethaddr, "\0\0\0\0\0\0", 6) == 0) {
 			int num = eth_get_dev_index();
 
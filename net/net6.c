@@ -0,0 +1,487 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * IPv6 support
+ *
+ * Only what is needed to boot over IPv6 is here: ICMPv6 echo, neighbour
+ * discovery (in ndisc.c) and UDP. Extension headers and fragments are not
+ * handled, so packets with them are dropped.
+ */
+
+#include <common.h>
+#include <env.h>
+#include <errno.h>
+#include <hexdump.h>
+#include <log.h>
+#include <net.h>
+#include <net6.h>
+#include <ndisc.h>
+#include <search.h>
+#include <linux/ctype.h>
+#include "ping6.h"
+
+/* Default prefix length, if 'ip6addr' does not give one */
+#define IP6_PREFIX_LEN_DEFAULT	64
+
+const struct in6_addr net_null_addr_ip6;
+
+struct in6_addr net_ip6;
+u32 net_prefix_length;
+struct in6_addr net_link_local_ip6;
+struct in6_addr net_gateway6;
+struct in6_addr net_server_ip6;
+bool net_use_ip6;
+
+static int on_ip6addr(const char *name, const char *value, enum env_op op,
+		      int flags)
+{
+	const char *slash;
+	struct in6_addr addr;
+	u32 len = IP6_PREFIX_LEN_DEFAULT;
+	int ret;
+
+	if (flags & H_PROGRAMMATIC)
+		return 0;
+
+	if (op == env_op_delete) {
+		net_ip6 = net_null_addr_ip6;
+		return 0;
+	}
+
+	slash = strchr(value, '/');
+	if (slash) {
+		len = simple_strtoul(slash + 1, NULL, 10);
+		if (len > 128)
+			return -EINVAL;
+	}
+	ret = string_to_ip6(value, slash ? slash - value : strlen(value),
+			    &addr);
+	if (ret)
+		return ret;
+	net_ip6 = addr;
+	net_prefix_length = len;
+
+	return 0;
+}
+U_BOOT_ENV_CALLBACK(ip6addr, on_ip6addr);
+
+static int on_ip6_var(struct in6_addr *addr, const char *value,
+		      enum env_op op, int flags)
+{
+	if (flags & H_PROGRAMMATIC)
+		return 0;
+
+	if (op == env_op_delete) {
+		*addr = net_null_addr_ip6;
+		return 0;
+	}
+
+	return string_to_ip6(value, strlen(value), addr);
+}
+
+static int on_gatewayip6(const char *name, const char *value, enum env_op op,
+			 int flags)
+{
+	return on_ip6_var(&net_gateway6, value, op, flags);
+}
+U_BOOT_ENV_CALLBACK(gatewayip6, on_gatewayip6);
+
+static int on_serverip6(const char *name, const char *value, enum env_op op,
+			int flags)
+{
+	return on_ip6_var(&net_server_ip6, value, op, flags);
+}
+U_BOOT_ENV_CALLBACK(serverip6, on_serverip6);
+
+int string_to_ip6(const char *str, size_t len, struct in6_addr *addr)
+{
+	const char *s = str, *end = str + len;
+	u16 groups[8];
+	int n = 0, gap = -1;
+	int i, digit, digits;
+	u32 val;
+
+	if (!str || !len)
+		return -EINVAL;
+
+	if (len >= 2 && s[0] == ':' && s[1] == ':') {
+		gap = 0;
+		s += 2;
+	}
+
+	while (s < end) {
+		val = 0;
+		for (digits = 0; s < end && isxdigit(*s); digits++, s++) {
+			digit = hex_to_bin(*s);
+			val = val << 4 | digit;
+		}
+		if (!digits || digits > 4 || n == 8)
+			return -EINVAL;
+		groups[n++] = val;
+		if (s == end)
+			break;
+		if (*s++ != ':' || s == end)
+			return -EINVAL;
+		if (*s == ':') {
+			if (gap >= 0)
+				return -EINVAL;
+			gap = n;
+			s++;
+		}
+	}
+
+	if (gap < 0 ? n != 8 : n > 7)
+		return -EINVAL;
+
+	memset(addr, '\0', IN6ADDRSZ);
+	for (i = 0; i < n; i++) {
+		if (gap < 0 || i < gap)
+			addr->s6_addr16[i] = htons(groups[i]);
+		else
+			addr->s6_addr16[8 - n + i] = htons(groups[i]);
+	}
+
+	return 0;
+}
+
+bool ip6_is_our_addr(const struct in6_addr *addr)
+{
+	if (!memcmp(addr, &net_link_local_ip6, IN6ADDRSZ))
+		return true;
+
+	return !ip6_is_unspecified_addr(&net_ip6) &&
+		!memcmp(addr, &net_ip6, IN6ADDRSZ);
+}
+
+void ip6_make_eui64_addr(struct in6_addr *addr, const struct in6_addr *prefix,
+			 const u8 enetaddr[ARP_HLEN])
+{
+	memcpy(addr->s6_addr, prefix->s6_addr, 8);
+	/* Flip the universal/local bit, per RFC 4291 appendix A */
+	addr->s6_addr[8] = enetaddr[0] ^ 0x02;
+	addr->s6_addr[9] = enetaddr[1];
+	addr->s6_addr[10] = enetaddr[2];
+	addr->s6_addr[11] = 0xff;
+	addr->s6_addr[12] = 0xfe;
+	addr->s6_addr[13] = enetaddr[3];
+	addr->s6_addr[14] = enetaddr[4];
+	addr->s6_addr[15] = enetaddr[5];
+}
+
+void ip6_make_lladdr(struct in6_addr *lladdr, const u8 enetaddr[ARP_HLEN])
+{
+	static const struct in6_addr prefix = {
+		.s6_addr = { 0xfe, 0x80 },
+	};
+
+	ip6_make_eui64_addr(lladdr, &prefix, enetaddr);
+}
+
+void ip6_make_snma(struct in6_addr *mcast, const struct in6_addr *ip6)
+{
+	/* ff02::1:ffxx:xxxx, with the low 24 bits of the address */
+	memset(mcast, '\0', IN6ADDRSZ);
+	mcast->s6_addr[0] = 0xff;
+	mcast->s6_addr[1] = 0x02;
+	mcast->s6_addr[11] = 0x01;
+	mcast->s6_addr[12] = 0xff;
+	memcpy(&mcast->s6_addr[13], &ip6->s6_addr[13], 3);
+}
+
+void ip6_make_mult_ethdstaddr(u8 enetaddr[ARP_HLEN],
+			      const struct in6_addr *mcast)
+{
+	/* 33:33 and the low 32 bits of the address, per RFC 2464 */
+	enetaddr[0] = 0x33;
+	enetaddr[1] = 0x33;
+	memcpy(&enetaddr[2], &mcast->s6_addr[12], 4);
+}
+
+bool ip6_addr_in_subnet(const struct in6_addr *our_addr,
+			const struct in6_addr *neigh_addr, u32 prefix_length)
+{
+	u32 bytes = min(prefix_length, 128U) / 8;
+	u32 bits = prefix_length % 8;
+	u8 mask;
+
+	if (memcmp(our_addr, neigh_addr, bytes))
+		return false;
+	if (bytes == IN6ADDRSZ || !bits)
+		return true;
+	mask = 0xff << (8 - bits);
+
+	return !((our_addr->s6_addr[bytes] ^ neigh_addr->s6_addr[bytes]) &
+		 mask);
+}
+
+u16 net_ip6_csum(const struct in6_addr *saddr, const struct in6_addr *daddr,
+		 u16 len, u8 proto, const void *data)
+{
+	const u8 *p = data;
+	u32 sum = len + proto;
+	int i;
+
+	/* Work a byte at a time, as nothing here need be aligned */
+	for (i = 0; i < IN6ADDRSZ; i += 2) {
+		sum += saddr->s6_addr[i] << 8 | saddr->s6_addr[i + 1];
+		sum += daddr->s6_addr[i] << 8 | daddr->s6_addr[i + 1];
+	}
+	for (i = 0; i + 1 < len; i += 2)
+		sum += p[i] << 8 | p[i + 1];
+	if (len & 1)
+		sum += p[len - 1] << 8;
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return ~sum & 0xffff;
+}
+
+int ip6_add_hdr(uchar *xip, const struct in6_addr *src,
+		const struct in6_addr *dest, int nextheader, int hop_limit,
+		int payload_len)
+{
+	struct ip6_hdr *ip6 = (struct ip6_hdr *)xip;
+
+	ip6->ip6_flow = htonl(IP6_FLOW);
+	ip6->payload_len = htons(payload_len);
+	ip6->nexthdr = nextheader;
+	ip6->hop_limit = hop_limit;
+	memcpy(&ip6->saddr, src, IN6ADDRSZ);
+	memcpy(&ip6->daddr, dest, IN6ADDRSZ);
+
+	return IP6_HDR_SIZE;
+}
+
+const struct in6_addr *net_ip6_src(const struct in6_addr *dest)
+{
+	if (ip6_is_link_local(dest) || ip6_is_multicast(dest) ||
+	    ip6_is_unspecified_addr(&net_ip6))
+		return &net_link_local_ip6;
+
+	return &net_ip6;
+}
+
+int net_send_ip6_packet(uchar *ether, const struct in6_addr *dest,
+			int nextheader, int payload_len)
+{
+	const struct in6_addr *src = net_ip6_src(dest);
+	uchar mcast_ether[ARP_HLEN];
+	struct icmp6_hdr *icmp;
+	struct udp_hdr *udp;
+	int eth_hdr_size, len;
+	uchar *pkt;
+	u16 csum;
+
+	/* make sure the net_tx_packet is initialized (net_init() was called) */
+	if (!net_tx_packet)
+		return -1;
+
+	if (ip6_is_multicast(dest)) {
+		ip6_make_mult_ethdstaddr(mcast_ether, dest);
+		ether = mcast_ether;
+	}
+
+	eth_hdr_size = net_set_ether(net_tx_packet, ether, PROT_IPV6);
+	pkt = net_tx_packet + eth_hdr_size;
+	ip6_add_hdr(pkt, src, dest, nextheader, IP6_HOP_LIMIT, payload_len);
+	pkt += IP6_HDR_SIZE;
+
+	switch (nextheader) {
+	case IPPROTO_UDP:
+		udp = (struct udp_hdr *)pkt;
+		udp->udp_xsum = 0;
+		csum = net_ip6_csum(src, dest, payload_len, nextheader, pkt);
+		/* A checksum of 0 means there is none, so send all ones */
+		udp->udp_xsum = htons(csum ? csum : 0xffff);
+		break;
+	case IPPROTO_ICMPV6:
+		icmp = (struct icmp6_hdr *)pkt;
+		icmp->icmp6_cksum = 0;
+		csum = net_ip6_csum(src, dest, payload_len, nextheader, pkt);
+		icmp->icmp6_cksum = htons(csum);
+		break;
+	default:
+		return -EINVAL;
+	}
+	len = eth_hdr_size + IP6_HDR_SIZE + payload_len;
+
+	/* if MAC address was not discovered yet, do neighbour discovery */
+	if (!memcmp(ether, net_null_ethaddr, ARP_HLEN)) {
+		debug_cond(DEBUG_DEV_PKT, "sending NS for %pI6c\n", dest);
+		ndisc_wait(ether, dest, len);
+		return 1;	/* waiting */
+	}
+
+	debug_cond(DEBUG_DEV_PKT, "sending IPv6 to %pI6c/%pM\n", dest, ether);
+	net_send_packet(net_tx_packet, len);
+
+	return 0;	/* transmitted */
+}
+
+int net_send_udp_packet6(uchar *ether, const struct in6_addr *dest, int dport,
+			 int sport, int len)
+{
+	struct udp_hdr *udp;
+
+	udp = (struct udp_hdr *)(net_tx_packet + net_eth_hdr_size() +
+				 IP6_HDR_SIZE);
+	udp->udp_src = htons(sport);
+	udp->udp_dst = htons(dport);
+	udp->udp_len = htons(UDP_HDR_SIZE + len);
+
+	return net_send_ip6_packet(ether, dest, IPPROTO_UDP, UDP_HDR_SIZE + len);
+}
+
+/* Answer an echo request, in place */
+static void net_ip6_echo_reply(struct ethernet_hdr *et, struct ip6_hdr *ip6,
+			       int len)
+{
+	struct icmp6_hdr *icmp = (struct icmp6_hdr *)(ip6 + 1);
+	struct in6_addr our_addr;
+	int eth_hdr_size;
+	uchar *tx_packet;
+
+	/* Only answer requests sent to us alone */
+	if (ip6_is_multicast(&ip6->daddr))
+		return;
+
+	eth_hdr_size = net_update_ether(et, et->et_src, PROT_IPV6);
+	debug_cond(DEBUG_DEV_PKT, "Got ICMPv6 ECHO REQUEST, return %d bytes\n",
+		   eth_hdr_size + (int)IP6_HDR_SIZE + len);
+
+	our_addr = ip6->daddr;
+	ip6->daddr = ip6->saddr;
+	ip6->saddr = our_addr;
+	ip6->hop_limit = IP6_HOP_LIMIT;
+
+	icmp->icmp6_type = ICMPV6_ECHO_REPLY;
+	icmp->icmp6_cksum = 0;
+	icmp->icmp6_cksum = htons(net_ip6_csum(&ip6->saddr, &ip6->daddr, len,
+					       IPPROTO_ICMPV6, icmp));
+
+	tx_packet = net_get_async_tx_pkt_buf();
+	memcpy(tx_packet, et, eth_hdr_size + IP6_HDR_SIZE + len);
+	net_send_packet(tx_packet, eth_hdr_size + IP6_HDR_SIZE + len);
+}
+
+static int net_ip6_receive_icmp(struct ethernet_hdr *et, struct ip6_hdr *ip6,
+				int len)
+{
+	struct icmp6_hdr *icmp = (struct icmp6_hdr *)(ip6 + 1);
+
+	if (len < ICMP6_HDR_SIZE)
+		return -EINVAL;
+	if (net_ip6_csum(&ip6->saddr, &ip6->daddr, len, IPPROTO_ICMPV6, icmp))
+		return -EINVAL;
+
+	switch (icmp->icmp6_type) {
+	case ICMPV6_ECHO_REQUEST:
+		net_ip6_echo_reply(et, ip6, len);
+		break;
+	case ICMPV6_ECHO_REPLY:
+#ifdef CONFIG_CMD_PING6
+		ping6_receive(et, ip6, len);
+#endif
+		break;
+	case ICMPV6_NEIGHBOUR_SOL:
+	case ICMPV6_NEIGHBOUR_ADV:
+	case ICMPV6_ROUTER_ADV:
+		return ndisc_receive(et, ip6, len);
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static int net_ip6_receive_udp(struct ip6_hdr *ip6, int len)
+{
+	struct udp_hdr *udp = (struct udp_hdr *)(ip6 + 1);
+	struct in_addr no_ip4 = { .s_addr = 0 };
+	int udp_len;
+
+	if (len < UDP_HDR_SIZE)
+		return -EINVAL;
+	udp_len = ntohs(udp->udp_len);
+	if (udp_len < UDP_HDR_SIZE || udp_len > len)
+		return -EINVAL;
+
+	/* The checksum is not optional in IPv6 */
+	if (!udp->udp_xsum)
+		return -EINVAL;
+	if (IS_ENABLED(CONFIG_UDP_CHECKSUM) &&
+	    net_ip6_csum(&ip6->saddr, &ip6->daddr, udp_len, IPPROTO_UDP,
+			 udp)) {
+		printf(" UDP wrong checksum %04x\n", ntohs(udp->udp_xsum));
+		return -EINVAL;
+	}
+
+	debug_cond(DEBUG_DEV_PKT, "received UDP (to=%pI6c, from=%pI6c, len=%d)\n",
+		   &ip6->daddr, &ip6->saddr, udp_len);
+
+	/* Handlers see no IPv4 source; they know the server they talk to */
+	net_get_udp_handler()((uchar *)udp + UDP_HDR_SIZE,
+			      ntohs(udp->udp_dst), no_ip4,
+			      ntohs(udp->udp_src), udp_len - UDP_HDR_SIZE);
+
+	return 0;
+}
+
+int net_ip6_handler(struct ethernet_hdr *et, struct ip6_hdr *ip6, int len)
+{
+	int payload_len;
+
+	debug_cond(DEBUG_NET_PKT, "Got IPv6\n");
+	if (len < IP6_HDR_SIZE)
+		return -EINVAL;
+	if ((ntohl(ip6->ip6_flow) >> 28) != 6)
+		return -EINVAL;
+	payload_len = ntohs(ip6->payload_len);
+	if (len < IP6_HDR_SIZE + payload_len)
+		return -EINVAL;
+
+	/* If it is not for us, ignore it */
+	if (!ip6_is_our_addr(&ip6->daddr) && !ip6_is_multicast(&ip6->daddr))
+		return 0;
+
+	switch (ip6->nexthdr) {
+	case IPPROTO_ICMPV6:
+		return net_ip6_receive_icmp(et, ip6, payload_len);
+	case IPPROTO_UDP:
+		return net_ip6_receive_udp(ip6, payload_len);
+	default:
+		/* Extension headers and other protocols are not supported */
+		return 0;
+	}
+}
+
+void net_ip6_init(void)
+{
+	ip6_make_lladdr(&net_link_local_ip6, net_ethaddr);
+}
+
+bool is_serverip6_in_cmd(void)
+{
+	return net_boot_file_name[0] == '[';
+}
+
+int net_parse_bootfile6(struct in6_addr *ipaddr, char *filename, int max_len)
+{
+	const char *name = net_boot_file_name;
+	const char *end;
+
+	if (!*name)
+		return 0;
+
+	if (is_serverip6_in_cmd()) {
+		end = strchr(name, ']');
+		if (!end || end[1] != ':')
+			return -EINVAL;
+		if (string_to_ip6(name + 1, end - name - 1, ipaddr))
+			return -EINVAL;
+		name = end + 2;
+	}
+	strncpy(filename, name, max_len);
+	filename[max_len - 1] = '\0';
+
+	return 1;
+}
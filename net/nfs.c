@@ -32,11 +32,13 @@
 #include <image.h>
 #include <log.h>
 #include <net.h>
+#include <net6.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include "nfs.h"
 #include "bootp.h"
 #include <time.h>
+#include <linux/log2.h>
 
 #define HASHES_PER_LINE 65	/* Number of "loading" hashes per line	*/
 #define NFS_RETRY_COUNT 30
@@ -49,10 +51,43 @@
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+/* How often to check the READ requests for timeouts, in ms */
+#define NFS_READ_TICK	100
+/* Bytes loaded for each hash mark */
+#define NFS_HASH_BYTES	(NFS_READ_SIZE / 2 * 10)
+
+/**
+ * struct nfs_read - a READ request waiting for its reply
+ *
+ * @id:		RPC transaction ID (XID) of the request
+ * @offset:	offset in the file of the data requested
+ * @len:	number of bytes requested, 0 if this entry is not in use
+ * @time:	time at which the request was last sent, in ms
+ * @retries:	number of times the request was sent again
+ */
+struct nfs_read {
+	ulong id;
+	ulong offset;
+	uint len;
+	ulong time;
+	int retries;
+};
+
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
+/* READ requests in flight, answered in any order */
+static struct nfs_read nfs_reads[CONFIG_NFS_READ_WINDOW];
+/* Offset of the next READ to send */
+static ulong nfs_next_offset;
+/* End of the file, ULONG_MAX until a READ reaches it */
+static ulong nfs_eof;
+/* Size of the file from the LOOKUP attributes, ULONG_MAX if not sent */
+static ulong nfs_filesize;
+/* Bytes asked for by each READ, agreed with the server */
+static uint nfs_read_size;
+static ulong nfs_received;
+/* Bytes of RPC and NFS headers in front of the data in the last READ reply */
+static int nfs_read_hdr_len;
 static ulong nfs_timeout = NFS_TIMEOUT;
 
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
@@ -61,6 +96,9 @@ static int filefh3_length;	/* (variable) length of filefh when NFSv3 */
 
 static enum net_loop_state nfs_download_state;
 static struct in_addr nfs_server_ip;
+#ifdef CONFIG_IPV6
+static struct in6_addr nfs_server_ip6;
+#endif
 static int nfs_server_mount_port;
 static int nfs_server_port;
 static int nfs_our_port;
@@ -73,6 +111,7 @@ static int nfs_state;
 #define STATE_LOOKUP_REQ		5
 #define STATE_READ_REQ			6
 #define STATE_READLINK_REQ		7
+#define STATE_FSINFO_REQ		8
 
 static char *nfs_filename;
 static char *nfs_path;
@@ -108,7 +147,7 @@ static inline int store_block(uchar *src, unsigned offset, unsigned len)
 	{
 		void *ptr = map_sysmem(image_load_addr + offset, len);
 
-		memcpy(ptr, src, len);
+		net_store_payload(ptr, src, len);
 		unmap_sysmem(ptr);
 	}
 
@@ -173,17 +212,16 @@ static uint32_t *rpc_add_credentials(uint32_t *p)
 }
 
 /**************************************************************************
-RPC_LOOKUP - Lookup RPC Port numbers
+RPC_SEND - Send an RPC call with the given transaction ID
 **************************************************************************/
-static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+static void rpc_send(unsigned long id, int rpc_prog, int rpc_proc,
+		     uint32_t *data, int datalen)
 {
 	struct rpc_t rpc_pkt;
-	unsigned long id;
 	uint32_t *p;
 	int pktlen;
 	int sport;
 
-	id = ++rpc_id;
 	rpc_pkt.u.call.id = htonl(id);
 	rpc_pkt.u.call.type = htonl(MSG_CALL);
 	rpc_pkt.u.call.rpcvers = htonl(2);	/* use RPC version 2 */
@@ -208,7 +246,7 @@ static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
 
 	pktlen = (char *)p + datalen * sizeof(uint32_t) - (char *)&rpc_pkt;
 
-	memcpy((char *)net_tx_packet + net_eth_hdr_size() + IP_UDP_HDR_SIZE,
+	memcpy((char *)net_tx_packet + net_eth_hdr_size() + net_ip_udp_hdr_size(),
 	       &rpc_pkt.u.data[0], pktlen);
 
 	if (rpc_prog == PROG_PORTMAP)
@@ -218,10 +256,25 @@ static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
 	else
 		sport = nfs_server_port;
 
+#ifdef CONFIG_IPV6
+	if (net_use_ip6) {
+		net_send_udp_packet6(net_server_ethaddr, &nfs_server_ip6, sport,
+				     nfs_our_port, pktlen);
+		return;
+	}
+#endif
 	net_send_udp_packet(net_server_ethaddr, nfs_server_ip, sport,
 			    nfs_our_port, pktlen);
 }
 
+/**************************************************************************
+RPC_REQ - Send an RPC call with a new transaction ID
+**************************************************************************/
+static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+{
+	rpc_send(++rpc_id, rpc_prog, rpc_proc, data, datalen);
+}
+
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
@@ -358,10 +411,31 @@ static void nfs_lookup_req(char *fname)
 	}
 }
 
+/**************************************************************************
+NFS_FSINFO - Get the largest read size which the server allows (NFSv3)
+**************************************************************************/
+static void nfs_fsinfo_req(void)
+{
+	uint32_t data[1024];
+	uint32_t *p;
+	int len;
+
+	p = &(data[0]);
+	p = rpc_add_credentials(p);
+
+	*p++ = htonl(filefh3_length);
+	memcpy(p, filefh, filefh3_length);
+	p += (filefh3_length / 4);
+
+	len = (uint32_t *)p - (uint32_t *)&(data[0]);
+
+	rpc_req(PROG_NFS, NFS3PROC_FSINFO, data, len);
+}
+
 /**************************************************************************
 NFS_READ - Read File on NFS Server
 **************************************************************************/
-static void nfs_read_req(int offset, int readlen)
+static void nfs_read_req(struct nfs_read *rd)
 {
 	uint32_t data[1024];
 	uint32_t *p;
@@ -373,22 +447,23 @@ static void nfs_read_req(int offset, int readlen)
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		memcpy(p, filefh, NFS_FHSIZE);
 		p += (NFS_FHSIZE / 4);
-		*p++ = htonl(offset);
-		*p++ = htonl(readlen);
+		*p++ = htonl(rd->offset);
+		*p++ = htonl(rd->len);
 		*p++ = 0;
 	} else { /* NFSV3_FLAG */
 		*p++ = htonl(filefh3_length);
 		memcpy(p, filefh, filefh3_length);
 		p += (filefh3_length / 4);
 		*p++ = htonl(0); /* offset is 64-bit long, so fill with 0 */
-		*p++ = htonl(offset);
-		*p++ = htonl(readlen);
+		*p++ = htonl(rd->offset);
+		*p++ = htonl(rd->len);
 		*p++ = 0;
 	}
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
-	rpc_req(PROG_NFS, NFS_READ, data, len);
+	rd->time = get_timer(0);
+	rpc_send(rd->id, PROG_NFS, NFS_READ, data, len);
 }
 
 /**************************************************************************
@@ -420,8 +495,8 @@ static void nfs_send(void)
 	case STATE_LOOKUP_REQ:
 		nfs_lookup_req(nfs_filename);
 		break;
-	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+	case STATE_FSINFO_REQ:
+		nfs_fsinfo_req();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
@@ -516,6 +591,7 @@ static int nfs_umountall_reply(uchar *pkt, unsigned len)
 static int nfs_lookup_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
+	int attr;
 
 	debug("%s\n", __func__);
 
@@ -570,10 +646,15 @@ static int nfs_lookup_reply(uchar *pkt, unsigned len)
 		return -1;
 	}
 
+	nfs_filesize = ULONG_MAX;
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + NFS_FHSIZE) > len)
 			return -NFS_RPC_DROP;
 		memcpy(filefh, rpc_pkt.u.reply.data + 1, NFS_FHSIZE);
+		/* fattr follows the handle, size is its sixth word */
+		attr = 1 + NFS_FHSIZE / 4;
+		if ((uchar *)&rpc_pkt.u.reply.data[attr + 6] - (uchar *)&rpc_pkt <= len)
+			nfs_filesize = ntohl(rpc_pkt.u.reply.data[attr + 5]);
 	} else {  /* NFSV3_FLAG */
 		filefh3_length = ntohl(rpc_pkt.u.reply.data[1]);
 		if (filefh3_length > NFS3_FHSIZE)
@@ -581,6 +662,15 @@ static int nfs_lookup_reply(uchar *pkt, unsigned len)
 		if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + filefh3_length) > len)
 			return -NFS_RPC_DROP;
 		memcpy(filefh, rpc_pkt.u.reply.data + 2, filefh3_length);
+		/*
+		 * post_op_attr follows the handle: a flag, then fattr3 with
+		 * the 64-bit size in its sixth and seventh words
+		 */
+		attr = 2 + DIV_ROUND_UP(filefh3_length, 4);
+		if ((uchar *)&rpc_pkt.u.reply.data[attr + 8] - (uchar *)&rpc_pkt <= len &&
+		    rpc_pkt.u.reply.data[attr] &&
+		    !rpc_pkt.u.reply.data[attr + 6])
+			nfs_filesize = ntohl(rpc_pkt.u.reply.data[attr + 7]);
 	}
 
 	return 0;
@@ -664,21 +754,59 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
-static int nfs_read_reply(uchar *pkt, unsigned len)
+static int nfs3_fsinfo_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
-	int rlen;
-	uchar *data_ptr;
+	int nfsv3_data_offset;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	memcpy(&rpc_pkt.u.data[0], pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
 	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
 		return -NFS_RPC_DROP;
 
+	if (rpc_pkt.u.reply.rstatus  ||
+	    rpc_pkt.u.reply.verifier ||
+	    rpc_pkt.u.reply.astatus  ||
+	    rpc_pkt.u.reply.data[0])
+		return -1;
+
+	nfsv3_data_offset = nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
+	if (((uchar *)&(rpc_pkt.u.reply.data[2 + nfsv3_data_offset]) -
+	     (uchar *)(&rpc_pkt)) > len)
+		return -NFS_RPC_DROP;
+
+	/* rtmax, the largest read the server allows */
+	return ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+}
+
+static int nfs_read_reply(uchar *pkt, unsigned len, struct nfs_read **rdp)
+{
+	struct rpc_t rpc_pkt;
+	struct nfs_read *rd = NULL;
+	int rlen;
+	uchar *data_ptr;
+	int i;
+
+	debug("%s\n", __func__);
+
+	/* Only the headers are needed here; the data is stored from @pkt */
+	memcpy(&rpc_pkt.u.data[0], pkt,
+	       sizeof(rpc_pkt.u.reply) - NFS_READ_SIZE);
+
+	/* Find the request, which need not be the latest one sent */
+	for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+		if (nfs_reads[i].len &&
+		    nfs_reads[i].id == ntohl(rpc_pkt.u.reply.id))
+			rd = &nfs_reads[i];
+	}
+	if (!rd)
+		return -NFS_RPC_DROP;
+	*rdp = rd;
+
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
 	    rpc_pkt.u.reply.astatus  ||
@@ -690,12 +818,6 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
 		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
@@ -713,15 +835,174 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
 	}
 
-	if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + rlen) > len)
+	nfs_read_hdr_len = data_ptr - (uchar *)&rpc_pkt;
+	if (rlen < 0 || rlen > rd->len || nfs_read_hdr_len + rlen > len)
 			return -9999;
 
-	if (store_block(data_ptr, nfs_offset, rlen))
+	if (store_block(pkt + nfs_read_hdr_len, rd->offset, rlen))
 			return -9999;
 
 	return rlen;
 }
 
+/*
+ * Largest read whose reply fits, with its headers, in a datagram which we can
+ * receive
+ */
+static uint nfs_read_size_max(void)
+{
+#ifdef CONFIG_IP_DEFRAG
+	/* IPv6 fragments are not reassembled */
+	if (net_use_ip6)
+		return NFS_READ_SIZE;
+	return rounddown_pow_of_two(CONFIG_NET_MAXDEFRAG - IP_UDP_HDR_SIZE -
+				    (6 + NFS_MAX_ATTRS) * sizeof(uint32_t));
+#else
+	return NFS_READ_SIZE;
+#endif
+}
+
+static void nfs_show_progress(int len)
+{
+	ulong hashes = nfs_received / NFS_HASH_BYTES;
+
+	nfs_received += len;
+	while (hashes < nfs_received / NFS_HASH_BYTES) {
+		if (!(++hashes % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+	}
+}
+
+/*
+ * Have the data of the next READ reply received where it is to be stored,
+ * assuming that the headers are as long as in the last reply. Replies mostly
+ * come in order, so the next is taken to be that for the lowest offset.
+ * Nothing is lent unless the server sent the file size, so that the last
+ * reply cannot be received past the end of the file.
+ */
+static void nfs_lend_next_read(void)
+{
+	int hdr_len = net_eth_hdr_size() + net_ip_udp_hdr_size() + nfs_read_hdr_len;
+	struct nfs_read *next = NULL;
+	ulong len;
+	int i;
+
+	if (!IS_ENABLED(CONFIG_NET_RX_LEND) ||
+	    IS_ENABLED(CONFIG_SYS_DIRECT_FLASH_NFS) ||
+	    nfs_filesize == ULONG_MAX)
+		return;
+
+	for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+		struct nfs_read *rd = &nfs_reads[i];
+
+		if (rd->len && rd->offset < nfs_eof &&
+		    rd->offset < nfs_filesize &&
+		    (!next || rd->offset < next->offset))
+			next = rd;
+	}
+	if (!next || next->offset < hdr_len)
+		return;
+
+	len = min_t(ulong, next->len, nfs_filesize - next->offset);
+	net_rx_lend(map_sysmem(image_load_addr + next->offset, len),
+		    hdr_len, len);
+}
+
+/* Send a READ request, with a new transaction ID */
+static void nfs_read_send(struct nfs_read *rd)
+{
+	rd->id = ++rpc_id;
+	rd->retries = 0;
+	nfs_read_req(rd);
+}
+
+/* Send READ requests until the window is full or the end of file is reached */
+static void nfs_read_fill(void)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+		struct nfs_read *rd = &nfs_reads[i];
+
+		if (rd->len)
+			continue;
+		if (nfs_next_offset >= nfs_eof)
+			break;
+		rd->offset = nfs_next_offset;
+		rd->len = nfs_read_size;
+		nfs_next_offset += rd->len;
+		nfs_read_send(rd);
+	}
+}
+
+static void nfs_read_timeout_handler(void)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+		struct nfs_read *rd = &nfs_reads[i];
+
+		if (!rd->len || get_timer(rd->time) <
+		    nfs_timeout + NFS_TIMEOUT * rd->retries)
+			continue;
+		if (++rd->retries > NFS_RETRY_COUNT) {
+			puts("\nRetry count exceeded; starting again\n");
+			net_start_again();
+			return;
+		}
+		/* Send it again as it was, so that either reply is accepted */
+		puts("T ");
+		nfs_read_req(rd);
+	}
+	net_set_timeout_handler(NFS_READ_TICK, nfs_read_timeout_handler);
+}
+
+static void nfs_read_start(void)
+{
+	debug("NFS read size %u, %d in flight\n", nfs_read_size,
+	      CONFIG_NFS_READ_WINDOW);
+	nfs_state = STATE_READ_REQ;
+	memset(nfs_reads, '\0', sizeof(nfs_reads));
+	nfs_next_offset = 0;
+	nfs_eof = ULONG_MAX;
+	nfs_received = 0;
+	net_set_timeout_handler(NFS_READ_TICK, nfs_read_timeout_handler);
+	nfs_read_fill();
+}
+
+/*
+ * Handle the data of a READ reply. Returns true if the file is complete, i.e.
+ * the end of the file is known and everything before it has been received.
+ */
+static bool nfs_read_done(struct nfs_read *rd, int rlen)
+{
+	int i;
+
+	nfs_show_progress(rlen);
+	if (!rlen) {
+		nfs_eof = min(nfs_eof, rd->offset);
+	} else if (rlen < rd->len) {
+		/*
+		 * A short read is not necessarily the end of the file; ask
+		 * for the rest, which is empty if it is
+		 */
+		rd->offset += rlen;
+		rd->len -= rlen;
+		nfs_read_send(rd);
+		return false;
+	}
+	rd->len = 0;
+	nfs_read_fill();
+
+	for (i = 0; i < CONFIG_NFS_READ_WINDOW; i++) {
+		if (nfs_reads[i].len && nfs_reads[i].offset < nfs_eof)
+			return false;
+	}
+
+	return nfs_eof != ULONG_MAX;
+}
+
 /**************************************************************************
 Interfaces of U-BOOT
 **************************************************************************/
@@ -742,12 +1023,14 @@ static void nfs_timeout_handler(void)
 static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			unsigned src, unsigned len)
 {
+	struct nfs_read *rd;
 	int rlen;
 	int reply;
 
 	debug("%s\n", __func__);
 
-	if (len > sizeof(struct rpc_t))
+	/* READ replies may be larger, but only their headers are copied */
+	if (len > sizeof(struct rpc_t) && nfs_state != STATE_READ_REQ)
 		return;
 
 	if (dest != nfs_our_port)
@@ -812,14 +1095,29 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			/* And retry with another supported version */
 			nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
 			nfs_send();
+		} else if (supported_nfs_versions & NFSV2_FLAG) {
+			nfs_read_size = min_t(uint, NFS2_MAXDATA,
+					      nfs_read_size_max());
+			nfs_read_start();
 		} else {
-			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
+			/* Ask NFSv3 servers for their largest read size */
+			nfs_state = STATE_FSINFO_REQ;
 			nfs_send();
 		}
 		break;
 
+	case STATE_FSINFO_REQ:
+		reply = nfs3_fsinfo_reply(pkt, len);
+		if (reply == -NFS_RPC_DROP)
+			break;
+		/* Without an answer, use the size which always works */
+		if (reply >= NFS_READ_SIZE)
+			nfs_read_size = min_t(uint, reply, nfs_read_size_max());
+		else
+			nfs_read_size = NFS_READ_SIZE;
+		nfs_read_start();
+		break;
+
 	case STATE_READLINK_REQ:
 		reply = nfs_readlink_reply(pkt, len);
 		if (reply == -NFS_RPC_DROP) {
@@ -839,21 +1137,22 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		break;
 
 	case STATE_READ_REQ:
-		rlen = nfs_read_reply(pkt, len);
+		rlen = nfs_read_reply(pkt, len, &rd);
 		if (rlen == -NFS_RPC_DROP)
 			break;
+		if (rlen >= 0 && !nfs_read_done(rd, rlen)) {
+			nfs_lend_next_read();
+			break;
+		}
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
-			nfs_send();
-		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
+		if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
+			if (rlen >= 0)
 				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
+			else
 				debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
@@ -865,8 +1164,11 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 void nfs_start(void)
 {
+	int ret;
+
 	debug("%s\n", __func__);
 	nfs_download_state = NETLOOP_FAIL;
+	nfs_filesize = ULONG_MAX;
 
 	nfs_server_ip = net_server_ip;
 	nfs_path = (char *)nfs_path_buff;
@@ -877,8 +1179,21 @@ void nfs_start(void)
 		return;
 	}
 
-	if (!net_parse_bootfile(&nfs_server_ip, nfs_path,
-				sizeof(nfs_path_buff))) {
+#ifdef CONFIG_IPV6
+	nfs_server_ip6 = net_server_ip6;
+	if (net_use_ip6)
+		ret = net_parse_bootfile6(&nfs_server_ip6, nfs_path,
+					  sizeof(nfs_path_buff));
+	else
+#endif
+		ret = net_parse_bootfile(&nfs_server_ip, nfs_path,
+					 sizeof(nfs_path_buff));
+	if (ret < 0) {
+		net_set_state(NETLOOP_FAIL);
+		printf("*** ERROR: bad server address in file name\n");
+		return;
+	}
+	if (!ret) {
 		sprintf(nfs_path, "/nfsroot/%02X%02X%02X%02X.img",
 			net_ip.s_addr & 0xFF,
 			(net_ip.s_addr >>  8) & 0xFF,
@@ -894,11 +1209,17 @@ void nfs_start(void)
 
 	printf("Using %s device\n", eth_get_name());
 
+#ifdef CONFIG_IPV6
+	if (net_use_ip6)
+		printf("File transfer via NFS from server %pI6c; our IPv6 address is %pI6c",
+		       &nfs_server_ip6, net_ip6_src(&nfs_server_ip6));
+	else
+#endif
 	printf("File transfer via NFS from server %pI4; our IP address is %pI4",
 	       &nfs_server_ip, &net_ip);
 
 	/* Check if we need to send across this subnet */
-	if (net_gateway.s_addr && net_netmask.s_addr) {
+	if (!net_use_ip6 && net_gateway.s_addr && net_netmask.s_addr) {
 		struct in_addr our_net;
 		struct in_addr server_net;
 
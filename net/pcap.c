@@ -4,10 +4,13 @@
  */
 
 #include <common.h>
+#include <env.h>
 #include <net.h>
+#include <net6.h>
 #include <net/pcap.h>
 #include <time.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 
 #define LINKTYPE_ETHERNET	1
 
@@ -18,8 +21,22 @@ static void *buf;
 static unsigned int max_size;
 static unsigned int pos;
 
+/* In ring mode the oldest packets make way for new ones */
+static bool ring;
+/* Whether the newest packets have gone back to the start of the buffer */
+static bool wrapped;
+/* Offset of the oldest packet */
+static unsigned int head;
+/* End of the oldest packets, if wrapped */
+static unsigned int wrap;
+/* Most bytes kept of each packet */
+static unsigned int snaplen = PCAP_SNAPLEN_MAX;
+static struct pcap_filter filter;
+static bool filtering;
+
 static unsigned long incoming_count;
 static unsigned long outgoing_count;
+static unsigned long overwritten_count;
 
 struct pcap_header {
 	u32 magic;
@@ -42,7 +59,7 @@ static struct pcap_header file_header = {
 	.magic = 0xa1b2c3d4,
 	.version_major = 2,
 	.version_minor = 4,
-	.snaplen = 65535,
+	.snaplen = PCAP_SNAPLEN_MAX,
 	.network = LINKTYPE_ETHERNET,
 };
 
@@ -57,14 +74,168 @@ int pcap_init(phys_addr_t paddr, unsigned long size)
 	printf("PCAP capture initialized: addr: 0x%lx max length: %lu\n",
 	       (unsigned long)buf, size);
 
+	file_header.snaplen = snaplen;
 	memcpy(buf, &file_header, sizeof(file_header));
 	pos = sizeof(file_header);
+	head = pos;
+	wrapped = false;
 	max_size = size;
 	initialized = true;
 	running = false;
 	buffer_full = false;
 	incoming_count = 0;
 	outgoing_count = 0;
+	overwritten_count = 0;
+	return 0;
+}
+
+static void pcap_reverse(u8 *start, unsigned int len)
+{
+	u8 *end = start + len - 1;
+	u8 tmp;
+
+	while (start < end) {
+		tmp = *start;
+		*start++ = *end;
+		*end-- = tmp;
+	}
+}
+
+/* Put the packets of a wrapped capture back in order, to make a pcap file */
+static void pcap_unwrap(void)
+{
+	u8 *base = buf + sizeof(file_header);
+	unsigned int new_len = pos - sizeof(file_header);
+	unsigned int old_len = wrap - head;
+
+	if (!wrapped)
+		return;
+
+	/* Close the gap, then swap the newest and oldest packets round */
+	memmove(base + new_len, buf + head, old_len);
+	pcap_reverse(base, new_len);
+	pcap_reverse(base + new_len, old_len);
+	pcap_reverse(base, new_len + old_len);
+
+	pos = sizeof(file_header) + new_len + old_len;
+	head = sizeof(file_header);
+	wrapped = false;
+}
+
+/* Make room for @len bytes at pos, dropping the oldest packets in ring mode */
+static bool pcap_make_room(unsigned int len)
+{
+	struct pcap_packet_header header;
+
+	if (len > max_size - sizeof(file_header))
+		return false;
+
+	while (true) {
+		if (!wrapped) {
+			if (pos + len <= max_size)
+				return true;
+			if (!ring)
+				return false;
+			wrap = pos;
+			pos = sizeof(file_header);
+			wrapped = true;
+		}
+		if (head - pos >= len)
+			return true;
+
+		/* Drop the oldest packet */
+		memcpy(&header, buf + head, sizeof(header));
+		head += sizeof(header) + header.incl_len;
+		overwritten_count++;
+		if (head >= wrap) {
+			head = sizeof(file_header);
+			wrapped = false;
+		}
+	}
+}
+
+/* Check a packet against the filter, without copying anything */
+static bool pcap_match(const u8 *packet, size_t len)
+{
+	const struct ethernet_hdr *et = (const struct ethernet_hdr *)packet;
+	const struct ip_udp_hdr *ip;
+	const struct ip6_hdr *ip6;
+	const u8 *end = packet + len;
+	const u8 *l4;
+	int proto, ip_proto, hdr_size = ETHER_HDR_SIZE;
+
+	if (len < ETHER_HDR_SIZE)
+		return false;
+	proto = ntohs(et->et_protlen);
+	if (proto == PROT_VLAN) {
+		if (len < VLAN_ETHER_HDR_SIZE)
+			return false;
+		proto = ntohs(((struct vlan_ethernet_hdr *)et)->vet_type);
+		hdr_size = VLAN_ETHER_HDR_SIZE;
+	}
+	if (filter.eth_proto && proto != filter.eth_proto)
+		return false;
+	if (!filter.ip_proto && !filter.port && !filter.host.s_addr)
+		return true;
+
+	if (proto == PROT_IP && len >= hdr_size + IP_HDR_SIZE) {
+		ip = (const struct ip_udp_hdr *)(packet + hdr_size);
+		if (filter.host.s_addr &&
+		    net_read_ip((void *)&ip->ip_src).s_addr != filter.host.s_addr &&
+		    net_read_ip((void *)&ip->ip_dst).s_addr != filter.host.s_addr)
+			return false;
+		ip_proto = ip->ip_p;
+		l4 = (const u8 *)ip + (ip->ip_hl_v & 0x0f) * 4;
+	} else if (proto == PROT_IPV6 && len >= hdr_size + IP6_HDR_SIZE &&
+		   !filter.host.s_addr) {
+		ip6 = (const struct ip6_hdr *)(packet + hdr_size);
+		ip_proto = ip6->nexthdr;
+		l4 = (const u8 *)(ip6 + 1);
+	} else {
+		return false;
+	}
+	if (filter.ip_proto && ip_proto != filter.ip_proto)
+		return false;
+	if (filter.port) {
+		if ((ip_proto != IPPROTO_UDP && ip_proto != IPPROTO_TCP) ||
+		    l4 + 4 > end)
+			return false;
+		if (get_unaligned_be16(l4) != filter.port &&
+		    get_unaligned_be16(l4 + 2) != filter.port)
+			return false;
+	}
+
+	return true;
+}
+
+int pcap_set_ring(bool enable)
+{
+	ring = enable;
+
+	return 0;
+}
+
+int pcap_set_snaplen(unsigned int len)
+{
+	if (!len || len > PCAP_SNAPLEN_MAX)
+		return -EINVAL;
+	snaplen = len;
+	file_header.snaplen = len;
+	if (initialized)
+		memcpy(buf, &file_header, sizeof(file_header));
+
+	return 0;
+}
+
+int pcap_set_filter(const struct pcap_filter *new_filter)
+{
+	if (new_filter)
+		filter = *new_filter;
+	else
+		memset(&filter, '\0', sizeof(filter));
+	filtering = filter.eth_proto || filter.ip_proto || filter.port ||
+		    filter.host.s_addr;
+
 	return 0;
 }
 
@@ -76,6 +247,10 @@ int pcap_start_stop(bool start)
 	}
 
 	running = start;
+	if (!start) {
+		pcap_unwrap();
+		env_set_hex("pcapsize", pos);
+	}
 
 	return 0;
 }
@@ -88,9 +263,13 @@ int pcap_clear(void)
 	}
 
 	pos = sizeof(file_header);
+	head = pos;
+	wrapped = false;
 	incoming_count = 0;
 	outgoing_count = 0;
+	overwritten_count = 0;
 	buffer_full = false;
+	env_set_hex("pcapsize", pos);
 
 	printf("pcap capture cleared\n");
 	return 0;
@@ -99,7 +278,8 @@ int pcap_clear(void)
 int pcap_post(const void *packet, size_t len, bool outgoing)
 {
 	struct pcap_packet_header header;
-	u64 cur_time = timer_get_us();
+	unsigned int incl_len;
+	u64 cur_time;
 
 	if (!initialized || !running || !buf)
 		return -ENODEV;
@@ -107,29 +287,33 @@ int pcap_post(const void *packet, size_t len, bool outgoing)
 	if (buffer_full)
 		return -ENOMEM;
 
-	if ((pos + len + sizeof(header)) >= max_size) {
+	/* Drop unwanted packets before any copying */
+	if (filtering && !pcap_match(packet, len))
+		return 0;
+
+	incl_len = min_t(size_t, len, snaplen);
+	if (!pcap_make_room(sizeof(header) + incl_len)) {
 		buffer_full = true;
 		printf("\n!!! Buffer is full, consider increasing buffer size !!!\n");
 		return -ENOMEM;
 	}
 
+	cur_time = timer_get_us();
 	header.ts_sec = cur_time / 1000000;
 	header.ts_usec = cur_time % 1000000;
-	header.incl_len = len;
+	header.incl_len = incl_len;
 	header.orig_len = len;
 
 	memcpy(buf + pos, &header, sizeof(header));
 	pos += sizeof(header);
-	memcpy(buf + pos, packet, len);
-	pos += len;
+	memcpy(buf + pos, packet, incl_len);
+	pos += incl_len;
 
 	if (outgoing)
 		outgoing_count++;
 	else
 		incoming_count++;
 
-	env_set_hex("pcapsize", pos);
-
 	return 0;
 }
 
@@ -143,9 +327,25 @@ int pcap_print_status(void)
 	printf("\tInitialized addr: 0x%lx\tmax length: %u\n",
 	       (unsigned long)buf, max_size);
 	printf("\tStatus: %s.\t file size: %u\n", running ? "Active" : "Idle",
-	       pos);
+	       wrapped ? pos + wrap - head : pos);
 	printf("\tIncoming packets: %lu Outgoing packets: %lu\n",
 	       incoming_count, outgoing_count);
+	printf("\tMode: %s\tsnaplen: %u\n", ring ? "ring" : "linear",
+	       snaplen);
+	if (ring)
+		printf("\tOverwritten packets: %lu\n", overwritten_count);
+	if (filtering) {
+		printf("\tFilter:");
+		if (filter.eth_proto)
+			printf(" ethertype 0x%04x", filter.eth_proto);
+		if (filter.ip_proto)
+			printf(" ip proto %d", filter.ip_proto);
+		if (filter.port)
+			printf(" port %d", filter.port);
+		if (filter.host.s_addr)
+			printf(" host %pI4", &filter.host);
+		printf("\n");
+	}
 
 	return 0;
 }
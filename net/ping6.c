@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * ICMPv6 echo, for the ping6 command
+ *
+ * This works as ping.c does for IPv4: one echo request is sent, once
+ * neighbour discovery has found the MAC address of the next hop.
+ */
+
+#include "ping6.h"
+#include <log.h>
+#include <net.h>
+#include <net6.h>
+
+static ushort ping6_seq_number;
+
+/* The address to ping */
+struct in6_addr net_ping_ip6;
+
+static int ping6_send(void)
+{
+	/* Always find the next hop, as ping.c always does ARP */
+	static uchar ether[ARP_HLEN];
+	struct icmp6_hdr *icmp;
+
+	memset(ether, '\0', ARP_HLEN);
+	icmp = (struct icmp6_hdr *)(net_tx_packet + net_eth_hdr_size() +
+				    IP6_HDR_SIZE);
+	icmp->icmp6_type = ICMPV6_ECHO_REQUEST;
+	icmp->icmp6_code = 0;
+	icmp->un.echo.id = 0;
+	icmp->un.echo.sequence = htons(ping6_seq_number++);
+
+	return net_send_ip6_packet(ether, &net_ping_ip6, IPPROTO_ICMPV6,
+				   ICMP6_HDR_SIZE);
+}
+
+static void ping6_timeout_handler(void)
+{
+	eth_halt();
+	net_set_state(NETLOOP_FAIL);	/* we did not get the reply */
+}
+
+void ping6_start(void)
+{
+	printf("Using %s device\n", eth_get_name());
+	net_set_timeout_handler(10000UL, ping6_timeout_handler);
+
+	ping6_send();
+}
+
+void ping6_receive(struct ethernet_hdr *et, struct ip6_hdr *ip6, int len)
+{
+	if (!memcmp(&ip6->saddr, &net_ping_ip6, IN6ADDRSZ))
+		net_set_state(NETLOOP_SUCCESS);
+}
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * ICMPv6 echo, for the ping6 command
+ */
+
+#ifndef __PING6_H__
+#define __PING6_H__
+
+#include <common.h>
+#include <net6.h>
+
+/*
+ * Initialize ping6 (beginning of netloop)
+ */
+void ping6_start(void);
+
+/*
+ * Deal with the receipt of an ICMPv6 echo reply
+ *
+ * @param et Ethernet header in packet
+ * @param ip6 IPv6 header in the same packet
+ * @param len Length of the ICMPv6 message
+ */
+void ping6_receive(struct ethernet_hdr *et, struct ip6_hdr *ip6, int len);
+
+#endif /* __PING6_H__ */
@@ -14,7 +14,9 @@
 #include <log.h>
 #include <mapmem.h>
 #include <net.h>
+#include <net6.h>
 #include <asm/global_data.h>
+#include <asm/unaligned.h>
 #include <net/tftp.h>
 #include "bootp.h"
 #ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
@@ -74,6 +76,9 @@ enum {
 };
 
 static struct in_addr tftp_remote_ip;
+#ifdef CONFIG_IPV6
+static struct in6_addr tftp_remote_ip6;
+#endif
 /* The UDP port at their end */
 static int	tftp_remote_port;
 /* The UDP port at our end */
@@ -124,6 +129,8 @@ static int	tftp_put_final_block_sent;
 
 /* default TFTP block size */
 #define TFTP_BLOCK_SIZE		512
+/* largest block in an unfragmented IPv6 packet, for an MTU of 1500 */
+#define TFTP_BLOCK_SIZE_IP6_MAX	(1500 - IP6_UDP_HDR_SIZE - 4)
 /* sequence number is 16 bit */
 #define TFTP_SEQUENCE_SIZE	((ulong)(1<<16))
 
@@ -156,12 +163,13 @@ static char tftp_filename[MAX_LEN];
 
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = CONFIG_TFTP_BLOCKSIZE;
+/* Block size asked for, which must fit in one packet over IPv6 */
+static unsigned short tftp_block_size_req = CONFIG_TFTP_BLOCKSIZE;
 static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
 
-static inline int store_block(int block, uchar *src, unsigned int len)
+/* Store data received for the given offset in the file */
+static int tftp_store(ulong offset, uchar *src, unsigned int len)
 {
-	ulong offset = block * tftp_block_size + tftp_block_wrap_offset -
-			tftp_block_size;
 	ulong newsize = offset + len;
 	ulong store_addr = tftp_load_addr + offset;
 #ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
@@ -202,7 +210,7 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 		}
 #endif
 		ptr = map_sysmem(store_addr, len);
-		memcpy(ptr, src, len);
+		net_store_payload(ptr, src, len);
 		unmap_sysmem(ptr);
 	}
 
@@ -212,6 +220,48 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 	return 0;
 }
 
+static inline int store_block(int block, uchar *src, unsigned int len)
+{
+	ulong offset = block * tftp_block_size + tftp_block_wrap_offset -
+			tftp_block_size;
+
+	return tftp_store(offset, src, len);
+}
+
+/*
+ * Have the next block received where it is to be stored. The packet headers
+ * cover the end of the current block until net_rx_reclaim() puts it back.
+ */
+static void tftp_lend_next_block(void)
+{
+	ulong offset = tftp_cur_block * tftp_block_size + tftp_block_wrap_offset;
+	int hdr_len = net_eth_hdr_size() + net_ip_udp_hdr_size() + 4;
+	int len = tftp_block_size;
+
+	if (!IS_ENABLED(CONFIG_NET_RX_LEND) ||
+	    !IS_ENABLED(CONFIG_TFTP_TSIZE) ||
+	    IS_ENABLED(CONFIG_SYS_DIRECT_FLASH_TFTP))
+		return;
+
+	/* Stay within the loaded file, and leave block numbers wrapping */
+	if (offset < hdr_len || tftp_cur_block + 1 >= TFTP_SEQUENCE_SIZE)
+		return;
+#ifdef CONFIG_TFTP_TSIZE
+	/*
+	 * Any frame may be received into the lent buffer, so it must end with
+	 * the file. Nothing is lent if the server did not give the size.
+	 */
+	if (offset >= tftp_tsize)
+		return;
+	len = min_t(ulong, len, tftp_tsize - offset);
+#endif
+#ifdef CONFIG_LMB
+	if (tftp_load_size && offset + len > tftp_load_size)
+		return;
+#endif
+	net_rx_lend(map_sysmem(tftp_load_addr + offset, len), hdr_len, len);
+}
+
 /* Clear our state ready for a new transfer */
 static void new_transfer(void)
 {
@@ -248,6 +298,20 @@ static int load_block(unsigned block, uchar *dst, unsigned len)
 #endif
 
 static void tftp_send(void);
+
+/* Send a packet to the server, over IPv6 if that is in use */
+static void tftp_send_udp(int dport, int sport, int len)
+{
+#ifdef CONFIG_IPV6
+	if (net_use_ip6) {
+		net_send_udp_packet6(net_server_ethaddr, &tftp_remote_ip6,
+				     dport, sport, len);
+		return;
+	}
+#endif
+	net_send_udp_packet(net_server_ethaddr, tftp_remote_ip, dport, sport,
+			    len);
+}
 static void tftp_timeout_handler(void);
 
 /**********************************************************************/
@@ -311,18 +375,9 @@ static void update_block_number(void)
 	show_block_marker();
 }
 
-/* The TFTP get or put is complete */
-static void tftp_complete(void)
+/* Show the transfer rate and report success */
+static void tftp_finish(void)
 {
-#ifdef CONFIG_TFTP_TSIZE
-	/* Print hash marks for the last packet received */
-	while (tftp_tsize && tftp_tsize_num_hash < 49) {
-		putc('#');
-		tftp_tsize_num_hash++;
-	}
-	puts("  ");
-	print_size(tftp_tsize, "");
-#endif
 	time_start = get_timer(time_start);
 	if (time_start > 0) {
 		puts("\n\t ");	/* Line up with "Loading: " */
@@ -339,6 +394,21 @@ static void tftp_complete(void)
 	net_set_state(NETLOOP_SUCCESS);
 }
 
+/* The TFTP get or put is complete */
+static void tftp_complete(void)
+{
+#ifdef CONFIG_TFTP_TSIZE
+	/* Print hash marks for the last packet received */
+	while (tftp_tsize && tftp_tsize_num_hash < 49) {
+		putc('#');
+		tftp_tsize_num_hash++;
+	}
+	puts("  ");
+	print_size(tftp_tsize, "");
+#endif
+	tftp_finish();
+}
+
 static void tftp_send(void)
 {
 	uchar *pkt;
@@ -351,7 +421,7 @@ static void tftp_send(void)
 	 *	We will always be sending some sort of packet, so
 	 *	cobble together the packet headers now.
 	 */
-	pkt = net_tx_packet + net_eth_hdr_size() + IP_UDP_HDR_SIZE;
+	pkt = net_tx_packet + net_eth_hdr_size() + net_ip_udp_hdr_size();
 
 	switch (tftp_state) {
 	case STATE_SEND_RRQ:
@@ -380,7 +450,7 @@ static void tftp_send(void)
 #endif
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
-				0, tftp_block_size_option, 0);
+				0, tftp_block_size_req, 0);
 
 		/* try for more effic. window size.
 		 * Implemented only for tftp get.
@@ -453,8 +523,7 @@ static void tftp_send(void)
 		break;
 	}
 
-	net_send_udp_packet(net_server_ethaddr, tftp_remote_ip,
-			    tftp_remote_port, tftp_our_port, len);
+	tftp_send_udp(tftp_remote_port, tftp_our_port, len);
 
 	if (err_pkt)
 		net_set_state(NETLOOP_FAIL);
@@ -557,7 +626,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 					dectoul((char *)pkt + i + 8, NULL);
 				debug("Blocksize oack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
-				if (tftp_block_size > tftp_block_size_option) {
+				if (tftp_block_size > tftp_block_size_req) {
 					printf("Invalid blk size(=%d)\n",
 					       tftp_block_size);
 					tftp_state = STATE_INVALID_OPTION;
@@ -671,6 +740,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			tftp_complete();
 			break;
 		}
+		tftp_lend_next_block();
 
 		/*
 		 *	Acknowledge the block just received, which will prompt
@@ -739,8 +809,804 @@ static int tftp_init_load_addr(void)
 	return 0;
 }
 
+#if CONFIG_TFTP_MAX_CONNS > 1 || defined(CONFIG_MCAST_TFTP)
+/**
+ * tftp_find_option() - find an option in an OACK
+ *
+ * @pkt:	options, each a name and a value, both nul-terminated
+ * @len:	length of the options
+ * @name:	option to find
+ * Return: value of the option, or NULL if the server did not acknowledge it
+ */
+static const char *tftp_find_option(uchar *pkt, uint len, const char *name)
+{
+	char *opt = (char *)pkt, *end = (char *)pkt + len;
+	char *val;
+
+	while (opt < end) {
+		val = opt + strnlen(opt, end - opt) + 1;
+		if (val >= end || val + strnlen(val, end - val) >= end)
+			break;
+		if (!strcasecmp(opt, name))
+			return val;
+		opt = val + strlen(val) + 1;
+	}
+
+	return NULL;
+}
+
+/**
+ * tftp_get_option() - find a numeric option in an OACK
+ *
+ * @pkt:	options, each a name and a value, both nul-terminated
+ * @len:	length of the options
+ * @name:	option to find
+ * @valp:	returns the value of the option
+ * Return: true if found, false if the server did not acknowledge the option
+ */
+static bool tftp_get_option(uchar *pkt, uint len, const char *name,
+			    ulong *valp)
+{
+	const char *val = tftp_find_option(pkt, len, name);
+
+	if (!val)
+		return false;
+	*valp = dectoul(val, NULL);
+
+	return true;
+}
+#endif
+
+#if CONFIG_TFTP_MAX_CONNS > 1
+/*
+ * Parallel download
+ *
+ * With 'tftpconns' set above 1, a file is fetched over several connections
+ * at once, each loading its own part of it, so that the transfer is not
+ * limited by the round trip of a single connection. The first connection asks
+ * for the file size with the 'tsize' option. Once the server gives it, the
+ * file is split into ranges and a connection is opened for each of the others,
+ * with an 'offset' option giving the byte at which the server is to start.
+ * That option is not part of any RFC: if the server leaves it out of its OACK,
+ * the range is left to the connection before it, so that the file is still
+ * loaded, just over fewer connections.
+ *
+ * Each connection has its own port, which the UDP handler uses to find it.
+ * A single timer checks all of them for timeouts.
+ */
+
+/* Fewest blocks worth opening another connection for */
+#define TFTP_CONN_MIN_BLOCKS	64
+
+/* How often to check the connections for timeouts, in ms */
+#define TFTP_CONN_TICK		100
+
+enum tftp_conn_state {
+	CONN_IDLE,
+	CONN_SEND_RRQ,
+	CONN_DATA,
+	CONN_DONE,
+};
+
+/**
+ * struct tftp_conn - a connection of a parallel download
+ *
+ * @state:	current state
+ * @our_port:	our UDP port, which identifies the connection
+ * @remote_port: UDP port of the server, once it has replied
+ * @start:	offset in the file of the first byte to load
+ * @end:	offset in the file just past the last byte to load, or
+ *		ULONG_MAX to load up to the end of the file
+ * @pos:	offset in the file of the next byte to be received
+ * @blksize:	block size agreed with the server
+ * @windowsize:	window size agreed with the server
+ * @block:	number of the last block received
+ * @next_ack:	number of the block after which to send an ACK
+ * @last_nack:	number of the last block acknowledged after a lost one
+ * @last_time:	time of the last packet received or resent, in ms
+ * @retries:	number of timeouts since the last packet received
+ */
+struct tftp_conn {
+	enum tftp_conn_state state;
+	int our_port;
+	int remote_port;
+	ulong start;
+	ulong end;
+	ulong pos;
+	ushort blksize;
+	ushort windowsize;
+	ushort block;
+	ushort next_ack;
+	ushort last_nack;
+	ulong last_time;
+	int retries;
+};
+
+static struct tftp_conn tftp_conns[CONFIG_TFTP_MAX_CONNS];
+/* Number of connections to use, from 'tftpconns' */
+static int tftp_num_conns;
+/* Size of the file as given by the server, 0 if not known */
+static ulong tftp_conns_size;
+/* Number of bytes received and hash marks shown */
+static ulong tftp_conns_received;
+static ulong tftp_conns_num_hash;
+
+static void tftp_conn_send(struct tftp_conn *conn, uchar *xp, uchar *pkt)
+{
+	tftp_send_udp(conn->remote_port, conn->our_port, pkt - xp);
+}
+
+static void tftp_conn_send_rrq(struct tftp_conn *conn)
+{
+	uchar *xp, *pkt;
+
+	xp = net_tx_packet + net_eth_hdr_size() + net_ip_udp_hdr_size();
+	pkt = xp;
+	put_unaligned_be16(TFTP_RRQ, pkt);
+	pkt += 2;
+	pkt += sprintf((char *)pkt, "%s%coctet%ctimeout%c%lu%cblksize%c%d",
+		       tftp_filename, 0, 0, 0, timeout_ms / 1000, 0, 0,
+		       tftp_block_size_req) + 1;
+	if (tftp_window_size_option > 1)
+		pkt += sprintf((char *)pkt, "windowsize%c%d", 0,
+			       tftp_window_size_option) + 1;
+	if (conn == tftp_conns)
+		pkt += sprintf((char *)pkt, "tsize%c0", 0) + 1;
+	else
+		pkt += sprintf((char *)pkt, "offset%c%lu", 0, conn->start) + 1;
+	tftp_conn_send(conn, xp, pkt);
+}
+
+static void tftp_conn_send_ack(struct tftp_conn *conn)
+{
+	uchar *xp, *pkt;
+
+	xp = net_tx_packet + net_eth_hdr_size() + net_ip_udp_hdr_size();
+	pkt = xp;
+	put_unaligned_be16(TFTP_ACK, pkt);
+	put_unaligned_be16(conn->block, pkt + 2);
+	tftp_conn_send(conn, xp, pkt + 4);
+}
+
+/* Send an error to the server, which ends the connection */
+static void tftp_conn_send_error(struct tftp_conn *conn, int code,
+				 const char *msg)
+{
+	uchar *xp, *pkt;
+
+	xp = net_tx_packet + net_eth_hdr_size() + net_ip_udp_hdr_size();
+	pkt = xp;
+	put_unaligned_be16(TFTP_ERROR, pkt);
+	put_unaligned_be16(code, pkt + 2);
+	pkt += 4;
+	pkt += sprintf((char *)pkt, "%s", msg) + 1;
+	tftp_conn_send(conn, xp, pkt);
+	conn->state = CONN_DONE;
+}
+
+/* Split the file into ranges and open a connection for each */
+static void tftp_conns_split(struct tftp_conn *first)
+{
+	ulong chunk, min_size;
+	int i, num;
+
+	min_size = (ulong)first->blksize * TFTP_CONN_MIN_BLOCKS;
+	num = min_t(ulong, tftp_num_conns,
+		    DIV_ROUND_UP(tftp_conns_size, min_size));
+	if (num < 2)
+		return;
+	chunk = roundup(DIV_ROUND_UP(tftp_conns_size, num), first->blksize);
+	debug("TFTP: %d connections of %lu bytes\n", num, chunk);
+
+	first->end = chunk;
+	for (i = 1; i < num && i * chunk < tftp_conns_size; i++) {
+		struct tftp_conn *conn = &tftp_conns[i];
+
+		conn->state = CONN_SEND_RRQ;
+		conn->start = i * chunk;
+		conn->pos = conn->start;
+		/* The last connection reads to the end, however long it is */
+		conn->end = i == num - 1 ? ULONG_MAX : conn->start + chunk;
+		conn->last_time = get_timer(0);
+		tftp_conn_send_rrq(conn);
+	}
+}
+
+/*
+ * The server does not support the 'offset' option, so give this connection's
+ * range to the connection loading the range before it
+ */
+static int tftp_conn_no_offset(struct tftp_conn *conn)
+{
+	int i;
+
+	printf("\nTFTP server ignores 'offset'; using fewer connections\n");
+	tftp_conn_send_error(conn, TFTP_ERR_OPTION_NEGOTIATION,
+			     "Option Negotiation Failed");
+	for (i = 0; i < tftp_num_conns; i++) {
+		struct tftp_conn *prev = &tftp_conns[i];
+
+		if (prev->state != CONN_IDLE && prev->state != CONN_DONE &&
+		    prev->end == conn->start) {
+			prev->end = conn->end;
+			return 0;
+		}
+	}
+	puts("TFTP error: part of the file was not loaded; set tftpconns to 1\n");
+
+	return -EPROTONOSUPPORT;
+}
+
+static void tftp_conns_progress(struct tftp_conn *conn, uint len)
+{
+	ulong hashes;
+
+	tftp_conns_received += len;
+	if (!tftp_conns_size) {
+		if (!(conn->block % 10))
+			putc('#');
+		return;
+	}
+	hashes = min(tftp_conns_received * 50 / tftp_conns_size, 50UL);
+	while (tftp_conns_num_hash < hashes) {
+		putc('#');
+		tftp_conns_num_hash++;
+	}
+}
+
+static void tftp_conns_fail(void)
+{
+	eth_halt();
+	net_set_state(NETLOOP_FAIL);
+}
+
+/* Check whether all connections are done, and if so report success */
+static void tftp_conns_check_done(void)
+{
+	int i;
+
+	for (i = 0; i < tftp_num_conns; i++) {
+		if (tftp_conns[i].state != CONN_IDLE &&
+		    tftp_conns[i].state != CONN_DONE)
+			return;
+	}
+	puts("  ");
+	print_size(net_boot_file_size, "");
+	tftp_finish();
+}
+
+static void tftp_conn_oack(struct tftp_conn *conn, uchar *pkt, uint len)
+{
+	ulong val;
+
+	if (tftp_get_option(pkt, len, "timeout", &val) &&
+	    val != timeout_ms / 1000) {
+		printf("Invalid timeout val(=%ld s)\n", val);
+		goto bad_option;
+	}
+	if (tftp_get_option(pkt, len, "blksize", &val)) {
+		if (!val || val > tftp_block_size_req) {
+			printf("Invalid blk size(=%ld)\n", val);
+			goto bad_option;
+		}
+		conn->blksize = val;
+	}
+	if (tftp_get_option(pkt, len, "windowsize", &val) && val)
+		conn->windowsize = val;
+	conn->next_ack = conn->windowsize;
+	conn->state = CONN_DATA;
+
+	if (conn == tftp_conns) {
+		if (tftp_get_option(pkt, len, "tsize", &val))
+			tftp_conns_size = val;
+		tftp_conn_send_ack(conn);
+		if (tftp_conns_size)
+			tftp_conns_split(conn);
+		return;
+	}
+	if (!tftp_get_option(pkt, len, "offset", &val) || val != conn->start) {
+		if (tftp_conn_no_offset(conn))
+			tftp_conns_fail();
+		return;
+	}
+	tftp_conn_send_ack(conn);
+	return;
+
+bad_option:
+	tftp_conn_send_error(conn, TFTP_ERR_OPTION_NEGOTIATION,
+			     "Option Negotiation Failed");
+	tftp_conns_fail();
+}
+
+static void tftp_conn_data(struct tftp_conn *conn, uchar *pkt, uint len)
+{
+	ushort block;
+	uint count;
+
+	if (len < 2)
+		return;
+	block = get_unaligned_be16(pkt);
+	pkt += 2;
+	len -= 2;
+
+	if (conn->state == CONN_SEND_RRQ) {
+		/* The server ignored all our options */
+		if (conn != tftp_conns) {
+			if (tftp_conn_no_offset(conn))
+				tftp_conns_fail();
+			return;
+		}
+		conn->state = CONN_DATA;
+		conn->next_ack = conn->windowsize;
+	}
+
+	if (block != (ushort)(conn->block + 1)) {
+		debug("Received unexpected block: %d, expected: %d\n", block,
+		      (ushort)(conn->block + 1));
+		/* Ask for the lost block, but only once per window */
+		if (conn->last_nack != conn->block) {
+			tftp_conn_send_ack(conn);
+			conn->last_nack = conn->block;
+			conn->next_ack = conn->block + conn->windowsize;
+		}
+		return;
+	}
+	conn->block = block;
+	conn->retries = 0;
+	conn->last_time = get_timer(0);
+
+	count = min_t(ulong, len, conn->end - conn->pos);
+	if (tftp_store(conn->pos, pkt, count)) {
+		tftp_conns_fail();
+		return;
+	}
+	conn->pos += count;
+	tftp_conns_progress(conn, count);
+
+	if (len < conn->blksize) {
+		/* End of the file */
+		tftp_conn_send_ack(conn);
+		conn->state = CONN_DONE;
+		tftp_conns_check_done();
+	} else if (conn->pos >= conn->end) {
+		/* End of the range; the next connection loads the rest */
+		tftp_conn_send_error(conn, TFTP_ERR_UNDEFINED,
+				     "Range complete");
+		tftp_conns_check_done();
+	} else if (block == conn->next_ack) {
+		tftp_conn_send_ack(conn);
+		conn->next_ack += conn->windowsize;
+	}
+}
+
+static void tftp_conns_handler(uchar *pkt, unsigned dest, struct in_addr sip,
+			       unsigned src, unsigned len)
+{
+	struct tftp_conn *conn = NULL;
+	int i;
+
+	for (i = 0; i < tftp_num_conns; i++) {
+		if (tftp_conns[i].our_port == dest)
+			conn = &tftp_conns[i];
+	}
+	if (!conn || conn->state == CONN_IDLE || conn->state == CONN_DONE)
+		return;
+	if (conn->state == CONN_SEND_RRQ)
+		conn->remote_port = src;
+	else if (src != conn->remote_port)
+		return;
+	if (len < 2)
+		return;
+
+	switch (get_unaligned_be16(pkt)) {
+	case TFTP_OACK:
+		if (conn->state == CONN_SEND_RRQ)
+			tftp_conn_oack(conn, pkt + 2, len - 2);
+		break;
+	case TFTP_DATA:
+		tftp_conn_data(conn, pkt + 2, len - 2);
+		break;
+	case TFTP_ERROR:
+		if (len < 4)
+			break;
+		printf("\nTFTP error: '%s' (%d)\n", (char *)pkt + 4,
+		       get_unaligned_be16(pkt + 2));
+		switch (get_unaligned_be16(pkt + 2)) {
+		case TFTP_ERR_FILE_NOT_FOUND:
+		case TFTP_ERR_ACCESS_DENIED:
+			puts("Not retrying...\n");
+			tftp_conns_fail();
+			break;
+		default:
+			puts("Starting again\n\n");
+			net_start_again();
+			break;
+		}
+		break;
+	}
+}
+
+static void tftp_conns_timeout_handler(void)
+{
+	int i;
+
+	for (i = 0; i < tftp_num_conns; i++) {
+		struct tftp_conn *conn = &tftp_conns[i];
+
+		if (conn->state != CONN_SEND_RRQ && conn->state != CONN_DATA)
+			continue;
+		if (get_timer(conn->last_time) < timeout_ms)
+			continue;
+		if (++conn->retries > timeout_count_max) {
+			restart("Retry count exceeded");
+			return;
+		}
+		puts("T ");
+		conn->last_time = get_timer(0);
+		if (conn->state == CONN_SEND_RRQ) {
+			tftp_conn_send_rrq(conn);
+		} else {
+			tftp_conn_send_ack(conn);
+			conn->next_ack = conn->block + conn->windowsize;
+		}
+	}
+	net_set_timeout_handler(TFTP_CONN_TICK, tftp_conns_timeout_handler);
+}
+
+/* Start a parallel download, with the remote port and our first port given */
+static void tftp_conns_start(int remote_port, int our_port)
+{
+	int i;
+
+	memset(tftp_conns, '\0', sizeof(tftp_conns));
+	for (i = 0; i < tftp_num_conns; i++) {
+		struct tftp_conn *conn = &tftp_conns[i];
+
+		conn->our_port = our_port + i;
+		conn->remote_port = remote_port;
+		conn->blksize = TFTP_BLOCK_SIZE;
+		conn->windowsize = 1;
+	}
+	tftp_conns_size = 0;
+	tftp_conns_received = 0;
+	tftp_conns_num_hash = 0;
+
+	/* Open the first connection, which finds the file size */
+	tftp_conns[0].state = CONN_SEND_RRQ;
+	tftp_conns[0].end = ULONG_MAX;
+	tftp_conns[0].last_time = get_timer(0);
+
+	net_set_timeout_handler(TFTP_CONN_TICK, tftp_conns_timeout_handler);
+	net_set_udp_handler(tftp_conns_handler);
+	tftp_conn_send_rrq(&tftp_conns[0]);
+}
+#endif /* CONFIG_TFTP_MAX_CONNS > 1 */
+
+#ifdef CONFIG_MCAST_TFTP
+/*
+ * Multicast download (RFC 2090)
+ *
+ * With 'tftpmcast' set, the read request asks for the 'multicast' option. A
+ * server which supports it gives a group and port in its OACK and sends the
+ * blocks of the file to that group, so that any number of boards loading the
+ * file at the same time share one stream. The server makes one client the
+ * master, which acknowledges blocks as usual; the others just listen, noting
+ * in a bitmap which blocks they have.
+ *
+ * A client which joins part-way through, or loses blocks, asks for what it
+ * lacks over unicast once the server makes it master: it acknowledges the
+ * block before the first one missing, and the server sends on from there. A
+ * client which hears nothing for a while sends its request again, to remind
+ * the server that it is waiting. Each client acknowledges the last block
+ * once it has the whole file, so that the server can pick another master.
+ *
+ * A server which ignores the option just sends the file to us, which works
+ * as a group of one with us as master.
+ */
+
+/* Blocks received, by number */
+static ulong tftp_mcast_bitmap[BITS_TO_LONGS(TFTP_SEQUENCE_SIZE)];
+/* Number of blocks in the file, 0 if not yet known */
+static ulong tftp_mcast_blocks;
+/* Number of blocks received without a gap from the start of the file */
+static ulong tftp_mcast_done;
+/* Number of blocks received */
+static ulong tftp_mcast_count;
+/* Port to which multicast data is sent, 0 if not in a group */
+static int tftp_mcast_port;
+/* Server port to which read requests go */
+static int tftp_mcast_rrq_port;
+/* Whether we acknowledge blocks, as master client or over unicast */
+static bool tftp_mcast_master;
+/* Use multicast for the next download, from 'tftpmcast' */
+static bool tftp_mcast_enabled;
+
+static void tftp_mcast_timeout_handler(void);
+
+static void tftp_mcast_send_rrq(void)
+{
+	uchar *xp, *pkt;
+
+	xp = net_tx_packet + net_eth_hdr_size() + IP_UDP_HDR_SIZE;
+	pkt = xp;
+	put_unaligned_be16(TFTP_RRQ, pkt);
+	pkt += 2;
+	pkt += sprintf((char *)pkt, "%s%coctet%ctimeout%c%lu%cblksize%c%d",
+		       tftp_filename, 0, 0, 0, timeout_ms / 1000, 0, 0,
+		       tftp_block_size_req) + 1;
+	pkt += sprintf((char *)pkt, "tsize%c0", 0) + 1;
+	pkt += sprintf((char *)pkt, "multicast") + 2;
+	net_send_udp_packet(net_server_ethaddr, tftp_remote_ip,
+			    tftp_mcast_rrq_port, tftp_our_port, pkt - xp);
+}
+
+static void tftp_mcast_send_ack(ulong block)
+{
+	uchar *pkt;
+
+	pkt = net_tx_packet + net_eth_hdr_size() + IP_UDP_HDR_SIZE;
+	put_unaligned_be16(TFTP_ACK, pkt);
+	put_unaligned_be16(block, pkt + 2);
+	net_send_udp_packet(net_server_ethaddr, tftp_remote_ip,
+			    tftp_remote_port, tftp_our_port, 4);
+}
+
+/* Leave the multicast group, if we are in one */
+static void tftp_mcast_leave(void)
+{
+	if (net_mcast_addr.s_addr)
+		eth_mcast_join(net_mcast_addr, 0);
+	net_mcast_addr.s_addr = 0;
+	tftp_mcast_port = 0;
+}
+
+static void tftp_mcast_fail(void)
+{
+	tftp_mcast_leave();
+	eth_halt();
+	net_set_state(NETLOOP_FAIL);
+}
+
+/*
+ * Handle the 'multicast' option, "<group>,<port>,<mc>", where the group and
+ * port may be left out if they are unchanged and mc is 1 for the master
+ */
+static int tftp_mcast_option(const char *val)
+{
+	struct in_addr group = net_mcast_addr;
+	const char *port;
+
+	port = strchr(val, ',');
+	if (!port || !strchr(port + 1, ','))
+		return -EINVAL;
+	if (*val != ',')
+		group = string_to_ip(val);
+	if (port[1] != ',')
+		tftp_mcast_port = dectoul(port + 1, NULL);
+	tftp_mcast_master = *(strchr(port + 1, ',') + 1) == '1';
+	if (!group.s_addr || !tftp_mcast_port)
+		return -EINVAL;
+
+	if (group.s_addr != net_mcast_addr.s_addr) {
+		int ret;
+
+		if (net_mcast_addr.s_addr)
+			eth_mcast_join(net_mcast_addr, 0);
+		net_mcast_addr.s_addr = 0;
+		/* Devices without a filter receive every group anyway */
+		ret = eth_mcast_join(group, 1);
+		if (ret && ret != -ENOSYS) {
+			printf("\nTFTP: cannot join group %pI4 (err=%d)\n",
+			       &group, ret);
+			return -EADDRNOTAVAIL;
+		}
+		net_mcast_addr = group;
+	}
+
+	return 0;
+}
+
+/*
+ * End a session whose multicast group we cannot receive and load the file
+ * over unicast instead
+ */
+static void tftp_mcast_unicast(void)
+{
+	puts("Loading over unicast\n");
+	tftp_state = STATE_INVALID_OPTION;
+	tftp_send();
+	tftp_mcast_leave();
+
+	/* Start afresh from a new port, so that the old session is ignored */
+	tftp_remote_port = tftp_mcast_rrq_port;
+	tftp_our_port++;
+	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_cur_block = 0;
+	timeout_count = 0;
+	tftp_state = STATE_SEND_RRQ;
+	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+	net_set_udp_handler(tftp_handler);
+	tftp_send();
+}
+
+static void tftp_mcast_oack(uchar *pkt, uint len)
+{
+	const char *mcast;
+	ulong val;
+
+	if (tftp_get_option(pkt, len, "timeout", &val) &&
+	    val != timeout_ms / 1000) {
+		printf("Invalid timeout val(=%ld s)\n", val);
+		goto bad_option;
+	}
+	if (tftp_state == STATE_SEND_RRQ &&
+	    tftp_get_option(pkt, len, "blksize", &val)) {
+		if (!val || val > tftp_block_size_req) {
+			printf("Invalid blk size(=%ld)\n", val);
+			goto bad_option;
+		}
+		tftp_block_size = val;
+	}
+	if (!tftp_mcast_blocks && tftp_get_option(pkt, len, "tsize", &val)) {
+		tftp_mcast_blocks = val / tftp_block_size + 1;
+		if (tftp_mcast_blocks >= TFTP_SEQUENCE_SIZE) {
+			puts("\nTFTP error: file too large for multicast\n");
+			goto bad_option;
+		}
+	}
+
+	mcast = tftp_find_option(pkt, len, "multicast");
+	if (mcast) {
+		int ret = tftp_mcast_option(mcast);
+
+		if (ret == -EADDRNOTAVAIL) {
+			tftp_mcast_unicast();
+			return;
+		} else if (ret) {
+			printf("Invalid multicast option '%s'\n", mcast);
+			goto bad_option;
+		}
+	} else {
+		tftp_mcast_master = true;
+	}
+	tftp_state = STATE_DATA;
+
+	/* Ask for the first block we do not have */
+	if (tftp_mcast_master)
+		tftp_mcast_send_ack(tftp_mcast_done);
+	return;
+
+bad_option:
+	tftp_state = STATE_INVALID_OPTION;
+	tftp_send();
+	tftp_mcast_leave();
+}
+
+static void tftp_mcast_data(uchar *pkt, uint len)
+{
+	ulong block;
+
+	if (len < 2)
+		return;
+	block = get_unaligned_be16(pkt);
+	pkt += 2;
+	len -= 2;
+
+	if (tftp_state == STATE_SEND_RRQ) {
+		/* The server ignored all our options */
+		tftp_state = STATE_DATA;
+		tftp_mcast_master = true;
+	}
+	if (!block || (tftp_mcast_blocks && block > tftp_mcast_blocks))
+		return;
+
+	if (!test_bit(block, tftp_mcast_bitmap)) {
+		if (tftp_store((block - 1) * tftp_block_size, pkt, len)) {
+			tftp_mcast_fail();
+			return;
+		}
+		set_bit(block, tftp_mcast_bitmap);
+		tftp_mcast_count++;
+		if (!(tftp_mcast_count % 10))
+			putc('#');
+		if (len < tftp_block_size)
+			tftp_mcast_blocks = block;
+		while (tftp_mcast_done + 1 < TFTP_SEQUENCE_SIZE &&
+		       test_bit(tftp_mcast_done + 1, tftp_mcast_bitmap))
+			tftp_mcast_done++;
+		timeout_count = 0;
+		net_set_timeout_handler(timeout_ms,
+					tftp_mcast_timeout_handler);
+	}
+
+	if (tftp_mcast_blocks && tftp_mcast_done == tftp_mcast_blocks) {
+		/* Let the server know that we are done */
+		tftp_mcast_send_ack(tftp_mcast_blocks);
+		tftp_mcast_leave();
+		puts("  ");
+		print_size(net_boot_file_size, "");
+		tftp_finish();
+	} else if (tftp_mcast_master) {
+		tftp_mcast_send_ack(tftp_mcast_done);
+	}
+}
+
+static void tftp_mcast_handler(uchar *pkt, unsigned dest, struct in_addr sip,
+			       unsigned src, unsigned len)
+{
+	if (dest != tftp_our_port &&
+	    (!tftp_mcast_port || dest != tftp_mcast_port))
+		return;
+	if (tftp_state == STATE_SEND_RRQ)
+		tftp_remote_port = src;
+	else if (src != tftp_remote_port)
+		return;
+	if (len < 2)
+		return;
+
+	switch (get_unaligned_be16(pkt)) {
+	case TFTP_OACK:
+		tftp_mcast_oack(pkt + 2, len - 2);
+		break;
+	case TFTP_DATA:
+		tftp_mcast_data(pkt + 2, len - 2);
+		break;
+	case TFTP_ERROR:
+		if (len < 4)
+			break;
+		printf("\nTFTP error: '%s' (%d)\n", (char *)pkt + 4,
+		       get_unaligned_be16(pkt + 2));
+		switch (get_unaligned_be16(pkt + 2)) {
+		case TFTP_ERR_FILE_NOT_FOUND:
+		case TFTP_ERR_ACCESS_DENIED:
+			puts("Not retrying...\n");
+			tftp_mcast_fail();
+			break;
+		default:
+			puts("Starting again\n\n");
+			tftp_mcast_leave();
+			net_start_again();
+			break;
+		}
+		break;
+	}
+}
+
+/* Ask for what is missing, or remind the server that we are waiting */
+static void tftp_mcast_timeout_handler(void)
+{
+	if (++timeout_count > timeout_count_max) {
+		tftp_mcast_leave();
+		restart("Retry count exceeded");
+		return;
+	}
+	puts("T ");
+	net_set_timeout_handler(timeout_ms, tftp_mcast_timeout_handler);
+	if (tftp_state == STATE_DATA && tftp_mcast_master)
+		tftp_mcast_send_ack(tftp_mcast_done);
+	else
+		tftp_mcast_send_rrq();
+}
+
+static void tftp_mcast_start(void)
+{
+	memset(tftp_mcast_bitmap, '\0', sizeof(tftp_mcast_bitmap));
+	tftp_mcast_blocks = 0;
+	tftp_mcast_done = 0;
+	tftp_mcast_count = 0;
+	tftp_mcast_master = false;
+	tftp_mcast_rrq_port = tftp_remote_port;
+	tftp_mcast_leave();
+
+	net_set_timeout_handler(timeout_ms, tftp_mcast_timeout_handler);
+	net_set_udp_handler(tftp_mcast_handler);
+	tftp_mcast_send_rrq();
+}
+#endif /* CONFIG_MCAST_TFTP */
+
 void tftp_start(enum proto_t protocol)
 {
+	int ret;
 #if CONFIG_NET_TFTP_VARS
 	char *ep;             /* Environment pointer */
 
@@ -778,11 +1644,38 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
+#if CONFIG_TFTP_MAX_CONNS > 1
+	tftp_num_conns = clamp_t(ulong, env_get_ulong("tftpconns", 10, 1), 1,
+				 CONFIG_TFTP_MAX_CONNS);
+#endif
+#ifdef CONFIG_MCAST_TFTP
+	tftp_mcast_enabled = env_get_yesno("tftpmcast") == 1;
+#endif
+
+	tftp_block_size_req = tftp_block_size_option;
+	if (net_use_ip6)
+		tftp_block_size_req = min_t(unsigned short, tftp_block_size_req,
+					    TFTP_BLOCK_SIZE_IP6_MAX);
+
 	debug("TFTP blocksize = %i, TFTP windowsize = %d timeout = %ld ms\n",
-	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
+	      tftp_block_size_req, tftp_window_size_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
-	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
+#ifdef CONFIG_IPV6
+	tftp_remote_ip6 = net_server_ip6;
+	if (net_use_ip6)
+		ret = net_parse_bootfile6(&tftp_remote_ip6, tftp_filename,
+					  MAX_LEN);
+	else
+#endif
+		ret = net_parse_bootfile(&tftp_remote_ip, tftp_filename,
+					 MAX_LEN);
+	if (ret < 0) {
+		puts("*** ERROR: bad server address in file name\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	if (!ret) {
 		sprintf(default_filename, "%02X%02X%02X%02X.img",
 			net_ip.s_addr & 0xFF,
 			(net_ip.s_addr >>  8) & 0xFF,
@@ -797,6 +1690,13 @@ void tftp_start(enum proto_t protocol)
 	}
 
 	printf("Using %s device\n", eth_get_name());
+#ifdef CONFIG_IPV6
+	if (net_use_ip6) {
+		printf("TFTP %s server %pI6c; our IPv6 address is %pI6c",
+		       protocol == TFTPPUT ? "to" : "from", &tftp_remote_ip6,
+		       net_ip6_src(&tftp_remote_ip6));
+	} else
+#endif
 	printf("TFTP %s server %pI4; our IP address is %pI4",
 #ifdef CONFIG_CMD_TFTPPUT
 	       protocol == TFTPPUT ? "to" : "from",
@@ -806,7 +1706,7 @@ void tftp_start(enum proto_t protocol)
 	       &tftp_remote_ip, &net_ip);
 
 	/* Check if we need to send across this subnet */
-	if (net_gateway.s_addr && net_netmask.s_addr) {
+	if (!net_use_ip6 && net_gateway.s_addr && net_netmask.s_addr) {
 		struct in_addr our_net;
 		struct in_addr remote_net;
 
@@ -883,6 +1783,18 @@ void tftp_start(enum proto_t protocol)
 	tftp_tsize_num_hash = 0;
 #endif
 
+#ifdef CONFIG_MCAST_TFTP
+	if (protocol == TFTPGET && tftp_mcast_enabled && !net_use_ip6) {
+		tftp_mcast_start();
+		return;
+	}
+#endif
+#if CONFIG_TFTP_MAX_CONNS > 1
+	if (protocol == TFTPGET && tftp_num_conns > 1) {
+		tftp_conns_start(tftp_remote_port, tftp_our_port);
+		return;
+	}
+#endif
 	tftp_send();
 }
 
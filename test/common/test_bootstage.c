@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for bootstage export
+ */
+
+#include <common.h>
+#include <bootstage.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+static int test_bootstage_export(struct unit_test_state *uts)
+{
+	char buf[4096];
+	char *p;
+	int len;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DECOMP, "decomp");
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DECOMP);
+	bootstage_accum_name("test_probe", timer_get_boot_us() - 100);
+
+	len = bootstage_export_json(buf, sizeof(buf));
+	ut_assert(len > 0);
+	ut_asserteq(len, strlen(buf));
+	ut_asserteq_strn("{\"version\":1,\"records\":[\n{\"id\":0,", buf);
+	ut_asserteq_str("\n]}\n", buf + len - 4);
+	ut_assertnonnull(strstr(buf, "\"name\":\"reset\",\"mark\":0}"));
+	ut_assertnonnull(strstr(buf, "\"name\":\"test_probe\",\"accum\":"));
+
+	/* A second call accumulates into the same record */
+	bootstage_accum_name("test_probe", timer_get_boot_us() - 100);
+	len = bootstage_export_json(buf, sizeof(buf));
+	ut_assert(len > 0);
+	p = strstr(buf, "\"test_probe\"");
+	ut_assertnonnull(p);
+	ut_assertnull(strstr(p + 1, "\"test_probe\""));
+
+	ut_asserteq(-ENOSPC, bootstage_export_json(buf, len));
+
+	return 0;
+}
+COMMON_TEST(test_bootstage_export, 0);
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for DFU writes, using the RAM back end
+ */
+
+#include <common.h>
+#include <dfu.h>
+#include <env.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <linux/sizes.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define TEST_DFU_SIZE	SZ_4M
+#define TEST_DFU_CHUNK	4096
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _test_dfu_write(struct unit_test_state *uts, u8 *src, u8 *dst)
+{
+	struct dfu_entity *dfu;
+	char alt_info[64];
+	int i;
+
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	for (i = 0; i < TEST_DFU_SIZE; i++)
+		src[i] = i ^ (i >> 12);
+
+	/* Make the buffer fill several times */
+	ut_assertok(env_set("dfu_bufsiz", "0x40000"));
+	snprintf(alt_info, sizeof(alt_info), "test ram %lx %x",
+		 (ulong)map_to_sysmem(dst), TEST_DFU_SIZE);
+	ut_assertok(dfu_config_entities(alt_info, "ram", "0"));
+	dfu = dfu_get_entity(0);
+	ut_assertnonnull(dfu);
+
+	/* Small chunks, as received over USB, with polls in between */
+	memset(dst, '\0', TEST_DFU_SIZE);
+	for (i = 0; i < TEST_DFU_SIZE / TEST_DFU_CHUNK; i++) {
+		ut_assertok(dfu_write(dfu, src + i * TEST_DFU_CHUNK,
+				      TEST_DFU_CHUNK, i));
+		ut_assertok(dfu_write_poll());
+	}
+	ut_assertok(dfu_flush(dfu, NULL, 0, i));
+	ut_asserteq_mem(src, dst, TEST_DFU_SIZE);
+
+	/* Whole buffers from memory, which may skip the copy */
+	memset(dst, '\0', TEST_DFU_SIZE);
+	ut_assertok(dfu_write_from_mem_addr(dfu, src, TEST_DFU_SIZE));
+	ut_asserteq_mem(src, dst, TEST_DFU_SIZE);
+
+	/* A short last chunk goes through the buffer */
+	memset(dst, '\0', TEST_DFU_SIZE);
+	ut_assertok(dfu_write_from_mem_addr(dfu, src, SZ_1M + 100));
+	ut_asserteq_mem(src, dst, SZ_1M + 100);
+	ut_asserteq(0, dst[SZ_1M + 100]);
+
+	return 0;
+}
+
+static int test_dfu_write(struct unit_test_state *uts)
+{
+	u8 *src, *dst;
+	int retval;
+
+	src = memalign(ARCH_DMA_MINALIGN, TEST_DFU_SIZE);
+	dst = malloc(TEST_DFU_SIZE);
+
+	retval = _test_dfu_write(uts, src, dst);
+
+	/* Restore the env */
+	dfu_free_entities();
+	env_set("dfu_bufsiz", NULL);
+	free(dst);
+	free(src);
+
+	return retval;
+}
+COMMON_TEST(test_dfu_write, 0);
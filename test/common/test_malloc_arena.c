@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for malloc() arenas
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <malloc_arena.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define TEST_ARENA_COUNT	1000
+
+static int test_malloc_arena(struct unit_test_state *uts)
+{
+	struct malloc_arena_stats *stats;
+	struct malloc_arena *arena;
+	void *ptrs[TEST_ARENA_COUNT];
+	ulong heap;
+	char *str;
+	int i;
+
+	heap = mallinfo().uordblks;
+	arena = malloc_arena_create("test");
+	ut_assertnonnull(arena);
+	stats = &arena->stats;
+
+	/* Objects of one size share slabs and are aligned */
+	for (i = 0; i < TEST_ARENA_COUNT; i++) {
+		ptrs[i] = malloc_arena_alloc(arena, 24);
+		ut_assertnonnull(ptrs[i]);
+		ut_assert(IS_ALIGNED((ulong)ptrs[i], ARENA_MIN_SIZE));
+		memset(ptrs[i], i, 24);
+	}
+	ut_asserteq(TEST_ARENA_COUNT, stats->allocs);
+	ut_asserteq(TEST_ARENA_COUNT * 32, stats->in_use);
+	ut_assert(stats->slabs <= TEST_ARENA_COUNT * 32 / ARENA_SLAB_SIZE + 2);
+	ut_asserteq(stats->slabs * ARENA_SLAB_SIZE, stats->held);
+
+	/* Freeing every other object keeps the slabs */
+	for (i = 0; i < TEST_ARENA_COUNT; i += 2)
+		malloc_arena_free(arena, ptrs[i]);
+	ut_asserteq(TEST_ARENA_COUNT / 2, stats->allocs);
+	ut_asserteq(TEST_ARENA_COUNT * 32, stats->peak);
+	for (i = 1; i < TEST_ARENA_COUNT; i += 2)
+		ut_asserteq(i & 0xff, *(u8 *)ptrs[i]);
+
+	/* Freeing the rest returns all but one slab to the heap */
+	for (i = 1; i < TEST_ARENA_COUNT; i += 2)
+		malloc_arena_free(arena, ptrs[i]);
+	ut_asserteq(0, stats->allocs);
+	ut_asserteq(0, stats->in_use);
+	ut_asserteq(1, stats->slabs);
+
+	/* Large allocations come from the heap */
+	str = malloc_arena_alloc(arena, ARENA_MAX_SIZE + 1);
+	ut_assertnonnull(str);
+	ut_asserteq(ARENA_MAX_SIZE + 1, stats->in_use);
+	malloc_arena_free(arena, str);
+	ut_asserteq(0, stats->in_use);
+
+	/* Resetting the arena frees everything at once */
+	str = malloc_arena_strdup(arena, "squashfs");
+	ut_asserteq_str("squashfs", str);
+	for (i = 0; i < 100; i++)
+		ut_assertnonnull(malloc_arena_alloc(arena, 8 << (i % 8)));
+	malloc_arena_reset(arena);
+	ut_asserteq(0, stats->allocs);
+	ut_asserteq(0, stats->held);
+	ut_asserteq(0, stats->slabs);
+
+	malloc_arena_destroy(arena);
+	ut_asserteq(heap, mallinfo().uordblks);
+
+	return 0;
+}
+COMMON_TEST(test_malloc_arena, 0);
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for heap profiling
+ */
+
+#include <common.h>
+#include <command.h>
+#include <console.h>
+#include <dfu.h>
+#include <malloc.h>
+#include <malloc_profile.h>
+#include <mapmem.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define TEST_DFU_SIZE	0x10000
+#define TEST_DFU_CHUNK	4096
+
+static int test_malloc_profile(struct unit_test_state *uts)
+{
+	struct malloc_profile_stats start, stats;
+	void *ptr, *ptr2, *ptr3;
+
+	malloc_profile_get_stats(&start);
+
+	ptr = malloc(100);
+	ut_assertnonnull(ptr);
+	malloc_profile_get_stats(&stats);
+	ut_asserteq(start.count + 1, stats.count);
+	ut_asserteq(start.bytes + 100, stats.bytes);
+	ut_asserteq(1, malloc_profile_leaks(start.seq, false));
+
+	/* A reallocated block is recorded once, with its new size */
+	ptr = realloc(ptr, 300);
+	ut_assertnonnull(ptr);
+	malloc_profile_get_stats(&stats);
+	ut_asserteq(start.bytes + 300, stats.bytes);
+	ut_asserteq(1, malloc_profile_leaks(start.seq, false));
+
+	ptr2 = calloc(4, 50);
+	ptr3 = memalign(ARCH_DMA_MINALIGN, 64);
+	ut_asserteq(3, malloc_profile_leaks(start.seq, false));
+
+	/* The call site holding most memory comes first */
+	console_record_reset_enable();
+	ut_assertok(run_command("malloc top 1", 0));
+	ut_assert_nextlinen("Live: ");
+	ut_assert_nextline("    Caller      Bytes   Allocs");
+	ut_assert_skipline();
+	ut_assert_console_end();
+
+	free(ptr3);
+	free(ptr2);
+	free(ptr);
+	malloc_profile_get_stats(&stats);
+	ut_asserteq(start.count, stats.count);
+	ut_asserteq(start.bytes, stats.bytes);
+	ut_asserteq(0, malloc_profile_leaks(start.seq, false));
+
+	return 0;
+}
+COMMON_TEST(test_malloc_profile, UT_TESTF_CONSOLE_REC);
+
+/* Check that repeated DFU sessions do not leak memory */
+static int test_malloc_profile_dfu(struct unit_test_state *uts)
+{
+	struct malloc_profile_stats start;
+	struct dfu_entity *dfu;
+	char alt_info[64];
+	u8 *src, *dst;
+	int i, j;
+
+	if (!IS_ENABLED(CONFIG_DFU_RAM))
+		return -EAGAIN;
+
+	src = memalign(ARCH_DMA_MINALIGN, TEST_DFU_SIZE);
+	dst = malloc(TEST_DFU_SIZE);
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	memset(src, 0x5a, TEST_DFU_SIZE);
+	snprintf(alt_info, sizeof(alt_info), "test ram %lx %x",
+		 (ulong)map_to_sysmem(dst), TEST_DFU_SIZE);
+
+	malloc_profile_get_stats(&start);
+	for (i = 0; i < 3; i++) {
+		ut_assertok(dfu_config_entities(alt_info, "ram", "0"));
+		dfu = dfu_get_entity(0);
+		ut_assertnonnull(dfu);
+		for (j = 0; j < TEST_DFU_SIZE / TEST_DFU_CHUNK; j++) {
+			ut_assertok(dfu_write(dfu, src + j * TEST_DFU_CHUNK,
+					      TEST_DFU_CHUNK, j));
+			ut_assertok(dfu_write_poll());
+		}
+		ut_assertok(dfu_flush(dfu, NULL, 0, j));
+		dfu_free_entities();
+		ut_asserteq(0, malloc_profile_leaks(start.seq, true));
+	}
+	ut_asserteq_mem(src, dst, TEST_DFU_SIZE);
+
+	free(dst);
+	free(src);
+
+	return 0;
+}
+COMMON_TEST(test_malloc_profile_dfu, 0);
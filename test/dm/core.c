@@ -1258,3 +1258,29 @@ static int dm_test_get_stats(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_get_stats, UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(DM_PROBE_STATS)
+/* Test that heap usage is recorded for each device probe */
+static int dm_test_probe_stats(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_BUS, "some-bus",
+					       &bus));
+	ut_assert(!(dev_get_flags(bus) & DM_FLAG_ACTIVATED));
+	ut_assertok(uclass_get_device_by_name(UCLASS_TEST_FDT, "c-test@5",
+					      &dev));
+	ut_asserteq_ptr(bus, dev_get_parent(dev));
+
+	/*
+	 * The bus was probed as part of the child, so counts as nested. Both
+	 * drivers allocate private data when probed.
+	 */
+	ut_assert(dev_get_flags(bus) & DM_FLAG_ACTIVATED);
+	ut_assert(bus->probe_stats.heap > 0);
+	ut_assert(dev->probe_stats.heap > 0);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_stats, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
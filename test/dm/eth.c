@@ -7,16 +7,24 @@
  */
 
 #include <common.h>
+#include <command.h>
 #include <dm.h>
 #include <env.h>
 #include <fdtdec.h>
+#include <image.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
+#include <net6.h>
+#include <stdio_dev.h>
+#include <time.h>
 #include <asm/eth.h>
+#include <asm/unaligned.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
+#include <net/pcap.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -42,6 +50,40 @@ static int dm_test_eth(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_eth, UT_TESTF_SCAN_FDT);
 
+static int dm_test_eth_stats(struct unit_test_state *uts)
+{
+	struct eth_stats *stats;
+	struct udevice *dev;
+	int i;
+
+	net_ping_ip = string_to_ip("1.1.2.2");
+	env_set("ethact", "eth@10002000");
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000", &dev));
+	stats = eth_get_stats(dev);
+	memset(stats, '\0', sizeof(*stats));
+
+	/* An ARP request and reply, then an echo request and reply */
+	ut_assertok(net_loop(PING));
+	ut_asserteq(2, stats->tx_packets);
+	ut_asserteq(2, stats->rx_packets);
+	ut_asserteq(1, stats->rx_arp);
+	ut_asserteq(1, stats->rx_icmp);
+	ut_asserteq(0, stats->rx_errors);
+	ut_asserteq(0, stats->rx_dropped);
+
+	/* Overfill the receive ring */
+	for (i = 0; i < PKTBUFSRX; i++)
+		ut_assertok(sandbox_eth_recv_arp_req(dev));
+	ut_asserteq(-EOVERFLOW, sandbox_eth_recv_arp_req(dev));
+	ut_asserteq(1, stats->rx_overruns);
+
+	ut_assertok(run_command("net stats reset", 0));
+	ut_asserteq(0, stats->tx_packets);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_stats, UT_TESTF_SCAN_FDT);
+
 static int dm_test_eth_alias(struct unit_test_state *uts)
 {
 	net_ping_ip = string_to_ip("1.1.2.2");
@@ -431,3 +473,803 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, UT_TESTF_SCAN_FDT);
+
+static int sb_tftp_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	sandbox_eth_arp_req_to_reply(dev, packet, len);
+	sandbox_eth_tftp_req_to_reply(dev, packet, len);
+
+	return 0;
+}
+
+/* Settings changed by tftp_test_setup(), and the file being served */
+struct tftp_test {
+	ulong old_load_addr;
+	char *old_ethact;
+	u8 *data;
+	int size;
+};
+
+/*
+ * Have the sandbox driver serve a test file of @size bytes, for loading to
+ * 0x100000 from 1.1.2.2. The byte at offset i is i * @mult. @handler sees
+ * each packet sent. Call tftp_test_teardown() afterwards, even on failure.
+ */
+static int tftp_test_setup(struct tftp_test *tt, int size, int mult,
+			   sandbox_eth_tx_hand_f *handler)
+{
+	const char *ethact = env_get("ethact");
+	int i;
+
+	tt->data = malloc(size);
+	if (!tt->data)
+		return -ENOMEM;
+	tt->size = size;
+	for (i = 0; i < size; i++)
+		tt->data[i] = i * mult;
+	tt->old_load_addr = image_load_addr;
+	tt->old_ethact = ethact ? strdup(ethact) : NULL;
+
+	sandbox_eth_set_tftp_file(0, tt->data, size);
+	sandbox_eth_set_tx_handler(0, handler);
+	net_server_ip = string_to_ip("1.1.2.2");
+	env_set("ethact", "eth@10002000");
+	strcpy(net_boot_file_name, "test.bin");
+	image_load_addr = 0x100000;
+
+	return 0;
+}
+
+static void tftp_test_teardown(struct tftp_test *tt)
+{
+	net_server_ip.s_addr = 0;
+	net_boot_file_name[0] = '\0';
+	image_load_addr = tt->old_load_addr;
+	sandbox_eth_set_tftp_file(0, NULL, 0);
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("ethact", tt->old_ethact);
+	free(tt->old_ethact);
+	free(tt->data);
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_tftp_copy(struct unit_test_state *uts, u8 *data,
+				  int size)
+{
+	u8 *buf;
+
+	net_rx_copied = 0;
+	ut_asserteq(size, net_loop(TFTPGET));
+
+	buf = map_sysmem(image_load_addr, size);
+	ut_asserteq_mem(data, buf, size);
+	unmap_sysmem(buf);
+
+	/*
+	 * Blocks are received in place, except the first as its headers would
+	 * go below the load address
+	 */
+	ut_asserteq(IS_ENABLED(CONFIG_NET_RX_LEND) ? CONFIG_TFTP_BLOCKSIZE : size,
+		    net_rx_copied);
+
+	return 0;
+}
+
+/* Check how much of a TFTP download is copied after being received */
+static int dm_test_eth_tftp_copy(struct unit_test_state *uts)
+{
+	struct tftp_test tt;
+	int retval;
+
+	ut_assertok(tftp_test_setup(&tt, 20 * CONFIG_TFTP_BLOCKSIZE + 100, 7,
+				    sb_tftp_handler));
+
+	retval = _dm_test_eth_tftp_copy(uts, tt.data, tt.size);
+
+	/* Restore the env */
+	tftp_test_teardown(&tt);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_tftp_copy, UT_TESTF_SCAN_FDT);
+
+/* Number of packets sent with a UDP checksum */
+static int sb_csum_count;
+
+/* Return 0 if the UDP checksum of a packet is correct */
+static uint sb_udp_csum(struct ip_udp_hdr *ip)
+{
+	static uchar buf[12 + PKTSIZE] __aligned(4);
+	int len = ntohs(ip->udp_len);
+
+	/* Put the pseudo-header in front of the UDP header and data */
+	memcpy(buf, &ip->ip_src, 8);
+	put_unaligned_be16(IPPROTO_UDP, buf + 8);
+	put_unaligned_be16(len, buf + 10);
+	memcpy(buf + 12, &ip->udp_src, len);
+
+	return compute_ip_checksum(buf, 12 + len);
+}
+
+static int sb_csum_offload_handler(struct udevice *dev, void *packet,
+				   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	/* Used by all of the ut_assert macros */
+	struct unit_test_state *uts = priv->priv;
+	int count = priv->recv_packets;
+
+	if (ntohs(eth->et_protlen) == PROT_IP && ip->ip_p == IPPROTO_UDP &&
+	    ip->udp_xsum) {
+		ut_asserteq(0, sb_udp_csum(ip));
+		sb_csum_count++;
+	}
+
+	sandbox_eth_arp_req_to_reply(dev, packet, len);
+	sandbox_eth_tftp_req_to_reply(dev, packet, len);
+
+	/* Spoil the checksum of a reply, which the device claims to check */
+	if (priv->recv_packets > count) {
+		ip = (void *)priv->recv_packet_buffer[count] + ETHER_HDR_SIZE;
+		if (ip->ip_p == IPPROTO_UDP)
+			ip->udp_xsum = htons(0x1234);
+	}
+
+	return 0;
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_csum_offload(struct unit_test_state *uts, u8 *data,
+				     int size)
+{
+	struct eth_stats *stats;
+	struct udevice *dev;
+	u8 *buf;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000", &dev));
+	stats = eth_get_stats(dev);
+	sb_csum_count = 0;
+	ut_asserteq(size, net_loop(TFTPGET));
+
+	buf = map_sysmem(image_load_addr, size);
+	ut_asserteq_mem(data, buf, size);
+	unmap_sysmem(buf);
+
+	/* The device filled in correct checksums for the acknowledgements */
+	ut_assert(sb_csum_count > 0);
+	ut_asserteq(0, stats->tx_errors);
+
+	/* The data was accepted without its checksum being checked again */
+	ut_asserteq(0, stats->rx_dropped);
+
+	return 0;
+}
+
+/* Check that checksums are left to a device which can handle them */
+static int dm_test_eth_csum_offload(struct unit_test_state *uts)
+{
+	struct tftp_test tt;
+	int retval;
+
+	ut_assertok(tftp_test_setup(&tt, 20 * CONFIG_TFTP_BLOCKSIZE + 100, 3,
+				    sb_csum_offload_handler));
+	/* Used by all of the ut_assert macros in the tx_handler */
+	sandbox_eth_set_priv(0, uts);
+	sandbox_eth_set_offload(0, ETH_OFFLOAD_TX_CSUM | ETH_OFFLOAD_RX_CSUM);
+
+	retval = _dm_test_eth_csum_offload(uts, tt.data, tt.size);
+
+	/* Restore the env */
+	sandbox_eth_set_offload(0, 0);
+	tftp_test_teardown(&tt);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_csum_offload, UT_TESTF_SCAN_FDT);
+
+#if CONFIG_TFTP_MAX_CONNS >= 3
+static int _dm_test_eth_tftp_conns(struct unit_test_state *uts, u8 *data,
+				   int size)
+{
+	struct eth_sandbox_priv *priv;
+	struct udevice *dev;
+	u8 *buf;
+
+	ut_asserteq(size, net_loop(TFTPGET));
+
+	buf = map_sysmem(image_load_addr, size);
+	ut_asserteq_mem(data, buf, size);
+	unmap_sysmem(buf);
+
+	/* The server saw three transfers, starting at different offsets */
+	ut_assertok(uclass_get_device(UCLASS_ETH, 0, &dev));
+	priv = dev_get_priv(dev);
+	ut_asserteq(0, priv->tftp_sessions[0].offset);
+	ut_assert(priv->tftp_sessions[1].offset > 0);
+	ut_assert(priv->tftp_sessions[2].offset >
+		  priv->tftp_sessions[1].offset);
+	ut_asserteq(0, priv->tftp_sessions[3].port);
+
+	return 0;
+}
+
+/* Check a TFTP download split over several connections */
+static int dm_test_eth_tftp_conns(struct unit_test_state *uts)
+{
+	struct tftp_test tt;
+	int retval;
+
+	ut_assertok(tftp_test_setup(&tt, 200 * CONFIG_TFTP_BLOCKSIZE + 100, 13,
+				    sb_tftp_handler));
+	/* The sandbox driver only queues enough replies for three */
+	env_set("tftpconns", "3");
+
+	retval = _dm_test_eth_tftp_conns(uts, tt.data, tt.size);
+
+	/* Restore the env */
+	env_set("tftpconns", NULL);
+	tftp_test_teardown(&tt);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_tftp_conns, UT_TESTF_SCAN_FDT);
+#endif
+
+#ifdef CONFIG_MCAST_TFTP
+#define MCAST_TEST_BLOCKS	31
+#define MCAST_TEST_FIRST	5
+#define MCAST_TEST_LOSS		6
+
+/* Whether the device was in a multicast group while we were sending */
+static bool sb_mcast_joined;
+
+static int sb_mcast_handler(struct udevice *dev, void *packet,
+			    unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	if (priv->mcast_groups)
+		sb_mcast_joined = true;
+
+	return sb_tftp_handler(dev, packet, len);
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_tftp_mcast(struct unit_test_state *uts, u8 *data,
+				   int size)
+{
+	struct eth_sandbox_priv *priv;
+	struct sb_tftp_mcast *mc;
+	struct udevice *dev;
+	int missing;
+	u8 *buf;
+
+	/*
+	 * Two other receivers are already in the group. We join at block 5,
+	 * then lose every sixth block.
+	 */
+	ut_assertok(uclass_get_device(UCLASS_ETH, 0, &dev));
+	priv = dev_get_priv(dev);
+	mc = &priv->tftp_mcast;
+	mc->group = string_to_ip("239.1.1.1");
+	mc->others = 2;
+	mc->first = MCAST_TEST_FIRST;
+	mc->loss = MCAST_TEST_LOSS;
+
+	env_set("tftpmcast", "y");
+	sb_mcast_joined = false;
+	ut_asserteq(size, net_loop(TFTPGET));
+
+	buf = map_sysmem(image_load_addr, size);
+	ut_asserteq_mem(data, buf, size);
+	unmap_sysmem(buf);
+
+	ut_assert(sb_mcast_joined);
+	ut_asserteq(0, priv->mcast_groups);
+	ut_asserteq(0, net_mcast_addr.s_addr);
+
+	/*
+	 * Each block went to the group once, and only the missing ones were
+	 * sent again, each asked for with one acknowledgement. The last
+	 * acknowledgement told the server that we were done.
+	 */
+	missing = MCAST_TEST_FIRST - 1 + MCAST_TEST_BLOCKS / MCAST_TEST_LOSS;
+	ut_asserteq(MCAST_TEST_BLOCKS - (MCAST_TEST_FIRST - 1) + missing,
+		    mc->sent);
+	ut_asserteq(missing + 1, mc->acks);
+	ut_asserteq(0, mc->port);
+
+	return 0;
+}
+
+/* Check a multicast download which joins late and repairs what it missed */
+static int dm_test_eth_tftp_mcast(struct unit_test_state *uts)
+{
+	struct tftp_test tt;
+	int retval;
+
+	ut_assertok(tftp_test_setup(&tt, (MCAST_TEST_BLOCKS - 1) *
+				    CONFIG_TFTP_BLOCKSIZE + 100, 11,
+				    sb_mcast_handler));
+
+	retval = _dm_test_eth_tftp_mcast(uts, tt.data, tt.size);
+
+	/* Restore the env */
+	env_set("tftpmcast", NULL);
+	tftp_test_teardown(&tt);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_tftp_mcast, UT_TESTF_SCAN_FDT);
+#endif
+
+#ifdef CONFIG_CMD_PCAP
+#define PCAP_TEST_ADDR		0x200000
+#define PCAP_TEST_SIZE		2048
+#define PCAP_TEST_SNAPLEN	64
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_pcap_ring(struct unit_test_state *uts, u8 *data,
+				  int size)
+{
+	struct pcap_filter filter = { .ip_proto = IPPROTO_UDP };
+	u64 last_us = 0, us;
+	u32 incl_len;
+	u8 *buf, *rec;
+	uint pos;
+
+	ut_assertok(pcap_init(PCAP_TEST_ADDR, PCAP_TEST_SIZE));
+	ut_assertok(pcap_set_ring(true));
+	ut_assertok(pcap_set_snaplen(PCAP_TEST_SNAPLEN));
+	ut_assertok(pcap_set_filter(&filter));
+	ut_assertok(pcap_start_stop(true));
+
+	ut_asserteq(size, net_loop(TFTPGET));
+	ut_assertok(pcap_start_stop(false));
+
+	/* The buffer holds a pcap file of the newest UDP packets, in order */
+	buf = map_sysmem(PCAP_TEST_ADDR, PCAP_TEST_SIZE);
+	ut_asserteq(0xa1b2c3d4, get_unaligned((u32 *)buf));
+	ut_asserteq(PCAP_TEST_SNAPLEN, get_unaligned((u32 *)(buf + 16)));
+	for (pos = 24; pos < env_get_hex("pcapsize", 0); pos += 16 + incl_len) {
+		rec = buf + pos;
+		us = get_unaligned((u32 *)rec) * 1000000ULL +
+			get_unaligned((u32 *)(rec + 4));
+		incl_len = get_unaligned((u32 *)(rec + 8));
+		ut_assert(us >= last_us);
+		ut_assert(incl_len <= PCAP_TEST_SNAPLEN);
+		ut_assert(incl_len <= get_unaligned((u32 *)(rec + 12)));
+		ut_asserteq(PROT_IP, get_unaligned_be16(rec + 16 + 12));
+		ut_asserteq(IPPROTO_UDP, rec[16 + ETHER_HDR_SIZE + 9]);
+		last_us = us;
+	}
+	ut_asserteq(env_get_hex("pcapsize", 0), pos);
+
+	/* The read request went long ago, to make room for later packets */
+	rec = buf + 24 + 16 + ETHER_HDR_SIZE + IP_HDR_SIZE;
+	ut_assert(get_unaligned_be16(rec + 2) != 69);
+	unmap_sysmem(buf);
+
+	return 0;
+}
+
+/* Check that a ring capture keeps the newest matching packets */
+static int dm_test_eth_pcap_ring(struct unit_test_state *uts)
+{
+	struct tftp_test tt;
+	int retval;
+
+	ut_assertok(tftp_test_setup(&tt, 20 * CONFIG_TFTP_BLOCKSIZE, 0,
+				    sb_tftp_handler));
+
+	retval = _dm_test_eth_pcap_ring(uts, tt.data, tt.size);
+
+	/* Restore the env */
+	pcap_start_stop(false);
+	pcap_set_ring(false);
+	pcap_set_snaplen(PCAP_SNAPLEN_MAX);
+	pcap_set_filter(NULL);
+	env_set("pcapsize", NULL);
+	tftp_test_teardown(&tt);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_pcap_ring, UT_TESTF_SCAN_FDT);
+#endif
+
+#ifdef CONFIG_NETCONSOLE_BATCH
+/* Netconsole packets sent, and the payload of the last one */
+static int sb_nc_count;
+static char sb_nc_text[80];
+
+static int sb_nc_handler(struct udevice *dev, void *packet, unsigned int len)
+{
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	int size;
+
+	if (ntohs(((struct ethernet_hdr *)packet)->et_protlen) != PROT_IP ||
+	    ip->ip_p != IPPROTO_UDP || ntohs(ip->udp_dst) != 6666)
+		return 0;
+
+	size = min_t(int, ntohs(ip->udp_len) - UDP_HDR_SIZE,
+		     sizeof(sb_nc_text) - 1);
+	memcpy(sb_nc_text, (void *)ip + IP_UDP_HDR_SIZE, size);
+	sb_nc_text[size] = '\0';
+	sb_nc_count++;
+
+	return 0;
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_netconsole(struct unit_test_state *uts,
+				   struct stdio_dev *nc)
+{
+	const char *line = "0123456789012345678901234567890123456789\n";
+
+	env_set("ethact", "eth@10002000");
+	ut_assertok(nc->start(nc));
+
+	/* Output is sent a line at a time */
+	sb_nc_count = 0;
+	nc->puts(nc, "abc");
+	nc->putc(nc, 'd');
+	ut_asserteq(0, sb_nc_count);
+	nc->puts(nc, "ef\ngh");
+	ut_asserteq(1, sb_nc_count);
+	ut_asserteq_str("abcdef\n", sb_nc_text);
+
+	/* A partial line is sent once it has been held long enough */
+	timer_test_add_offset(CONFIG_NETCONSOLE_FLUSH_MS);
+	nc->puts(nc, "i");
+	ut_asserteq(2, sb_nc_count);
+	ut_asserteq_str("gh", sb_nc_text);
+	ut_assertok(nc->stop(nc));
+	ut_asserteq(3, sb_nc_count);
+	ut_asserteq_str("i", sb_nc_text);
+
+	/* Output over the rate limit is dropped, leaving a gap in the numbers */
+	env_set("ncseq", "y");
+	env_set("ncrate", "60");
+	ut_assertok(nc->start(nc));
+	nc->puts(nc, line);
+	ut_asserteq(4, sb_nc_count);
+	ut_asserteq_strn("[3] 0123", sb_nc_text);
+	nc->puts(nc, line);
+	ut_asserteq(4, sb_nc_count);
+	timer_test_add_offset(1000);
+	nc->puts(nc, line);
+	ut_asserteq(5, sb_nc_count);
+	ut_asserteq_strn("[5] 0123", sb_nc_text);
+
+	/* Other settings can change without topping up the rate limit */
+	env_set("ncoutport", "6666");
+	ut_assertok(nc->start(nc));
+	nc->puts(nc, line);
+	ut_asserteq(5, sb_nc_count);
+
+	return 0;
+}
+
+/* Check that netconsole output is sent in lines, numbered and rate-limited */
+static int dm_test_eth_netconsole(struct unit_test_state *uts)
+{
+	struct stdio_dev *nc;
+	int retval;
+
+	nc = stdio_get_by_name("nc");
+	ut_assertnonnull(nc);
+	sandbox_eth_set_tx_handler(0, sb_nc_handler);
+
+	retval = _dm_test_eth_netconsole(uts, nc);
+
+	/* Restore the env */
+	env_set("ncseq", NULL);
+	env_set("ncrate", NULL);
+	env_set("ncoutport", NULL);
+	nc->start(nc);
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_netconsole, UT_TESTF_SCAN_FDT);
+#endif
+
+#ifdef CONFIG_NET_ARP_CACHE
+/* Number of ARP requests sent */
+static int sb_arp_count;
+
+static int sb_arp_count_handler(struct udevice *dev, void *packet,
+				unsigned int len)
+{
+	struct ethernet_hdr *eth = packet;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP)
+		sb_arp_count++;
+
+	return sb_tftp_handler(dev, packet, len);
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_arp_cache(struct unit_test_state *uts, u8 *data,
+				  int size)
+{
+	arp_cache_flush();
+	sb_arp_count = 0;
+	ut_asserteq(size, net_loop(TFTPGET));
+	ut_asserteq(1, sb_arp_count);
+
+	/* The second time the server's MAC address is known */
+	ut_asserteq(size, net_loop(TFTPGET));
+	ut_asserteq(1, sb_arp_count);
+
+	/* It is asked for again once it has been kept for long enough */
+	timer_test_add_offset(CONFIG_NET_ARP_CACHE_TTL * 1000);
+	ut_asserteq(size, net_loop(TFTPGET));
+	ut_asserteq(2, sb_arp_count);
+
+	return 0;
+}
+
+/* Check that ARP is not repeated for each command */
+static int dm_test_eth_arp_cache(struct unit_test_state *uts)
+{
+	struct tftp_test tt;
+	int retval;
+
+	ut_assertok(tftp_test_setup(&tt, 4 * CONFIG_TFTP_BLOCKSIZE, 5,
+				    sb_arp_count_handler));
+
+	retval = _dm_test_eth_arp_cache(uts, tt.data, tt.size);
+
+	/* Restore the env */
+	arp_cache_flush();
+	tftp_test_teardown(&tt);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_arp_cache, UT_TESTF_SCAN_FDT);
+#endif
+
+#ifdef CONFIG_DHCP_LEASE_REUSE
+/* Number of DHCP messages sent */
+static int sb_dhcp_count;
+
+static int sb_dhcp_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+
+	if (ntohs(eth->et_protlen) == PROT_IP && ip->ip_p == IPPROTO_UDP &&
+	    ntohs(ip->udp_dst) == 67)
+		sb_dhcp_count++;
+
+	return sandbox_eth_dhcp_req_to_reply(dev, packet, len);
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_dhcp_reuse(struct unit_test_state *uts)
+{
+	struct in_addr addr = string_to_ip(SB_DHCP_ADDR);
+
+	env_set("ethact", "eth@10002000");
+	env_set("autoload", "no");
+
+	/* The first time there is a discover and a request */
+	sb_dhcp_count = 0;
+	ut_assertok(net_loop(DHCP));
+	ut_asserteq(addr.s_addr, net_ip.s_addr);
+	ut_asserteq(2, sb_dhcp_count);
+
+	/* Then the lease is used again without asking */
+	sb_dhcp_count = 0;
+	ut_assertok(net_loop(DHCP));
+	ut_asserteq(addr.s_addr, net_ip.s_addr);
+	ut_asserteq(0, sb_dhcp_count);
+
+	/* After the renewal time, the same address is asked for directly */
+	timer_test_add_offset(SB_DHCP_LEASE / 2 * 1000);
+	ut_assertok(net_loop(DHCP));
+	ut_asserteq(addr.s_addr, net_ip.s_addr);
+	ut_asserteq(1, sb_dhcp_count);
+
+	return 0;
+}
+
+/* Check that a DHCP lease is used again by later commands */
+static int dm_test_eth_dhcp_reuse(struct unit_test_state *uts)
+{
+	struct in_addr old_ip = net_ip, old_netmask = net_netmask;
+	int retval;
+
+	sandbox_eth_set_tx_handler(0, sb_dhcp_handler);
+
+	retval = _dm_test_eth_dhcp_reuse(uts);
+
+	/* Restore the env */
+	env_set("autoload", NULL);
+	net_ip = old_ip;
+	net_netmask = old_netmask;
+	net_server_ip.s_addr = 0;
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_dhcp_reuse, UT_TESTF_SCAN_FDT);
+#endif
+
+#ifdef CONFIG_IPV6
+/* Check parsing and printing of IPv6 addresses */
+static int dm_test_eth_ip6_addr(struct unit_test_state *uts)
+{
+	static const char *const bad[] = {
+		"", ":", "1::2::3", "1:2:3:4:5:6:7:8:9", "12345::", "fe80::g",
+		"1:2:3:4:5:6:7",
+	};
+	struct in6_addr addr, mcast;
+	char buf[IP6_STR_LEN];
+	int i;
+
+	ut_assertok(string_to_ip6("fe80::1", 7, &addr));
+	ut_asserteq(0xfe80, ntohs(addr.s6_addr16[0]));
+	ut_asserteq(1, ntohs(addr.s6_addr16[7]));
+	sprintf(buf, "%pI6c", &addr);
+	ut_asserteq_str("fe80::1", buf);
+
+	/* The length given is used, with no terminator needed */
+	ut_assertok(string_to_ip6("2001:db8:0:0:1:0:0:1/64", 20, &addr));
+	sprintf(buf, "%pI6c", &addr);
+	ut_asserteq_str("2001:db8::1:0:0:1", buf);
+	sprintf(buf, "%pI6", &addr);
+	ut_asserteq_str("2001:0db8:0000:0000:0001:0000:0000:0001", buf);
+
+	ut_assertok(string_to_ip6("::", 2, &addr));
+	ut_assert(ip6_is_unspecified_addr(&addr));
+	sprintf(buf, "%pI6c", &addr);
+	ut_asserteq_str("::", buf);
+
+	for (i = 0; i < ARRAY_SIZE(bad); i++)
+		ut_asserteq(-EINVAL, string_to_ip6(bad[i], strlen(bad[i]),
+						   &addr));
+
+	/* Addresses made from a MAC address and from another address */
+	ip6_make_lladdr(&addr, (const u8 *)"\x00\x00\x11\x22\x33\x44");
+	sprintf(buf, "%pI6c", &addr);
+	ut_asserteq_str("fe80::200:11ff:fe22:3344", buf);
+	ip6_make_snma(&mcast, &addr);
+	sprintf(buf, "%pI6c", &mcast);
+	ut_asserteq_str("ff02::1:ff22:3344", buf);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_ip6_addr, 0);
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_ping6(struct unit_test_state *uts)
+{
+	env_set("ethact", "eth@10002000");
+	ut_assertok(string_to_ip6("fe80::1", 7, &net_ping_ip6));
+	ut_assertok(net_loop(PING6));
+
+	/* A global address is used for a destination off our link */
+	ut_assertok(string_to_ip6("2001:db8::1", 11, &net_ip6));
+	net_prefix_length = 64;
+	ut_assertok(string_to_ip6("2001:db8::2", 11, &net_ping_ip6));
+	ut_assertok(net_loop(PING6));
+
+	return 0;
+}
+
+/* Check ping6, finding the MAC address of the host by neighbour discovery */
+static int dm_test_eth_ping6(struct unit_test_state *uts)
+{
+	u32 old_prefix_length = net_prefix_length;
+	int retval;
+
+	retval = _dm_test_eth_ping6(uts);
+
+	/* Restore the env */
+	net_ip6 = net_null_addr_ip6;
+	net_ping_ip6 = net_null_addr_ip6;
+	net_prefix_length = old_prefix_length;
+
+	return retval;
+}
+DM_TEST(dm_test_eth_ping6, UT_TESTF_SCAN_FDT);
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_ndisc_slaac(struct unit_test_state *uts)
+{
+	struct eth_sandbox_priv *priv;
+	struct in6_addr prefix, addr;
+	struct udevice *dev;
+	char buf[IP6_STR_LEN + 4];
+
+	env_set("ethact", "eth@10002000");
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000", &dev));
+	priv = dev_get_priv(dev);
+	ut_assertok(net_loop(NDISC));
+
+	/* Our address is made from the advertised prefix and our MAC address */
+	ut_assertok(string_to_ip6("2001:db8::", 10, &prefix));
+	ip6_make_eui64_addr(&addr, &prefix, net_ethaddr);
+	ut_asserteq_mem(&addr, &net_ip6, IN6ADDRSZ);
+	ut_asserteq(64, net_prefix_length);
+	sprintf(buf, "%pI6c/64", &addr);
+	ut_asserteq_str(buf, env_get("ip6addr"));
+
+	/* The host is now our router */
+	ip6_make_lladdr(&addr, priv->fake_host_hwaddr);
+	ut_asserteq_mem(&addr, &net_gateway6, IN6ADDRSZ);
+
+	return 0;
+}
+
+/* Check that router advertisements give us an address and a router */
+static int dm_test_eth_ndisc_slaac(struct unit_test_state *uts)
+{
+	int retval;
+
+	net_ip6 = net_null_addr_ip6;
+	net_gateway6 = net_null_addr_ip6;
+
+	retval = _dm_test_eth_ndisc_slaac(uts);
+
+	/* Restore the env */
+	env_set("ip6addr", NULL);
+	env_set("gatewayip6", NULL);
+	net_ip6 = net_null_addr_ip6;
+	net_gateway6 = net_null_addr_ip6;
+
+	return retval;
+}
+DM_TEST(dm_test_eth_ndisc_slaac, UT_TESTF_SCAN_FDT);
+
+static int sb_tftp6_handler(struct udevice *dev, void *packet,
+			    unsigned int len)
+{
+	sandbox_eth_nd_req_to_reply(dev, packet, len);
+	sandbox_eth_tftp_req_to_reply(dev, packet, len);
+
+	return 0;
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_tftp6(struct unit_test_state *uts, u8 *data, int size)
+{
+	u8 *buf;
+
+	ut_assertok(string_to_ip6("fe80::1", 7, &net_server_ip6));
+	ut_asserteq(size, net_loop(TFTPGET));
+
+	buf = map_sysmem(image_load_addr, size);
+	ut_asserteq_mem(data, buf, size);
+	unmap_sysmem(buf);
+
+	return 0;
+}
+
+/* Check a TFTP download over IPv6 */
+static int dm_test_eth_tftp6(struct unit_test_state *uts)
+{
+	struct tftp_test tt;
+	int retval;
+
+	ut_assertok(tftp_test_setup(&tt, 20 * CONFIG_TFTP_BLOCKSIZE + 100, 11,
+				    sb_tftp6_handler));
+	net_use_ip6 = true;
+
+	retval = _dm_test_eth_tftp6(uts, tt.data, tt.size);
+
+	/* Restore the env */
+	net_use_ip6 = false;
+	net_server_ip6 = net_null_addr_ip6;
+	tftp_test_teardown(&tt);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_tftp6, UT_TESTF_SCAN_FDT);
+#endif
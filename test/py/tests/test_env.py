@@ -463,6 +463,16 @@ def test_env_ext4(state_test_env):
         response = c.run_command('env load')
         assert 'Loading Environment from EXT4... OK' in response
 
+        if c.config.buildconfig.get('config_env_save_only_changed'):
+            response = c.run_command('env save')
+            assert 'Saving Environment to EXT4... unchanged' in response
+
+            # a variable set and deleted again leaves the content as stored
+            c.run_command('setenv test_env_ext4 1')
+            c.run_command('setenv test_env_ext4')
+            response = c.run_command('env save')
+            assert 'Saving Environment to EXT4... unchanged' in response
+
         response = c.run_command('ext4ls host 0:0')
         assert '8192 uboot.env' in response
 
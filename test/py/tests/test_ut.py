@@ -3,6 +3,68 @@
 
 import os.path
 import pytest
+import re
+
+# Tests known to leave heap allocations behind with CONFIG_MALLOC_PROFILE.
+# Any other test fails if it leaks.
+ut_leaky_tests = (
+    # Environment variables set by the test, or by the command it runs
+    'bootm bootm_test_silent',
+    'bootm bootm_test_silent_var',
+    'bootm bootm_test_subst',
+    'bootm bootm_test_subst_both',
+    'bootm bootm_test_subst_var',
+    'common test_autoboot',
+    'mem mem_test_ms_b',
+    'mem mem_test_ms_cont',
+    'mem mem_test_ms_cont_end',
+    'mem mem_test_ms_l',
+    'mem mem_test_ms_limit',
+    'mem mem_test_ms_mult',
+    'mem mem_test_ms_quiet',
+    'mem mem_test_ms_s',
+    'mem mem_test_ms_w',
+    'setexpr setexpr_test_fmt',
+    'setexpr setexpr_test_int',
+    'setexpr setexpr_test_oper',
+    'setexpr setexpr_test_plus',
+    'setexpr setexpr_test_regex',
+    'setexpr setexpr_test_regex_inc',
+    'setexpr setexpr_test_str',
+    'setexpr setexpr_test_str_long',
+    'setexpr setexpr_test_str_oper',
+
+    # ethact, and filesize / fileaddr after a TFTP transfer
+    'dm dm_test_dsa',
+    'dm dm_test_eth',
+    'dm dm_test_eth_act',
+    'dm dm_test_eth_alias',
+    'dm dm_test_eth_arp_cache',
+    'dm dm_test_eth_async_arp_reply',
+    'dm dm_test_eth_async_ping_reply',
+    'dm dm_test_eth_csum_offload',
+    'dm dm_test_eth_dhcp_reuse',
+    'dm dm_test_eth_ndisc_slaac',
+    'dm dm_test_eth_netconsole',
+    'dm dm_test_eth_pcap_ring',
+    'dm dm_test_eth_ping6',
+    'dm dm_test_eth_rotate',
+    'dm dm_test_eth_stats',
+    'dm dm_test_eth_tftp6',
+    'dm dm_test_eth_tftp_conns',
+    'dm dm_test_eth_tftp_copy',
+    'dm dm_test_eth_tftp_mcast',
+    'dm dm_test_net_retry',
+    'log log_test_syslog_debug',
+    'log log_test_syslog_err',
+    'log log_test_syslog_info',
+    'log log_test_syslog_nodebug',
+    'log log_test_syslog_notice',
+    'log log_test_syslog_warning',
+
+    # The hush 'for' loop variable
+    'lib lib_test_hush_echo',
+)
 
 @pytest.mark.buildconfigspec('ut_dm')
 def test_ut_dm_init(u_boot_console):
@@ -41,3 +103,6 @@ def test_ut(u_boot_console, ut_subtest):
 
     output = u_boot_console.run_command('ut ' + ut_subtest)
     assert output.endswith('Failures: 0')
+    m = re.search(r'^Leaks: (\d+)', output, re.MULTILINE)
+    if m and ut_subtest not in ut_leaky_tests:
+        assert m.group(1) == '0', 'Test left heap allocations behind'
@@ -7,6 +7,7 @@
 #include <common.h>
 #include <console.h>
 #include <dm.h>
+#include <malloc_profile.h>
 #include <dm/root.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
@@ -224,6 +225,12 @@ static int test_pre_run(struct unit_test_state *uts, struct unit_test *test)
 	ut_set_skip_delays(uts, false);
 
 	uts->start = mallinfo();
+	if (CONFIG_IS_ENABLED(MALLOC_PROFILE)) {
+		struct malloc_profile_stats stats;
+
+		malloc_profile_get_stats(&stats);
+		uts->malloc_seq = stats.seq;
+	}
 
 	if (test->flags & UT_TESTF_SCAN_PDATA)
 		ut_assertok(dm_scan_plat(false));
@@ -261,6 +268,16 @@ static int test_post_run(struct unit_test_state *uts, struct unit_test *test)
 	if (test->flags & UT_TESTF_DM)
 		ut_assertok(dm_test_post_run(uts));
 
+	if (CONFIG_IS_ENABLED(MALLOC_PROFILE)) {
+		int leaks = malloc_profile_leaks(uts->malloc_seq, false);
+
+		if (leaks) {
+			printf("Leaked %d allocations:\n", leaks);
+			malloc_profile_leaks(uts->malloc_seq, true);
+			uts->leak_count += leaks;
+		}
+	}
+
 	return 0;
 }
 
@@ -429,6 +446,9 @@ int ut_run_list(const char *category, const char *prefix,
 
 	if (ret == -ENOENT)
 		printf("Test '%s' not found\n", select_name);
+	else if (CONFIG_IS_ENABLED(MALLOC_PROFILE))
+		printf("Leaks: %d\nFailures: %d\n", uts.leak_count,
+		       uts.fail_count);
 	else
 		printf("Failures: %d\n", uts.fail_count);
 